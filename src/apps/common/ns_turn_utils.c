@@ -47,6 +47,7 @@
 #endif
 
 #include <stdarg.h>
+#include <stdbool.h>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -562,6 +563,236 @@ static int get_syslog_level(TURN_LOG_LEVEL level) {
   return level;
 }
 
+/* Fix for Issue 24, raised by John Selbie: */
+#define MAX_RTPPRINTF_BUFFER_SIZE (1024)
+
+static void log_output(TURN_LOG_LEVEL level, const char *s, size_t len) {
+  if (!no_stdout_log) {
+    fwrite(s, len, 1, stdout);
+  }
+  /* write to syslog or to log file */
+  if (to_syslog) {
+
+#if defined(WINDOWS)
+    // TODO: add event tracing: https://docs.microsoft.com/en-us/windows/win32/etw/about-event-tracing
+    //  windows10: https://docs.microsoft.com/en-us/windows/win32/tracelogging/trace-logging-portal
+    printf("%s", s);
+#else
+    syslog(syslog_facility | get_syslog_level(level), "%s", s);
+#endif
+
+  } else {
+    log_lock();
+    set_rtpfile();
+    if (fprintf(_rtpfile, "%s", s) < 0) {
+      reset_rtpprintf();
+    } else if (fflush(_rtpfile) < 0) {
+      reset_rtpprintf();
+    }
+    log_unlock();
+  }
+}
+
+////////// ASYNC LOG ///////////
+
+/*
+ * Every logging thread formats its lines into its own single-producer ring;
+ * one writer thread drains all the rings and writes in batches. A line that
+ * does not fit into the ring is dropped and counted, the caller never waits.
+ */
+
+static int async_log = 0;
+
+#if !defined(WINDOWS)
+
+#define ASYNC_LOG_RING_SIZE (64 << 10)
+#define ASYNC_LOG_BATCH_SIZE (64 << 10)
+#define ASYNC_LOG_IDLE_NSEC (10 * 1000 * 1000)
+
+typedef struct _async_log_ring {
+  struct _async_log_ring *next;
+  _Atomic size_t head;
+  _Atomic size_t tail;
+  _Atomic uint64_t dropped;
+  uint64_t dropped_reported; /* writer thread only */
+  char data[ASYNC_LOG_RING_SIZE];
+} async_log_ring;
+
+static _Atomic(async_log_ring *) async_log_rings = NULL;
+static _Thread_local async_log_ring *async_log_thread_ring = NULL;
+static atomic_int async_log_on = 0;
+static atomic_int async_log_stop = 0;
+static pthread_t async_log_thread;
+
+static async_log_ring *async_log_get_ring(void) {
+  async_log_ring *r = async_log_thread_ring;
+  if (!r) {
+    r = (async_log_ring *)calloc(1, sizeof(async_log_ring));
+    if (r) {
+      r->next = atomic_load_explicit(&async_log_rings, memory_order_relaxed);
+      while (!atomic_compare_exchange_weak_explicit(&async_log_rings, &(r->next), r, memory_order_release,
+                                                    memory_order_relaxed)) {
+      }
+      async_log_thread_ring = r;
+    }
+  }
+  return r;
+}
+
+static void async_log_ring_copy_in(async_log_ring *r, size_t pos, const void *src, size_t len) {
+  const size_t off = pos & (ASYNC_LOG_RING_SIZE - 1);
+  const size_t first = min(len, (size_t)(ASYNC_LOG_RING_SIZE - off));
+  memcpy(r->data + off, src, first);
+  memcpy(r->data, (const char *)src + first, len - first);
+}
+
+static void async_log_ring_copy_out(const async_log_ring *r, size_t pos, void *dst, size_t len) {
+  const size_t off = pos & (ASYNC_LOG_RING_SIZE - 1);
+  const size_t first = min(len, (size_t)(ASYNC_LOG_RING_SIZE - off));
+  memcpy(dst, r->data + off, first);
+  memcpy((char *)dst + first, r->data, len - first);
+}
+
+/* Record: 32 bits header (level << 24 | length), then the text */
+static bool async_log_put(TURN_LOG_LEVEL level, const char *s, size_t len) {
+  async_log_ring *r = async_log_get_ring();
+  if (!r) {
+    return false;
+  }
+
+  const uint32_t hdr = ((uint32_t)level << 24) | (uint32_t)len;
+  const size_t head = atomic_load_explicit(&(r->head), memory_order_relaxed);
+  const size_t tail = atomic_load_explicit(&(r->tail), memory_order_acquire);
+  if (ASYNC_LOG_RING_SIZE - (head - tail) < sizeof(hdr) + len) {
+    atomic_fetch_add_explicit(&(r->dropped), 1, memory_order_relaxed);
+    return true;
+  }
+
+  async_log_ring_copy_in(r, head, &hdr, sizeof(hdr));
+  async_log_ring_copy_in(r, head + sizeof(hdr), s, len);
+  atomic_store_explicit(&(r->head), head + sizeof(hdr) + len, memory_order_release);
+
+  return true;
+}
+
+static void async_log_flush(const char *batch, size_t len) {
+  if (len) {
+    if (!no_stdout_log) {
+      fwrite(batch, len, 1, stdout);
+    }
+    if (!to_syslog) {
+      log_lock();
+      set_rtpfile();
+      if (fwrite(batch, len, 1, _rtpfile) != 1) {
+        reset_rtpprintf();
+      } else if (fflush(_rtpfile) < 0) {
+        reset_rtpprintf();
+      }
+      log_unlock();
+    }
+  }
+}
+
+static size_t async_log_drain(char *batch, size_t *batch_len) {
+  size_t records = 0;
+  uint64_t dropped = 0;
+  char s[MAX_RTPPRINTF_BUFFER_SIZE + 2];
+
+  for (async_log_ring *r = atomic_load_explicit(&async_log_rings, memory_order_acquire); r; r = r->next) {
+    size_t tail = atomic_load_explicit(&(r->tail), memory_order_relaxed);
+    const size_t head = atomic_load_explicit(&(r->head), memory_order_acquire);
+    while (tail != head) {
+      uint32_t hdr = 0;
+      async_log_ring_copy_out(r, tail, &hdr, sizeof(hdr));
+      const size_t len = hdr & 0xFFFFFF;
+      async_log_ring_copy_out(r, tail + sizeof(hdr), s, len);
+      s[len] = 0;
+      tail += sizeof(hdr) + len;
+      ++records;
+
+#if defined(__unix__) || defined(unix) || defined(__APPLE__)
+      if (to_syslog) {
+        syslog(syslog_facility | get_syslog_level((TURN_LOG_LEVEL)(hdr >> 24)), "%s", s);
+      }
+#endif
+      if (*batch_len + len > ASYNC_LOG_BATCH_SIZE) {
+        async_log_flush(batch, *batch_len);
+        *batch_len = 0;
+      }
+      memcpy(batch + *batch_len, s, len);
+      *batch_len += len;
+    }
+    atomic_store_explicit(&(r->tail), tail, memory_order_release);
+
+    const uint64_t d = atomic_load_explicit(&(r->dropped), memory_order_relaxed);
+    dropped += d - r->dropped_reported;
+    r->dropped_reported = d;
+  }
+
+  if (dropped) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_WARNING, "log buffers overflow: %llu log lines dropped\n",
+                  (unsigned long long)dropped);
+  }
+
+  return records;
+}
+
+static void *async_log_run(void *arg) {
+  UNUSED_ARG(arg);
+
+  char *batch = (char *)malloc(ASYNC_LOG_BATCH_SIZE);
+  if (!batch) {
+    return NULL;
+  }
+
+  for (;;) {
+    const int stop = atomic_load(&async_log_stop);
+    size_t batch_len = 0;
+    const size_t records = async_log_drain(batch, &batch_len);
+    async_log_flush(batch, batch_len);
+    if (!records) {
+      if (stop) {
+        break;
+      }
+      const struct timespec idle = {0, ASYNC_LOG_IDLE_NSEC};
+      nanosleep(&idle, NULL);
+    }
+  }
+
+  free(batch);
+  return NULL;
+}
+
+void stop_async_log(void) {
+  if (atomic_exchange(&async_log_on, 0)) {
+    atomic_store(&async_log_stop, 1);
+    pthread_join(async_log_thread, NULL);
+  }
+}
+
+void start_async_log(void) {
+  if (async_log && !atomic_load(&async_log_on)) {
+    atomic_store(&async_log_stop, 0);
+    atomic_store(&async_log_on, 1);
+    if (pthread_create(&async_log_thread, NULL, async_log_run, NULL)) {
+      atomic_store(&async_log_on, 0);
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Cannot start the log writer thread, logging synchronously\n");
+    } else {
+      atexit(stop_async_log);
+    }
+  }
+}
+
+#else
+
+void start_async_log(void) {}
+
+void stop_async_log(void) {}
+
+#endif
+
+void set_async_log(int val) { async_log = val; }
+
 #if defined(WINDOWS)
 void err(int eval, const char *format, ...) {
   va_list args;
@@ -578,8 +809,6 @@ void turn_log_func_default(const char *const file, const int line, const TURN_LO
 #if defined(TURN_LOG_FUNC_IMPL)
   TURN_LOG_FUNC_IMPL(level, format, args);
 #else
-  /* Fix for Issue 24, raised by John Selbie: */
-#define MAX_RTPPRINTF_BUFFER_SIZE (1024)
   char s[MAX_RTPPRINTF_BUFFER_SIZE + 1];
   size_t so_far = 0;
   if (use_new_log_timestamp_format) {
@@ -619,30 +848,13 @@ void turn_log_func_default(const char *const file, const int line, const TURN_LO
   if (so_far > MAX_RTPPRINTF_BUFFER_SIZE + 1) {
     so_far = MAX_RTPPRINTF_BUFFER_SIZE + 1;
   }
-  if (!no_stdout_log) {
-    fwrite(s, so_far, 1, stdout);
+#if !defined(WINDOWS)
+  if (atomic_load_explicit(&async_log_on, memory_order_relaxed) && async_log_put(level, s, strnlen(s, so_far))) {
+    va_end(args);
+    return;
   }
-  /* write to syslog or to log file */
-  if (to_syslog) {
-
-#if defined(WINDOWS)
-    // TODO: add event tracing: https://docs.microsoft.com/en-us/windows/win32/etw/about-event-tracing
-    //  windows10: https://docs.microsoft.com/en-us/windows/win32/tracelogging/trace-logging-portal
-    printf("%s", s);
-#else
-    syslog(syslog_facility | get_syslog_level(level), "%s", s);
 #endif
-
-  } else {
-    log_lock();
-    set_rtpfile();
-    if (fprintf(_rtpfile, "%s", s) < 0) {
-      reset_rtpprintf();
-    } else if (fflush(_rtpfile) < 0) {
-      reset_rtpprintf();
-    }
-    log_unlock();
-  }
+  log_output(level, s, so_far);
 #endif
   va_end(args);
 }
@@ -81,6 +81,9 @@ typedef enum {
 void set_no_stdout_log(int val);
 void set_log_to_syslog(int val);
 void set_simple_log(int val);
+void set_async_log(int val);
+void start_async_log(void);
+void stop_async_log(void);
 
 void set_syslog_facility(char *val);
 
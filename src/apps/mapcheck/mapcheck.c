@@ -0,0 +1,292 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Checks of ur_string_map: randomized operations against a reference
+ * array for both map variants, a reader without the lock running against
+ * a writer (meant to be run under ThreadSanitizer as well), and a
+ * benchmark with as many keys as realms or users on a large server.
+ */
+
+#include "ns_turn_maps.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//////////////////////////////////////////////////
+
+#define CHECK_KEYS (1024)
+#define CHECK_OPERATIONS (400000)
+#define CONCURRENT_KEYS (4096)
+#define CONCURRENT_ROUNDS (8)
+#define BENCHMARK_KEYS (100000)
+#define KEY_SIZE (64)
+
+static uint32_t rnd_state = 2463534242U;
+
+static uint32_t rnd(void) {
+  rnd_state ^= rnd_state << 13;
+  rnd_state ^= rnd_state >> 17;
+  rnd_state ^= rnd_state << 5;
+  return rnd_state;
+}
+
+static uint64_t now_ns(void) {
+  struct timespec tp;
+  clock_gettime(CLOCK_MONOTONIC, &tp);
+  return (uint64_t)tp.tv_sec * 1000000000ULL + (uint64_t)tp.tv_nsec;
+}
+
+static void make_key(char *key, const char *prefix, size_t i) {
+  snprintf(key, KEY_SIZE, "%s-%lu", prefix, (unsigned long)i);
+}
+
+/////////////////// Randomized check ////////////////
+
+static int check_random(bool read_mostly) {
+  static uintptr_t ref[CHECK_KEYS];
+  size_t ref_size = 0;
+  char key[KEY_SIZE];
+
+  memset(ref, 0, sizeof(ref));
+
+  printf("ur_string_map randomized check (%s) result: ", read_mostly ? "read-mostly" : "regular");
+
+  ur_string_map *map = read_mostly ? ur_string_map_create_read_mostly(NULL) : ur_string_map_create(NULL);
+  if (!map) {
+    printf("failure on map creation\n");
+    return -1;
+  }
+
+  for (size_t op = 0; op < CHECK_OPERATIONS; ++op) {
+    const size_t i = rnd() % CHECK_KEYS;
+    /* keys of different lengths, some with a common prefix */
+    make_key(key, (i & 1) ? "realm" : "user@example.org", i);
+
+    const uint32_t what = rnd() % 100;
+    if (what < 40) {
+      const uintptr_t value = (uintptr_t)(rnd() | 1);
+      if (!ur_string_map_put(map, key, (ur_string_map_value_type)value)) {
+        printf("failure on put of %s\n", key);
+        return -1;
+      }
+      if (!ref[i]) {
+        ++ref_size;
+      }
+      ref[i] = value;
+    } else if (what < 75) {
+      ur_string_map_value_type value = NULL;
+      const bool found = ((what & 1) && read_mostly) ? ur_string_map_get_unlocked(map, key, &value)
+                                                     : ur_string_map_get(map, key, &value);
+      if (found != (ref[i] != 0) || (found && ((uintptr_t)value != ref[i]))) {
+        printf("failure on get of %s\n", key);
+        return -1;
+      }
+    } else if (what < 99) {
+      if (ur_string_map_del(map, key) != (ref[i] != 0)) {
+        printf("failure on del of %s\n", key);
+        return -1;
+      }
+      if (ref[i]) {
+        --ref_size;
+      }
+      ref[i] = 0;
+    } else if (!(rnd() % 64)) {
+      ur_string_map_clean(map);
+      memset(ref, 0, sizeof(ref));
+      ref_size = 0;
+    }
+
+    if (ur_string_map_size(map) != ref_size) {
+      printf("failure on size: %lu, must be %lu\n", (unsigned long)ur_string_map_size(map), (unsigned long)ref_size);
+      return -1;
+    }
+  }
+
+  ur_string_map_free(&map);
+
+  printf("success\n");
+  return 0;
+}
+
+/////////////////// Reader without the lock ////////////////
+
+typedef struct _concurrent_check {
+  ur_string_map *map;
+  atomic_bool done;
+  atomic_bool failed;
+} concurrent_check;
+
+static uintptr_t concurrent_value(size_t i) { return (uintptr_t)(i + 1); }
+
+static void *concurrent_reader(void *arg) {
+  concurrent_check *cc = (concurrent_check *)arg;
+  char key[KEY_SIZE];
+  uint32_t x = 88675123U;
+
+  while (!atomic_load(&(cc->done))) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    const size_t i = x % CONCURRENT_KEYS;
+    make_key(key, "realm", i);
+    ur_string_map_value_type value = NULL;
+    if (ur_string_map_get_unlocked(cc->map, key, &value) && ((uintptr_t)value != concurrent_value(i))) {
+      atomic_store(&(cc->failed), true);
+    }
+  }
+
+  return NULL;
+}
+
+static int check_concurrent(void) {
+  concurrent_check cc;
+  char key[KEY_SIZE];
+
+  printf("ur_string_map reader without the lock check result: ");
+
+  cc.map = ur_string_map_create_read_mostly(NULL);
+  atomic_init(&(cc.done), false);
+  atomic_init(&(cc.failed), false);
+  if (!(cc.map)) {
+    printf("failure on map creation\n");
+    return -1;
+  }
+
+  pthread_t reader;
+  if (pthread_create(&reader, NULL, concurrent_reader, &cc)) {
+    printf("failure on thread creation\n");
+    return -1;
+  }
+
+  /* The table grows and the keys come and go while the reader looks them up */
+  for (size_t round = 0; round < CONCURRENT_ROUNDS; ++round) {
+    for (size_t i = 0; i < CONCURRENT_KEYS; ++i) {
+      make_key(key, "realm", i);
+      ur_string_map_lock(cc.map);
+      ur_string_map_put(cc.map, key, (ur_string_map_value_type)concurrent_value(i));
+      ur_string_map_unlock(cc.map);
+    }
+    for (size_t i = round & 1; i < CONCURRENT_KEYS; i += 2) {
+      make_key(key, "realm", i);
+      ur_string_map_lock(cc.map);
+      ur_string_map_del(cc.map, key);
+      ur_string_map_unlock(cc.map);
+    }
+  }
+
+  atomic_store(&(cc.done), true);
+  pthread_join(reader, NULL);
+  ur_string_map_free(&(cc.map));
+
+  if (atomic_load(&(cc.failed))) {
+    printf("failure on lookup\n");
+    return -1;
+  }
+
+  printf("success\n");
+  return 0;
+}
+
+/////////////////// Benchmark ////////////////
+
+static void benchmark(const char *prefix) {
+  char(*keys)[KEY_SIZE] = (char(*)[KEY_SIZE])malloc((size_t)BENCHMARK_KEYS * KEY_SIZE);
+  char(*missing)[KEY_SIZE] = (char(*)[KEY_SIZE])malloc((size_t)BENCHMARK_KEYS * KEY_SIZE);
+  if (!keys || !missing) {
+    free(keys);
+    free(missing);
+    return;
+  }
+  for (size_t i = 0; i < BENCHMARK_KEYS; ++i) {
+    make_key(keys[i], prefix, i);
+    make_key(missing[i], prefix, i + BENCHMARK_KEYS);
+  }
+
+  ur_string_map *map = ur_string_map_create(NULL);
+  uint64_t t[5];
+  size_t found = 0;
+
+  t[0] = now_ns();
+  for (size_t i = 0; i < BENCHMARK_KEYS; ++i) {
+    ur_string_map_put(map, keys[i], (ur_string_map_value_type)(uintptr_t)(i + 1));
+  }
+  t[1] = now_ns();
+  for (size_t i = 0; i < BENCHMARK_KEYS; ++i) {
+    ur_string_map_value_type value = NULL;
+    found += ur_string_map_get(map, keys[(i * 7919) % BENCHMARK_KEYS], &value);
+  }
+  t[2] = now_ns();
+  for (size_t i = 0; i < BENCHMARK_KEYS; ++i) {
+    ur_string_map_value_type value = NULL;
+    found += ur_string_map_get(map, missing[i], &value);
+  }
+  t[3] = now_ns();
+  for (size_t i = 0; i < BENCHMARK_KEYS; ++i) {
+    ur_string_map_del(map, keys[i]);
+  }
+  t[4] = now_ns();
+
+  ur_string_map_free(&map);
+  free(keys);
+  free(missing);
+
+  printf("ur_string_map %d %s keys, ns per operation: insert %lu, hit %lu, miss %lu, delete %lu (%lu found)\n",
+         BENCHMARK_KEYS, prefix, (unsigned long)((t[1] - t[0]) / BENCHMARK_KEYS),
+         (unsigned long)((t[2] - t[1]) / BENCHMARK_KEYS), (unsigned long)((t[3] - t[2]) / BENCHMARK_KEYS),
+         (unsigned long)((t[4] - t[3]) / BENCHMARK_KEYS), (unsigned long)found);
+}
+
+//////////////////////////////////////////////////
+
+int main(int argc, const char **argv) {
+  const bool benchmark_only = (argc > 1) && !strcmp(argv[1], "-b");
+
+  if (!benchmark_only) {
+    if ((check_random(false) < 0) || (check_random(true) < 0) || (check_concurrent() < 0)) {
+      exit(-1);
+    }
+  }
+
+  benchmark("realm");
+  benchmark("user@example.org");
+
+  return 0;
+}
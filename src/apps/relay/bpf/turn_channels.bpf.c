@@ -0,0 +1,286 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * XDP fast path for UDP ChannelData relaying.
+ *
+ * The TURN server installs one entry per bound channel into each of the
+ * two hash maps (see turn_channels_maps.h). Packets matching an entry are
+ * rewritten and forwarded from the driver; everything else (STUN, TCP,
+ * IPv6, fragments, unknown channels, unresolved next hops) is passed up
+ * to the regular socket path untouched.
+ *
+ * Build: clang -O2 -g -target bpf -c turn_channels.bpf.c -o turn_channels.bpf.o
+ */
+
+#include <linux/bpf.h>
+#include <linux/if_ether.h>
+#include <linux/in.h>
+#include <linux/ip.h>
+#include <linux/udp.h>
+
+#include <bpf/bpf_endian.h>
+#include <bpf/bpf_helpers.h>
+
+#include "turn_channels_maps.h"
+
+#ifndef AF_INET
+#define AF_INET (2)
+#endif
+
+#define TURN_KC_CHANNEL_HDR_LEN (4)
+#define TURN_KC_IP_FRAGMENT_MASK (0x3FFF)
+
+struct {
+  __uint(type, BPF_MAP_TYPE_HASH);
+  __uint(max_entries, TURN_KC_MAX_CHANNELS);
+  __type(key, struct turn_kc_client_key);
+  __type(value, struct turn_kc_value);
+} turn_kc_client SEC(".maps");
+
+struct {
+  __uint(type, BPF_MAP_TYPE_HASH);
+  __uint(max_entries, TURN_KC_MAX_CHANNELS);
+  __type(key, struct turn_kc_peer_key);
+  __type(value, struct turn_kc_value);
+} turn_kc_peer SEC(".maps");
+
+struct turn_kc_hdrs {
+  struct ethhdr eth;
+  struct iphdr ip;
+  struct udphdr udp;
+} __attribute__((packed));
+
+static __always_inline __u16 turn_kc_ip_checksum(struct iphdr *ip) {
+  __u32 csum = 0;
+  __u16 *p = (__u16 *)ip;
+
+  ip->check = 0;
+#pragma unroll
+  for (int i = 0; i < (int)(sizeof(struct iphdr) >> 1); ++i) {
+    csum += p[i];
+  }
+  csum = (csum & 0xffff) + (csum >> 16);
+  csum = (csum & 0xffff) + (csum >> 16);
+
+  return (__u16)~csum;
+}
+
+static __always_inline int turn_kc_fib_lookup(struct xdp_md *ctx, const struct turn_kc_hdrs *h, __u16 tot_len,
+                                              struct bpf_fib_lookup *fib) {
+  __builtin_memset(fib, 0, sizeof(*fib));
+  fib->family = AF_INET;
+  fib->tos = h->ip.tos;
+  fib->l4_protocol = IPPROTO_UDP;
+  fib->tot_len = tot_len;
+  fib->ipv4_src = h->ip.saddr;
+  fib->ipv4_dst = h->ip.daddr;
+  fib->ifindex = ctx->ingress_ifindex;
+
+  return bpf_fib_lookup(ctx, fib, sizeof(*fib), 0);
+}
+
+/* Trims the link-layer padding (and the optional ChannelData padding) past the wanted frame size */
+static __always_inline int turn_kc_trim_tail(struct xdp_md *ctx, __u32 wanted) {
+  const __u32 current = (__u32)(ctx->data_end - ctx->data);
+  if (current > wanted) {
+    return bpf_xdp_adjust_tail(ctx, -(int)(current - wanted));
+  }
+  return 0;
+}
+
+static __always_inline int turn_kc_send(struct xdp_md *ctx, const struct bpf_fib_lookup *fib) {
+  if (fib->ifindex == ctx->ingress_ifindex) {
+    return XDP_TX;
+  }
+  return bpf_redirect(fib->ifindex, 0);
+}
+
+/* Client ChannelData -> peer: strip the 4-byte channel header and send from the relay endpoint */
+static __always_inline int turn_kc_to_peer(struct xdp_md *ctx, struct turn_kc_hdrs *h, struct turn_kc_value *v,
+                                           __u16 chlen) {
+  struct bpf_fib_lookup fib;
+  const __u16 udp_len = (__u16)(sizeof(struct udphdr) + chlen);
+  const __u16 tot_len = (__u16)(sizeof(struct iphdr) + udp_len);
+
+  h->ip.saddr = v->src_ip;
+  h->ip.daddr = v->dst_ip;
+  h->ip.tot_len = bpf_htons(tot_len);
+
+  if (turn_kc_fib_lookup(ctx, h, tot_len, &fib) != BPF_FIB_LKUP_RET_SUCCESS) {
+    return XDP_PASS;
+  }
+
+  if (turn_kc_trim_tail(ctx, (__u32)(sizeof(*h) + TURN_KC_CHANNEL_HDR_LEN + chlen)) < 0) {
+    return XDP_PASS;
+  }
+  if (bpf_xdp_adjust_head(ctx, TURN_KC_CHANNEL_HDR_LEN) < 0) {
+    return XDP_DROP;
+  }
+
+  void *data = (void *)(long)ctx->data;
+  void *data_end = (void *)(long)ctx->data_end;
+  if (data + sizeof(*h) > data_end) {
+    return XDP_DROP;
+  }
+
+  __builtin_memcpy(h->eth.h_dest, fib.dmac, ETH_ALEN);
+  __builtin_memcpy(h->eth.h_source, fib.smac, ETH_ALEN);
+  h->udp.source = v->src_port;
+  h->udp.dest = v->dst_port;
+  h->udp.len = bpf_htons(udp_len);
+  h->udp.check = 0;
+  h->ip.check = turn_kc_ip_checksum(&(h->ip));
+  __builtin_memcpy(data, h, sizeof(*h));
+
+  __sync_fetch_and_add(&(v->packets), 1);
+  __sync_fetch_and_add(&(v->bytes), chlen);
+
+  return turn_kc_send(ctx, &fib);
+}
+
+/* Peer datagram -> client: prepend the 4-byte channel header and send from the listener endpoint */
+static __always_inline int turn_kc_to_client(struct xdp_md *ctx, struct turn_kc_hdrs *h, struct turn_kc_value *v,
+                                             __u16 payload_len) {
+  struct bpf_fib_lookup fib;
+  const __u16 udp_len = (__u16)(sizeof(struct udphdr) + TURN_KC_CHANNEL_HDR_LEN + payload_len);
+  const __u16 tot_len = (__u16)(sizeof(struct iphdr) + udp_len);
+
+  if (payload_len > 0xFFFF - sizeof(struct iphdr) - sizeof(struct udphdr) - TURN_KC_CHANNEL_HDR_LEN) {
+    return XDP_PASS;
+  }
+
+  h->ip.saddr = v->src_ip;
+  h->ip.daddr = v->dst_ip;
+  h->ip.tot_len = bpf_htons(tot_len);
+
+  /* The lookup also enforces the egress MTU for the grown packet */
+  if (turn_kc_fib_lookup(ctx, h, tot_len, &fib) != BPF_FIB_LKUP_RET_SUCCESS) {
+    return XDP_PASS;
+  }
+
+  if (turn_kc_trim_tail(ctx, (__u32)(sizeof(*h) + payload_len)) < 0) {
+    return XDP_PASS;
+  }
+  if (bpf_xdp_adjust_head(ctx, -TURN_KC_CHANNEL_HDR_LEN) < 0) {
+    return XDP_PASS;
+  }
+
+  void *data = (void *)(long)ctx->data;
+  void *data_end = (void *)(long)ctx->data_end;
+  if (data + sizeof(*h) + TURN_KC_CHANNEL_HDR_LEN > data_end) {
+    return XDP_DROP;
+  }
+
+  __builtin_memcpy(h->eth.h_dest, fib.dmac, ETH_ALEN);
+  __builtin_memcpy(h->eth.h_source, fib.smac, ETH_ALEN);
+  h->udp.source = v->src_port;
+  h->udp.dest = v->dst_port;
+  h->udp.len = bpf_htons(udp_len);
+  h->udp.check = 0;
+  h->ip.check = turn_kc_ip_checksum(&(h->ip));
+  __builtin_memcpy(data, h, sizeof(*h));
+
+  __u8 *ch = (__u8 *)data + sizeof(*h);
+  ch[0] = (__u8)(v->chnum >> 8);
+  ch[1] = (__u8)(v->chnum & 0xff);
+  ch[2] = (__u8)(payload_len >> 8);
+  ch[3] = (__u8)(payload_len & 0xff);
+
+  __sync_fetch_and_add(&(v->packets), 1);
+  __sync_fetch_and_add(&(v->bytes), payload_len);
+
+  return turn_kc_send(ctx, &fib);
+}
+
+SEC("xdp")
+int turn_channels_xdp(struct xdp_md *ctx) {
+  void *data = (void *)(long)ctx->data;
+  void *data_end = (void *)(long)ctx->data_end;
+  struct turn_kc_hdrs h;
+
+  if (data + sizeof(h) > data_end) {
+    return XDP_PASS;
+  }
+  __builtin_memcpy(&h, data, sizeof(h));
+
+  if (h.eth.h_proto != bpf_htons(ETH_P_IP) || h.ip.ihl != 5 || h.ip.protocol != IPPROTO_UDP) {
+    return XDP_PASS;
+  }
+  if (h.ip.frag_off & bpf_htons(TURN_KC_IP_FRAGMENT_MASK)) {
+    return XDP_PASS;
+  }
+
+  const __u16 udp_len = bpf_ntohs(h.udp.len);
+  if (udp_len < sizeof(struct udphdr) ||
+      data + sizeof(struct ethhdr) + sizeof(struct iphdr) + udp_len > data_end) {
+    return XDP_PASS;
+  }
+  const __u16 payload_len = (__u16)(udp_len - sizeof(struct udphdr));
+
+  struct turn_kc_peer_key pkey = {
+      .peer_ip = h.ip.saddr, .relay_ip = h.ip.daddr, .peer_port = h.udp.source, .relay_port = h.udp.dest};
+  struct turn_kc_value *v = bpf_map_lookup_elem(&turn_kc_peer, &pkey);
+  if (v) {
+    return turn_kc_to_client(ctx, &h, v, payload_len);
+  }
+
+  if (payload_len < TURN_KC_CHANNEL_HDR_LEN) {
+    return XDP_PASS;
+  }
+  const __u8 *ch = (const __u8 *)data + sizeof(h);
+  if ((const void *)(ch + TURN_KC_CHANNEL_HDR_LEN) > data_end) {
+    return XDP_PASS;
+  }
+  const __u16 chnum = (__u16)(((__u16)ch[0] << 8) | ch[1]);
+  const __u16 chlen = (__u16)(((__u16)ch[2] << 8) | ch[3]);
+  if (chnum < 0x4000 || chnum > 0x7FFF || chlen > payload_len - TURN_KC_CHANNEL_HDR_LEN) {
+    return XDP_PASS;
+  }
+
+  struct turn_kc_client_key ckey = {.client_ip = h.ip.saddr,
+                                    .server_ip = h.ip.daddr,
+                                    .client_port = h.udp.source,
+                                    .server_port = h.udp.dest,
+                                    .chnum = chnum,
+                                    .pad = 0};
+  v = bpf_map_lookup_elem(&turn_kc_client, &ckey);
+  if (v) {
+    return turn_kc_to_peer(ctx, &h, v, chlen);
+  }
+
+  return XDP_PASS;
+}
+
+char _license[] SEC("license") = "Dual BSD/GPL";
@@ -0,0 +1,83 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Map layout shared by the kernel channels XDP program
+ * and the user space control plane (kernel_channels.c).
+ *
+ * All addresses and ports are stored in network byte order.
+ */
+
+#ifndef __TURN_CHANNELS_MAPS__
+#define __TURN_CHANNELS_MAPS__
+
+#include <linux/types.h>
+
+#define TURN_KC_MAX_CHANNELS (65536)
+
+#define TURN_KC_CLIENT_MAP_NAME "turn_kc_client"
+#define TURN_KC_PEER_MAP_NAME "turn_kc_peer"
+#define TURN_KC_PROG_NAME "turn_channels_xdp"
+
+/* Client -> relay direction: ChannelData received on the client socket */
+struct turn_kc_client_key {
+  __u32 client_ip;
+  __u32 server_ip;
+  __u16 client_port;
+  __u16 server_port;
+  __u16 chnum; /* host byte order */
+  __u16 pad;
+};
+
+/* Peer -> relay direction: raw UDP received on the relay socket */
+struct turn_kc_peer_key {
+  __u32 peer_ip;
+  __u32 relay_ip;
+  __u16 peer_port;
+  __u16 relay_port;
+};
+
+/* Rewritten headers of the forwarded packet, and the traffic counters */
+struct turn_kc_value {
+  __u32 src_ip;
+  __u32 dst_ip;
+  __u16 src_port;
+  __u16 dst_port;
+  __u16 chnum; /* host byte order, peer -> client direction only */
+  __u16 pad;
+  __u64 packets;
+  __u64 bytes;
+};
+
+#endif /* __TURN_CHANNELS_MAPS__ */
@@ -0,0 +1,111 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * XDP program steering client datagrams for the UDP listener endpoints
+ * to the AF_XDP sockets of the TURN server (see xdp_socket.c).
+ * Only the endpoints present in turn_xsk_endpoints are redirected,
+ * all other traffic goes to the kernel stack as usual.
+ *
+ * Build: clang -O2 -g -target bpf -c turn_xsk.bpf.c -o turn_xsk.bpf.o
+ */
+
+#include <linux/bpf.h>
+#include <linux/if_ether.h>
+#include <linux/in.h>
+#include <linux/ip.h>
+#include <linux/udp.h>
+
+#include <bpf/bpf_endian.h>
+#include <bpf/bpf_helpers.h>
+
+#include "turn_xsk_maps.h"
+
+struct {
+  __uint(type, BPF_MAP_TYPE_XSKMAP);
+  __uint(max_entries, TURN_XSK_MAX_QUEUES);
+  __type(key, __u32);
+  __type(value, __u32);
+} turn_xsk_map SEC(".maps");
+
+struct {
+  __uint(type, BPF_MAP_TYPE_HASH);
+  __uint(max_entries, TURN_XSK_MAX_ENDPOINTS);
+  __type(key, struct turn_xsk_endpoint);
+  __type(value, __u8);
+} turn_xsk_endpoints SEC(".maps");
+
+SEC("xdp")
+int turn_xsk_xdp(struct xdp_md *ctx) {
+  void *data = (void *)(long)ctx->data;
+  void *data_end = (void *)(long)ctx->data_end;
+
+  struct ethhdr *eth = data;
+  if ((void *)(eth + 1) > data_end || eth->h_proto != bpf_htons(ETH_P_IP)) {
+    return XDP_PASS;
+  }
+
+  struct iphdr *ip = (struct iphdr *)(eth + 1);
+  if ((void *)(ip + 1) > data_end || ip->version != 4 || ip->ihl != 5 || ip->protocol != IPPROTO_UDP) {
+    return XDP_PASS;
+  }
+  /* Fragments are left to the kernel to reassemble */
+  if (ip->frag_off & bpf_htons(0x3FFF)) {
+    return XDP_PASS;
+  }
+
+  struct udphdr *udp = (struct udphdr *)(ip + 1);
+  if ((void *)(udp + 1) > data_end) {
+    return XDP_PASS;
+  }
+
+  /* The lengths must fit the frame; anything odd is for the kernel to drop */
+  const __u32 tot_len = bpf_ntohs(ip->tot_len);
+  const __u32 udp_len = bpf_ntohs(udp->len);
+  if ((tot_len < sizeof(struct iphdr) + sizeof(struct udphdr)) ||
+      ((void *)ip + tot_len > data_end) || (udp_len < sizeof(struct udphdr)) ||
+      (udp_len > tot_len - sizeof(struct iphdr))) {
+    return XDP_PASS;
+  }
+
+  struct turn_xsk_endpoint ep = {.ip = ip->daddr, .port = udp->dest, .pad = 0};
+  if (!bpf_map_lookup_elem(&turn_xsk_endpoints, &ep)) {
+    return XDP_PASS;
+  }
+
+  /* Queues without a bound AF_XDP socket fall back to the kernel stack */
+  return bpf_redirect_map(&turn_xsk_map, ctx->rx_queue_index, XDP_PASS);
+}
+
+char _license[] SEC("license") = "Dual BSD/GPL";
@@ -0,0 +1,240 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* pthread_setaffinity_np() */
+#endif
+
+#include "cpu_affinity.h"
+
+#include "ns_turn_utils.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+//////////////////////////////////////////////////
+
+#define TURN_CPU_MAX (4096)
+#define TURN_NUMA_NODES_MAX (1024)
+
+int turn_cpu_list_parse(const char *s, turn_cpu_list *cl) {
+  if (!s || !cl) {
+    return -1;
+  }
+
+  int *cpus = NULL;
+  size_t size = 0;
+
+  while (*s) {
+    char *end = NULL;
+    const long first = strtol(s, &end, 10);
+    long last = first;
+    if ((end == s) || (first < 0) || (first >= TURN_CPU_MAX)) {
+      free(cpus);
+      return -1;
+    }
+    s = end;
+    if (*s == '-') {
+      ++s;
+      last = strtol(s, &end, 10);
+      if ((end == s) || (last < first) || (last >= TURN_CPU_MAX)) {
+        free(cpus);
+        return -1;
+      }
+      s = end;
+    }
+    if (*s == ',') {
+      ++s;
+    } else if (*s) {
+      free(cpus);
+      return -1;
+    }
+
+    int *more = (int *)realloc(cpus, (size + (size_t)(last - first + 1)) * sizeof(int));
+    if (!more) {
+      free(cpus);
+      return -1;
+    }
+    cpus = more;
+    for (long cpu = first; cpu <= last; ++cpu) {
+      cpus[size++] = (int)cpu;
+    }
+  }
+
+  if (!size) {
+    return -1;
+  }
+
+  free(cl->cpus);
+  cl->cpus = cpus;
+  cl->size = size;
+  return 0;
+}
+
+int turn_cpu_list_get(const turn_cpu_list *cl, size_t index) {
+  if (!cl || !(cl->size)) {
+    return -1;
+  }
+  return cl->cpus[index % cl->size];
+}
+
+int turn_cpu_node(int cpu) {
+#if defined(__linux__)
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+  DIR *dir = opendir(path);
+  if (!dir) {
+    return -1;
+  }
+  int node = -1;
+  struct dirent *de = NULL;
+  while ((node < 0) && (de = readdir(dir))) {
+    if (!strncmp(de->d_name, "node", 4) && (de->d_name[4] >= '0') && (de->d_name[4] <= '9')) {
+      node = atoi(de->d_name + 4);
+    }
+  }
+  closedir(dir);
+  return node;
+#else
+  UNUSED_ARG(cpu);
+  return -1;
+#endif
+}
+
+#if defined(__linux__)
+static void turn_node_mask(int node, unsigned long *mask, size_t mask_size) {
+  memset(mask, 0, mask_size * sizeof(unsigned long));
+  mask[(size_t)node / (8 * sizeof(unsigned long))] |= 1UL << ((size_t)node % (8 * sizeof(unsigned long)));
+}
+#endif
+
+int turn_thread_pin(int cpu, bool numa_local, const char *name, int *node) {
+  if (node) {
+    *node = -1;
+  }
+  if (cpu < 0) {
+    return -1;
+  }
+
+#if defined(__linux__)
+  if (cpu >= CPU_SETSIZE) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "%s thread: CPU %d is out of range\n", name, cpu);
+    return -1;
+  }
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  const int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (err) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "%s thread: cannot pin to CPU %d: %s\n", name, cpu, strerror(err));
+    return -1;
+  }
+
+  const int cpu_node = turn_cpu_node(cpu);
+  if (node) {
+    *node = cpu_node;
+  }
+
+  if (numa_local && (cpu_node >= 0) && (cpu_node < TURN_NUMA_NODES_MAX)) {
+    unsigned long mask[TURN_NUMA_NODES_MAX / (8 * sizeof(unsigned long))];
+    turn_node_mask(cpu_node, mask, sizeof(mask) / sizeof(mask[0]));
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, (unsigned long)(8 * sizeof(mask))) < 0) {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_WARNING, "%s thread: cannot prefer the memory of NUMA node %d: %s\n", name,
+                    cpu_node, strerror(errno));
+    }
+  }
+
+  TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "%s thread pinned to CPU %d, NUMA node %d\n", name, cpu, cpu_node);
+  return 0;
+#else
+  UNUSED_ARG(numa_local);
+  TURN_LOG_FUNC(TURN_LOG_LEVEL_WARNING, "%s thread: CPU affinity is not supported on this platform\n", name);
+  return -1;
+#endif
+}
+
+int turn_memory_bind_node(void *addr, size_t len, int node) {
+#if defined(__linux__)
+  if (!addr || (node < 0) || (node >= TURN_NUMA_NODES_MAX)) {
+    return -1;
+  }
+
+  /* whole pages only */
+  const uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+  const uintptr_t start = ((uintptr_t)addr + page - 1) & ~(page - 1);
+  const uintptr_t end = ((uintptr_t)addr + len) & ~(page - 1);
+  if (end <= start) {
+    return 0;
+  }
+
+  unsigned long mask[TURN_NUMA_NODES_MAX / (8 * sizeof(unsigned long))];
+  turn_node_mask(node, mask, sizeof(mask) / sizeof(mask[0]));
+  if (syscall(SYS_mbind, (void *)start, (unsigned long)(end - start), MPOL_PREFERRED, mask,
+              (unsigned long)(8 * sizeof(mask)), MPOL_MF_MOVE) < 0) {
+    return -1;
+  }
+  return 0;
+#else
+  UNUSED_ARG(addr);
+  UNUSED_ARG(len);
+  UNUSED_ARG(node);
+  return -1;
+#endif
+}
+
+int turn_socket_set_incoming_cpu(evutil_socket_t fd, int cpu) {
+#if defined(SO_INCOMING_CPU)
+  if ((fd < 0) || (cpu < 0)) {
+    return -1;
+  }
+  return setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu));
+#else
+  UNUSED_ARG(fd);
+  UNUSED_ARG(cpu);
+  return -1;
+#endif
+}
@@ -0,0 +1,88 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * CPU affinity and NUMA placement of the server threads
+ */
+
+#ifndef __CPU_AFFINITY__
+#define __CPU_AFFINITY__
+
+#include "ns_turn_ioalib.h"
+
+#include <event2/util.h>
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//////////////////////////////////////////////////
+
+typedef struct _turn_cpu_list {
+  int *cpus;
+  size_t size;
+} turn_cpu_list;
+
+/* "0-3,8,10-11": returns -1 and leaves cl unchanged on a syntax error */
+int turn_cpu_list_parse(const char *s, turn_cpu_list *cl);
+
+/* The CPU of the thread number index, round-robin over the list; -1 when the list is empty */
+int turn_cpu_list_get(const turn_cpu_list *cl, size_t index);
+
+/* The NUMA node of the CPU, -1 when unknown */
+int turn_cpu_node(int cpu);
+
+/*
+ * Pins the calling thread to the CPU. With numa_local, the memory the thread
+ * allocates from now on is preferably taken from the node of the CPU.
+ * Returns 0 when pinned, -1 otherwise; *node is set to the NUMA node of
+ * the CPU, -1 when unknown (a pinned thread may still have no known node).
+ */
+int turn_thread_pin(int cpu, bool numa_local, const char *name, int *node);
+
+/* Moves the pages of the memory range to the node, preferably, from now on */
+int turn_memory_bind_node(void *addr, size_t len, int node);
+
+/* SO_INCOMING_CPU: a SO_REUSEPORT group member is chosen for the CPU that received the packet */
+int turn_socket_set_incoming_cpu(evutil_socket_t fd, int cpu);
+
+//////////////////////////////////////////////////
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CPU_AFFINITY__ */
@@ -41,6 +41,8 @@
 
 #include "ns_turn_openssl.h"
 #include "prom_server.h"
+#include "tls_handshake.h"
+#include "xdp_socket.h"
 
 #include <pthread.h>
 #include <stdint.h>
@@ -62,6 +64,13 @@ typedef uint16_t in_port_t;
   TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "%s:%d:end\n", __FUNCTION__, __LINE__)
 
 #define COOKIE_SECRET_LENGTH (32)
+/* A cookie is good for the current and the previous period, in seconds */
+#define COOKIE_PERIOD (30)
+
+#define DTLS_RECORD_HEADER_LENGTH (13)
+#define DTLS_HANDSHAKE_HEADER_LENGTH (12)
+#define DTLS_CLIENT_HELLO (1)
+#define DTLS_HELLO_VERIFY_REQUEST (3)
 
 #define MAX_SINGLE_UDP_BATCH (16)
 
@@ -83,6 +92,8 @@ struct dtls_listener_relay_server_info {
   struct message_to_relay sm;
   size_t slen0;
   ioa_engine_new_connection_event_handler connect_cb;
+  /* received datagrams by class, not reported yet */
+  uint32_t packet_classes[TURN_PACKET_CLASSES_NUMBER];
 };
 
 ///////////// forward declarations ////////
@@ -90,6 +101,10 @@ struct dtls_listener_relay_server_info {
 static int create_server_socket(dtls_listener_relay_server_type *server, int report_creation, int sock_buf_size);
 static int clean_server(dtls_listener_relay_server_type *server);
 static int reopen_server_socket(dtls_listener_relay_server_type *server, evutil_socket_t fd);
+#if DTLS_SUPPORTED
+static void dtls_server_handshake_done(ioa_socket_handle s, int rc, ioa_network_buffer_handle *dgrams,
+                                       size_t dgrams_number, void *arg);
+#endif
 
 ///////////// dtls message types //////////
 
@@ -170,175 +185,327 @@ static size_t print_packet_txt2pcap(uint64_t now, uint8_t *payload, size_t paylo
 
 #if DTLS_SUPPORTED
 
-static void calculate_cookie(SSL *ssl, unsigned char *cookie_secret, unsigned int cookie_length) {
-  const long rv = (long)ssl;
-  const long inum = (cookie_length - (((long)cookie_secret) % sizeof(long))) / sizeof(long);
-  long i = 0;
-  long *ip = (long *)cookie_secret;
-  for (i = 0; i < inum; ++i, ++ip) {
-    *ip = rv;
-  }
-}
-
-static int generate_cookie(SSL *ssl, unsigned char *cookie, unsigned int *cookie_len) {
-  unsigned char buffer[sizeof(struct in6_addr) + sizeof(in_port_t)];
-  unsigned char result[EVP_MAX_MD_SIZE];
-  unsigned int length = 0;
-  unsigned int resultlength;
-  ioa_addr peer;
+static unsigned char cookie_secret[COOKIE_SECRET_LENGTH];
 
-  unsigned char cookie_secret[COOKIE_SECRET_LENGTH];
-  calculate_cookie(ssl, cookie_secret, sizeof(cookie_secret));
-
-  /* Read peer information */
-  (void)BIO_dgram_get_peer(SSL_get_wbio(ssl), &peer);
+/*
+ * The cookie is a keyed hash of the client address and port and of the
+ * current period: it proves that the client receives at that address, and
+ * the server keeps nothing until it comes back.
+ */
+static unsigned int calculate_cookie(const ioa_addr *peer, uint32_t period, unsigned char *cookie) {
+  unsigned char buffer[sizeof(uint32_t) + sizeof(in_port_t) + sizeof(struct in6_addr)];
+  size_t length = 0;
 
-  // TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO,"%s: family=%u(1)\n",__FUNCTION__,(unsigned)peer.ss.sa_family);
+  memcpy(buffer, &period, sizeof(period));
+  length += sizeof(period);
 
-  /* Create buffer with peer's address and port */
-  length = 0;
-  switch (peer.ss.sa_family) {
+  switch (peer->ss.sa_family) {
   case AF_INET:
+    memcpy(buffer + length, &peer->s4.sin_port, sizeof(in_port_t));
+    length += sizeof(in_port_t);
+    memcpy(buffer + length, &peer->s4.sin_addr, sizeof(struct in_addr));
     length += sizeof(struct in_addr);
     break;
   case AF_INET6:
+    memcpy(buffer + length, &peer->s6.sin6_port, sizeof(in_port_t));
+    length += sizeof(in_port_t);
+    memcpy(buffer + length, &peer->s6.sin6_addr, sizeof(struct in6_addr));
     length += sizeof(struct in6_addr);
     break;
   default:
-    OPENSSL_assert(0);
-    break;
+    return 0;
   }
-  length += sizeof(in_port_t);
 
-  // TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO,"%s: family=%u(2)\n",__FUNCTION__,(unsigned)peer.ss.sa_family);
+  unsigned int resultlength = 0;
+  HMAC(EVP_sha256(), (const void *)cookie_secret, COOKIE_SECRET_LENGTH, (const unsigned char *)buffer, length, cookie,
+       &resultlength);
 
-  switch (peer.ss.sa_family) {
-  case AF_INET:
-    memcpy(buffer, &peer.s4.sin_port, sizeof(in_port_t));
-    memcpy(buffer + sizeof(peer.s4.sin_port), &peer.s4.sin_addr, sizeof(struct in_addr));
-    break;
-  case AF_INET6:
-    memcpy(buffer, &peer.s6.sin6_port, sizeof(in_port_t));
-    memcpy(buffer + sizeof(in_port_t), &peer.s6.sin6_addr, sizeof(struct in6_addr));
-    break;
-  default:
-    OPENSSL_assert(0);
-    break;
+  return resultlength;
+}
+
+static uint32_t current_cookie_period(void) { return (uint32_t)(turn_time() / COOKIE_PERIOD); }
+
+static bool check_cookie(const ioa_addr *peer, const unsigned char *cookie, size_t cookie_len) {
+  const uint32_t period = current_cookie_period();
+  unsigned char result[EVP_MAX_MD_SIZE];
+
+  for (uint32_t i = 0; i < 2; ++i) {
+    const unsigned int resultlength = calculate_cookie(peer, period - i, result);
+    if (resultlength && (cookie_len == resultlength) && !CRYPTO_memcmp(result, cookie, resultlength)) {
+      return true;
+    }
   }
 
-  /* Calculate HMAC of buffer using the secret */
-  HMAC(EVP_sha1(), (const void *)cookie_secret, COOKIE_SECRET_LENGTH, (const unsigned char *)buffer, length, result,
-       &resultlength);
+  return false;
+}
+
+static int generate_cookie(SSL *ssl, unsigned char *cookie, unsigned int *cookie_len) {
+  ioa_addr peer;
+
+  /* Read peer information */
+  (void)BIO_dgram_get_peer(SSL_get_wbio(ssl), &peer);
 
-  memcpy(cookie, result, resultlength);
-  *cookie_len = resultlength;
+  *cookie_len = calculate_cookie(&peer, current_cookie_period(), cookie);
 
-  return 1;
+  return (*cookie_len > 0);
 }
 
 static int verify_cookie(SSL *ssl, const unsigned char *cookie, unsigned int cookie_len) {
-  unsigned int resultlength = 0;
-  unsigned char result[COOKIE_SECRET_LENGTH];
+  ioa_addr peer;
 
-  generate_cookie(ssl, result, &resultlength);
+  (void)BIO_dgram_get_peer(SSL_get_wbio(ssl), &peer);
 
-  if (cookie_len == resultlength && memcmp(result, cookie, resultlength) == 0) {
-    // TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO,"%s: cookies are OK, length=%u\n",__FUNCTION__,cookie_len);
-    return 1;
-  } else {
-    // TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO,"%s: cookies are OK, length=%u\n",__FUNCTION__,cookie_len);
-    return 0;
-  }
+  return check_cookie(&peer, cookie, cookie_len);
 }
 
-/////////////// io handlers ///////////////////
+static uint32_t get_uint24(const uint8_t *p) { return ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | (uint32_t)p[2]; }
 
-static ioa_socket_handle dtls_accept_client_connection(dtls_listener_relay_server_type *server, ioa_socket_handle sock,
-                                                       SSL *ssl, ioa_addr *remote_addr, ioa_addr *local_addr,
-                                                       ioa_network_buffer_handle nbh) {
-  FUNCSTART;
+static void set_uint24(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 16);
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)v;
+}
 
-  if (!server || !ssl) {
-    return NULL;
+/*
+ * HelloVerifyRequest (RFC 6347 4.2.1) built without any SSL: DTLS 1.0 version,
+ * epoch and record sequence number of the ClientHello, message sequence 0.
+ */
+static void dtls_server_send_hello_verify(ioa_socket_handle s, const ioa_addr *remote_addr,
+                                          const uint8_t *record_seq) {
+  uint8_t cookie[EVP_MAX_MD_SIZE];
+  const unsigned int cookie_len = calculate_cookie(remote_addr, current_cookie_period(), cookie);
+  if (!cookie_len) {
+    return;
   }
 
-  const int rc = ssl_read(sock->fd, ssl, nbh, server->verbose);
+  uint8_t buf[DTLS_RECORD_HEADER_LENGTH + DTLS_HANDSHAKE_HEADER_LENGTH + 3 + EVP_MAX_MD_SIZE];
+  const size_t body_len = 3 + cookie_len;
+  const size_t msg_len = DTLS_HANDSHAKE_HEADER_LENGTH + body_len;
+
+  uint8_t *p = buf;
+  *p++ = 22; /* handshake */
+  *p++ = 0xfe;
+  *p++ = 0xff;
+  memcpy(p, record_seq, 8);
+  p += 8;
+  *p++ = (uint8_t)(msg_len >> 8);
+  *p++ = (uint8_t)msg_len;
+
+  *p++ = DTLS_HELLO_VERIFY_REQUEST;
+  set_uint24(p, (uint32_t)body_len);
+  p += 3;
+  *p++ = 0;
+  *p++ = 0;
+  set_uint24(p, 0);
+  p += 3;
+  set_uint24(p, (uint32_t)body_len);
+  p += 3;
+
+  *p++ = 0xfe;
+  *p++ = 0xff;
+  *p++ = (uint8_t)cookie_len;
+  memcpy(p, cookie, cookie_len);
+  p += cookie_len;
+
+  udp_send(s, remote_addr, (const char *)buf, (int)(p - buf));
+}
 
-  if (rc < 0) {
-    return NULL;
+/*
+ * Stateless first step of the DTLS server handshake, on the raw datagram of
+ * a source without a session. A ClientHello without a cookie is answered with
+ * a HelloVerifyRequest. Returns true only for an unfragmented ClientHello
+ * that returns a valid cookie: the SSL of the client can be created then.
+ */
+static bool dtls_server_check_hello(ioa_socket_handle s, ioa_network_buffer_handle nbh, const ioa_addr *remote_addr) {
+  const uint8_t *buf = ioa_network_buffer_data(nbh);
+  const size_t len = ioa_network_buffer_get_size(nbh);
+
+  /* handshake record of a DTLS version, epoch 0 */
+  if ((len < DTLS_RECORD_HEADER_LENGTH + DTLS_HANDSHAKE_HEADER_LENGTH) || (buf[0] != 22) || (buf[1] != 0xfe) ||
+      buf[3] || buf[4]) {
+    prom_inc_dtls_cookie_rejected();
+    return false;
   }
 
-  addr_debug_print(server->verbose, remote_addr, "Accepted connection from");
-
-  ioa_socket_handle ioas =
-      create_ioa_socket_from_ssl(server->e, sock, ssl, DTLS_SOCKET, CLIENT_SOCKET, remote_addr, local_addr);
-
-  if (ioas) {
-    set_ioa_socket_buf_size(ioas, server->ts->sock_buf_size);
+  const size_t rec_len = ((size_t)buf[11] << 8) | (size_t)buf[12];
+  const uint8_t *hs = buf + DTLS_RECORD_HEADER_LENGTH;
+  const size_t msg_len = get_uint24(hs + 1);
 
-    addr_cpy(&(server->sm.m.sm.nd.src_addr), remote_addr);
-    server->sm.m.sm.nd.recv_ttl = TTL_IGNORE;
-    server->sm.m.sm.nd.recv_tos = TOS_IGNORE;
-    server->sm.m.sm.s = ioas;
-  } else {
-    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Cannot create ioa_socket from SSL\n");
+  if ((DTLS_RECORD_HEADER_LENGTH + rec_len > len) || (hs[0] != DTLS_CLIENT_HELLO) || get_uint24(hs + 6) ||
+      (get_uint24(hs + 9) != msg_len) || (DTLS_HANDSHAKE_HEADER_LENGTH + msg_len > rec_len)) {
+    prom_inc_dtls_cookie_rejected();
+    return false;
   }
 
-  FUNCEND;
-
-  return ioas;
-}
+  /* client_version, random, session_id, cookie */
+  const uint8_t *body = hs + DTLS_HANDSHAKE_HEADER_LENGTH;
+  size_t pos = 2 + 32;
+  if (pos + 1 > msg_len) {
+    prom_inc_dtls_cookie_rejected();
+    return false;
+  }
+  pos += 1 + body[pos];
+  if (pos + 1 > msg_len) {
+    prom_inc_dtls_cookie_rejected();
+    return false;
+  }
+  const size_t cookie_len = body[pos++];
+  if (pos + cookie_len > msg_len) {
+    prom_inc_dtls_cookie_rejected();
+    return false;
+  }
 
-static ioa_socket_handle dtls_server_input_handler(dtls_listener_relay_server_type *server, ioa_socket_handle s,
-                                                   ioa_network_buffer_handle nbh) {
-  FUNCSTART;
+  if (!cookie_len) {
+    dtls_server_send_hello_verify(s, remote_addr, buf + 3);
+    prom_inc_dtls_hello_verify();
+    return false;
+  }
 
-  if (!server || !nbh) {
-    return NULL;
+  if (!check_cookie(remote_addr, body + pos, cookie_len)) {
+    prom_inc_dtls_cookie_rejected();
+    return false;
   }
 
-  SSL *connecting_ssl = NULL;
+  return true;
+}
 
-  BIO *wbio = NULL;
+/*
+ * SSL of a client that returned a valid cookie. DTLSv1_listen takes its
+ * ClientHello again and sets the handshake up as if this SSL had sent the
+ * HelloVerifyRequest; the server flight is left to ssl_resume_handshake.
+ */
+static SSL *dtls_server_new_ssl(dtls_listener_relay_server_type *server, evutil_socket_t fd,
+                                const ioa_addr *remote_addr, ioa_network_buffer_handle nbh, bool connected) {
   struct timeval timeout;
 
   /* Create BIO */
-  wbio = BIO_new_dgram(s->fd, BIO_NOCLOSE);
-  (void)BIO_dgram_set_peer(wbio, (struct sockaddr *)&(server->sm.m.sm.nd.src_addr));
+  BIO *wbio = BIO_new_dgram(fd, BIO_NOCLOSE);
+  (void)BIO_dgram_set_peer(wbio, (const struct sockaddr *)remote_addr);
+
+  if (connected) {
+    BIO_ctrl(wbio, BIO_CTRL_DGRAM_SET_CONNECTED, 0, (void *)remote_addr);
+  }
 
   /* Set and activate timeouts */
   timeout.tv_sec = DTLS_MAX_RECV_TIMEOUT;
   timeout.tv_usec = 0;
   BIO_ctrl(wbio, BIO_CTRL_DGRAM_SET_RECV_TIMEOUT, 0, &timeout);
 
-  connecting_ssl = SSL_new(server->e->dtls_ctx);
+  BIO *rbio = BIO_new_mem_buf(ioa_network_buffer_data(nbh), (int)ioa_network_buffer_get_size(nbh));
+  BIO_set_mem_eof_return(rbio, -1);
 
-  SSL_set_accept_state(connecting_ssl);
+  SSL *ssl = SSL_new(server->e->dtls_ctx);
 
-  SSL_set_bio(connecting_ssl, NULL, wbio);
-  SSL_set_options(connecting_ssl, SSL_OP_COOKIE_EXCHANGE
+  SSL_set_accept_state(ssl);
+
+  SSL_set_bio(ssl, rbio, wbio);
+  SSL_set_options(ssl, SSL_OP_COOKIE_EXCHANGE
 #if defined(SSL_OP_NO_RENEGOTIATION)
-                                      | SSL_OP_NO_RENEGOTIATION
+                           | SSL_OP_NO_RENEGOTIATION
 #endif
   );
-  SSL_set_max_cert_list(connecting_ssl, 655350);
+  SSL_set_max_cert_list(ssl, 655350);
+
+  BIO_ADDR *client = BIO_ADDR_new();
+  const int rc = DTLSv1_listen(ssl, client);
+  BIO_ADDR_free(client);
+
+  SSL_set0_rbio(ssl, NULL);
+
+  if (rc != 1) {
+    if (eve(server->verbose)) {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "%s: DTLSv1_listen failed: %d\n", __FUNCTION__, rc);
+    }
+    SSL_free(ssl);
+    return NULL;
+  }
+
+  return ssl;
+}
+
+/////////////// io handlers ///////////////////
+
+static ioa_socket_handle dtls_server_input_handler(dtls_listener_relay_server_type *server, ioa_socket_handle s,
+                                                   ioa_network_buffer_handle nbh) {
+  FUNCSTART;
+
+  if (!server || !nbh) {
+    return NULL;
+  }
 
-  ioa_socket_handle rc =
-      dtls_accept_client_connection(server, s, connecting_ssl, &(server->sm.m.sm.nd.src_addr), &(server->addr), nbh);
+  ioa_addr *remote_addr = &(server->sm.m.sm.nd.src_addr);
 
-  if (!rc) {
-    if (!(SSL_get_shutdown(connecting_ssl) & SSL_SENT_SHUTDOWN)) {
-      SSL_set_shutdown(connecting_ssl, SSL_RECEIVED_SHUTDOWN);
-      SSL_shutdown(connecting_ssl);
+  SSL *ssl = dtls_server_new_ssl(server, s->fd, remote_addr, nbh, false);
+  if (!ssl) {
+    return NULL;
+  }
+
+  addr_debug_print(server->verbose, remote_addr, "Accepted connection from");
+
+  ioa_socket_handle ioas =
+      create_ioa_socket_from_ssl(server->e, s, ssl, DTLS_SOCKET, CLIENT_SOCKET, remote_addr, &(server->addr));
+
+  if (!ioas) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Cannot create ioa_socket from SSL\n");
+    SSL_free(ssl);
+    return NULL;
+  }
+
+  set_ioa_socket_buf_size(ioas, server->ts->sock_buf_size);
+
+  /* The server flight: certificate, key exchange */
+  if (tls_handshake_pool_enabled()) {
+    if (!tls_handshake_submit_dtls(ioas, NULL, dtls_server_handshake_done, server)) {
+      IOA_CLOSE_SOCKET(ioas);
+      return NULL;
     }
-    SSL_free(connecting_ssl);
+  } else if (ssl_resume_handshake(s->fd, ssl, server->verbose) < 0) {
+    IOA_CLOSE_SOCKET(ioas);
+    return NULL;
   }
 
-  return rc;
+  server->sm.m.sm.nd.recv_ttl = TTL_IGNORE;
+  server->sm.m.sm.nd.recv_tos = TOS_IGNORE;
+  server->sm.m.sm.s = ioas;
+
+  FUNCEND;
+
+  return ioas;
 }
 
 #endif
 
+/*
+ * Answers a plain Binding request from a source without a session straight
+ * from the listener. Returns true when the datagram has been consumed.
+ */
+static bool udp_server_stateless_binding(dtls_listener_relay_server_type *server, ioa_socket_handle s,
+                                         ioa_network_buffer_handle in_nbh, const ioa_addr *src_addr) {
+  if (turn_params.no_stateless_binding || !(server->ts) || !s) {
+    return false;
+  }
+
+  ioa_network_buffer_handle nbh = ioa_network_buffer_allocate(server->e);
+  if (!stateless_binding_response(server->ts, in_nbh, get_local_addr_from_ioa_socket(s), src_addr, nbh)) {
+    ioa_network_buffer_delete(server->e, nbh);
+    return false;
+  }
+
+  if (server->e->verbose && turn_params.log_binding) {
+    char saddr[MAX_IOA_ADDR_STRING];
+    char rsaddr[MAX_IOA_ADDR_STRING];
+    addr_to_string(get_local_addr_from_ioa_socket(s), saddr);
+    addr_to_string(src_addr, rsaddr);
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "%s: stateless BINDING: local addr %s, remote addr %s\n", __FUNCTION__,
+                  (char *)saddr, (char *)rsaddr);
+  }
+
+  udp_send(s, src_addr, (const char *)ioa_network_buffer_data(nbh), (int)ioa_network_buffer_get_size(nbh));
+  ioa_network_buffer_delete(server->e, nbh);
+
+  return true;
+}
+
 static int handle_udp_packet(dtls_listener_relay_server_type *server, struct message_to_relay *sm,
                              ioa_engine_handle ioa_eng, turn_turnserver *ts) {
   const int verbose = ioa_eng->verbose;
@@ -359,6 +526,19 @@ static int handle_udp_packet(dtls_listener_relay_server_type *server, struct mes
   if (chs && !ioa_socket_tobeclosed(chs) && (chs->sockets_container == amap) && (chs->magic == SOCKET_MAGIC)) {
     s = chs;
     sm->m.sm.s = s;
+#if DTLS_SUPPORTED
+    if (s->handshake) {
+      tls_handshake_dtls_input(s, sm->m.sm.nd.nbh);
+      sm->m.sm.nd.nbh = NULL;
+      return 0;
+    }
+    if (s->ssl && !SSL_is_init_finished(s->ssl) && tls_handshake_pool_enabled()) {
+      if (tls_handshake_submit_dtls(s, sm->m.sm.nd.nbh, dtls_server_handshake_done, server)) {
+        sm->m.sm.nd.nbh = NULL;
+      }
+      return 0;
+    }
+#endif
     if (s->ssl) {
       const int sslret = ssl_read(s->fd, s->ssl, sm->m.sm.nd.nbh, verbose);
       if (sslret < 0) {
@@ -452,12 +632,21 @@ static int handle_udp_packet(dtls_listener_relay_server_type *server, struct mes
 
     chs = NULL;
 
+    if (udp_server_stateless_binding(server, s, sm->m.sm.nd.nbh, &(sm->m.sm.nd.src_addr))) {
+      return 0;
+    }
+
 #if DTLS_SUPPORTED
     if (!turn_params.no_dtls && is_dtls_handshake_message(ioa_network_buffer_data(sm->m.sm.nd.nbh),
                                                           (int)ioa_network_buffer_get_size(sm->m.sm.nd.nbh))) {
-      chs = dtls_server_input_handler(server, s, sm->m.sm.nd.nbh);
+      if (dtls_server_check_hello(s, sm->m.sm.nd.nbh, &(sm->m.sm.nd.src_addr))) {
+        chs = dtls_server_input_handler(server, s, sm->m.sm.nd.nbh);
+      }
       ioa_network_buffer_delete(server->e, sm->m.sm.nd.nbh);
       sm->m.sm.nd.nbh = NULL;
+      if (!chs) {
+        return 0;
+      }
     }
 #endif
 
@@ -494,6 +683,52 @@ static int handle_udp_packet(dtls_listener_relay_server_type *server, struct mes
   return 0;
 }
 
+#if DTLS_SUPPORTED
+/*
+ * The handshake workers are done with the DTLS client socket s. The
+ * datagrams that arrived after its handshake go through the usual path.
+ */
+static void dtls_server_handshake_done(ioa_socket_handle s, int rc, ioa_network_buffer_handle *dgrams,
+                                       size_t dgrams_number, void *arg) {
+  dtls_listener_relay_server_type *server = (dtls_listener_relay_server_type *)arg;
+  ioa_engine_handle ioa_eng = s->e;
+
+  struct message_to_relay sm;
+  memset(&sm, 0, sizeof(sm));
+  sm.t = RMT_SOCKET;
+  addr_cpy(&(sm.m.sm.nd.src_addr), &(s->remote_addr));
+  sm.m.sm.nd.recv_ttl = TTL_IGNORE;
+  sm.m.sm.nd.recv_tos = TOS_IGNORE;
+
+  if (rc < 0) {
+    for (size_t i = 0; i < dgrams_number; ++i) {
+      ioa_network_buffer_delete(ioa_eng, dgrams[i]);
+    }
+    ts_ur_super_session *ss = (ts_ur_super_session *)s->session;
+    if (ss) {
+      turn_turnserver *ts = (turn_turnserver *)ss->server;
+      if (ts) {
+        shutdown_client_connection(ts, ss, 0, "SSL handshake error");
+      }
+    } else {
+      close_ioa_socket(s);
+    }
+    ur_addr_map_del(server->children_ss, &(sm.m.sm.nd.src_addr), NULL);
+    return;
+  }
+
+  for (size_t i = 0; i < dgrams_number; ++i) {
+    sm.m.sm.s = server->udp_listen_s;
+    sm.m.sm.nd.nbh = dgrams[i];
+    handle_udp_packet(server, &sm, ioa_eng, server->ts);
+    if (sm.m.sm.nd.nbh) {
+      ioa_network_buffer_delete(ioa_eng, sm.m.sm.nd.nbh);
+      sm.m.sm.nd.nbh = NULL;
+    }
+  }
+}
+#endif
+
 static int create_new_connected_udp_socket(dtls_listener_relay_server_type *server, ioa_socket_handle s) {
 
   evutil_socket_t udp_fd = socket(s->local_addr.ss.sa_family, CLIENT_DGRAM_SOCKET_TYPE, CLIENT_DGRAM_SOCKET_PROTOCOL);
@@ -558,38 +793,13 @@ static int create_new_connected_udp_socket(dtls_listener_relay_server_type *serv
   if (!turn_params.no_dtls && is_dtls_handshake_message(ioa_network_buffer_data(server->sm.m.sm.nd.nbh),
                                                         (int)ioa_network_buffer_get_size(server->sm.m.sm.nd.nbh))) {
 
-    SSL *connecting_ssl = NULL;
-
-    BIO *wbio = NULL;
-    struct timeval timeout;
-
-    /* Create BIO */
-    wbio = BIO_new_dgram(ret->fd, BIO_NOCLOSE);
-    (void)BIO_dgram_set_peer(wbio, (struct sockaddr *)&(server->sm.m.sm.nd.src_addr));
-
-    BIO_ctrl(wbio, BIO_CTRL_DGRAM_SET_CONNECTED, 0, &(server->sm.m.sm.nd.src_addr));
-
-    /* Set and activate timeouts */
-    timeout.tv_sec = DTLS_MAX_RECV_TIMEOUT;
-    timeout.tv_usec = 0;
-    BIO_ctrl(wbio, BIO_CTRL_DGRAM_SET_RECV_TIMEOUT, 0, &timeout);
-
-    connecting_ssl = SSL_new(server->e->dtls_ctx);
-
-    SSL_set_accept_state(connecting_ssl);
-
-    SSL_set_bio(connecting_ssl, NULL, wbio);
-
-    SSL_set_options(connecting_ssl, SSL_OP_COOKIE_EXCHANGE
-#if defined(SSL_OP_NO_RENEGOTIATION)
-                                        | SSL_OP_NO_RENEGOTIATION
-#endif
-    );
-
-    SSL_set_max_cert_list(connecting_ssl, 655350);
-    const int rc = ssl_read(ret->fd, connecting_ssl, server->sm.m.sm.nd.nbh, server->verbose);
+    SSL *connecting_ssl = dtls_server_new_ssl(server, ret->fd, &(server->sm.m.sm.nd.src_addr), server->sm.m.sm.nd.nbh, true);
+    if (!connecting_ssl) {
+      IOA_CLOSE_SOCKET(ret);
+      return -1;
+    }
 
-    if (rc < 0) {
+    if (ssl_resume_handshake(ret->fd, connecting_ssl, server->verbose) < 0) {
       if (!(SSL_get_shutdown(connecting_ssl) & SSL_SENT_SHUTDOWN)) {
         SSL_set_shutdown(connecting_ssl, SSL_RECEIVED_SHUTDOWN);
         SSL_shutdown(connecting_ssl);
@@ -614,6 +824,114 @@ static int create_new_connected_udp_socket(dtls_listener_relay_server_type *serv
   return server->connect_cb(server->e, &(server->sm));
 }
 
+/*
+ * Validates a datagram received on the listener, and hands it over to the
+ * session handling. Returns false when the datagram has been dropped.
+ */
+static bool udp_server_process_packet(dtls_listener_relay_server_type *server, ioa_socket_handle s,
+                                      ioa_network_buffer_handle elem, size_t bsize) {
+  int rc = 0;
+  ioa_network_buffer_set_size(elem, bsize);
+
+  uint8_t *data = ioa_network_buffer_data(elem);
+
+  const TURN_PACKET_CLASS pclass = turn_packet_classify_str(data, bsize, false);
+  server->packet_classes[pclass] += 1;
+
+  // Do minimal validation on the received UDP packet
+  bool is_valid_packet = false;
+  switch (pclass) {
+  case TURN_PACKET_CHANNEL_DATA:
+  case TURN_PACKET_STUN_REQUEST:
+  case TURN_PACKET_STUN_INDICATION:
+  case TURN_PACKET_STUN_RESPONSE:
+    is_valid_packet = true;
+    break;
+#if DTLS_SUPPORTED
+  case TURN_PACKET_DTLS:
+    is_valid_packet = !turn_params.no_dtls;
+    break;
+#endif
+  default:;
+  }
+
+  if (turn_params.drop_invalid_packets && !is_valid_packet) {
+    packetcounter++;
+    if (turn_params.drop_invalid_packets_log && (packetcounter % 1000 == 0)) {
+      uint8_t txt2pcap[1000]; // 1000 is enough to print ~300B packet (3 chars per byte) with extras
+      print_packet_txt2pcap(packetcounter, data, bsize, txt2pcap, sizeof(txt2pcap));
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_DEBUG, "TXT2PCAP: %s\n", txt2pcap);
+    }
+    return false;
+  }
+
+  if (server->connect_cb) {
+
+    if ((pclass == TURN_PACKET_STUN_REQUEST) &&
+        udp_server_stateless_binding(server, s, elem, &(server->sm.m.sm.nd.src_addr))) {
+      return true;
+    }
+
+#if DTLS_SUPPORTED
+    if (!turn_params.no_dtls && (pclass == TURN_PACKET_DTLS) && is_dtls_handshake_message(data, (int)bsize) &&
+        !dtls_server_check_hello(s, elem, &(server->sm.m.sm.nd.src_addr))) {
+      return true;
+    }
+#endif
+
+    rc = create_new_connected_udp_socket(server, s);
+    if (rc < 0) {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Cannot handle UDP packet, size %d\n", (int)bsize);
+    }
+
+  } else {
+    server->sm.m.sm.s = s;
+    rc = handle_udp_packet(server, &(server->sm), server->e, server->ts);
+  }
+
+  if (rc < 0) {
+    if (eve(server->e->verbose)) {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Cannot handle UDP event\n");
+    }
+  }
+
+  return true;
+}
+
+/*
+ * Datagram steered to this listener by an AF_XDP socket of the engine.
+ * The replies still go out through the listener socket.
+ */
+static void udp_server_xdp_input_handler(void *arg, const ioa_addr *src_addr, int ttl, int tos,
+                                         const uint8_t *payload, size_t len) {
+  dtls_listener_relay_server_type *server = (dtls_listener_relay_server_type *)arg;
+  if (!server || !(server->udp_listen_s) || !len || (len > ioa_network_buffer_get_capacity_udp())) {
+    return;
+  }
+
+  ioa_network_buffer_handle elem = ioa_network_buffer_allocate(server->e);
+  memcpy(ioa_network_buffer_data(elem), payload, len);
+
+  server->sm.m.sm.nd.nbh = elem;
+  server->sm.m.sm.nd.recv_ttl = ttl;
+  server->sm.m.sm.nd.recv_tos = tos;
+  server->sm.m.sm.can_resume = 1;
+  addr_cpy(&(server->sm.m.sm.nd.src_addr), src_addr);
+
+  if (udp_server_process_packet(server, server->udp_listen_s, elem, len)) {
+    prom_inc_packet_processed(1);
+  } else {
+    prom_inc_packet_dropped(1);
+  }
+  prom_inc_packet_classes(server->packet_classes);
+  memset(server->packet_classes, 0, sizeof(server->packet_classes));
+
+  if (server->sm.m.sm.nd.nbh != NULL) {
+    ioa_network_buffer_delete(server->e, server->sm.m.sm.nd.nbh);
+    server->sm.m.sm.nd.nbh = NULL;
+  }
+}
+
 static void udp_server_input_handler(evutil_socket_t fd, short what, void *arg) {
 
   if (!arg) {
@@ -733,54 +1051,10 @@ start_udp_cycle:
   }
 
   if (bsize > 0) {
-
-    int rc = 0;
-    ioa_network_buffer_set_size(elem, (size_t)bsize);
-
-    // Do minimal validation on the received UDP packet
-    // stun_is_channel_message_str and stun_is_command_message_str
-    size_t blen = bsize;
-    uint16_t chnum = 0;
-    uint8_t *data = ioa_network_buffer_data(elem);
-
-    bool is_valid_packet = false;
-    if (stun_is_channel_message_str(data, &blen, &chnum, false) || stun_is_command_message_str(data, blen)) {
-      is_valid_packet = true;
-    }
-#if DTLS_SUPPORTED
-    else if (!turn_params.no_dtls && is_dtls_message(data, blen)) {
-      is_valid_packet = true;
-    }
-#endif
-
-    if (turn_params.drop_invalid_packets && !is_valid_packet) {
-      packetcounter++;
-      if (turn_params.drop_invalid_packets_log && (packetcounter % 1000 == 0)) {
-        uint8_t txt2pcap[1000]; // 1000 is enough to print ~300B packet (3 chars per byte) with extras
-        print_packet_txt2pcap(packetcounter, data, blen, txt2pcap, sizeof(txt2pcap));
-        TURN_LOG_FUNC(TURN_LOG_LEVEL_DEBUG, "TXT2PCAP: %s\n", txt2pcap);
-      }
-      ++packets_dropped;
-    } else {
+    if (udp_server_process_packet(server, s, elem, (size_t)bsize)) {
       ++packets_processed;
-
-      if (server->connect_cb) {
-
-        rc = create_new_connected_udp_socket(server, s);
-        if (rc < 0) {
-          TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Cannot handle UDP packet, size %d\n", (int)bsize);
-        }
-
-      } else {
-        server->sm.m.sm.s = s;
-        rc = handle_udp_packet(server, &(server->sm), server->e, server->ts);
-      }
-
-      if (rc < 0) {
-        if (eve(server->e->verbose)) {
-          TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Cannot handle UDP event\n");
-        }
-      }
+    } else {
+      ++packets_dropped;
     }
   }
 
@@ -801,6 +1075,8 @@ start_udp_cycle:
 
   prom_inc_packet_dropped(packets_dropped);
   prom_inc_packet_processed(packets_processed);
+  prom_inc_packet_classes(server->packet_classes);
+  memset(server->packet_classes, 0, sizeof(server->packet_classes));
 
   FUNCEND;
 }
@@ -831,6 +1107,11 @@ static int create_server_socket(dtls_listener_relay_server_type *server, int rep
 
     set_ioa_socket_buf_size(server->udp_listen_s, sock_buf_size);
 
+    /* before the bind, when the socket joins the SO_REUSEPORT group */
+    if (server->e->cpu >= 0) {
+      turn_socket_set_incoming_cpu(udp_listen_fd, server->e->cpu);
+    }
+
     if (sock_bind_to_device(udp_listen_fd, (unsigned char *)server->ifname) < 0) {
       TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "Cannot bind listener socket to device %s\n", server->ifname);
     }
@@ -917,6 +1198,10 @@ static int reopen_server_socket(dtls_listener_relay_server_type *server, evutil_
     set_socket_options(server->udp_listen_s);
     set_ioa_socket_buf_size(server->udp_listen_s, server->ts->sock_buf_size);
 
+    if (server->e->cpu >= 0) {
+      turn_socket_set_incoming_cpu(udp_listen_fd, server->e->cpu);
+    }
+
     if (sock_bind_to_device(udp_listen_fd, (unsigned char *)server->ifname) < 0) {
       TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Cannot bind listener socket to device %s. Error: %s\n", server->ifname,
                     strerror(errno));
@@ -989,7 +1274,15 @@ static int init_server(dtls_listener_relay_server_type *server, const char *ifna
 
   server->e = e;
 
-  return create_server_socket(server, report_creation, sock_buf_size);
+  if (create_server_socket(server, report_creation, sock_buf_size) < 0) {
+    return -1;
+  }
+
+  if (xdp_sockets_enabled()) {
+    xdp_socket_add_listener(e, &(server->addr), udp_server_xdp_input_handler, server);
+  }
+
+  return 0;
 }
 
 static int clean_server(dtls_listener_relay_server_type *server) {
@@ -1014,6 +1307,14 @@ void setup_dtls_callbacks(SSL_CTX *ctx) {
   SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER | SSL_VERIFY_CLIENT_ONCE, dtls_verify_callback);
 #endif
 
+  static bool cookie_secret_set = false;
+  if (!cookie_secret_set) {
+    if (RAND_bytes(cookie_secret, COOKIE_SECRET_LENGTH) != 1) {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "%s: cannot generate the DTLS cookie secret\n", __FUNCTION__);
+    }
+    cookie_secret_set = true;
+  }
+
   SSL_CTX_set_cookie_generate_cb(ctx, generate_cookie);
   SSL_CTX_set_cookie_verify_cb(ctx, verify_cookie);
 }
@@ -1043,6 +1344,12 @@ ioa_engine_handle get_engine(dtls_listener_relay_server_type *server) {
   return NULL;
 }
 
+void udp_listener_set_incoming_cpu(dtls_listener_relay_server_type *server, int cpu) {
+  if (server && server->udp_listen_s && (server->udp_listen_s->fd >= 0) && (cpu >= 0)) {
+    turn_socket_set_incoming_cpu(server->udp_listen_s->fd, cpu);
+  }
+}
+
 //////////// UDP send ////////////////
 
 void udp_send_message(dtls_listener_relay_server_type *server, ioa_network_buffer_handle nbh, ioa_addr *dest) {
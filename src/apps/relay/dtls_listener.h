@@ -69,6 +69,9 @@ void udp_send_message(dtls_listener_relay_server_type *server, ioa_network_buffe
 
 ioa_engine_handle get_engine(dtls_listener_relay_server_type *server);
 
+/* For the listeners created before their thread was pinned to cpu */
+void udp_listener_set_incoming_cpu(dtls_listener_relay_server_type *server, int cpu);
+
 ///////////////////////////////////////////
 
 #ifdef __cplusplus
@@ -0,0 +1,273 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "kernel_channels.h"
+
+#include "ns_turn_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(TURN_NO_BPF)
+
+#include "bpf/turn_channels_maps.h"
+
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+#include <linux/if_link.h>
+#include <net/if.h>
+
+typedef struct _kernel_channel {
+  struct turn_kc_client_key client_key;
+  struct turn_kc_peer_key peer_key;
+  /* counters already reported to the session */
+  uint64_t client_packets;
+  uint64_t client_bytes;
+  uint64_t peer_packets;
+  uint64_t peer_bytes;
+} kernel_channel;
+
+static struct bpf_object *kc_obj = NULL;
+static int kc_client_map_fd = -1;
+static int kc_peer_map_fd = -1;
+static int kc_ifindex = 0;
+static uint32_t kc_xdp_flags = 0;
+
+int kernel_channels_init(const char *ifname, const char *object_file) {
+  if (!ifname || !ifname[0]) {
+    return -1;
+  }
+
+  if (!object_file || !object_file[0]) {
+    object_file = DEFAULT_KERNEL_CHANNELS_OBJECT;
+  }
+
+  kc_ifindex = (int)if_nametoindex(ifname);
+  if (!kc_ifindex) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "kernel channels: cannot find network interface %s\n", ifname);
+    return -1;
+  }
+
+  kc_obj = bpf_object__open_file(object_file, NULL);
+  if (!kc_obj) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "kernel channels: cannot open BPF object %s\n", object_file);
+    return -1;
+  }
+
+  if (bpf_object__load(kc_obj) < 0) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "kernel channels: cannot load BPF object %s\n", object_file);
+    goto err;
+  }
+
+  struct bpf_program *prog = bpf_object__find_program_by_name(kc_obj, TURN_KC_PROG_NAME);
+  if (!prog) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "kernel channels: program %s not found in %s\n", TURN_KC_PROG_NAME,
+                  object_file);
+    goto err;
+  }
+
+  kc_client_map_fd = bpf_object__find_map_fd_by_name(kc_obj, TURN_KC_CLIENT_MAP_NAME);
+  kc_peer_map_fd = bpf_object__find_map_fd_by_name(kc_obj, TURN_KC_PEER_MAP_NAME);
+  if (kc_client_map_fd < 0 || kc_peer_map_fd < 0) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "kernel channels: maps not found in %s\n", object_file);
+    goto err;
+  }
+
+  /* Native (driver) mode first, then the generic mode that works on any device (veth etc) */
+  kc_xdp_flags = XDP_FLAGS_UPDATE_IF_NOEXIST | XDP_FLAGS_DRV_MODE;
+  if (bpf_xdp_attach(kc_ifindex, bpf_program__fd(prog), kc_xdp_flags, NULL) < 0) {
+    kc_xdp_flags = XDP_FLAGS_UPDATE_IF_NOEXIST | XDP_FLAGS_SKB_MODE;
+    if (bpf_xdp_attach(kc_ifindex, bpf_program__fd(prog), kc_xdp_flags, NULL) < 0) {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "kernel channels: cannot attach XDP program to %s\n", ifname);
+      goto err;
+    }
+  }
+
+  TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "kernel channels: XDP program attached to %s (%s mode)\n", ifname,
+                (kc_xdp_flags & XDP_FLAGS_DRV_MODE) ? "native" : "generic");
+
+  return 0;
+
+err:
+  bpf_object__close(kc_obj);
+  kc_obj = NULL;
+  kc_client_map_fd = -1;
+  kc_peer_map_fd = -1;
+  return -1;
+}
+
+void kernel_channels_shutdown(void) {
+  if (kc_obj) {
+    bpf_xdp_detach(kc_ifindex, kc_xdp_flags & ~XDP_FLAGS_UPDATE_IF_NOEXIST, NULL);
+    bpf_object__close(kc_obj);
+    kc_obj = NULL;
+    kc_client_map_fd = -1;
+    kc_peer_map_fd = -1;
+  }
+}
+
+bool kernel_channels_enabled(void) { return (kc_client_map_fd >= 0) && (kc_peer_map_fd >= 0); }
+
+TURN_CHANNEL_HANDLER_KERNEL create_turn_channel_kernel(uint16_t channel_number, int address_family_client,
+                                                       int address_family_peer, int protocol_client,
+                                                       const ioa_addr *client_addr, const ioa_addr *local_addr,
+                                                       const ioa_addr *local_relay_addr, const ioa_addr *peer_addr) {
+  /* The XDP program handles plain IPv4 UDP only */
+  if (!kernel_channels_enabled() || (address_family_client != AF_INET) || (address_family_peer != AF_INET) ||
+      (protocol_client != IPPROTO_UDP)) {
+    return NULL;
+  }
+
+  if (!client_addr || !local_addr || !local_relay_addr || !peer_addr) {
+    return NULL;
+  }
+
+  kernel_channel *kc = (kernel_channel *)calloc(1, sizeof(kernel_channel));
+  if (!kc) {
+    return NULL;
+  }
+
+  struct turn_kc_value cv;
+  memset(&cv, 0, sizeof(cv));
+  kc->client_key.client_ip = client_addr->s4.sin_addr.s_addr;
+  kc->client_key.client_port = client_addr->s4.sin_port;
+  kc->client_key.server_ip = local_addr->s4.sin_addr.s_addr;
+  kc->client_key.server_port = local_addr->s4.sin_port;
+  kc->client_key.chnum = channel_number;
+  cv.src_ip = local_relay_addr->s4.sin_addr.s_addr;
+  cv.src_port = local_relay_addr->s4.sin_port;
+  cv.dst_ip = peer_addr->s4.sin_addr.s_addr;
+  cv.dst_port = peer_addr->s4.sin_port;
+
+  struct turn_kc_value pv;
+  memset(&pv, 0, sizeof(pv));
+  kc->peer_key.peer_ip = peer_addr->s4.sin_addr.s_addr;
+  kc->peer_key.peer_port = peer_addr->s4.sin_port;
+  kc->peer_key.relay_ip = local_relay_addr->s4.sin_addr.s_addr;
+  kc->peer_key.relay_port = local_relay_addr->s4.sin_port;
+  pv.src_ip = local_addr->s4.sin_addr.s_addr;
+  pv.src_port = local_addr->s4.sin_port;
+  pv.dst_ip = client_addr->s4.sin_addr.s_addr;
+  pv.dst_port = client_addr->s4.sin_port;
+  pv.chnum = channel_number;
+
+  if (bpf_map_update_elem(kc_client_map_fd, &(kc->client_key), &cv, BPF_ANY) < 0) {
+    free(kc);
+    return NULL;
+  }
+
+  if (bpf_map_update_elem(kc_peer_map_fd, &(kc->peer_key), &pv, BPF_ANY) < 0) {
+    bpf_map_delete_elem(kc_client_map_fd, &(kc->client_key));
+    free(kc);
+    return NULL;
+  }
+
+  return (TURN_CHANNEL_HANDLER_KERNEL)kc;
+}
+
+void delete_turn_channel_kernel(TURN_CHANNEL_HANDLER_KERNEL handler) {
+  kernel_channel *kc = (kernel_channel *)handler;
+  if (kc) {
+    if (kernel_channels_enabled()) {
+      bpf_map_delete_elem(kc_client_map_fd, &(kc->client_key));
+      bpf_map_delete_elem(kc_peer_map_fd, &(kc->peer_key));
+    }
+    free(kc);
+  }
+}
+
+int get_turn_channel_kernel_traffic(TURN_CHANNEL_HANDLER_KERNEL handler, turn_channel_kernel_traffic *traffic) {
+  kernel_channel *kc = (kernel_channel *)handler;
+  if (!kc || !traffic || !kernel_channels_enabled()) {
+    return -1;
+  }
+
+  struct turn_kc_value cv;
+  struct turn_kc_value pv;
+  if ((bpf_map_lookup_elem(kc_client_map_fd, &(kc->client_key), &cv) < 0) ||
+      (bpf_map_lookup_elem(kc_peer_map_fd, &(kc->peer_key), &pv) < 0)) {
+    return -1;
+  }
+
+  traffic->client_packets = cv.packets - kc->client_packets;
+  traffic->client_bytes = cv.bytes - kc->client_bytes;
+  traffic->peer_packets = pv.packets - kc->peer_packets;
+  traffic->peer_bytes = pv.bytes - kc->peer_bytes;
+
+  kc->client_packets = cv.packets;
+  kc->client_bytes = cv.bytes;
+  kc->peer_packets = pv.packets;
+  kc->peer_bytes = pv.bytes;
+
+  return 0;
+}
+
+#else /* TURN_NO_BPF */
+
+int kernel_channels_init(const char *ifname, const char *object_file) {
+  UNUSED_ARG(object_file);
+  if (ifname && ifname[0]) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_WARNING, "kernel channels are not supported in this build (no libbpf)\n");
+  }
+  return -1;
+}
+
+void kernel_channels_shutdown(void) {}
+
+bool kernel_channels_enabled(void) { return false; }
+
+TURN_CHANNEL_HANDLER_KERNEL create_turn_channel_kernel(uint16_t channel_number, int address_family_client,
+                                                       int address_family_peer, int protocol_client,
+                                                       const ioa_addr *client_addr, const ioa_addr *local_addr,
+                                                       const ioa_addr *local_relay_addr, const ioa_addr *peer_addr) {
+  UNUSED_ARG(channel_number);
+  UNUSED_ARG(address_family_client);
+  UNUSED_ARG(address_family_peer);
+  UNUSED_ARG(protocol_client);
+  UNUSED_ARG(client_addr);
+  UNUSED_ARG(local_addr);
+  UNUSED_ARG(local_relay_addr);
+  UNUSED_ARG(peer_addr);
+  return NULL;
+}
+
+void delete_turn_channel_kernel(TURN_CHANNEL_HANDLER_KERNEL handler) { UNUSED_ARG(handler); }
+
+int get_turn_channel_kernel_traffic(TURN_CHANNEL_HANDLER_KERNEL handler, turn_channel_kernel_traffic *traffic) {
+  UNUSED_ARG(handler);
+  UNUSED_ARG(traffic);
+  return -1;
+}
+
+#endif /* TURN_NO_BPF */
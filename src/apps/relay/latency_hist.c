@@ -0,0 +1,255 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "latency_hist.h"
+
+#include "ns_turn_msg_defs.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//////////////////////////////////////////////////
+
+const double turn_latency_quantiles[TURN_LATENCY_QUANTILES_NUMBER] = {0.5, 0.9, 0.99, 0.999};
+
+static const char *turn_latency_op_names[TURN_LATENCY_OPS_NUMBER] = {
+    "allocate", "refresh", "create_permission", "channel_bind", "connect",      "connection_bind",
+    "binding",  "auth",    "db",                "tls_handshake", "dtls_handshake"};
+
+typedef struct _latency_hist {
+  atomic_uint_fast64_t count;
+  atomic_uint_fast64_t sum_us;
+  atomic_uint_fast64_t max_us;
+  atomic_uint_fast64_t buckets[TURN_LATENCY_BUCKETS_NUMBER];
+} latency_hist;
+
+/* One per thread, written by its thread only */
+typedef struct _latency_shard {
+  struct _latency_shard *next;
+  char thread[TURN_LATENCY_THREAD_NAME_SIZE];
+  latency_hist ops[TURN_LATENCY_OPS_NUMBER];
+} latency_shard;
+
+static _Atomic(latency_shard *) latency_shards = NULL;
+static _Thread_local latency_shard *latency_thread_shard = NULL;
+
+const char *turn_latency_op_name(TURN_LATENCY_OP op) {
+  if ((op < 0) || (op >= TURN_LATENCY_OPS_NUMBER)) {
+    return "unknown";
+  }
+  return turn_latency_op_names[op];
+}
+
+uint64_t turn_time_us(void) {
+  struct timespec tp = {0, 0};
+  clock_gettime(CLOCK_MONOTONIC, &tp);
+  return (uint64_t)tp.tv_sec * 1000000 + (uint64_t)(tp.tv_nsec / 1000);
+}
+
+static inline size_t latency_bucket(uint64_t us) {
+  if (us < (1 << TURN_LATENCY_SUB_BUCKET_BITS)) {
+    return (size_t)us;
+  }
+#if defined(__GNUC__)
+  int m = 63 - __builtin_clzll(us);
+#else
+  int m = TURN_LATENCY_SUB_BUCKET_BITS;
+  while (us >> (m + 1)) {
+    ++m;
+  }
+#endif
+  if (m > TURN_LATENCY_MAX_MAGNITUDE) {
+    return TURN_LATENCY_BUCKETS_NUMBER - 1;
+  }
+  const size_t sub = (size_t)(us >> (m - TURN_LATENCY_SUB_BUCKET_BITS)) & ((1 << TURN_LATENCY_SUB_BUCKET_BITS) - 1);
+  return ((size_t)(m - TURN_LATENCY_SUB_BUCKET_BITS + 1) << TURN_LATENCY_SUB_BUCKET_BITS) + sub;
+}
+
+/* The highest value of the bucket */
+static uint64_t latency_bucket_value(size_t b) {
+  if (b < (1 << TURN_LATENCY_SUB_BUCKET_BITS)) {
+    return (uint64_t)b;
+  }
+  const int m = (int)(b >> TURN_LATENCY_SUB_BUCKET_BITS) + TURN_LATENCY_SUB_BUCKET_BITS - 1;
+  const uint64_t sub = (b & ((1 << TURN_LATENCY_SUB_BUCKET_BITS) - 1)) + (1 << TURN_LATENCY_SUB_BUCKET_BITS);
+  return ((sub + 1) << (m - TURN_LATENCY_SUB_BUCKET_BITS)) - 1;
+}
+
+static inline void latency_add(atomic_uint_fast64_t *c, uint64_t v) {
+  atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + v, memory_order_relaxed);
+}
+
+/* The name is set before the shard is published, and never changes */
+static latency_shard *latency_thread_shard_get(const char *thread) {
+  latency_shard *sh = latency_thread_shard;
+  if (!sh) {
+    sh = (latency_shard *)calloc(1, sizeof(latency_shard));
+    if (!sh) {
+      return NULL;
+    }
+    STRCPY(sh->thread, thread);
+    sh->next = atomic_load_explicit(&latency_shards, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&latency_shards, &(sh->next), sh, memory_order_release,
+                                                  memory_order_relaxed)) {
+    }
+    latency_thread_shard = sh;
+  }
+  return sh;
+}
+
+void turn_latency_set_thread_name(const char *name) {
+  if (name && name[0] && !latency_thread_shard) {
+    latency_thread_shard_get(name);
+  }
+}
+
+void turn_latency_record(TURN_LATENCY_OP op, uint64_t start_us) {
+  if (!start_us || (op < 0) || (op >= TURN_LATENCY_OPS_NUMBER)) {
+    return;
+  }
+
+  latency_shard *sh = latency_thread_shard_get(TURN_LATENCY_THREAD_OTHER);
+  if (!sh) {
+    return;
+  }
+
+  const uint64_t now = turn_time_us();
+  const uint64_t us = (now > start_us) ? (now - start_us) : 0;
+
+  latency_hist *h = &(sh->ops[op]);
+  latency_add(&(h->buckets[latency_bucket(us)]), 1);
+  latency_add(&(h->sum_us), us);
+  if (us > atomic_load_explicit(&(h->max_us), memory_order_relaxed)) {
+    atomic_store_explicit(&(h->max_us), us, memory_order_relaxed);
+  }
+  /* last: a reader never sees more requests than bucket entries */
+  atomic_store_explicit(&(h->count), atomic_load_explicit(&(h->count), memory_order_relaxed) + 1,
+                        memory_order_release);
+}
+
+void turn_latency_summarize(TURN_LATENCY_OP op, turn_latency_summary *summary) {
+  turn_latency_summarize_thread(NULL, op, summary);
+}
+
+void turn_latency_summarize_thread(const char *thread, TURN_LATENCY_OP op, turn_latency_summary *summary) {
+  if (!summary) {
+    return;
+  }
+  memset(summary, 0, sizeof(turn_latency_summary));
+  if ((op < 0) || (op >= TURN_LATENCY_OPS_NUMBER)) {
+    return;
+  }
+
+  uint64_t buckets[TURN_LATENCY_BUCKETS_NUMBER];
+  memset(buckets, 0, sizeof(buckets));
+
+  for (latency_shard *sh = atomic_load_explicit(&latency_shards, memory_order_acquire); sh; sh = sh->next) {
+    if (thread && strcmp(sh->thread, thread)) {
+      continue;
+    }
+    latency_hist *h = &(sh->ops[op]);
+    summary->count += atomic_load_explicit(&(h->count), memory_order_acquire);
+    summary->sum_us += atomic_load_explicit(&(h->sum_us), memory_order_relaxed);
+    const uint64_t max_us = atomic_load_explicit(&(h->max_us), memory_order_relaxed);
+    if (max_us > summary->max_us) {
+      summary->max_us = max_us;
+    }
+    for (size_t b = 0; b < TURN_LATENCY_BUCKETS_NUMBER; ++b) {
+      buckets[b] += atomic_load_explicit(&(h->buckets[b]), memory_order_relaxed);
+    }
+  }
+
+  if (!(summary->count)) {
+    return;
+  }
+
+  uint64_t seen = 0;
+  size_t q = 0;
+  for (size_t b = 0; (b < TURN_LATENCY_BUCKETS_NUMBER) && (q < TURN_LATENCY_QUANTILES_NUMBER); ++b) {
+    seen += buckets[b];
+    while ((q < TURN_LATENCY_QUANTILES_NUMBER) && (seen >= turn_latency_quantiles[q] * (double)summary->count)) {
+      const uint64_t v = latency_bucket_value(b);
+      summary->quantiles_us[q++] = (v < summary->max_us) ? v : summary->max_us;
+    }
+  }
+  while (q < TURN_LATENCY_QUANTILES_NUMBER) {
+    summary->quantiles_us[q++] = summary->max_us;
+  }
+}
+
+void turn_latency_foreach_thread(turn_latency_thread_cb cb, void *arg) {
+  if (!cb) {
+    return;
+  }
+  latency_shard *first = atomic_load_explicit(&latency_shards, memory_order_acquire);
+  for (latency_shard *sh = first; sh; sh = sh->next) {
+    /* once per name: the threads without a name share TURN_LATENCY_THREAD_OTHER */
+    latency_shard *prev = first;
+    while ((prev != sh) && strcmp(prev->thread, sh->thread)) {
+      prev = prev->next;
+    }
+    if (prev == sh) {
+      cb(sh->thread, arg);
+    }
+  }
+}
+
+void turn_report_request_latency(uint16_t method, uint64_t start_us) {
+  switch (method) {
+  case STUN_METHOD_ALLOCATE:
+    turn_latency_record(TURN_LATENCY_ALLOCATE, start_us);
+    break;
+  case STUN_METHOD_REFRESH:
+    turn_latency_record(TURN_LATENCY_REFRESH, start_us);
+    break;
+  case STUN_METHOD_CREATE_PERMISSION:
+    turn_latency_record(TURN_LATENCY_CREATE_PERMISSION, start_us);
+    break;
+  case STUN_METHOD_CHANNEL_BIND:
+    turn_latency_record(TURN_LATENCY_CHANNEL_BIND, start_us);
+    break;
+  case STUN_METHOD_CONNECT:
+    turn_latency_record(TURN_LATENCY_CONNECT, start_us);
+    break;
+  case STUN_METHOD_CONNECTION_BIND:
+    turn_latency_record(TURN_LATENCY_CONNECTION_BIND, start_us);
+    break;
+  case STUN_METHOD_BINDING:
+    turn_latency_record(TURN_LATENCY_BINDING, start_us);
+    break;
+  default:;
+  }
+}
@@ -0,0 +1,117 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Latency histograms of the control plane operations
+ */
+
+#ifndef __LATENCY_HIST__
+#define __LATENCY_HIST__
+
+#include "ns_turn_ioalib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//////////////////////////////////////////////////
+
+enum _TURN_LATENCY_OP {
+  TURN_LATENCY_ALLOCATE,
+  TURN_LATENCY_REFRESH,
+  TURN_LATENCY_CREATE_PERMISSION,
+  TURN_LATENCY_CHANNEL_BIND,
+  TURN_LATENCY_CONNECT,
+  TURN_LATENCY_CONNECTION_BIND,
+  TURN_LATENCY_BINDING,
+  /* relay thread -> auth thread -> relay thread */
+  TURN_LATENCY_AUTH,
+  /* user database driver call */
+  TURN_LATENCY_DB,
+  TURN_LATENCY_TLS_HANDSHAKE,
+  TURN_LATENCY_DTLS_HANDSHAKE,
+  TURN_LATENCY_OPS_NUMBER
+};
+
+typedef enum _TURN_LATENCY_OP TURN_LATENCY_OP;
+
+/*
+ * Log-linear buckets of microseconds: 8 buckets per power of two, so that a
+ * value is known within 12.5%, up to 2^30 microseconds.
+ */
+#define TURN_LATENCY_SUB_BUCKET_BITS (3)
+#define TURN_LATENCY_MAX_MAGNITUDE (29)
+#define TURN_LATENCY_BUCKETS_NUMBER ((TURN_LATENCY_MAX_MAGNITUDE - 1) << TURN_LATENCY_SUB_BUCKET_BITS)
+
+#define TURN_LATENCY_QUANTILES_NUMBER (4)
+extern const double turn_latency_quantiles[TURN_LATENCY_QUANTILES_NUMBER];
+
+typedef struct _turn_latency_summary {
+  uint64_t count;
+  uint64_t sum_us;
+  uint64_t max_us;
+  /* at turn_latency_quantiles */
+  uint64_t quantiles_us[TURN_LATENCY_QUANTILES_NUMBER];
+} turn_latency_summary;
+
+#define TURN_LATENCY_THREAD_NAME_SIZE (32)
+/* The threads that record before (or without) naming themselves */
+#define TURN_LATENCY_THREAD_OTHER "other"
+
+const char *turn_latency_op_name(TURN_LATENCY_OP op);
+
+/* Names the histograms of the calling thread; only before its first record */
+void turn_latency_set_thread_name(const char *name);
+
+/* Any thread, without locks: the histograms are kept per thread */
+void turn_latency_record(TURN_LATENCY_OP op, uint64_t start_us);
+
+/* Merges the histograms of all threads */
+void turn_latency_summarize(TURN_LATENCY_OP op, turn_latency_summary *summary);
+
+/* Merges the histograms of the threads named thread; all threads when NULL */
+void turn_latency_summarize_thread(const char *thread, TURN_LATENCY_OP op, turn_latency_summary *summary);
+
+typedef void (*turn_latency_thread_cb)(const char *thread, void *arg);
+
+/* Each thread name with histograms, once */
+void turn_latency_foreach_thread(turn_latency_thread_cb cb, void *arg);
+
+//////////////////////////////////////////////////
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LATENCY_HIST__ */
@@ -0,0 +1,218 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "loop_stats.h"
+
+#include "ns_turn_utils.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//////////////////////////////////////////////////
+
+#define LOOP_STATS_READ_ATTEMPTS (16)
+
+struct _loop_stats {
+  struct _loop_stats *next;
+  struct event_base *eb;
+  struct event *probe;
+  loop_stats_window_cb window_cb;
+  void *window_arg;
+  /* owner thread only */
+  uint64_t probe_due_us;
+  int probes;
+  uint64_t iterations;
+  uint64_t callbacks;
+  uint64_t lateness_sum_us;
+  uint64_t lateness_max_us;
+  uint64_t window_start_us;
+  uint64_t window_start_cpu_us;
+  uint64_t window_start_iterations;
+  uint64_t window_start_callbacks;
+  /* published under the sequence lock, odd while written */
+  atomic_uint seq;
+  loop_stats_snapshot published;
+};
+
+static _Atomic(loop_stats *) loop_stats_list = NULL;
+
+static uint64_t loop_stats_cpu_us(void) {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+  struct timespec tp = {0, 0};
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &tp) == 0) {
+    return (uint64_t)tp.tv_sec * 1000000 + (uint64_t)(tp.tv_nsec / 1000);
+  }
+#endif
+  return 0;
+}
+
+static void loop_stats_publish(loop_stats *ls, uint64_t now) {
+  const uint64_t cpu = loop_stats_cpu_us();
+
+  const unsigned int seq = atomic_load_explicit(&(ls->seq), memory_order_relaxed);
+  atomic_store_explicit(&(ls->seq), seq + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  ls->published.iterations = ls->iterations;
+  ls->published.window_us = now - ls->window_start_us;
+  ls->published.busy_us = (cpu > ls->window_start_cpu_us) ? (cpu - ls->window_start_cpu_us) : 0;
+  ls->published.window_iterations = ls->iterations - ls->window_start_iterations;
+  ls->published.window_callbacks = ls->callbacks - ls->window_start_callbacks;
+  ls->published.lateness_avg_us = ls->probes ? (ls->lateness_sum_us / (uint64_t)ls->probes) : 0;
+  ls->published.lateness_max_us = ls->lateness_max_us;
+
+  atomic_store_explicit(&(ls->seq), seq + 2, memory_order_release);
+
+  if (ls->window_cb) {
+    ls->window_cb(&(ls->published), ls->window_arg);
+  }
+
+  ls->window_start_us = now;
+  ls->window_start_cpu_us = cpu;
+  ls->window_start_iterations = ls->iterations;
+  ls->window_start_callbacks = ls->callbacks;
+  ls->probes = 0;
+  ls->lateness_sum_us = 0;
+  ls->lateness_max_us = 0;
+}
+
+static void loop_stats_probe_add(loop_stats *ls) {
+  struct timeval tv;
+  tv.tv_sec = LOOP_STATS_PROBE_INTERVAL_US / 1000000;
+  tv.tv_usec = LOOP_STATS_PROBE_INTERVAL_US % 1000000;
+  ls->probe_due_us = turn_time_us() + LOOP_STATS_PROBE_INTERVAL_US;
+  evtimer_add(ls->probe, &tv);
+}
+
+static void loop_stats_probe_cb(evutil_socket_t fd, short what, void *arg) {
+  UNUSED_ARG(fd);
+  UNUSED_ARG(what);
+
+  loop_stats *ls = (loop_stats *)arg;
+
+  const uint64_t now = turn_time_us();
+  const uint64_t lateness = (now > ls->probe_due_us) ? (now - ls->probe_due_us) : 0;
+  ls->lateness_sum_us += lateness;
+  if (lateness > ls->lateness_max_us) {
+    ls->lateness_max_us = lateness;
+  }
+
+  if (++(ls->probes) >= LOOP_STATS_WINDOW_PROBES) {
+    loop_stats_publish(ls, now);
+  }
+
+  loop_stats_probe_add(ls);
+}
+
+loop_stats *loop_stats_new(struct event_base *eb, const char *name, loop_stats_window_cb window_cb, void *arg) {
+  if (!eb) {
+    return NULL;
+  }
+
+  loop_stats *ls = (loop_stats *)calloc(1, sizeof(loop_stats));
+  if (!ls) {
+    return NULL;
+  }
+
+  ls->eb = eb;
+  ls->window_cb = window_cb;
+  ls->window_arg = arg;
+  ls->probe = evtimer_new(eb, loop_stats_probe_cb, ls);
+  if (!(ls->probe)) {
+    free(ls);
+    return NULL;
+  }
+
+  atomic_init(&(ls->seq), 0);
+  STRCPY(ls->published.name, name ? name : "");
+  ls->window_start_us = turn_time_us();
+  ls->window_start_cpu_us = loop_stats_cpu_us();
+  loop_stats_probe_add(ls);
+
+  ls->next = atomic_load_explicit(&loop_stats_list, memory_order_relaxed);
+  while (!atomic_compare_exchange_weak_explicit(&loop_stats_list, &(ls->next), ls, memory_order_release,
+                                                memory_order_relaxed)) {
+  }
+
+  return ls;
+}
+
+void loop_stats_dispatch(loop_stats *ls) {
+  if (!ls) {
+    return;
+  }
+
+  /* The exit flags of the previous dispatch are only cleared by the next loop */
+  do {
+    if (event_base_loop(ls->eb, EVLOOP_ONCE) != 0) {
+      break;
+    }
+    ++(ls->iterations);
+    ls->callbacks += (uint64_t)event_base_get_max_events(ls->eb, EVENT_BASE_COUNT_ACTIVE, 1);
+  } while (!event_base_got_exit(ls->eb) && !event_base_got_break(ls->eb));
+}
+
+static bool loop_stats_read(const loop_stats *ls, loop_stats_snapshot *snapshot) {
+  for (int attempt = 0; attempt < LOOP_STATS_READ_ATTEMPTS; ++attempt) {
+    const unsigned int seq = atomic_load_explicit(&(ls->seq), memory_order_acquire);
+    if (seq & 1) {
+      continue;
+    }
+
+    memcpy(snapshot, &(ls->published), sizeof(loop_stats_snapshot));
+
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&(ls->seq), memory_order_relaxed) == seq) {
+      snapshot->name[sizeof(snapshot->name) - 1] = 0;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void loop_stats_foreach(loop_stats_visitor v, void *arg) {
+  if (!v) {
+    return;
+  }
+
+  loop_stats_snapshot snapshot;
+  for (loop_stats *ls = atomic_load_explicit(&loop_stats_list, memory_order_acquire); ls; ls = ls->next) {
+    if (loop_stats_read(ls, &snapshot)) {
+      v(&snapshot, arg);
+    }
+  }
+}
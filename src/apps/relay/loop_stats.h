@@ -0,0 +1,99 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Event loop load of the server threads
+ */
+
+#ifndef __LOOP_STATS__
+#define __LOOP_STATS__
+
+#include "ns_turn_ioalib.h"
+
+#include <event2/event.h>
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//////////////////////////////////////////////////
+
+/* The probe timer interval, its lateness is the loop lag */
+#define LOOP_STATS_PROBE_INTERVAL_US (100000)
+/* The published values cover that many probe intervals */
+#define LOOP_STATS_WINDOW_PROBES (10)
+
+#define LOOP_STATS_NAME_SIZE (32)
+
+/* The last complete window of a thread */
+typedef struct _loop_stats_snapshot {
+  char name[LOOP_STATS_NAME_SIZE];
+  /* loop iterations since the start */
+  uint64_t iterations;
+  /* window length, wall time */
+  uint64_t window_us;
+  /* thread CPU time during the window */
+  uint64_t busy_us;
+  uint64_t window_iterations;
+  /* events made active during the window iterations */
+  uint64_t window_callbacks;
+  uint64_t lateness_avg_us;
+  uint64_t lateness_max_us;
+} loop_stats_snapshot;
+
+struct _loop_stats;
+typedef struct _loop_stats loop_stats;
+
+/* Owner thread, at the end of every window */
+typedef void (*loop_stats_window_cb)(const loop_stats_snapshot *s, void *arg);
+
+/* Owner thread: the probe timer runs on eb from now on. window_cb may be NULL. */
+loop_stats *loop_stats_new(struct event_base *eb, const char *name, loop_stats_window_cb window_cb, void *arg);
+
+/* Owner thread: event_base_dispatch(), one iteration at a time */
+void loop_stats_dispatch(loop_stats *ls);
+
+/* Any thread: calls v with a consistent copy of every thread window */
+typedef void (*loop_stats_visitor)(const loop_stats_snapshot *s, void *arg);
+void loop_stats_foreach(loop_stats_visitor v, void *arg);
+
+//////////////////////////////////////////////////
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LOOP_STATS__ */
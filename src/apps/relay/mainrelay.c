@@ -37,7 +37,11 @@
 
 #include "dbdrivers/dbdriver.h"
 
+#include "kernel_channels.h"
+#include "xdp_socket.h"
 #include "prom_server.h"
+#include "tls_session_cache.h"
+#include "tls_handshake.h"
 #include <assert.h>
 #include <limits.h>
 
@@ -207,6 +211,9 @@ turn_params_t turn_params = {
     0,                                  /* fingerprint */
     ':',                                /* rest_api_separator */
     STUN_DEFAULT_NONCE_EXPIRATION_TIME, /* stale_nonce */
+    false,                              /* stateless_nonce */
+    false,                              /* nonce_secret_set */
+    {0},                                /* nonce_secret */
     STUN_DEFAULT_MAX_ALLOCATE_LIFETIME, /* max_allocate_lifetime */
     STUN_DEFAULT_CHANNEL_LIFETIME,      /* channel_lifetime */
     STUN_DEFAULT_PERMISSION_LIFETIME,   /* permission_lifetime */
@@ -216,6 +223,9 @@ turn_params_t turn_params = {
     0,                                  /* max_bps */
     0,                                  /* bps_capacity */
     0,                                  /* bps_capacity_allocated */
+    TOKEN_BUCKET_DEFAULT_BURST_MS,      /* bps_burst */
+    0,                                  /* bps_queue */
+    0,                                  /* realm_bps_capacity */
     0,                                  /* total_quota */
     0,                                  /* user_quota */
     false,                              /* prometheus disabled by default */
@@ -244,7 +254,34 @@ turn_params_t turn_params = {
     false, /* respond_http_unsupported */
     true,  /* drop_invalid_packets */
     false, /* drop_invalid_packets_log */
-    false  /* include_reason_string */
+    false, /* include_reason_string */
+    false, /* no_tcp_splice */
+    false, /* ktls */
+    false, /* no_stateless_binding */
+
+    ///////// TLS sessions /////////
+    DEFAULT_TLS_SESSION_CACHE_SIZE, /* tls_session_cache_size */
+    DEFAULT_TLS_SESSION_LIFETIME,   /* tls_session_lifetime */
+    0,                              /* tls_handshake_workers */
+    DEFAULT_TLS_HANDSHAKE_QUEUE,    /* tls_handshake_queue */
+
+    ///////// Kernel channels /////////
+    "",                             /* kernel_channels_ifname */
+    DEFAULT_KERNEL_CHANNELS_OBJECT, /* kernel_channels_object */
+
+    ///////// AF_XDP /////////
+    "",                        /* af_xdp_ifname */
+    1,                          /* af_xdp_queues */
+    DEFAULT_XDP_SOCKETS_OBJECT, /* af_xdp_object */
+
+    ///////// CPU affinity /////////
+    {NULL, 0}, /* relay_cpus */
+    {NULL, 0}, /* listener_cpus */
+    {NULL, 0}, /* auth_cpus */
+    false,     /* numa_local_memory */
+
+    ///////// Relay load /////////
+    false /* relay_rebalance */
 };
 
 //////////////// OpenSSL Init //////////////////////
@@ -1083,6 +1120,14 @@ static char Usage[] =
     "allocate\n"
     "						for the sessions, combined (input and output network streams are "
     "treated separately).\n"
+    "						It is also the limit of the traffic of the whole server.\n"
+    " --bps-burst			<msec>		How long a session, realm or server may send above its bandwidth\n"
+    "						after an idle time, as a burst. The default is 1000.\n"
+    " --bps-queue			<msec>		How long TCP and TLS input above the bandwidth may wait\n"
+    "						for it, instead of being dropped. The default is 0, drop.\n"
+    " --realm-bps-capacity		<number>	Total bytes-per-second bandwidth of the sessions of each realm\n"
+    "						(input and output network streams are treated separately).\n"
+    "						The default is 0, no limit.\n"
     " -c				<filename>	Configuration file name (default - turnserver.conf).\n"
 #if !defined(TURN_NO_SQLITE)
     " -b, , --db, --userdb	<filename>		SQLite database file name; default - /var/db/turndb or\n"
@@ -1248,6 +1293,9 @@ static char Usage[] =
     "						name will be constructed as-is, without PID and date appendage.\n"
     "						This option can be used, for example, together with the logrotate "
     "tool.\n"
+    " --async-log					Hand the log lines over to a dedicated writer thread through per-thread\n"
+    "						buffers, so that the logging threads never wait for the log file or syslog.\n"
+    "						Lines that do not fit into a full buffer are dropped and counted.\n"
     " --new-log-timestamp				Enable full ISO-8601 timestamp in all logs.\n"
     " --new-log-timestamp-format    	<format>	Set timestamp format (in strftime(1) format). Depends on "
     "--new-log-timestamp to be enabled.\n"
@@ -1255,6 +1303,12 @@ static char Usage[] =
     "avoid DoS attacks.\n"
     " --stale-nonce[=<value>]			Use extra security with nonce value having limited lifetime (default "
     "600 secs).\n"
+    " --stateless-nonce				Issue nonces that carry their issue time and are authenticated with a\n"
+    "						   key derived from a secret, instead of nonces stored in each session.\n"
+    "						   The secret is random per process unless --nonce-secret is set.\n"
+    " --nonce-secret		<secret>	Secret of the stateless nonces, to share between the servers of a\n"
+    "						   cluster so that their nonces stay valid after an ALTERNATE-SERVER\n"
+    "						   redirect. Implies --stateless-nonce.\n"
     " --max-allocate-lifetime	<value>		Set the maximum value for the allocation lifetime. Default to 3600 "
     "secs.\n"
     " --channel-lifetime		<value>		Set the lifetime for channel binding, default to 600 secs.\n"
@@ -1370,6 +1424,51 @@ static char Usage[] =
     "						   By default, only the standard reason phrase for the error code is\n"
     "						   sent. Enabling this option adds detailed error descriptions which\n"
     "						   may aid debugging but can also leak internal server information.\n"
+    " --no-tcp-splice				   Do not move the data of the plain TCP relay connections (RFC 6062) in the\n"
+    "						   kernel with splice(), copy it through user space instead (Linux only).\n"
+    " --ktls					   Let the kernel encrypt/decrypt the TLS records of TURN over TLS client\n"
+    "						   connections (kTLS, Linux with the tls module and OpenSSL 3). Used per\n"
+    "						   connection when the negotiated cipher allows it. Disabled by default.\n"
+    " --no-stateless-binding			   Do not answer the plain Binding requests from new UDP sources directly in\n"
+    "						   the listener; create a client session for them as for any other request.\n"
+    " --tls-session-cache		<number>	Number of TLS/DTLS sessions kept for resumption in the cache shared by\n"
+    "						   the relay threads. Default is 16384. Zero disables the cache; the\n"
+    "						   session tickets, with their rotating keys, are still issued.\n"
+    " --tls-session-lifetime		<sec>	Lifetime of the resumable TLS/DTLS sessions, also the rotation period\n"
+    "						   of the session ticket keys. Default is 3600 sec.\n"
+    " --tls-handshake-workers	<number>	Number of threads running the TLS/DTLS handshakes of the client\n"
+    "						   connections, so that the relay threads keep forwarding traffic\n"
+    "						   meanwhile. Default is 0: handshakes run in the relay threads.\n"
+    " --tls-handshake-queue		<number>	Maximum number of handshakes waiting or running in the handshake\n"
+    "						   workers; the connections over it are closed. Default is 1024.\n"
+#if !defined(TURN_NO_BPF)
+    " --kernel-channels		<device-name>	Relay UDP ChannelData of IPv4 UDP sessions in the kernel, with an\n"
+    "						XDP program attached to this network interface device (Linux only).\n"
+    "						Sessions with a bandwidth limit are always relayed in user space.\n"
+    " --kernel-channels-object	<filename>	Compiled XDP program for --kernel-channels. Same file search rules\n"
+    "						applied as for the configuration file. Default is " DEFAULT_KERNEL_CHANNELS_OBJECT ".\n"
+#endif
+#if !defined(TURN_NO_XDP)
+    " --af-xdp			<device-name>	Receive the client UDP datagrams of the IPv4 UDP listeners through\n"
+    "						AF_XDP sockets bound to this network interface device (Linux only,\n"
+    "						UDP socket per thread network engine only). Receive only: responses\n"
+    "						and the relay endpoints still use the regular sockets. Cannot share\n"
+    "						the device with --kernel-channels.\n"
+    " --af-xdp-queues		<number>	Number of receive queues of the --af-xdp device to bind AF_XDP\n"
+    "						sockets to, spread over the relay threads. Default is 1.\n"
+    " --af-xdp-object		<filename>	Compiled XDP program for --af-xdp. Same file search rules\n"
+    "						applied as for the configuration file. Default is " DEFAULT_XDP_SOCKETS_OBJECT ".\n"
+#endif
+    " --relay-cpus			<cpu-list>	Pin the relay threads to these CPUs, round-robin, for example\n"
+    "						0-3,8-11 (Linux only). In the UDP socket per thread network engine,\n"
+    "						the listener socket of each relay thread gets SO_INCOMING_CPU, so that\n"
+    "						the datagrams are read on the CPU that received them from the NIC.\n"
+    " --listener-cpus		<cpu-list>	Pin the listener threads to these CPUs, round-robin (Linux only).\n"
+    " --auth-cpus			<cpu-list>	Pin the authentication threads to these CPUs, round-robin (Linux only).\n"
+    " --numa-local-memory				The pinned threads take their memory from the NUMA node of their\n"
+    "						CPU, and move there the memory already allocated for them.\n"
+    " --relay-rebalance				Move UDP sessions, live, from a relay thread that is much busier\n"
+    "						than another one to the less busy one, one session per second.\n"
     " --version					Print version (and exit).\n"
     " -h						Help\n"
     "\n";
@@ -1457,6 +1556,8 @@ enum EXTRA_OPTS {
   MAX_PORT_OPT,
   SOCK_BUF_SIZE_OPT,
   STALE_NONCE_OPT,
+  STATELESS_NONCE_OPT,
+  NONCE_SECRET_OPT,
   MAX_ALLOCATE_LIFETIME_OPT,
   CHANNEL_LIFETIME_OPT,
   PERMISSION_LIFETIME_OPT,
@@ -1475,6 +1576,7 @@ enum EXTRA_OPTS {
   SYSLOG_OPT,
   SYSLOG_FACILITY_OPT,
   SIMPLE_LOG_OPT,
+  ASYNC_LOG_OPT,
   NEW_LOG_TIMESTAMP_OPT,
   NEW_LOG_TIMESTAMP_FORMAT_OPT,
   AUX_SERVER_OPT,
@@ -1534,7 +1636,27 @@ enum EXTRA_OPTS {
   DROP_INVALID_PACKETS_LOG_OPT,
   VERSION_OPT,
   CPUS_OPT,
-  INCLUDE_REASON_STRING_OPT
+  INCLUDE_REASON_STRING_OPT,
+  NO_TCP_SPLICE_OPT,
+  KTLS_OPT,
+  NO_STATELESS_BINDING_OPT,
+  TLS_SESSION_CACHE_OPT,
+  TLS_SESSION_LIFETIME_OPT,
+  TLS_HANDSHAKE_WORKERS_OPT,
+  TLS_HANDSHAKE_QUEUE_OPT,
+  KERNEL_CHANNELS_OPT,
+  KERNEL_CHANNELS_OBJECT_OPT,
+  AF_XDP_OPT,
+  AF_XDP_QUEUES_OPT,
+  AF_XDP_OBJECT_OPT,
+  RELAY_CPUS_OPT,
+  LISTENER_CPUS_OPT,
+  AUTH_CPUS_OPT,
+  NUMA_LOCAL_MEMORY_OPT,
+  RELAY_REBALANCE_OPT,
+  BPS_BURST_OPT,
+  BPS_QUEUE_OPT,
+  REALM_BPS_CAPACITY_OPT
 };
 
 struct myoption {
@@ -1605,6 +1727,9 @@ static const struct myoption long_options[] = {
     {"total-quota", required_argument, NULL, 'Q'},
     {"max-bps", required_argument, NULL, 's'},
     {"bps-capacity", required_argument, NULL, 'B'},
+    {"bps-burst", required_argument, NULL, BPS_BURST_OPT},
+    {"bps-queue", required_argument, NULL, BPS_QUEUE_OPT},
+    {"realm-bps-capacity", required_argument, NULL, REALM_BPS_CAPACITY_OPT},
     {"verbose", optional_argument, NULL, 'v'},
     {"Verbose", optional_argument, NULL, 'V'},
     {"daemon", optional_argument, NULL, 'o'},
@@ -1619,6 +1744,8 @@ static const struct myoption long_options[] = {
     {"no-udp-relay", optional_argument, NULL, NO_UDP_RELAY_OPT},
     {"no-tcp-relay", optional_argument, NULL, NO_TCP_RELAY_OPT},
     {"stale-nonce", optional_argument, NULL, STALE_NONCE_OPT},
+    {"stateless-nonce", optional_argument, NULL, STATELESS_NONCE_OPT},
+    {"nonce-secret", required_argument, NULL, NONCE_SECRET_OPT},
     {"max-allocate-lifetime", optional_argument, NULL, MAX_ALLOCATE_LIFETIME_OPT},
     {"channel-lifetime", optional_argument, NULL, CHANNEL_LIFETIME_OPT},
     {"permission-lifetime", optional_argument, NULL, PERMISSION_LIFETIME_OPT},
@@ -1632,6 +1759,7 @@ static const struct myoption long_options[] = {
     {"no-stdout-log", optional_argument, NULL, NO_STDOUT_LOG_OPT},
     {"syslog", optional_argument, NULL, SYSLOG_OPT},
     {"simple-log", optional_argument, NULL, SIMPLE_LOG_OPT},
+    {"async-log", optional_argument, NULL, ASYNC_LOG_OPT},
     {"new-log-timestamp", optional_argument, NULL, NEW_LOG_TIMESTAMP_OPT},
     {"new-log-timestamp-format", required_argument, NULL, NEW_LOG_TIMESTAMP_FORMAT_OPT},
     {"aux-server", required_argument, NULL, AUX_SERVER_OPT},
@@ -1683,9 +1811,30 @@ static const struct myoption long_options[] = {
     {"drop-invalid-packets", optional_argument, NULL, DROP_INVALID_PACKETS_OPT},
     {"drop-invalid-packets-log", optional_argument, NULL, DROP_INVALID_PACKETS_LOG_OPT},
     {"include-reason-string", optional_argument, NULL, INCLUDE_REASON_STRING_OPT},
+    {"no-tcp-splice", optional_argument, NULL, NO_TCP_SPLICE_OPT},
+    {"ktls", optional_argument, NULL, KTLS_OPT},
+    {"no-stateless-binding", optional_argument, NULL, NO_STATELESS_BINDING_OPT},
+    {"tls-session-cache", required_argument, NULL, TLS_SESSION_CACHE_OPT},
+    {"tls-session-lifetime", required_argument, NULL, TLS_SESSION_LIFETIME_OPT},
+    {"tls-handshake-workers", required_argument, NULL, TLS_HANDSHAKE_WORKERS_OPT},
+    {"tls-handshake-queue", required_argument, NULL, TLS_HANDSHAKE_QUEUE_OPT},
     {"version", optional_argument, NULL, VERSION_OPT},
     {"syslog-facility", required_argument, NULL, SYSLOG_FACILITY_OPT},
     {"cpus", required_argument, NULL, CPUS_OPT},
+#if !defined(TURN_NO_BPF)
+    {"kernel-channels", required_argument, NULL, KERNEL_CHANNELS_OPT},
+    {"kernel-channels-object", required_argument, NULL, KERNEL_CHANNELS_OBJECT_OPT},
+#endif
+#if !defined(TURN_NO_XDP)
+    {"af-xdp", required_argument, NULL, AF_XDP_OPT},
+    {"af-xdp-queues", required_argument, NULL, AF_XDP_QUEUES_OPT},
+    {"af-xdp-object", required_argument, NULL, AF_XDP_OBJECT_OPT},
+#endif
+    {"relay-cpus", required_argument, NULL, RELAY_CPUS_OPT},
+    {"listener-cpus", required_argument, NULL, LISTENER_CPUS_OPT},
+    {"auth-cpus", required_argument, NULL, AUTH_CPUS_OPT},
+    {"numa-local-memory", optional_argument, NULL, NUMA_LOCAL_MEMORY_OPT},
+    {"relay-rebalance", optional_argument, NULL, RELAY_REBALANCE_OPT},
     {NULL, no_argument, NULL, 0}};
 
 static const struct myoption admin_long_options[] = {
@@ -2155,6 +2304,16 @@ static void set_option(int c, char *value) {
   case STALE_NONCE_OPT:
     turn_params.stale_nonce = get_int_value(value, STUN_DEFAULT_NONCE_EXPIRATION_TIME);
     break;
+  case STATELESS_NONCE_OPT:
+    turn_params.stateless_nonce = get_bool_value(value);
+    break;
+  case NONCE_SECRET_OPT:
+    if (value && value[0]) {
+      SHA256((const unsigned char *)value, strlen(value), turn_params.nonce_secret);
+      turn_params.nonce_secret_set = true;
+      turn_params.stateless_nonce = true;
+    }
+    break;
   case MAX_ALLOCATE_LIFETIME_OPT:
     turn_params.max_allocate_lifetime = get_int_value(value, STUN_DEFAULT_MAX_ALLOCATE_LIFETIME);
     break;
@@ -2362,6 +2521,17 @@ static void set_option(int c, char *value) {
     TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "%lu bytes per second allowed, combined server capacity\n",
                   (unsigned long)turn_params.bps_capacity);
     break;
+  case BPS_BURST_OPT:
+    turn_params.bps_burst = (uint32_t)strtoul(value, NULL, 10);
+    break;
+  case BPS_QUEUE_OPT:
+    turn_params.bps_queue = (uint32_t)strtoul(value, NULL, 10);
+    break;
+  case REALM_BPS_CAPACITY_OPT:
+    turn_params.realm_bps_capacity = (band_limit_t)strtoul(value, NULL, 10);
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "%lu bytes per second allowed, combined realm capacity\n",
+                  (unsigned long)turn_params.realm_bps_capacity);
+    break;
   case CHECK_ORIGIN_CONSISTENCY_OPT:
     turn_params.check_origin = get_bool_value(value);
     break;
@@ -2473,6 +2643,29 @@ static void set_option(int c, char *value) {
   case INCLUDE_REASON_STRING_OPT:
     turn_params.include_reason_string = get_bool_value(value);
     break;
+  case NO_TCP_SPLICE_OPT:
+    turn_params.no_tcp_splice = get_bool_value(value);
+    break;
+  case KTLS_OPT:
+    turn_params.ktls = get_bool_value(value);
+    break;
+  case NO_STATELESS_BINDING_OPT:
+    turn_params.no_stateless_binding = get_bool_value(value);
+    break;
+  case TLS_SESSION_CACHE_OPT: {
+    const int size = get_int_value(value, DEFAULT_TLS_SESSION_CACHE_SIZE);
+    turn_params.tls_session_cache_size = (size > 0) ? (size_t)size : 0;
+    break;
+  }
+  case TLS_SESSION_LIFETIME_OPT:
+    turn_params.tls_session_lifetime = get_int_value(value, DEFAULT_TLS_SESSION_LIFETIME);
+    break;
+  case TLS_HANDSHAKE_WORKERS_OPT:
+    turn_params.tls_handshake_workers = get_int_value(value, 0);
+    break;
+  case TLS_HANDSHAKE_QUEUE_OPT:
+    turn_params.tls_handshake_queue = get_int_value(value, DEFAULT_TLS_HANDSHAKE_QUEUE);
+    break;
   case CPUS_OPT: {
     int cpus = atoi(value);
     if (cpus < 1) {
@@ -2487,12 +2680,55 @@ static void set_option(int c, char *value) {
       turn_params.cpus_configured = true;
     }
   } break;
+  case KERNEL_CHANNELS_OPT:
+    STRCPY(turn_params.kernel_channels_ifname, value);
+    break;
+  case KERNEL_CHANNELS_OBJECT_OPT:
+    STRCPY(turn_params.kernel_channels_object, value);
+    break;
+  case AF_XDP_OPT:
+    STRCPY(turn_params.af_xdp_ifname, value);
+    break;
+  case AF_XDP_QUEUES_OPT: {
+    const int queues = atoi(value);
+    if (queues <= 0) {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Wrong AF_XDP queues number: %s, using 1\n", value);
+      turn_params.af_xdp_queues = 1;
+    } else {
+      turn_params.af_xdp_queues = (size_t)queues;
+    }
+  } break;
+  case AF_XDP_OBJECT_OPT:
+    STRCPY(turn_params.af_xdp_object, value);
+    break;
+  case RELAY_CPUS_OPT:
+    if (turn_cpu_list_parse(value, &turn_params.relay_cpus) < 0) {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Wrong relay CPU list: %s\n", value);
+    }
+    break;
+  case LISTENER_CPUS_OPT:
+    if (turn_cpu_list_parse(value, &turn_params.listener_cpus) < 0) {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Wrong listener CPU list: %s\n", value);
+    }
+    break;
+  case AUTH_CPUS_OPT:
+    if (turn_cpu_list_parse(value, &turn_params.auth_cpus) < 0) {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Wrong auth CPU list: %s\n", value);
+    }
+    break;
+  case NUMA_LOCAL_MEMORY_OPT:
+    turn_params.numa_local_memory = get_bool_value(value);
+    break;
+  case RELAY_REBALANCE_OPT:
+    turn_params.relay_rebalance = get_bool_value(value);
+    break;
 
   /* these options have been already taken care of before: */
   case 'l':
   case NO_STDOUT_LOG_OPT:
   case SYSLOG_OPT:
   case SIMPLE_LOG_OPT:
+  case ASYNC_LOG_OPT:
   case NEW_LOG_TIMESTAMP_OPT:
   case NEW_LOG_TIMESTAMP_FORMAT_OPT:
   case SYSLOG_FACILITY_OPT:
@@ -2633,6 +2869,8 @@ static void read_config_file(int argc, char **argv, int pass) {
             set_log_to_syslog(get_bool_value(value));
           } else if ((pass == 0) && (c == SIMPLE_LOG_OPT)) {
             set_simple_log(get_bool_value(value));
+          } else if ((pass == 0) && (c == ASYNC_LOG_OPT)) {
+            set_async_log(get_bool_value(value));
           } else if ((pass == 0) && (c == NEW_LOG_TIMESTAMP_OPT)) {
             use_new_log_timestamp_format = 1;
           } else if ((pass == 0) && (c == NEW_LOG_TIMESTAMP_FORMAT_OPT)) {
@@ -3107,6 +3345,9 @@ int main(int argc, char **argv) {
       case SIMPLE_LOG_OPT:
         set_simple_log(get_bool_value(optarg));
         break;
+      case ASYNC_LOG_OPT:
+        set_async_log(get_bool_value(optarg));
+        break;
       case NEW_LOG_TIMESTAMP_OPT:
         use_new_log_timestamp_format = 1;
         break;
@@ -3321,6 +3562,14 @@ int main(int argc, char **argv) {
 
   openssl_setup();
 
+  if (turn_params.stateless_nonce && !turn_params.nonce_secret_set) {
+    if (!RAND_bytes(turn_params.nonce_secret, (int)sizeof(turn_params.nonce_secret))) {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Cannot generate the stateless nonce secret\n");
+      exit(-1);
+    }
+    turn_params.nonce_secret_set = true;
+  }
+
   int local_listeners = 0;
   if (!turn_params.listener.addrs_number) {
     TURN_LOG_FUNC(TURN_LOG_LEVEL_WARNING, "NO EXPLICIT LISTENER ADDRESS(ES) ARE CONFIGURED\n");
@@ -3450,6 +3699,21 @@ int main(int argc, char **argv) {
   }
 #endif
 
+  // After the daemon fork: the writer thread would not survive it
+  start_async_log();
+
+  if (turn_params.kernel_channels_ifname[0]) {
+    char *fn = find_config_file(turn_params.kernel_channels_object);
+    kernel_channels_init(turn_params.kernel_channels_ifname, fn ? fn : turn_params.kernel_channels_object);
+    free(fn);
+  }
+
+  if (turn_params.af_xdp_ifname[0]) {
+    char *fn = find_config_file(turn_params.af_xdp_object);
+    xdp_sockets_init(turn_params.af_xdp_ifname, fn ? fn : turn_params.af_xdp_object);
+    free(fn);
+  }
+
   setup_server();
 
 #if defined(WINDOWS)
@@ -3471,6 +3735,8 @@ int main(int argc, char **argv) {
 
   run_listener_server(&(turn_params.listener));
 
+  xdp_sockets_shutdown();
+  kernel_channels_shutdown();
   disconnect_database();
 
   return 0;
@@ -3751,6 +4017,7 @@ static void set_ctx(SSL_CTX **out, const char *protocol, const SSL_METHOD *metho
 
   SSL_CTX_set_cipher_list(ctx, turn_params.cipher_list);
   SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+  tls_session_cache_setup_ctx(ctx);
   SSL_CTX_set_ciphersuites(ctx, turn_params.cipher_list);
 
   if (!SSL_CTX_use_certificate_chain_file(ctx, turn_params.cert_file)) {
@@ -3938,6 +4205,35 @@ static void set_ctx(SSL_CTX **out, const char *protocol, const SSL_METHOD *metho
 #endif
 }
 
+static void set_ctx_ktls(SSL_CTX *ctx) {
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+  SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+
+  static bool ktls_checked = false;
+  if (!ktls_checked) {
+    ktls_checked = true;
+    bool ulp_loaded = false;
+    FILE *f = fopen("/proc/sys/net/ipv4/tcp_available_ulp", "r");
+    if (f) {
+      char ulps[256] = "";
+      if (fgets(ulps, sizeof(ulps), f)) {
+        ulp_loaded = (strstr(ulps, "tls") != NULL);
+      }
+      fclose(f);
+    }
+    if (ulp_loaded) {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "kTLS offload enabled for TLS connections\n");
+    } else {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_WARNING, "kTLS requested but the tls kernel module is not loaded, TLS connections "
+                                            "stay in user space unless the module can be loaded on demand\n");
+    }
+  }
+#else
+  UNUSED_ARG(ctx);
+  TURN_LOG_FUNC(TURN_LOG_LEVEL_WARNING, "kTLS is not supported by this OpenSSL library, option ignored\n");
+#endif
+}
+
 static void openssl_load_certificates(void);
 static void openssl_setup(void) {
   THREAD_setup();
@@ -3967,6 +4263,7 @@ static void openssl_setup(void) {
 
   if (!(turn_params.no_tls && turn_params.no_dtls)) {
     adjust_key_file_names();
+    tls_session_cache_init(turn_params.tls_session_cache_size, turn_params.tls_session_lifetime);
   }
 
   openssl_load_certificates();
@@ -3992,6 +4289,9 @@ static void openssl_load_certificates(void) {
     if (turn_params.no_tlsv1_2) {
       SSL_CTX_set_min_proto_version(turn_params.tls_ctx, TLS1_3_VERSION);
     }
+    if (turn_params.ktls) {
+      set_ctx_ktls(turn_params.tls_ctx);
+    }
     TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "TLS cipher suite: %s\n", turn_params.cipher_list);
 #endif
   }
@@ -4014,6 +4314,7 @@ static void openssl_load_certificates(void) {
 static void reload_ssl_certs(evutil_socket_t sock, short events, void *args) {
   TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "Reloading TLS certificates and keys\n");
   openssl_load_certificates();
+  tls_session_cache_flush();
   if (turn_params.tls_ctx_update_ev != NULL) {
     event_active(turn_params.tls_ctx_update_ev, EV_READ, 0);
   }
@@ -85,6 +85,7 @@
 
 #include "apputils.h"
 
+#include "cpu_affinity.h"
 #include "ns_ioalib_impl.h"
 
 #include <openssl/aes.h>
@@ -315,15 +316,22 @@ typedef struct _turn_params_ {
   int fingerprint;
   char rest_api_separator;
   vint stale_nonce;
+  bool stateless_nonce;
+  bool nonce_secret_set;
+  uint8_t nonce_secret[STATELESS_NONCE_SECRET_SIZE];
   vint max_allocate_lifetime;
   vint channel_lifetime;
   vint permission_lifetime;
   bool mobility;
   turn_credential_type ct;
   bool use_auth_secret_with_timestamp;
-  band_limit_t max_bps;
-  band_limit_t bps_capacity;
-  band_limit_t bps_capacity_allocated;
+  /* changed by the admin and allocations of any thread, without a lock */
+  _Atomic(band_limit_t) max_bps;
+  _Atomic(band_limit_t) bps_capacity;
+  _Atomic(band_limit_t) bps_capacity_allocated;
+  uint32_t bps_burst;
+  uint32_t bps_queue;
+  band_limit_t realm_bps_capacity;
   vint total_quota;
   vint user_quota;
   bool prometheus;
@@ -355,6 +363,33 @@ typedef struct _turn_params_ {
   bool drop_invalid_packets;
   bool drop_invalid_packets_log;
   bool include_reason_string;
+  bool no_tcp_splice;
+  bool ktls;
+  bool no_stateless_binding;
+
+  ///////// TLS sessions /////////
+  size_t tls_session_cache_size;
+  int tls_session_lifetime;
+  int tls_handshake_workers;
+  int tls_handshake_queue;
+
+  ///////// Kernel channels /////////
+  char kernel_channels_ifname[1025];
+  char kernel_channels_object[1025];
+
+  ///////// AF_XDP /////////
+  char af_xdp_ifname[1025];
+  size_t af_xdp_queues;
+  char af_xdp_object[1025];
+
+  ///////// CPU affinity /////////
+  turn_cpu_list relay_cpus;
+  turn_cpu_list listener_cpus;
+  turn_cpu_list auth_cpus;
+  bool numa_local_memory;
+
+  ///////// Relay load /////////
+  bool relay_rebalance;
 } turn_params_t;
 
 extern turn_params_t turn_params;
@@ -32,8 +32,14 @@
  * SUCH DAMAGE.
  */
 
+#include "latency_hist.h"
+#include "loop_stats.h"
 #include "mainrelay.h"
+#include "relay_load.h"
+#include "tls_handshake.h"
+#include "xdp_socket.h"
 #include <errno.h>
+#include <stdatomic.h>
 
 #include "ns_turn_ioalib.h"
 
@@ -81,7 +87,7 @@ static struct relay_server *get_relay_server(turnserver_id id);
 
 //////////////////////////////////////////////
 
-static void run_events(struct event_base *eb, ioa_engine_handle e);
+static void run_events(struct event_base *eb, ioa_engine_handle e, loop_stats *stats);
 static void setup_relay_server(struct relay_server *rs, ioa_engine_handle e, int to_set_rfc5780);
 
 /////////////// BARRIERS ///////////////////
@@ -112,79 +118,52 @@ static void barrier_wait_func(const char *func, int line) {
 
 /////////////// Bandwidth //////////////////
 
-static TURN_MUTEX_DECLARE(mutex_bps);
-
+/*
+ * Allocations reserve their bandwidth from the server capacity with a CAS,
+ * relay threads allocating at once do not wait for each other.
+ */
 static band_limit_t allocate_bps(band_limit_t bps, int positive) {
   band_limit_t ret = 0;
   if (bps > 0) {
-    TURN_MUTEX_LOCK(&mutex_bps);
-
-    if (positive) {
-
-      if (!(turn_params.bps_capacity)) {
-        ret = bps;
-        turn_params.bps_capacity_allocated += ret;
-      } else if (turn_params.bps_capacity_allocated < turn_params.bps_capacity) {
-        const band_limit_t reserve = turn_params.bps_capacity - turn_params.bps_capacity_allocated;
-        if (reserve <= bps) {
-          ret = reserve;
-          turn_params.bps_capacity_allocated = turn_params.bps_capacity;
-        } else {
+    band_limit_t allocated = atomic_load_explicit(&turn_params.bps_capacity_allocated, memory_order_relaxed);
+    band_limit_t next = 0;
+
+    do {
+      if (positive) {
+        const band_limit_t capacity = atomic_load_explicit(&turn_params.bps_capacity, memory_order_relaxed);
+        if (!capacity) {
           ret = bps;
-          turn_params.bps_capacity_allocated += ret;
+        } else if (allocated < capacity) {
+          const band_limit_t reserve = capacity - allocated;
+          ret = (reserve <= bps) ? reserve : bps;
+        } else {
+          return 0;
         }
-      }
-
-    } else {
-
-      if (turn_params.bps_capacity_allocated >= bps) {
-        turn_params.bps_capacity_allocated -= bps;
+        next = allocated + ret;
       } else {
-        turn_params.bps_capacity_allocated = 0;
+        next = (allocated >= bps) ? (allocated - bps) : 0;
       }
-    }
-
-    TURN_MUTEX_UNLOCK(&mutex_bps);
+    } while (!atomic_compare_exchange_weak_explicit(&turn_params.bps_capacity_allocated, &allocated, next,
+                                                    memory_order_relaxed, memory_order_relaxed));
   }
 
   return ret;
 }
 
 band_limit_t get_bps_capacity_allocated(void) {
-  band_limit_t ret = 0;
-  TURN_MUTEX_LOCK(&mutex_bps);
-  ret = turn_params.bps_capacity_allocated;
-  TURN_MUTEX_UNLOCK(&mutex_bps);
-  return ret;
+  return atomic_load_explicit(&turn_params.bps_capacity_allocated, memory_order_relaxed);
 }
 
-band_limit_t get_bps_capacity(void) {
-  band_limit_t ret = 0;
-  TURN_MUTEX_LOCK(&mutex_bps);
-  ret = turn_params.bps_capacity;
-  TURN_MUTEX_UNLOCK(&mutex_bps);
-  return ret;
-}
+band_limit_t get_bps_capacity(void) { return atomic_load_explicit(&turn_params.bps_capacity, memory_order_relaxed); }
 
 void set_bps_capacity(band_limit_t value) {
-  TURN_MUTEX_LOCK(&mutex_bps);
-  turn_params.bps_capacity = value;
-  TURN_MUTEX_UNLOCK(&mutex_bps);
+  atomic_store_explicit(&turn_params.bps_capacity, value, memory_order_relaxed);
+  token_bucket_set_server_bps(value);
 }
 
-band_limit_t get_max_bps(void) {
-  band_limit_t ret = 0;
-  TURN_MUTEX_LOCK(&mutex_bps);
-  ret = turn_params.max_bps;
-  TURN_MUTEX_UNLOCK(&mutex_bps);
-  return ret;
-}
+band_limit_t get_max_bps(void) { return atomic_load_explicit(&turn_params.max_bps, memory_order_relaxed); }
 
-void set_max_bps(band_limit_t value) {
-  TURN_MUTEX_LOCK(&mutex_bps);
-  turn_params.max_bps = value;
-  TURN_MUTEX_UNLOCK(&mutex_bps);
-}
+void set_max_bps(band_limit_t value) { atomic_store_explicit(&turn_params.max_bps, value, memory_order_relaxed); }
 
 /////////////// AUX SERVERS ////////////////
 
@@ -536,8 +515,7 @@ static int send_socket_to_general_relay(ioa_engine_handle e, struct message_to_r
   struct relay_server *rdest = sm->relay_server;
 
   if (!rdest) {
-    const size_t dest = (hash_int32(addr_get_port(&(sm->m.sm.nd.src_addr)))) % get_real_general_relay_servers_number();
-    rdest = general_relay_servers[dest];
+    rdest = general_relay_servers[relay_load_choose(addr_hash(&(sm->m.sm.nd.src_addr)))];
   }
 
   struct message_to_relay *smptr = sm;
@@ -705,6 +683,69 @@ err:
   return ret;
 }
 
+int send_session_migration_to_relay(turnsession_id sid, size_t dest) {
+  const turnserver_id id = (turnserver_id)(sid / TURN_SESSION_ID_FACTOR);
+
+  if (xdp_sockets_enabled()) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "%s: sessions cannot migrate with the AF_XDP sockets\n", __FUNCTION__);
+    return -1;
+  }
+
+  if ((id >= TURNSERVER_ID_BOUNDARY_BETWEEN_TCP_AND_UDP) || (dest >= get_real_general_relay_servers_number()) ||
+      (dest == (size_t)id)) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "%s: wrong relays for session migration: %d -> %lu\n", __FUNCTION__, (int)id,
+                  (unsigned long)dest);
+    return -1;
+  }
+
+  struct relay_server *rs = get_relay_server(id);
+  if (!rs) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "%s: can't find relay for turn_server_id: %d\n", __FUNCTION__, (int)id);
+    return -1;
+  }
+
+  struct message_to_relay sm;
+  memset(&sm, 0, sizeof(struct message_to_relay));
+  sm.t = RMT_MIGRATE_SESSION;
+  sm.relay_server = rs;
+  sm.m.msm.id = sid;
+  sm.m.msm.dest = (turnserver_id)dest;
+
+  struct evbuffer *output = bufferevent_get_output(rs->out_buf);
+  if (!output || (evbuffer_add(output, &sm, sizeof(struct message_to_relay)) < 0)) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "%s: Empty output buffer\n", __FUNCTION__);
+    return -1;
+  }
+
+  return 0;
+}
+
+/* In the thread of the relay of the session, which hands it to the other relay */
+static void migrate_session(relay_server_handle rs, turnsession_id sid, turnserver_id dest) {
+  struct relay_server *dest_rs = get_relay_server(dest);
+  if (!dest_rs || (dest_rs == rs)) {
+    return;
+  }
+
+  ts_ur_super_session *ss = turn_session_export(&(rs->server), sid);
+  if (ss) {
+    struct message_to_relay sm;
+    memset(&sm, 0, sizeof(struct message_to_relay));
+    sm.t = RMT_ADOPT_SESSION;
+    sm.relay_server = dest_rs;
+    sm.m.msm.id = sid;
+    sm.m.msm.dest = dest;
+    sm.m.msm.ss = ss;
+
+    struct evbuffer *output = bufferevent_get_output(dest_rs->out_buf);
+    if (!output || (evbuffer_add(output, &sm, sizeof(struct message_to_relay)) < 0)) {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "%s: Empty output buffer, session %018llu stays\n", __FUNCTION__,
+                    (unsigned long long)sid);
+      turn_session_import(&(rs->server), ss);
+    }
+  }
+}
+
 static int handle_relay_message(relay_server_handle rs, struct message_to_relay *sm) {
   if (rs && sm) {
 
@@ -713,6 +754,12 @@ static int handle_relay_message(relay_server_handle rs, struct message_to_relay
     case RMT_CANCEL_SESSION: {
       turn_cancel_session(&(rs->server), sm->m.csm.id);
     } break;
+    case RMT_MIGRATE_SESSION: {
+      migrate_session(rs, sm->m.msm.id, sm->m.msm.dest);
+    } break;
+    case RMT_ADOPT_SESSION: {
+      turn_session_import(&(rs->server), sm->m.msm.ss);
+    } break;
     case RMT_SOCKET: {
 
       if (sm->m.sm.s->defer_nbh) {
@@ -795,6 +842,7 @@ static int handle_relay_message(relay_server_handle rs, struct message_to_relay
 }
 
 static void handle_relay_auth_message(struct relay_server *rs, struct auth_message *am) {
+  turn_latency_record(TURN_LATENCY_AUTH, am->start_us);
   am->resume_func(am->success, am->out_oauth, am->max_session_time, am->key, am->pwd, &(rs->server), am->ctxkey,
                   &(am->in_buffer), am->realm);
   if (am->in_buffer.nbh) {
@@ -962,8 +1010,28 @@ static ioa_engine_handle create_new_listener_engine(void) {
   return e;
 }
 
+/*
+ * Pins the calling thread, and moves its memory region to the NUMA node of the CPU.
+ * Returns the CPU, or -1 when there is no CPU for the thread or it could not be pinned.
+ */
+static int pin_thread(const turn_cpu_list *cpus, size_t index, super_memory_t *sm, const char *name) {
+  const int cpu = turn_cpu_list_get(cpus, index);
+  if (cpu < 0) {
+    return -1;
+  }
+  int node = -1;
+  if (turn_thread_pin(cpu, turn_params.numa_local_memory, name, &node) < 0) {
+    return -1;
+  }
+  if (turn_params.numa_local_memory && (node >= 0)) {
+    bind_super_memory_region(sm, node);
+  }
+  return cpu;
+}
+
 static void *run_udp_listener_thread(void *arg) {
   static const int always_true = 1;
+  static atomic_uint udp_listener_threads_number = 0;
 
   ignore_sigpipe();
 
@@ -971,8 +1039,22 @@ static void *run_udp_listener_thread(void *arg) {
 
   dtls_listener_relay_server_type *server = (dtls_listener_relay_server_type *)arg;
 
+  loop_stats *stats = NULL;
+  ioa_engine_handle e = get_engine(server);
+  if (e) {
+    const unsigned int index = atomic_fetch_add(&udp_listener_threads_number, 1);
+    char name[LOOP_STATS_NAME_SIZE];
+    snprintf(name, sizeof(name), "udp-listener-%u", index);
+    /* the first CPU of the list is for the main listener thread */
+    e->cpu = pin_thread(&turn_params.listener_cpus, index + 1, e->sm, name);
+    turn_latency_set_thread_name(name);
+    /* the listener socket was created before the thread was pinned */
+    udp_listener_set_incoming_cpu(server, e->cpu);
+    stats = loop_stats_new(e->event_base, name, NULL, NULL);
+  }
+
   while (always_true && server) {
-    run_events(NULL, get_engine(server));
+    run_events(NULL, get_engine(server), stats);
   }
 
   return arg;
@@ -1287,6 +1369,14 @@ static void setup_socket_per_thread_udp_listener_servers(void) {
   }
 #endif
 
+  /* AF_XDP sockets: NIC queue q is served by the relay thread q % (number of relay threads) */
+  if (xdp_sockets_enabled()) {
+    for (i = 0; i < turn_params.af_xdp_queues; i++) {
+      relayindex = i % get_real_general_relay_servers_number();
+      xdp_socket_open(general_relay_servers[relayindex]->ioa_eng, (uint32_t)i);
+    }
+  }
+
   /* Aux UDP servers */
   for (i = 0; i < turn_params.aux_servers_list.size; i++) {
 
@@ -1385,6 +1475,8 @@ static void setup_socket_per_thread_udp_listener_servers(void) {
       }
     }
   }
+
+  xdp_sockets_start();
 }
 
 static void setup_socket_per_session_udp_listener_servers(void) {
@@ -1593,7 +1685,7 @@ static int get_alt_addr(ioa_addr *addr, ioa_addr *alt_addr) {
   return -1;
 }
 
-static void run_events(struct event_base *eb, ioa_engine_handle e) {
+static void run_events(struct event_base *eb, ioa_engine_handle e, loop_stats *stats) {
   if (!eb && e) {
     eb = e->event_base;
   }
@@ -1609,11 +1701,20 @@ static void run_events(struct event_base *eb, ioa_engine_handle e) {
 
   event_base_loopexit(eb, &timeout);
 
-  event_base_dispatch(eb);
+  if (stats) {
+    loop_stats_dispatch(stats);
+  } else {
+    event_base_dispatch(eb);
+  }
 }
 
 void run_listener_server(struct listener_server *ls) {
   unsigned int cycle = 0;
+  if (ls->ioa_eng) {
+    ls->ioa_eng->cpu = pin_thread(&turn_params.listener_cpus, 0, ls->ioa_eng->sm, "listener");
+    turn_latency_set_thread_name("listener");
+  }
+  loop_stats *stats = loop_stats_new(ls->event_base, "listener", NULL, NULL);
   while (!turn_params.stop_turn_server) {
 
 #if !defined(TURN_NO_SYSTEMD)
@@ -1631,7 +1732,7 @@ void run_listener_server(struct listener_server *ls) {
       TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "Drain complete, shutting down now...\n");
     }
 
-    run_events(ls->event_base, ls->ioa_eng);
+    run_events(ls->event_base, ls->ioa_eng, stats);
 
     rollover_logfile();
   }
@@ -1694,11 +1795,31 @@ static void setup_relay_server(struct relay_server *rs, ioa_engine_handle e, int
     set_rfc5780(&(rs->server), get_alt_addr, send_message_from_listener_to_client);
   }
 
+  if (turn_params.stateless_nonce) {
+    set_stateless_nonce(&(rs->server), turn_params.nonce_secret);
+  }
+
   if (turn_params.net_engine_version == NEV_UDP_SOCKET_PER_THREAD) {
     setup_tcp_listener_servers(rs->ioa_eng, rs);
   }
 }
 
+static void relay_loop_window(const loop_stats_snapshot *s, void *arg) {
+  struct relay_server *rs = (struct relay_server *)arg;
+  relay_load_window(rs->id, s);
+
+  if (turn_params.relay_rebalance && !xdp_sockets_enabled()) {
+    size_t dest = 0;
+    uint32_t max_pps = 0;
+    if (relay_load_imbalance(rs->id, &dest, &max_pps)) {
+      const turnsession_id sid = turn_session_migration_candidate(&(rs->server), max_pps);
+      if (sid) {
+        migrate_session(rs, sid, (turnserver_id)dest);
+      }
+    }
+  }
+}
+
 static void *run_general_relay_thread(void *arg) {
   static const int always_true = 1;
   struct relay_server *rs = (struct relay_server *)arg;
@@ -1711,7 +1832,15 @@ static void *run_general_relay_thread(void *arg) {
 
   ignore_sigpipe();
 
+  char name[LOOP_STATS_NAME_SIZE];
+  snprintf(name, sizeof(name), "relay-%u", (unsigned int)rs->id);
+
+  /* before the engine is created, so that its memory is local */
+  const int cpu = pin_thread(&turn_params.relay_cpus, rs->id, rs->sm, name);
+  turn_latency_set_thread_name(name);
+
   setup_relay_server(rs, NULL, we_need_rfc5780);
+  rs->ioa_eng->cpu = cpu;
 
 #if !defined(TURN_NO_THREAD_BARRIERS)
   if (turn_params.net_engine_version == NEV_UDP_SOCKET_PER_THREAD) {
@@ -1721,8 +1850,10 @@ static void *run_general_relay_thread(void *arg) {
 
   barrier_wait();
 
+  loop_stats *stats = loop_stats_new(rs->event_base, name, relay_loop_window, rs);
+
   while (always_true) {
-    run_events(rs->event_base, rs->ioa_eng);
+    run_events(rs->event_base, rs->ioa_eng, stats);
   }
 
   return arg;
@@ -1740,6 +1871,8 @@ static void setup_general_relay_servers(void) {
   }
 #endif
 
+  relay_load_init(get_real_general_relay_servers_number());
+
   for (i = 0; i < get_real_general_relay_servers_number(); i++) {
 
     if (turn_params.general_relay_servers_number == 0) {
@@ -1775,6 +1908,11 @@ static void *run_auth_server_thread(void *arg) {
 
   const authserver_id id = as->id;
 
+  char name[LOOP_STATS_NAME_SIZE];
+  snprintf(name, sizeof(name), "auth-%u", (unsigned int)id);
+  pin_thread(&turn_params.auth_cpus, id, NULL, name);
+  turn_latency_set_thread_name(name);
+
   if (id == 0) {
 
     reread_realms();
@@ -1813,12 +1951,14 @@ static void *run_auth_server_thread(void *arg) {
 
     barrier_wait();
 
+    loop_stats *stats = loop_stats_new(as->event_base, name, NULL, NULL);
+
     while (run_auth_server_flag) {
       if (!turn_params.no_auth_pings) {
         auth_ping(as->rch);
       }
 
-      run_events(as->event_base, NULL);
+      run_events(as->event_base, NULL, stats);
     }
   }
 
@@ -1842,7 +1982,7 @@ static void *run_admin_server_thread(void *arg) {
   barrier_wait();
 
   while (adminserver.event_base) {
-    run_events(adminserver.event_base, NULL);
+    run_events(adminserver.event_base, NULL, NULL);
   }
 
   return arg;
@@ -1868,9 +2008,13 @@ void setup_server(void) {
   evthread_use_pthreads();
 #endif
 
-  TURN_MUTEX_INIT(&mutex_bps);
   TURN_MUTEX_INIT(&auth_message_counter_mutex);
 
+  token_bucket_setup(turn_params.bps_burst, turn_params.bps_queue, turn_params.realm_bps_capacity);
+  token_bucket_set_server_bps(turn_params.bps_capacity);
+
+  tls_handshake_pool_init(turn_params.tls_handshake_workers, turn_params.tls_handshake_queue);
+
   authserver_number = 1 + (authserver_id)(turn_params.cpus / 2);
 
   if (authserver_number < MIN_AUTHSERVER_NUMBER) {
@@ -1892,6 +2036,10 @@ void setup_server(void) {
   setup_general_relay_servers();
   TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "Total General servers: %d\n", (int)get_real_general_relay_servers_number());
 
+  if (xdp_sockets_enabled() && (turn_params.net_engine_version != NEV_UDP_SOCKET_PER_THREAD)) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_WARNING, "AF_XDP is only used with the UDP socket per thread network engine\n");
+  }
+
   if (turn_params.net_engine_version == NEV_UDP_SOCKET_PER_THREAD) {
     setup_socket_per_thread_udp_listener_servers();
   } else if (turn_params.net_engine_version == NEV_UDP_SOCKET_PER_ENDPOINT) {
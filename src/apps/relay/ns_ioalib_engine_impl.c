@@ -44,7 +44,13 @@
 #include "ns_ioalib_impl.h"
 
 #include "mainrelay.h"
+#include "cpu_affinity.h"
+#include "latency_hist.h"
 #include "prom_server.h"
+#include "relay_load.h"
+#include "session_stats.h"
+#include "tcp_splice.h"
+#include "tls_handshake.h"
 
 #if TLS_SUPPORTED
 #include <event2/bufferevent_ssl.h>
@@ -367,12 +373,11 @@ static void free_blist_elem(ioa_engine_handle e, stun_buffer_list_elem *buf_elem
 
 static void timer_handler(ioa_engine_handle e, void *arg) {
 
+  UNUSED_ARG(e);
   UNUSED_ARG(arg);
 
   const turn_time_t now = turn_time();
   STORE_LOG_TIME(now);
-
-  e->jiffie = now;
 }
 
 ioa_engine_handle create_ioa_engine(super_memory_t *sm, struct event_base *eb, turnipports *tp,
@@ -416,6 +421,7 @@ ioa_engine_handle create_ioa_engine(super_memory_t *sm, struct event_base *eb, t
     ioa_engine_handle e = (ioa_engine_handle)allocate_super_memory_region(sm, sizeof(ioa_engine));
 
     e->sm = sm;
+    e->cpu = -1;
     e->default_relays = default_relays;
     e->verbose = verbose;
     e->tp = tp;
@@ -658,19 +664,27 @@ void delete_ioa_timer(ioa_timer_handle th) {
 
 /************** SOCKETS HELPERS ***********************/
 
-int ioa_socket_check_bandwidth(ioa_socket_handle s, ioa_network_buffer_handle nbh, int read) {
+/*
+ * Nanoseconds until the buffer fits the bandwidth of the socket, 0 when it
+ * does now and is taken. Only the data goes through the realm and server
+ * buckets, the control messages of a client get a session bucket of their own.
+ */
+static uint64_t ioa_socket_bandwidth_wait(ioa_socket_handle s, ioa_network_buffer_handle nbh, int read,
+                                          TOKEN_BUCKET_LEVEL *level) {
   if (s && (s->e) && nbh && ((s->sat == CLIENT_SOCKET) || (s->sat == RELAY_SOCKET) || (s->sat == RELAY_RTCP_SOCKET)) &&
       (s->session)) {
 
-    const size_t sz = ioa_network_buffer_get_size(nbh);
+    ts_ur_super_session *ss = s->session;
+    const band_limit_t max_bps = ss->bps;
+    const bool aggregate = token_bucket_aggregate();
 
-    const band_limit_t max_bps = s->session->bps;
-
-    if (max_bps < 1) {
-      return 1;
+    if ((max_bps < 1) && !aggregate) {
+      return 0;
     }
 
-    struct traffic_bytes *traffic = &(s->data_traffic);
+    const size_t sz = ioa_network_buffer_get_size(nbh);
+
+    struct traffic_buckets *traffic = &(s->data_traffic);
 
     if (s->sat == CLIENT_SOCKET) {
       uint8_t *buf = ioa_network_buffer_data(nbh);
@@ -682,42 +696,36 @@ int ioa_socket_check_bandwidth(ioa_socket_handle s, ioa_network_buffer_handle nb
       }
     }
 
-    const band_limit_t bsz = (band_limit_t)sz;
-
-    if (s->jiffie != s->e->jiffie) {
+    shared_token_bucket *realm = NULL;
+    shared_token_bucket *server = NULL;
 
-      s->jiffie = s->e->jiffie;
-      traffic->jiffie_bytes_read = 0;
-      traffic->jiffie_bytes_write = 0;
-
-      if (bsz > max_bps) {
-        return 0;
-      } else {
-        if (read) {
-          traffic->jiffie_bytes_read = bsz;
-        } else {
-          traffic->jiffie_bytes_write = bsz;
+    if (aggregate && (traffic == &(s->data_traffic))) {
+      /* The realm is known for sure only after the allocation; until then the realm level is skipped */
+      if (is_allocation_valid(get_allocation_ss(ss))) {
+        if (!(ss->realm_bps) || strcmp(ss->realm_bps_name, ss->realm_options.name)) {
+          ss->realm_bps = get_realm(ss->realm_options.name)->status.bps;
+          STRCPY(ss->realm_bps_name, ss->realm_options.name);
         }
-        return 1;
-      }
-    } else {
-      band_limit_t nsz;
-      if (read) {
-        nsz = traffic->jiffie_bytes_read + bsz;
-      } else {
-        nsz = traffic->jiffie_bytes_write + bsz;
-      }
-      if (nsz > max_bps) {
-        return 0;
-      } else {
-        if (read) {
-          traffic->jiffie_bytes_read = nsz;
-        } else {
-          traffic->jiffie_bytes_write = nsz;
-        }
-        return 1;
+        realm = &(ss->realm_bps[read ? 0 : 1]);
       }
+      server = token_bucket_server(read);
+    } else if (max_bps < 1) {
+      return 0;
     }
+
+    return token_bucket_take(read ? &(traffic->read) : &(traffic->write), max_bps, realm, server, sz,
+                             token_bucket_now(), level);
+  }
+
+  return 0;
+}
+
+int ioa_socket_check_bandwidth(ioa_socket_handle s, ioa_network_buffer_handle nbh, int read) {
+  TOKEN_BUCKET_LEVEL level = TOKEN_BUCKET_SESSION;
+
+  if (ioa_socket_bandwidth_wait(s, nbh, read, &level)) {
+    token_bucket_count(level, ioa_network_buffer_get_size(nbh), true);
+    return 0;
   }
 
   return 1;
@@ -1400,23 +1408,82 @@ ioa_socket_handle create_ioa_socket_from_fd(ioa_engine_handle e, ioa_socket_raw
   return ret;
 }
 
+static void ssl_handshake_completed(ioa_socket_handle s, SSL *ssl) {
+  /* TLS 1.3 reports it again after the post-handshake messages */
+  if (!(s->ssl_handshake_done)) {
+    s->ssl_handshake_done = 1;
+    prom_inc_tls_handshake(s->st, SSL_session_reused(ssl));
+    if (s->handshake_start) {
+      prom_observe_tls_handshake_duration(s->st,
+                                          (double)(tls_handshake_time_us() - s->handshake_start) / 1000000.0);
+      turn_latency_record((s->st == DTLS_SOCKET) ? TURN_LATENCY_DTLS_HANDSHAKE : TURN_LATENCY_TLS_HANDSHAKE,
+                          s->handshake_start);
+      s->handshake_start = 0;
+    }
+  }
+
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+  if ((SSL_get_options(ssl) & SSL_OP_ENABLE_KTLS) && !(s->ktls)) {
+    /* OpenSSL falls back to user space records when the cipher or the kernel does not allow it */
+    if (BIO_get_ktls_send(SSL_get_wbio(ssl))) {
+      s->ktls |= IOA_KTLS_TX;
+    }
+    if (BIO_get_ktls_recv(SSL_get_rbio(ssl))) {
+      s->ktls |= IOA_KTLS_RX;
+    }
+    if (s->ktls) {
+      prom_inc_ktls_session();
+      if (s->e && eve(s->e->verbose)) {
+        TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "%s: kTLS enabled on socket %p: tx=%d, rx=%d (%s)\n", __FUNCTION__, s,
+                      !!(s->ktls & IOA_KTLS_TX), !!(s->ktls & IOA_KTLS_RX), SSL_get_cipher(ssl));
+      }
+    }
+  }
+#endif
+}
+
+/*
+ * The app data slot belongs to the ALPN select callback, which stores the
+ * selected protocol name there; the socket has its own ex data slot.
+ */
+static int ssl_socket_index = -1;
+static pthread_once_t ssl_socket_index_once = PTHREAD_ONCE_INIT;
+
+static void ssl_socket_index_init(void) { ssl_socket_index = SSL_get_ex_new_index(0, NULL, NULL, NULL, NULL); }
+
+static int get_ssl_socket_index(void) {
+  (void)pthread_once(&ssl_socket_index_once, ssl_socket_index_init);
+  return ssl_socket_index;
+}
+
 static void ssl_info_callback(SSL *ssl, int where, int ret) {
   UNUSED_ARG(ret);
-  UNUSED_ARG(ssl);
-  UNUSED_ARG(where);
+
+  if (where & SSL_CB_HANDSHAKE_DONE) {
+    const int idx = get_ssl_socket_index();
+    ioa_socket_handle s = (idx < 0) ? NULL : (ioa_socket_handle)SSL_get_ex_data(ssl, idx);
+    if (s && (s->magic == SOCKET_MAGIC)) {
+      ssl_handshake_completed(s, ssl);
+    }
+  }
 }
 
 typedef void (*ssl_info_callback_t)(const SSL *ssl, int type, int val);
 
 static void set_socket_ssl(ioa_socket_handle s, SSL *ssl) {
   if (s && (s->ssl != ssl)) {
+    const int idx = get_ssl_socket_index();
     if (s->ssl) {
-      SSL_set_app_data(s->ssl, NULL);
+      if (idx >= 0) {
+        SSL_set_ex_data(s->ssl, idx, NULL);
+      }
       SSL_set_info_callback(s->ssl, (ssl_info_callback_t)NULL);
     }
     s->ssl = ssl;
     if (ssl) {
-      SSL_set_app_data(ssl, s);
+      if (idx >= 0) {
+        SSL_set_ex_data(ssl, idx, s);
+      }
       SSL_set_info_callback(ssl, (ssl_info_callback_t)ssl_info_callback);
       SSL_set_options(ssl,
 #if defined(SSL_OP_NO_RENEGOTIATION)
@@ -1431,6 +1498,14 @@ static void set_socket_ssl(ioa_socket_handle s, SSL *ssl) {
   }
 }
 
+/* Gives the SSL of a handshake completed elsewhere to the socket */
+void attach_ioa_socket_ssl(ioa_socket_handle s, SSL *ssl) {
+  set_socket_ssl(s, ssl);
+  if (s && ssl && SSL_is_init_finished(ssl)) {
+    ssl_handshake_completed(s, ssl);
+  }
+}
+
 /* Only must be called for DTLS_SOCKET */
 ioa_socket_handle create_ioa_socket_from_ssl(ioa_engine_handle e, ioa_socket_handle parent_s, SSL *ssl, SOCKET_TYPE st,
                                              SOCKET_APP_TYPE sat, const ioa_addr *remote_addr,
@@ -1443,6 +1518,9 @@ ioa_socket_handle create_ioa_socket_from_ssl(ioa_engine_handle e, ioa_socket_han
 
   if (ret) {
     set_socket_ssl(ret, ssl);
+    if (!SSL_is_init_finished(ssl)) {
+      ret->handshake_start = tls_handshake_time_us();
+    }
   }
 
   return ret;
@@ -1451,7 +1529,12 @@ ioa_socket_handle create_ioa_socket_from_ssl(ioa_engine_handle e, ioa_socket_han
 static void close_socket_net_data(ioa_socket_handle s) {
   if (s) {
 
+    tls_handshake_cancel(s);
+    tcp_splice_stop(s);
     EVENT_DEL(s->read_event);
+    EVENT_DEL(s->shaped_ev);
+    ioa_network_buffer_delete(s->e, s->shaped_nbh);
+    s->shaped_nbh = NULL;
     if (s->list_ev) {
       evconnlistener_free(s->list_ev);
       s->list_ev = NULL;
@@ -1490,7 +1573,11 @@ static void close_socket_net_data(ioa_socket_handle s) {
 
 void detach_socket_net_data(ioa_socket_handle s) {
   if (s) {
+    tcp_splice_stop(s);
     EVENT_DEL(s->read_event);
+    EVENT_DEL(s->shaped_ev);
+    ioa_network_buffer_delete(s->e, s->shaped_nbh);
+    s->shaped_nbh = NULL;
     s->read_cb = NULL;
     s->read_ctx = NULL;
     if (s->list_ev) {
@@ -1952,6 +2039,55 @@ int ssl_read(evutil_socket_t fd, SSL *ssl, ioa_network_buffer_handle nbh, int ve
   return ret;
 }
 
+/*
+ * Continues a server handshake whose ClientHello has already been consumed
+ * (DTLSv1_listen): sends the next flight and returns to wait for the client.
+ */
+int ssl_resume_handshake(evutil_socket_t fd, SSL *ssl, int verbose) {
+  if (!ssl) {
+    return -1;
+  }
+
+  BIO *wbio = SSL_get_wbio(ssl);
+  if (wbio) {
+    BIO_set_fd(wbio, fd, BIO_NOCLOSE);
+  }
+
+  BIO *rbio = BIO_new(BIO_s_mem());
+  BIO_set_mem_eof_return(rbio, -1);
+  SSL_set0_rbio(ssl, rbio);
+
+  int rc = 0;
+  do {
+    rc = SSL_do_handshake(ssl);
+  } while (rc < 0 && socket_eintr());
+
+  int ret = 0;
+  if (rc <= 0) {
+    switch (SSL_get_error(ssl, rc)) {
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+      break;
+    case SSL_ERROR_SYSCALL:
+      if (!handle_socket_error()) {
+        ret = -1;
+      }
+      break;
+    default:
+      if (verbose) {
+        char buf[1024];
+        TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "%s: SSL handshake error: %s\n", __FUNCTION__,
+                      ERR_error_string(ERR_get_error(), buf));
+      }
+      ret = -1;
+    }
+  }
+
+  SSL_set0_rbio(ssl, NULL);
+
+  return ret;
+}
+
 static int socket_readerr(evutil_socket_t fd, ioa_addr *orig_addr) {
   if ((fd < 0) || !orig_addr) {
     return -1;
@@ -2374,6 +2510,178 @@ static ssize_t socket_parse_proxy(ioa_socket_handle s, uint8_t *buf, size_t len)
   return tlen;
 }
 
+/*
+ * Length of the STUN message or ChannelData frame at the head of a stream
+ * input buffer, computed from its header without copying the buffer out.
+ * Returns 0 when the frame is not complete yet, and -1 when the content is
+ * not recognized as STUN framed.
+ */
+static int get_stream_frame_len(struct evbuffer *inbuf, size_t *app_msg_len) {
+  const size_t blen = evbuffer_get_length(inbuf);
+  const size_t hlen = (blen < STUN_HEADER_LENGTH) ? blen : STUN_HEADER_LENGTH;
+  if (hlen < 4) {
+    return 0;
+  }
+
+  uint8_t hbuf[STUN_HEADER_LENGTH];
+  const uint8_t *hdr = hbuf;
+  struct evbuffer_iovec v;
+  if ((evbuffer_peek(inbuf, (ev_ssize_t)hlen, NULL, &v, 1) > 0) && (v.iov_len >= hlen)) {
+    hdr = (const uint8_t *)v.iov_base;
+  } else {
+    evbuffer_copyout(inbuf, hbuf, hlen);
+  }
+
+  /* HTTP methods look like channel numbers */
+  if (!memcmp(hdr, "GET ", 4) || !memcmp(hdr, "POST", 4) || !memcmp(hdr, "DELE", 4) || !memcmp(hdr, "PUT ", 4)) {
+    return -1;
+  }
+
+  uint16_t w[2];
+  memcpy(w, hdr, sizeof(w));
+  const uint16_t first = nswap16(w[0]);
+  const size_t field_len = nswap16(w[1]);
+
+  size_t frame_len = 0;
+  size_t app_len = 0;
+
+  if (STUN_VALID_CHANNEL(first)) {
+    app_len = 4 + field_len;
+    frame_len = ((app_len & 0x0003) ? (((app_len >> 2) + 1) << 2) : app_len);
+  } else if ((hdr[0] & 0xC0) == 0) {
+    if (hlen < STUN_HEADER_LENGTH) {
+      return 0;
+    }
+    uint32_t cookie;
+    memcpy(&cookie, hdr + 4, sizeof(cookie));
+    if ((nswap32(cookie) != STUN_MAGIC_COOKIE) || (field_len & 0x0003)) {
+      return -1;
+    }
+    app_len = STUN_HEADER_LENGTH + field_len;
+    frame_len = app_len;
+  } else {
+    return -1;
+  }
+
+  if (frame_len > STUN_BUFFER_SIZE) {
+    return -1;
+  }
+  if (frame_len > blen) {
+    return 0;
+  }
+
+  *app_msg_len = app_len;
+  return (int)frame_len;
+}
+
+#if TLS_SUPPORTED
+/* The TLS worker pool is done with the handshake of the client socket s */
+static void socket_tls_handshake_done(ioa_socket_handle s, int rc, ioa_network_buffer_handle *dgrams,
+                                      size_t dgrams_number, void *arg) {
+  UNUSED_ARG(dgrams);
+  UNUSED_ARG(dgrams_number);
+  UNUSED_ARG(arg);
+
+  if ((rc < 0) || !(s->ssl)) {
+    s->broken = 1;
+    s->tobeclosed = 1;
+    close_ioa_socket_after_processing_if_necessary(s);
+    return;
+  }
+
+  /* The SSL keeps its socket BIO, and the kernel TLS state of it */
+  s->bev = bufferevent_openssl_socket_new(s->e->event_base, s->fd, s->ssl, BUFFEREVENT_SSL_OPEN,
+                                          TURN_BUFFEREVENTS_OPTIONS);
+  bufferevent_setcb(s->bev, socket_input_handler_bev, socket_output_handler_bev, eventcb_bev, s);
+  bufferevent_setwatermark(s->bev, EV_READ | EV_WRITE, 0, BUFFEREVENT_HIGH_WATERMARK);
+  bufferevent_enable(s->bev, EV_READ | EV_WRITE); /* Start reading. */
+}
+#endif
+
+/* Passes the input to the reader of the socket, or keeps it until there is one */
+static int socket_deliver_input(ioa_socket_handle s, stun_buffer_list_elem *buf_elem, const ioa_addr *remote_addr,
+                                int ttl, int tos) {
+  if (s->read_cb) {
+    ioa_net_data nd;
+
+    memset(&nd, 0, sizeof(ioa_net_data));
+    addr_cpy(&(nd.src_addr), remote_addr);
+    nd.nbh = buf_elem;
+    nd.recv_ttl = ttl;
+    nd.recv_tos = tos;
+
+    s->read_cb(s, IOA_EV_READ, &nd, s->read_ctx, 1);
+
+    if (nd.nbh) {
+      free_blist_elem(s->e, buf_elem);
+    }
+
+    return 1;
+  }
+
+  ioa_network_buffer_delete(s->e, s->defer_nbh);
+  s->defer_nbh = buf_elem;
+
+  return 0;
+}
+
+static void socket_shaped_input_wait(ioa_socket_handle s, uint64_t wait) {
+  struct timeval tv = {(time_t)(wait / 1000000000), (suseconds_t)((wait % 1000000000) / 1000 + 1)};
+  evtimer_add(s->shaped_ev, &tv);
+}
+
+static void socket_shaped_input_handler(evutil_socket_t fd, short what, void *arg) {
+  UNUSED_ARG(fd);
+  UNUSED_ARG(what);
+
+  ioa_socket_handle s = (ioa_socket_handle)arg;
+
+  if (!s || (s->magic != SOCKET_MAGIC) || (s->done) || !(s->shaped_nbh)) {
+    return;
+  }
+
+  stun_buffer_list_elem *buf_elem = (stun_buffer_list_elem *)s->shaped_nbh;
+  TOKEN_BUCKET_LEVEL level = TOKEN_BUCKET_SESSION;
+  const uint64_t wait = ioa_socket_bandwidth_wait(s, buf_elem, 1, &level);
+
+  if (wait) {
+    /* the shared buckets went to other sessions meanwhile */
+    socket_shaped_input_wait(s, wait);
+    return;
+  }
+
+  s->shaped_nbh = NULL;
+  socket_deliver_input(s, buf_elem, &(s->remote_addr), TTL_IGNORE, TOS_IGNORE);
+
+  /* what came in meanwhile */
+  if ((s->magic == SOCKET_MAGIC) && !(s->done) && s->bev) {
+    socket_input_handler_bev(s->bev, s);
+  }
+}
+
+/*
+ * Stream input over the bandwidth waits for the buckets when it is for a
+ * short time. The socket reads nothing else meanwhile, so the bufferevent
+ * high watermark and TCP push back on the sender. Datagrams are dropped.
+ */
+static bool socket_hold_shaped_input(ioa_socket_handle s, stun_buffer_list_elem *buf_elem, uint64_t wait) {
+  if (!(s->bev) || (wait > token_bucket_queue_ns())) {
+    return false;
+  }
+
+  if (!(s->shaped_ev)) {
+    s->shaped_ev = evtimer_new(s->e->event_base, socket_shaped_input_handler, s);
+    if (!(s->shaped_ev)) {
+      return false;
+    }
+  }
+
+  socket_shaped_input_wait(s, wait);
+  s->shaped_nbh = buf_elem;
+
+  return true;
+}
+
 static int socket_input_worker(ioa_socket_handle s) {
   int len = 0;
   int ret = 0;
@@ -2405,6 +2713,10 @@ static int socket_input_worker(ioa_socket_handle s) {
     return 0;
   }
 
+  if (s->shaped_nbh) {
+    return 0;
+  }
+
   if (s->connected) {
     addr_cpy(&remote_addr, &(s->remote_addr));
   }
@@ -2464,6 +2776,13 @@ static int socket_input_worker(ioa_socket_handle s) {
       }
 
       if (s->ssl) {
+        s->handshake_start = tls_handshake_time_us();
+        if (tls_handshake_pool_enabled()) {
+          if (!tls_handshake_submit(s, socket_tls_handshake_done, NULL)) {
+            s->tobeclosed = 1;
+          }
+          return 0;
+        }
         s->bev = bufferevent_openssl_socket_new(s->e->event_base, s->fd, s->ssl, BUFFEREVENT_SSL_ACCEPTING,
                                                 TURN_BUFFEREVENTS_OPTIONS);
         bufferevent_setcb(s->bev, socket_input_handler_bev, socket_output_handler_bev, eventcb_bev, s);
@@ -2501,6 +2820,13 @@ static int socket_input_worker(ioa_socket_handle s) {
         set_socket_ssl(s, SSL_new(s->e->tls_ctx));
       }
       if (s->ssl) {
+        s->handshake_start = tls_handshake_time_us();
+        if (tls_handshake_pool_enabled()) {
+          if (!tls_handshake_submit(s, socket_tls_handshake_done, NULL)) {
+            s->tobeclosed = 1;
+          }
+          return 0;
+        }
         s->bev = bufferevent_openssl_socket_new(s->e->event_base, s->fd, s->ssl, BUFFEREVENT_SSL_ACCEPTING,
                                                 TURN_BUFFEREVENTS_OPTIONS);
         bufferevent_setcb(s->bev, socket_input_handler_bev, socket_output_handler_bev, eventcb_bev, s);
@@ -2537,58 +2863,58 @@ try_start:
   if (s->bev) { /* TCP & TLS  & SCTP & SCTP/TLS */
     struct evbuffer *inbuf = bufferevent_get_input(s->bev);
     if (inbuf) {
-      ev_ssize_t blen = evbuffer_copyout(inbuf, buf_elem->buf.buf, STUN_BUFFER_SIZE);
-
-      if (blen > 0) {
-        int mlen = 0;
-
-        if (blen > (ev_ssize_t)STUN_BUFFER_SIZE) {
-          blen = (ev_ssize_t)STUN_BUFFER_SIZE;
-        }
+      ev_ssize_t blen = 0;
+      int mlen = 0;
 
-        if (s->st == TCP_SOCKET_PROXY) {
+      if (s->st == TCP_SOCKET_PROXY) {
+        blen = evbuffer_copyout(inbuf, buf_elem->buf.buf, STUN_BUFFER_SIZE);
+        if (blen > 0) {
           const ssize_t tlen = socket_parse_proxy(s, buf_elem->buf.buf, blen);
-          blen = 0;
           if (tlen < 0) {
             s->tobeclosed = 1;
             s->broken = 1;
             ret = -1;
             log_socket_event(s, "proxy protocol violated", 1);
           } else if (tlen > 0) {
-            bufferevent_read(s->bev, buf_elem->buf.buf, tlen);
-
-            blen = evbuffer_copyout(inbuf, buf_elem->buf.buf, STUN_BUFFER_SIZE);
+            evbuffer_drain(inbuf, tlen);
             s->st = TCP_SOCKET;
           }
         }
+      }
 
-        if (blen) {
-          if (is_stream_socket(s->st) && ((s->sat == TCP_CLIENT_DATA_SOCKET) || (s->sat == TCP_RELAY_DATA_SOCKET))) {
-            mlen = blen;
-          } else {
-            mlen = stun_get_message_len_str(buf_elem->buf.buf, blen, 1, &app_msg_len);
+      if ((s->st != TCP_SOCKET_PROXY) && (ret != -1)) {
+        if (is_stream_socket(s->st) && ((s->sat == TCP_CLIENT_DATA_SOCKET) || (s->sat == TCP_RELAY_DATA_SOCKET))) {
+          const size_t ilen = evbuffer_get_length(inbuf);
+          mlen = (int)((ilen > STUN_BUFFER_SIZE) ? STUN_BUFFER_SIZE : ilen);
+        } else {
+          /* Framing from the message header only, the message is copied once below */
+          mlen = get_stream_frame_len(inbuf, &app_msg_len);
+          if (mlen < 0) {
+            /* Not STUN framed (HTTP...): let the generic parser look at the content */
+            blen = evbuffer_copyout(inbuf, buf_elem->buf.buf, STUN_BUFFER_SIZE);
+            mlen = (blen > 0) ? stun_get_message_len_str(buf_elem->buf.buf, blen, 1, &app_msg_len) : 0;
           }
+        }
+      }
 
-          if (mlen > 0 && mlen <= (int)blen) {
-            len = (int)bufferevent_read(s->bev, buf_elem->buf.buf, mlen);
-            if (len < 0) {
-              ret = -1;
-              s->tobeclosed = 1;
-              s->broken = 1;
-              log_socket_event(s, "socket read failed, to be closed", 1);
-            } else if ((s->st == TLS_SOCKET) || (s->st == TLS_SCTP_SOCKET)) {
+      if (mlen > 0) {
+        len = (int)bufferevent_read(s->bev, buf_elem->buf.buf, mlen);
+        if (len < 0) {
+          ret = -1;
+          s->tobeclosed = 1;
+          s->broken = 1;
+          log_socket_event(s, "socket read failed, to be closed", 1);
+        } else if ((s->st == TLS_SOCKET) || (s->st == TLS_SCTP_SOCKET)) {
 #if TLS_SUPPORTED
-              SSL *ctx = bufferevent_openssl_get_ssl(s->bev);
-              if (!ctx || SSL_get_shutdown(ctx)) {
-                ret = -1;
-                s->tobeclosed = 1;
-              }
-#endif
-            }
-            if (ret != -1) {
-              ret = len;
-            }
+          SSL *ctx = bufferevent_openssl_get_ssl(s->bev);
+          if (!ctx || SSL_get_shutdown(ctx)) {
+            ret = -1;
+            s->tobeclosed = 1;
           }
+#endif
+        }
+        if (ret != -1) {
+          ret = len;
         }
       } else if (blen < 0) {
         s->tobeclosed = 1;
@@ -2646,32 +2972,17 @@ try_start:
       buf_elem->buf.len = len;
     }
 
-    if (ioa_socket_check_bandwidth(s, buf_elem, 1)) {
+    TOKEN_BUCKET_LEVEL level = TOKEN_BUCKET_SESSION;
+    const uint64_t wait = ioa_socket_bandwidth_wait(s, buf_elem, 1, &level);
 
-      if (s->read_cb) {
-        ioa_net_data nd;
-
-        memset(&nd, 0, sizeof(ioa_net_data));
-        addr_cpy(&(nd.src_addr), &remote_addr);
-        nd.nbh = buf_elem;
-        nd.recv_ttl = ttl;
-        nd.recv_tos = tos;
-
-        s->read_cb(s, IOA_EV_READ, &nd, s->read_ctx, 1);
-
-        if (nd.nbh) {
-          free_blist_elem(s->e, buf_elem);
-        }
-
-        buf_elem = NULL;
-
-        try_ok = 1;
-
-      } else {
-        ioa_network_buffer_delete(s->e, s->defer_nbh);
-        s->defer_nbh = buf_elem;
-        buf_elem = NULL;
-      }
+    if (!wait) {
+      try_ok = socket_deliver_input(s, buf_elem, &remote_addr, ttl, tos);
+      buf_elem = NULL;
+    } else if (socket_hold_shaped_input(s, buf_elem, wait)) {
+      token_bucket_count(level, buf_elem->buf.len, false);
+      buf_elem = NULL;
+    } else {
+      token_bucket_count(level, buf_elem->buf.len, true);
     }
   }
 
@@ -2798,6 +3109,12 @@ static void socket_output_handler_bev(struct bufferevent *bev, void *arg) {
         return;
       }
 
+      if (s->splice) {
+        /* the pair is relayed in the kernel, the bufferevents only flush what was queued before */
+        tcp_splice_output_drained(s);
+        return;
+      }
+
       if (s->sub_session) {
 
         if (s == s->sub_session->client_s) {
@@ -3694,6 +4011,7 @@ void turn_report_allocation_set(void *a, turn_time_t lifetime, int refresh) {
           if (!refresh) {
             prom_inc_allocation(get_ioa_socket_type(ss->client_socket));
             increment_global_allocation_count();
+            relay_load_allocation(server->id, 1);
           }
         }
       }
@@ -3772,6 +4090,7 @@ void turn_report_allocation_delete(void *a, SOCKET_TYPE socket_type) {
           }
           prom_dec_allocation(socket_type);
           decrement_global_allocation_count();
+          relay_load_allocation(server->id, -1);
         }
       }
     }
@@ -3784,8 +4103,12 @@ void turn_report_session_usage(void *session, int force_invalid) {
     turn_turnserver *server = (turn_turnserver *)ss->server;
     if (server && (ss->received_packets || ss->sent_packets || force_invalid)) {
       ioa_engine_handle e = turn_server_get_engine(server);
-      if (((ss->received_packets + ss->sent_packets + ss->peer_received_packets + ss->peer_sent_packets) & 4095) == 0 ||
-          force_invalid) {
+      if (!force_invalid) {
+        relay_load_packet(server->id);
+      }
+      const uint32_t packets =
+          ss->received_packets + ss->sent_packets + ss->peer_received_packets + ss->peer_sent_packets;
+      if ((packets & 4095) == 0 || force_invalid) {
         if (e && e->verbose) {
           TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO,
                         "session %018llu: usage: realm=<%s>, username=<%s>, rp=%lu, rb=%lu, sp=%lu, sb=%lu\n",
@@ -3845,9 +4168,11 @@ void turn_report_session_usage(void *session, int force_invalid) {
           }
         }
 
-        report_turn_session_info(server, ss, force_invalid);
-
         if (force_invalid) {
+          /* The session closes: the last totals go to the admin thread with the close event */
+          report_turn_session_info(server, ss, force_invalid);
+          turn_session_stats_detach(ss);
+
           const turn_dbdriver_t *dbd = get_dbdriver();
           if (dbd && dbd->report_usage) {
             dbd->report_usage(session);
@@ -3862,11 +4187,82 @@ void turn_report_session_usage(void *session, int force_invalid) {
         ss->peer_received_bytes = 0;
         ss->peer_sent_packets = 0;
         ss->peer_sent_bytes = 0;
+
+        if (ss->stats) {
+          session_stats_publish(ss->stats, ss);
+        }
+      } else if (ss->stats && ((packets & SESSION_STATS_PUBLISH_MASK) == 0)) {
+        session_stats_publish(ss->stats, ss);
+      }
+    }
+  }
+}
+
+void turn_report_session_migration(void *session, int arrived) {
+  ts_ur_super_session *ss = (ts_ur_super_session *)session;
+  if (ss && ss->server) {
+    turn_turnserver *server = (turn_turnserver *)ss->server;
+    if (arrived) {
+      relay_load_allocation(server->id, 1);
+    } else {
+      turn_session_stats_detach(ss);
+      relay_load_allocation(server->id, -1);
+#if !defined(TURN_NO_HIREDIS)
+      ioa_engine_handle e = turn_server_get_engine(server);
+      if (e) {
+        char key[1024];
+        if (ss->realm_options.name[0]) {
+          snprintf(key, sizeof(key), "turn/realm/%s/user/%s/allocation/%018llu/status", ss->realm_options.name,
+                   (char *)ss->username, (unsigned long long)ss->id);
+        } else {
+          snprintf(key, sizeof(key), "turn/user/%s/allocation/%018llu/status", (char *)ss->username,
+                   (unsigned long long)ss->id);
+        }
+        send_message_to_redis(e->rch, "del", key, "");
+        send_message_to_redis(e->rch, "publish", key, "migrated");
+      }
+#endif
+    }
+  }
+}
+
+/* The general relay threads first, then the UDP ones (their server ids start at the boundary) */
+static unsigned int relay_thread_index(turnserver_id id) {
+  if (id < TURNSERVER_ID_BOUNDARY_BETWEEN_TCP_AND_UDP) {
+    return (unsigned int)id;
+  }
+  const unsigned int general =
+      (turn_params.general_relay_servers_number > 1) ? (unsigned int)turn_params.general_relay_servers_number : 1;
+  return general + (unsigned int)(id - TURNSERVER_ID_BOUNDARY_BETWEEN_TCP_AND_UDP);
+}
+
+void turn_session_stats_attach(void *session) {
+  ts_ur_super_session *ss = (ts_ur_super_session *)session;
+  if (ss && !(ss->stats) && ss->server) {
+    ioa_engine_handle e = turn_server_get_engine((turn_turnserver *)ss->server);
+    if (e) {
+      if (!(e->stats)) {
+        e->stats = session_stats_table_new(relay_thread_index(((turn_turnserver *)ss->server)->id));
+      }
+      ss->stats = session_stats_acquire(e->stats, ss->id, ss->realm_options.name);
+      if (ss->stats) {
+        session_stats_publish(ss->stats, ss);
       }
     }
   }
 }
 
+void turn_session_stats_detach(void *session) {
+  ts_ur_super_session *ss = (ts_ur_super_session *)session;
+  if (ss && ss->stats) {
+    ioa_engine_handle e = turn_server_get_engine((turn_turnserver *)ss->server);
+    if (e) {
+      session_stats_release(e->stats, ss->stats);
+    }
+    ss->stats = NULL;
+  }
+}
+
 /////////////// SSL ///////////////////
 
 const char *get_ioa_socket_tls_cipher(ioa_socket_handle s) {
@@ -4000,6 +4396,16 @@ void *allocate_super_memory_region_func(super_memory_t *r, size_t size, const ch
   return ret;
 }
 
+void bind_super_memory_region(super_memory_t *r, int node) {
+  if (r && (node >= 0)) {
+    TURN_MUTEX_LOCK(&r->mutex_sm);
+    for (size_t i = 0; i <= r->sm_chunk; ++i) {
+      turn_memory_bind_node(r->super_memory[i], TURN_SM_SIZE, node);
+    }
+    TURN_MUTEX_UNLOCK(&r->mutex_sm);
+  }
+}
+
 void *allocate_super_memory_engine_func(ioa_engine_handle e, size_t size, const char *file, const char *func,
                                         int line) {
   if (e) {
@@ -104,6 +104,12 @@ struct cancelled_session_message {
   turnsession_id id;
 };
 
+struct migrated_session_message {
+  turnsession_id id;
+  turnserver_id dest;
+  ts_ur_super_session *ss;
+};
+
 struct relay_server {
   turnserver_id id;
   super_memory_t *sm;
@@ -124,6 +130,7 @@ struct message_to_relay {
     struct socket_message sm;
     struct cb_socket_message cb_sm;
     struct cancelled_session_message csm;
+    struct migrated_session_message msm;
   } m;
 };
 
@@ -138,6 +145,12 @@ typedef int (*ioa_engine_udp_event_handler)(relay_server_handle rs, struct messa
 #define PREDEF_TIMERS_NUM (14)
 extern const int predef_timer_intervals[PREDEF_TIMERS_NUM];
 
+struct _xdp_socket;
+struct _tcp_splice;
+struct _tls_handshake;
+struct _tls_handshake_queue;
+struct _session_stats_table;
+
 struct _ioa_engine {
   super_memory_t *sm;
   struct event_base *event_base;
@@ -148,7 +161,6 @@ struct _ioa_engine {
   stun_buffer_list bufs;
   SSL_CTX *tls_ctx;
   SSL_CTX *dtls_ctx;
-  turn_time_t jiffie; /* bandwidth check interval */
   ioa_timer_handle timer_ev;
   char cmsg[TURN_CMSG_SZ + 1];
   int predef_timer_intervals[PREDEF_TIMERS_NUM];
@@ -160,13 +172,25 @@ struct _ioa_engine {
   size_t relay_addr_counter;
   ioa_addr *relay_addrs;
   redis_context_handle rch;
+  /* AF_XDP sockets served by this engine */
+  struct _xdp_socket *xsks;
+  /* handshakes completed by the TLS workers for this engine */
+  struct _tls_handshake_queue *handshakes;
+  /* live counters of the sessions of this engine, created on demand */
+  struct _session_stats_table *stats;
+  /* the engine thread is pinned to, or -1 */
+  int cpu;
 };
 
 #define SOCKET_MAGIC (0xABACADEF)
 
-struct traffic_bytes {
-  band_limit_t jiffie_bytes_read;
-  band_limit_t jiffie_bytes_write;
+/* Kernel TLS record processing, per direction */
+#define IOA_KTLS_TX (0x1)
+#define IOA_KTLS_RX (0x2)
+
+struct traffic_buckets {
+  token_bucket read;
+  token_bucket write;
 };
 
 struct _ioa_socket {
@@ -181,6 +205,11 @@ struct _ioa_socket {
   SOCKET_APP_TYPE sat;
   SSL *ssl;
   uint32_t ssl_renegs;
+  int ssl_handshake_done;
+  uint64_t handshake_start;
+  /* handshake running in the TLS worker pool, the SSL is detached meanwhile */
+  struct _tls_handshake *handshake;
+  int ktls;
   int in_write;
   int bound;
   int local_addr_known;
@@ -203,9 +232,11 @@ struct _ioa_socket {
   int default_tos;
   int current_tos;
   stun_buffer_list bufs;
-  turn_time_t jiffie; /* bandwidth check interval */
-  struct traffic_bytes data_traffic;
-  struct traffic_bytes control_traffic;
+  struct traffic_buckets data_traffic;
+  struct traffic_buckets control_traffic;
+  /* stream input waiting for the bandwidth buckets */
+  ioa_network_buffer_handle shaped_nbh;
+  struct event *shaped_ev;
   /* RFC 6062 ==>> */
   // Connection session:
   tcp_connection *sub_session;
@@ -217,6 +248,8 @@ struct _ioa_socket {
   struct evconnlistener *list_ev;
   accept_cb acb;
   void *acbarg;
+  // Kernel data mover, when spliced to the other connection:
+  struct _tcp_splice *splice;
   /* <<== RFC 6062 */
   void *special_session;
   size_t special_session_size;
@@ -270,6 +303,8 @@ int udp_send(ioa_socket_handle s, const ioa_addr *dest_addr, const char *buffer,
 int udp_recvfrom(evutil_socket_t fd, ioa_addr *orig_addr, const ioa_addr *like_addr, char *buffer, int buf_size,
                  int *ttl, int *tos, char *ecmsg, int flags, uint32_t *errcode);
 int ssl_read(evutil_socket_t fd, SSL *ssl, ioa_network_buffer_handle nbh, int verbose);
+int ssl_resume_handshake(evutil_socket_t fd, SSL *ssl, int verbose);
+void attach_ioa_socket_ssl(ioa_socket_handle s, SSL *ssl);
 
 int set_raw_socket_ttl_options(evutil_socket_t fd, int family);
 int set_raw_socket_tos_options(evutil_socket_t fd, int family);
@@ -278,6 +313,7 @@ int set_socket_options_fd(evutil_socket_t fd, SOCKET_TYPE st, int family);
 int set_socket_options(ioa_socket_handle s);
 
 int send_session_cancellation_to_relay(turnsession_id sid);
+int send_session_migration_to_relay(turnsession_id sid, size_t dest);
 
 int send_data_from_ioa_socket_tcp(ioa_socket_handle s, const void *data, size_t sz);
 int send_str_from_ioa_socket_tcp(ioa_socket_handle s, const void *data);
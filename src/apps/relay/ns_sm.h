@@ -63,6 +63,9 @@ super_memory_t *new_super_memory_region(void);
 void *allocate_super_memory_region_func(super_memory_t *region, size_t size, const char *file, const char *func,
                                         int line);
 
+/* Moves the region to the NUMA node */
+void bind_super_memory_region(super_memory_t *region, int node);
+
 /////////////////////////////////////////////////
 
 #ifdef __cplusplus
@@ -33,8 +33,11 @@
  */
 
 #include "prom_server.h"
+#include "latency_hist.h"
+#include "loop_stats.h"
 #include "mainrelay.h"
 #include "ns_turn_utils.h"
+#include "session_stats.h"
 #if !defined(WINDOWS)
 #include <errno.h>
 #include <sys/socket.h>
@@ -45,6 +48,7 @@
 
 prom_counter_t *packet_processed;
 prom_counter_t *packet_dropped;
+prom_counter_t *packet_classified;
 
 prom_counter_t *stun_binding_request;
 prom_counter_t *stun_binding_response;
@@ -72,6 +76,373 @@ prom_counter_t *turn_total_traffic_peer_sentb;
 
 prom_gauge_t *turn_total_allocations;
 
+prom_counter_t *turn_ktls_sessions;
+
+prom_counter_t *turn_tls_handshakes_full;
+prom_counter_t *turn_tls_handshakes_resumed;
+prom_counter_t *turn_tls_handshakes_rejected;
+prom_histogram_t *turn_tls_handshake_duration;
+
+prom_counter_t *turn_dtls_hello_verify_requests;
+prom_counter_t *turn_dtls_cookies_rejected;
+
+/*
+ * Hot path counters: every thread counts into its own cache-line padded
+ * shard, the shards are summed into the registry metrics at scrape time.
+ */
+
+#define PROM_CACHE_LINE_SIZE (64)
+
+enum _PROM_SHARD_COUNTER {
+  PROM_SHARD_PACKET_PROCESSED,
+  PROM_SHARD_PACKET_DROPPED,
+  PROM_SHARD_BINDING_REQUEST,
+  PROM_SHARD_BINDING_RESPONSE,
+  PROM_SHARD_BINDING_ERROR,
+  /* TURN_PACKET_CLASSES_NUMBER entries */
+  PROM_SHARD_PACKET_CLASS,
+  PROM_SHARD_COUNTERS_NUMBER = PROM_SHARD_PACKET_CLASS + TURN_PACKET_CLASSES_NUMBER
+};
+
+typedef struct _prom_shard {
+  struct _prom_shard *next;
+  char head_pad[PROM_CACHE_LINE_SIZE];
+  /* written by the owner thread only */
+  atomic_uint_fast64_t counters[PROM_SHARD_COUNTERS_NUMBER];
+  char tail_pad[PROM_CACHE_LINE_SIZE];
+} prom_shard;
+
+static _Atomic(prom_shard *) prom_shards = NULL;
+static _Thread_local prom_shard *prom_thread_shard = NULL;
+
+static void prom_shard_add(int counter, uint64_t value) {
+  prom_shard *sh = prom_thread_shard;
+  if (!sh) {
+    sh = (prom_shard *)calloc(1, sizeof(prom_shard));
+    if (!sh) {
+      return;
+    }
+    sh->next = atomic_load_explicit(&prom_shards, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&prom_shards, &(sh->next), sh, memory_order_release,
+                                                  memory_order_relaxed)) {
+    }
+    prom_thread_shard = sh;
+  }
+  atomic_uint_fast64_t *c = &(sh->counters[counter]);
+  atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+/*
+ * Live traffic of the active sessions, from the shared session records, per
+ * relay thread and per realm
+ */
+
+enum _PROM_LIVE_METRIC {
+  PROM_LIVE_SESSIONS,
+  PROM_LIVE_RCVP,
+  PROM_LIVE_RCVB,
+  PROM_LIVE_SENTP,
+  PROM_LIVE_SENTB,
+  PROM_LIVE_RATE_RCVB,
+  PROM_LIVE_RATE_SENTB,
+  PROM_LIVE_METRICS_NUMBER
+};
+
+static const char *prom_live_names[PROM_LIVE_METRICS_NUMBER][2] = {
+    {"sessions", "Active sessions"},
+    {"traffic_rcvp", "Active sessions received packets"},
+    {"traffic_rcvb", "Active sessions received bytes"},
+    {"traffic_sentp", "Active sessions sent packets"},
+    {"traffic_sentb", "Active sessions sent bytes"},
+    {"rate_rcvb", "Active sessions receive rate, bytes per second"},
+    {"rate_sentb", "Active sessions send rate, bytes per second"}};
+
+static prom_gauge_t *turn_thread_live[PROM_LIVE_METRICS_NUMBER];
+static prom_gauge_t *turn_realm_live[PROM_LIVE_METRICS_NUMBER];
+
+typedef struct _prom_live_sums {
+  char realm[STUN_MAX_REALM_SIZE + 1];
+  double v[PROM_LIVE_METRICS_NUMBER];
+} prom_live_sums;
+
+typedef struct _prom_live_scrape {
+  prom_live_sums *threads;
+  size_t threads_number;
+  prom_live_sums *realms;
+  size_t realms_number;
+} prom_live_scrape;
+
+static prom_gauge_t *turn_latency_seconds;
+static prom_gauge_t *turn_latency_seconds_count;
+static prom_gauge_t *turn_latency_seconds_sum;
+static prom_gauge_t *turn_thread_latency_seconds;
+static prom_gauge_t *turn_thread_latency_seconds_count;
+static prom_gauge_t *turn_thread_latency_seconds_sum;
+
+static prom_gauge_t *turn_bandwidth_shaped_bytes;
+static prom_gauge_t *turn_bandwidth_dropped_bytes;
+
+enum {
+  PROM_LOOP_ITERATIONS,
+  PROM_LOOP_BUSY_RATIO,
+  PROM_LOOP_ITERATION_SECONDS,
+  PROM_LOOP_CALLBACKS_PER_ITERATION,
+  PROM_LOOP_LAG_SECONDS,
+  PROM_LOOP_LAG_MAX_SECONDS,
+  PROM_LOOP_METRICS_NUMBER
+};
+
+static const char *prom_loop_names[PROM_LOOP_METRICS_NUMBER][2] = {
+    {"turn_loop_iterations", "Event loop iterations since the start"},
+    {"turn_loop_busy_ratio", "Event loop thread CPU time over wall time, last second"},
+    {"turn_loop_iteration_seconds", "Event loop iteration CPU time, average of the last second"},
+    {"turn_loop_callbacks_per_iteration", "Event loop active events per iteration, average of the last second"},
+    {"turn_loop_lag_seconds", "Event loop timer lateness, average of the last second"},
+    {"turn_loop_lag_max_seconds", "Event loop timer lateness, maximum of the last second"}};
+
+static prom_gauge_t *turn_loop[PROM_LOOP_METRICS_NUMBER];
+
+static TURN_MUTEX_DECLARE(prom_scrape_mutex)
+static uint64_t prom_shard_exported[PROM_SHARD_COUNTERS_NUMBER];
+static size_t prom_live_threads_exported = 0;
+
+/*
+ * The client library cannot remove a label set once exported, so the realm
+ * series stay until the restart: their number is capped, and the realms
+ * seen after the cap is reached are summed under PROM_LIVE_REALM_OTHER.
+ */
+#define PROM_LIVE_REALMS_MAX (256)
+#define PROM_LIVE_REALM_OTHER "_other"
+
+typedef char prom_live_realm_label[STUN_MAX_REALM_SIZE + 1];
+
+static prom_live_realm_label *prom_live_realms_exported = NULL;
+static size_t prom_live_realms_exported_number = 0;
+static bool prom_live_realm_other_exported = false;
+
+static prom_counter_t *prom_shard_metric(int counter, const char **label) {
+  switch (counter) {
+  case PROM_SHARD_PACKET_PROCESSED:
+    return packet_processed;
+  case PROM_SHARD_PACKET_DROPPED:
+    return packet_dropped;
+  case PROM_SHARD_BINDING_REQUEST:
+    return stun_binding_request;
+  case PROM_SHARD_BINDING_RESPONSE:
+    return stun_binding_response;
+  case PROM_SHARD_BINDING_ERROR:
+    return stun_binding_error;
+  default:
+    label[0] = turn_packet_class_name((TURN_PACKET_CLASS)(counter - PROM_SHARD_PACKET_CLASS));
+    return packet_classified;
+  }
+}
+
+static void prom_collect_shards(void) {
+  uint64_t sums[PROM_SHARD_COUNTERS_NUMBER] = {0};
+
+  for (prom_shard *sh = atomic_load_explicit(&prom_shards, memory_order_acquire); sh; sh = sh->next) {
+    for (int i = 0; i < PROM_SHARD_COUNTERS_NUMBER; ++i) {
+      sums[i] += atomic_load_explicit(&(sh->counters[i]), memory_order_relaxed);
+    }
+  }
+
+  for (int i = 0; i < PROM_SHARD_COUNTERS_NUMBER; ++i) {
+    if (sums[i] != prom_shard_exported[i]) {
+      const char *label[] = {NULL};
+      prom_counter_t *metric = prom_shard_metric(i, label);
+      prom_counter_add(metric, (double)(sums[i] - prom_shard_exported[i]), label[0] ? label : NULL);
+      prom_shard_exported[i] = sums[i];
+    }
+  }
+}
+
+static void prom_live_add(prom_live_sums *sums, const session_stats_record *r) {
+  sums->v[PROM_LIVE_SESSIONS] += 1;
+  sums->v[PROM_LIVE_RCVP] += (double)r->received_packets;
+  sums->v[PROM_LIVE_RCVB] += (double)r->received_bytes;
+  sums->v[PROM_LIVE_SENTP] += (double)r->sent_packets;
+  sums->v[PROM_LIVE_SENTB] += (double)r->sent_bytes;
+  sums->v[PROM_LIVE_RATE_RCVB] += (double)r->received_rate;
+  sums->v[PROM_LIVE_RATE_SENTB] += (double)r->sent_rate;
+}
+
+static void prom_live_visit(unsigned int table_id, const session_stats_record *r, void *arg) {
+  prom_live_scrape *scrape = (prom_live_scrape *)arg;
+
+  if (table_id >= scrape->threads_number) {
+    prom_live_sums *threads = (prom_live_sums *)realloc(scrape->threads, (table_id + 1) * sizeof(prom_live_sums));
+    if (!threads) {
+      return;
+    }
+    memset(threads + scrape->threads_number, 0, (table_id + 1 - scrape->threads_number) * sizeof(prom_live_sums));
+    scrape->threads = threads;
+    scrape->threads_number = table_id + 1;
+  }
+  prom_live_add(&(scrape->threads[table_id]), r);
+
+  size_t i = 0;
+  while ((i < scrape->realms_number) && strcmp(scrape->realms[i].realm, r->realm)) {
+    ++i;
+  }
+  if (i == scrape->realms_number) {
+    prom_live_sums *realms = (prom_live_sums *)realloc(scrape->realms, (i + 1) * sizeof(prom_live_sums));
+    if (!realms) {
+      return;
+    }
+    memset(&(realms[i]), 0, sizeof(prom_live_sums));
+    STRCPY(realms[i].realm, r->realm);
+    scrape->realms = realms;
+    scrape->realms_number = i + 1;
+  }
+  prom_live_add(&(scrape->realms[i]), r);
+}
+
+static void prom_set_live(prom_gauge_t **gauges, const prom_live_sums *sums, const char *label_value) {
+  const char *label[] = {label_value};
+  for (int m = 0; m < PROM_LIVE_METRICS_NUMBER; ++m) {
+    prom_gauge_set(gauges[m], sums ? sums->v[m] : 0, label);
+  }
+}
+
+static void prom_collect_live_traffic(void) {
+  prom_live_scrape scrape = {NULL, 0, NULL, 0};
+  session_stats_foreach(prom_live_visit, &scrape);
+
+  if (scrape.threads_number > prom_live_threads_exported) {
+    prom_live_threads_exported = scrape.threads_number;
+  }
+  for (size_t i = 0; i < prom_live_threads_exported; ++i) {
+    char thread[32];
+    snprintf(thread, sizeof(thread), "%lu", (unsigned long)i);
+    prom_set_live(turn_thread_live, (i < scrape.threads_number) ? &(scrape.threads[i]) : NULL, thread);
+  }
+
+  /* The exported realms without active sessions any more are zeroed */
+  prom_live_sums other;
+  memset(&other, 0, sizeof(other));
+  bool other_used = false;
+  for (size_t j = 0; j < scrape.realms_number; ++j) {
+    size_t i = 0;
+    while ((i < prom_live_realms_exported_number) && strcmp(prom_live_realms_exported[i], scrape.realms[j].realm)) {
+      ++i;
+    }
+    if ((i == prom_live_realms_exported_number) && (i < PROM_LIVE_REALMS_MAX)) {
+      prom_live_realm_label *realms = (prom_live_realm_label *)realloc(prom_live_realms_exported,
+                                                                       (i + 1) * sizeof(prom_live_realm_label));
+      if (realms) {
+        STRCPY(realms[i], scrape.realms[j].realm);
+        prom_live_realms_exported = realms;
+        prom_live_realms_exported_number = i + 1;
+      }
+    }
+    if (i == prom_live_realms_exported_number) {
+      for (int m = 0; m < PROM_LIVE_METRICS_NUMBER; ++m) {
+        other.v[m] += scrape.realms[j].v[m];
+      }
+      other_used = true;
+    }
+  }
+  for (size_t i = 0; i < prom_live_realms_exported_number; ++i) {
+    size_t j = 0;
+    while ((j < scrape.realms_number) && strcmp(scrape.realms[j].realm, prom_live_realms_exported[i])) {
+      ++j;
+    }
+    prom_set_live(turn_realm_live, (j < scrape.realms_number) ? &(scrape.realms[j]) : NULL,
+                  prom_live_realms_exported[i]);
+  }
+  if (other_used || prom_live_realm_other_exported) {
+    prom_set_live(turn_realm_live, &other, PROM_LIVE_REALM_OTHER);
+    prom_live_realm_other_exported = true;
+  }
+
+  free(scrape.threads);
+  free(scrape.realms);
+}
+
+/* Per thread, the operations the thread has done only */
+static void prom_collect_thread_latency(const char *thread, void *arg) {
+  UNUSED_ARG(arg);
+  for (int op = 0; op < TURN_LATENCY_OPS_NUMBER; ++op) {
+    turn_latency_summary summary;
+    turn_latency_summarize_thread(thread, (TURN_LATENCY_OP)op, &summary);
+    if (!summary.count) {
+      continue;
+    }
+
+    const char *threadOpLabel[] = {thread, turn_latency_op_name((TURN_LATENCY_OP)op)};
+    prom_gauge_set(turn_thread_latency_seconds_count, (double)summary.count, threadOpLabel);
+    prom_gauge_set(turn_thread_latency_seconds_sum, (double)summary.sum_us / 1000000.0, threadOpLabel);
+
+    for (int q = 0; q < TURN_LATENCY_QUANTILES_NUMBER; ++q) {
+      char quantile[16];
+      snprintf(quantile, sizeof(quantile), "%g", turn_latency_quantiles[q]);
+      const char *label[] = {thread, threadOpLabel[1], quantile};
+      prom_gauge_set(turn_thread_latency_seconds, (double)summary.quantiles_us[q] / 1000000.0, label);
+    }
+  }
+}
+
+/* The histograms are merged here, the client library summaries cannot take pre-bucketed data */
+static void prom_collect_latency(void) {
+  for (int op = 0; op < TURN_LATENCY_OPS_NUMBER; ++op) {
+    turn_latency_summary summary;
+    turn_latency_summarize((TURN_LATENCY_OP)op, &summary);
+
+    const char *opLabel[] = {turn_latency_op_name((TURN_LATENCY_OP)op)};
+    prom_gauge_set(turn_latency_seconds_count, (double)summary.count, opLabel);
+    prom_gauge_set(turn_latency_seconds_sum, (double)summary.sum_us / 1000000.0, opLabel);
+
+    for (int q = 0; q < TURN_LATENCY_QUANTILES_NUMBER; ++q) {
+      char quantile[16];
+      snprintf(quantile, sizeof(quantile), "%g", turn_latency_quantiles[q]);
+      const char *label[] = {opLabel[0], quantile};
+      prom_gauge_set(turn_latency_seconds, (double)summary.quantiles_us[q] / 1000000.0, label);
+    }
+  }
+
+  turn_latency_foreach_thread(prom_collect_thread_latency, NULL);
+}
+
+static void prom_collect_bandwidth(void) {
+  token_bucket_stats stats;
+  token_bucket_get_stats(&stats);
+
+  for (int level = 0; level < TOKEN_BUCKET_LEVELS_NUMBER; ++level) {
+    const char *label[] = {token_bucket_level_name((TOKEN_BUCKET_LEVEL)level)};
+    prom_gauge_set(turn_bandwidth_shaped_bytes, (double)stats.shaped_bytes[level], label);
+    prom_gauge_set(turn_bandwidth_dropped_bytes, (double)stats.dropped_bytes[level], label);
+  }
+}
+
+static void prom_loop_visit(const loop_stats_snapshot *ls, void *arg) {
+  UNUSED_ARG(arg);
+
+  const double iterations = (double)(ls->window_iterations ? ls->window_iterations : 1);
+  double v[PROM_LOOP_METRICS_NUMBER];
+  v[PROM_LOOP_ITERATIONS] = (double)ls->iterations;
+  v[PROM_LOOP_BUSY_RATIO] = ls->window_us ? ((double)ls->busy_us / (double)ls->window_us) : 0;
+  v[PROM_LOOP_ITERATION_SECONDS] = (double)ls->busy_us / iterations / 1000000.0;
+  v[PROM_LOOP_CALLBACKS_PER_ITERATION] = (double)ls->window_callbacks / iterations;
+  v[PROM_LOOP_LAG_SECONDS] = (double)ls->lateness_avg_us / 1000000.0;
+  v[PROM_LOOP_LAG_MAX_SECONDS] = (double)ls->lateness_max_us / 1000000.0;
+
+  const char *label[] = {ls->name};
+  for (int m = 0; m < PROM_LOOP_METRICS_NUMBER; ++m) {
+    prom_gauge_set(turn_loop[m], v[m], label);
+  }
+}
+
+static void prom_collect(void) {
+  TURN_MUTEX_LOCK(&prom_scrape_mutex);
+  prom_collect_shards();
+  prom_collect_live_traffic();
+  prom_collect_latency();
+  prom_collect_bandwidth();
+  loop_stats_foreach(prom_loop_visit, NULL);
+  TURN_MUTEX_UNLOCK(&prom_scrape_mutex);
+}
+
 #if MHD_VERSION >= 0x00097002
 #define MHD_RESULT enum MHD_Result
 #else
@@ -90,6 +461,7 @@ MHD_RESULT promhttp_handler(void *cls, struct MHD_Connection *connection, const
     status = MHD_HTTP_METHOD_NOT_ALLOWED;
     body = "method not allowed";
   } else if (strcmp(url, turn_params.prometheus_path) == 0) {
+    prom_collect();
     body = prom_collector_registry_bridge(PROM_COLLECTOR_REGISTRY_DEFAULT);
     mode = MHD_RESPMEM_MUST_FREE;
     status = MHD_HTTP_OK;
@@ -186,6 +558,80 @@ void start_prometheus_server(void) {
       prom_counter_new("turn_packet_processed", "Incoming packet processed", 0, NULL));
   packet_dropped = prom_collector_registry_must_register_metric(
       prom_counter_new("turn_packet_dropped", "Incoming packet dropped", 0, NULL));
+  const char *classLabel[] = {"class"};
+  packet_classified = prom_collector_registry_must_register_metric(
+      prom_counter_new("turn_packet_classified", "Incoming packets on the UDP listeners by class", 1, classLabel));
+
+  // Live traffic of the active sessions
+  const char *threadLabel[] = {"thread"};
+  const char *realmLabel[] = {"realm"};
+  for (int m = 0; m < PROM_LIVE_METRICS_NUMBER; ++m) {
+    char name[64];
+    snprintf(name, sizeof(name), "turn_thread_live_%s", prom_live_names[m][0]);
+    turn_thread_live[m] = prom_collector_registry_must_register_metric(
+        prom_gauge_new(name, prom_live_names[m][1], 1, threadLabel));
+    snprintf(name, sizeof(name), "turn_realm_live_%s", prom_live_names[m][0]);
+    turn_realm_live[m] = prom_collector_registry_must_register_metric(
+        prom_gauge_new(name, prom_live_names[m][1], 1, realmLabel));
+  }
+
+  // Latency of the control plane operations
+  const char *opLabel[] = {"op"};
+  const char *opQuantileLabels[] = {"op", "quantile"};
+  turn_latency_seconds = prom_collector_registry_must_register_metric(
+      prom_gauge_new("turn_latency_seconds", "Control plane operations latency quantiles", 2, opQuantileLabels));
+  turn_latency_seconds_count = prom_collector_registry_must_register_metric(
+      prom_gauge_new("turn_latency_seconds_count", "Control plane operations count", 1, opLabel));
+  turn_latency_seconds_sum = prom_collector_registry_must_register_metric(
+      prom_gauge_new("turn_latency_seconds_sum", "Control plane operations total time", 1, opLabel));
+  // and per thread, to tell a slow thread from a slow operation
+  const char *threadOpLabels[] = {"thread", "op"};
+  const char *threadOpQuantileLabels[] = {"thread", "op", "quantile"};
+  turn_thread_latency_seconds = prom_collector_registry_must_register_metric(prom_gauge_new(
+      "turn_thread_latency_seconds", "Control plane operations latency quantiles, per thread", 3,
+      threadOpQuantileLabels));
+  turn_thread_latency_seconds_count = prom_collector_registry_must_register_metric(
+      prom_gauge_new("turn_thread_latency_seconds_count", "Control plane operations count, per thread", 2,
+                     threadOpLabels));
+  turn_thread_latency_seconds_sum = prom_collector_registry_must_register_metric(
+      prom_gauge_new("turn_thread_latency_seconds_sum", "Control plane operations total time, per thread", 2,
+                     threadOpLabels));
+
+  // Event loops load, per thread
+  for (int m = 0; m < PROM_LOOP_METRICS_NUMBER; ++m) {
+    turn_loop[m] = prom_collector_registry_must_register_metric(
+        prom_gauge_new(prom_loop_names[m][0], prom_loop_names[m][1], 1, threadLabel));
+  }
+
+  // Traffic over the bandwidth limits, per level of the limit
+  const char *levelLabel[] = {"level"};
+  turn_bandwidth_shaped_bytes = prom_collector_registry_must_register_metric(prom_gauge_new(
+      "turn_bandwidth_shaped_bytes", "Bytes delayed by the bandwidth limits since the start", 1, levelLabel));
+  turn_bandwidth_dropped_bytes = prom_collector_registry_must_register_metric(prom_gauge_new(
+      "turn_bandwidth_dropped_bytes", "Bytes dropped by the bandwidth limits since the start", 1, levelLabel));
+
+  TURN_MUTEX_INIT(&prom_scrape_mutex);
+
+  // TLS sessions with kernel TLS record processing
+  turn_ktls_sessions = prom_collector_registry_must_register_metric(
+      prom_counter_new("turn_ktls_sessions", "TLS sessions offloaded to kernel TLS", 0, NULL));
+
+  // TLS/DTLS client handshakes, full or resuming an earlier session, by socket type
+  turn_tls_handshakes_full = prom_collector_registry_must_register_metric(
+      prom_counter_new("turn_tls_handshakes_full", "Full TLS/DTLS handshakes", 1, typeLabel));
+  turn_tls_handshakes_resumed = prom_collector_registry_must_register_metric(
+      prom_counter_new("turn_tls_handshakes_resumed", "Resumed TLS/DTLS handshakes", 1, typeLabel));
+  turn_tls_handshakes_rejected = prom_collector_registry_must_register_metric(prom_counter_new(
+      "turn_tls_handshakes_rejected", "TLS/DTLS handshakes rejected by the full handshake worker queue", 1, typeLabel));
+  // from 1ms to 8s
+  turn_tls_handshake_duration = prom_collector_registry_must_register_metric(
+      prom_histogram_new("turn_tls_handshake_duration_seconds", "TLS/DTLS server handshake duration",
+                         prom_histogram_buckets_exponential(0.001, 2, 14), 1, typeLabel));
+
+  turn_dtls_hello_verify_requests = prom_collector_registry_must_register_metric(prom_counter_new(
+      "turn_dtls_hello_verify_requests", "DTLS HelloVerifyRequests sent without server state", 0, NULL));
+  turn_dtls_cookies_rejected = prom_collector_registry_must_register_metric(prom_counter_new(
+      "turn_dtls_cookies_rejected", "DTLS ClientHellos dropped for a malformed or invalid cookie", 0, NULL));
 
   // some flags appeared first in microhttpd v0.9.53
   unsigned int flags = 0;
@@ -292,32 +738,84 @@ void prom_dec_allocation(SOCKET_TYPE type) {
 }
 
 void prom_inc_packet_processed(int count) {
-  if (turn_params.prometheus) {
-    prom_counter_add(packet_processed, count, NULL);
+  if (turn_params.prometheus && count > 0) {
+    prom_shard_add(PROM_SHARD_PACKET_PROCESSED, (uint64_t)count);
   }
 }
 
 void prom_inc_packet_dropped(int count) {
+  if (turn_params.prometheus && count > 0) {
+    prom_shard_add(PROM_SHARD_PACKET_DROPPED, (uint64_t)count);
+  }
+}
+
+/*
+ * counts has TURN_PACKET_CLASSES_NUMBER entries
+ */
+void prom_inc_packet_classes(const uint32_t *counts) {
+  if (turn_params.prometheus) {
+    for (int i = 0; i < (int)TURN_PACKET_CLASSES_NUMBER; ++i) {
+      if (counts[i]) {
+        prom_shard_add(PROM_SHARD_PACKET_CLASS + i, counts[i]);
+      }
+    }
+  }
+}
+
+void prom_inc_ktls_session(void) {
   if (turn_params.prometheus) {
-    prom_counter_add(packet_dropped, count, NULL);
+    prom_counter_add(turn_ktls_sessions, 1, NULL);
+  }
+}
+
+void prom_inc_tls_handshake(SOCKET_TYPE type, bool resumed) {
+  if (turn_params.prometheus) {
+    const char *label[] = {socket_type_name(type)};
+    prom_counter_add(resumed ? turn_tls_handshakes_resumed : turn_tls_handshakes_full, 1, label);
+  }
+}
+
+void prom_inc_tls_handshake_rejected(SOCKET_TYPE type) {
+  if (turn_params.prometheus) {
+    const char *label[] = {socket_type_name(type)};
+    prom_counter_add(turn_tls_handshakes_rejected, 1, label);
+  }
+}
+
+void prom_observe_tls_handshake_duration(SOCKET_TYPE type, double seconds) {
+  if (turn_params.prometheus) {
+    const char *label[] = {socket_type_name(type)};
+    prom_histogram_observe(turn_tls_handshake_duration, seconds, label);
+  }
+}
+
+void prom_inc_dtls_hello_verify(void) {
+  if (turn_params.prometheus) {
+    prom_counter_add(turn_dtls_hello_verify_requests, 1, NULL);
+  }
+}
+
+void prom_inc_dtls_cookie_rejected(void) {
+  if (turn_params.prometheus) {
+    prom_counter_add(turn_dtls_cookies_rejected, 1, NULL);
   }
 }
 
 void prom_inc_stun_binding_request(void) {
   if (turn_params.prometheus) {
-    prom_counter_add(stun_binding_request, 1, NULL);
+    prom_shard_add(PROM_SHARD_BINDING_REQUEST, 1);
   }
 }
 
 void prom_inc_stun_binding_response(void) {
   if (turn_params.prometheus) {
-    prom_counter_add(stun_binding_response, 1, NULL);
+    prom_shard_add(PROM_SHARD_BINDING_RESPONSE, 1);
   }
 }
 
 void prom_inc_stun_binding_error(void) {
   if (turn_params.prometheus) {
-    prom_counter_add(stun_binding_error, 1, NULL);
+    prom_shard_add(PROM_SHARD_BINDING_ERROR, 1);
   }
 }
 
@@ -363,4 +861,24 @@ void prom_inc_packet_processed(int count) { UNUSED_ARG(count); }
 
 void prom_inc_packet_dropped(int count) { UNUSED_ARG(count); }
 
+void prom_inc_packet_classes(const uint32_t *counts) { UNUSED_ARG(counts); }
+
+void prom_inc_ktls_session(void) {}
+
+void prom_inc_tls_handshake(SOCKET_TYPE type, bool resumed) {
+  UNUSED_ARG(type);
+  UNUSED_ARG(resumed);
+}
+
+void prom_inc_tls_handshake_rejected(SOCKET_TYPE type) { UNUSED_ARG(type); }
+
+void prom_observe_tls_handshake_duration(SOCKET_TYPE type, double seconds) {
+  UNUSED_ARG(type);
+  UNUSED_ARG(seconds);
+}
+
+void prom_inc_dtls_hello_verify(void) {}
+
+void prom_inc_dtls_cookie_rejected(void) {}
+
 #endif /* TURN_NO_PROMETHEUS */
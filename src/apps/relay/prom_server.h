@@ -36,6 +36,7 @@
 #define __PROM_SERVER_H__
 
 #include "ns_turn_ioalib.h"
+#include "ns_turn_msg.h"
 #include <stdbool.h>
 #include <stdlib.h>
 
@@ -61,6 +62,7 @@ extern "C" {
 
 extern prom_counter_t *packet_processed;
 extern prom_counter_t *packet_dropped;
+extern prom_counter_t *packet_classified;
 
 extern prom_counter_t *stun_binding_request;
 extern prom_counter_t *stun_binding_response;
@@ -92,6 +94,16 @@ extern prom_counter_t *turn_total_traffic_peer_sentb;
 
 extern prom_gauge_t *turn_total_allocations_number;
 
+extern prom_counter_t *turn_ktls_sessions;
+
+extern prom_counter_t *turn_tls_handshakes_full;
+extern prom_counter_t *turn_tls_handshakes_resumed;
+extern prom_counter_t *turn_tls_handshakes_rejected;
+extern prom_histogram_t *turn_tls_handshake_duration;
+
+extern prom_counter_t *turn_dtls_hello_verify_requests;
+extern prom_counter_t *turn_dtls_cookies_rejected;
+
 int is_ipv6_enabled(void);
 
 void prom_inc_stun_binding_request(void);
@@ -109,5 +121,12 @@ void prom_inc_allocation(SOCKET_TYPE type);
 void prom_dec_allocation(SOCKET_TYPE type);
 void prom_inc_packet_processed(int count);
 void prom_inc_packet_dropped(int count);
+void prom_inc_packet_classes(const uint32_t *counts);
+void prom_inc_ktls_session(void);
+void prom_inc_tls_handshake(SOCKET_TYPE type, bool resumed);
+void prom_inc_tls_handshake_rejected(SOCKET_TYPE type);
+void prom_observe_tls_handshake_duration(SOCKET_TYPE type, double seconds);
+void prom_inc_dtls_hello_verify(void);
+void prom_inc_dtls_cookie_rejected(void);
 
 #endif /* __PROM_SERVER_H__ */
@@ -0,0 +1,215 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "relay_load.h"
+
+#include "ns_turn_ioaddr.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+//////////////////////////////////////////////////
+
+#define RELAY_LOAD_CACHE_LINE_SIZE (64)
+
+/* Busy ratios closer than that (per mille) are equal */
+#define RELAY_LOAD_BUSY_MARGIN (50)
+/* Packet rates closer than 1/8 of the higher one, or under that rate, are equal */
+#define RELAY_LOAD_PPS_SHIFT (3)
+#define RELAY_LOAD_PPS_MIN (1000)
+
+/* Recent choices, in sets of ways picked by the key */
+#define RELAY_LOAD_CHOICES_SETS (1024)
+#define RELAY_LOAD_CHOICES_WAYS (4)
+/* A choice younger than that (seconds) is not evicted: its session may not be there yet */
+#define RELAY_LOAD_CONNECT_WINDOW (2)
+#define RELAY_LOAD_TIME_MASK (0xFFFFFFU)
+
+/* A relay busier than that (per mille) moves sessions out, */
+#define RELAY_LOAD_REBALANCE_BUSY (700)
+/* to a relay less busy by that much */
+#define RELAY_LOAD_REBALANCE_GAP (300)
+
+typedef struct _relay_load {
+  /* written by the relay thread only */
+  atomic_uint allocations;
+  atomic_uint pps;
+  atomic_uint busy;
+  atomic_uint_fast64_t packets;
+  uint64_t window_packets;
+  char pad[RELAY_LOAD_CACHE_LINE_SIZE];
+} relay_load;
+
+static relay_load *relay_loads = NULL;
+static size_t relay_loads_number = 0;
+
+/* key in the high half, then 24 bits of the choice time (seconds) and 8 bits of relay index + 1 */
+static atomic_uint_fast64_t relay_load_choices[RELAY_LOAD_CHOICES_SETS][RELAY_LOAD_CHOICES_WAYS];
+
+void relay_load_init(size_t relays_number) {
+  if (!relay_loads && relays_number) {
+    relay_loads = (relay_load *)calloc(relays_number, sizeof(relay_load));
+    if (relay_loads) {
+      relay_loads_number = relays_number;
+    }
+  }
+}
+
+static inline relay_load *relay_load_get(turnserver_id id) {
+  return ((size_t)id < relay_loads_number) ? &(relay_loads[id]) : NULL;
+}
+
+void relay_load_allocation(turnserver_id id, int delta) {
+  relay_load *rl = relay_load_get(id);
+  if (rl) {
+    atomic_store_explicit(&(rl->allocations),
+                          atomic_load_explicit(&(rl->allocations), memory_order_relaxed) + (unsigned int)delta,
+                          memory_order_relaxed);
+  }
+}
+
+void relay_load_packet(turnserver_id id) {
+  relay_load *rl = relay_load_get(id);
+  if (rl) {
+    atomic_store_explicit(&(rl->packets), atomic_load_explicit(&(rl->packets), memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+  }
+}
+
+void relay_load_window(turnserver_id id, const loop_stats_snapshot *s) {
+  relay_load *rl = relay_load_get(id);
+  if (rl && s && s->window_us) {
+    const uint64_t packets = atomic_load_explicit(&(rl->packets), memory_order_relaxed);
+    atomic_store_explicit(&(rl->pps), (unsigned int)((packets - rl->window_packets) * 1000000 / s->window_us),
+                          memory_order_relaxed);
+    rl->window_packets = packets;
+    atomic_store_explicit(&(rl->busy), (unsigned int)(s->busy_us * 1000 / s->window_us), memory_order_relaxed);
+  }
+}
+
+/* The busy time first, then the packet rate, then the allocations */
+static bool relay_load_less(relay_load *a, relay_load *b) {
+  const unsigned int busy_a = atomic_load_explicit(&(a->busy), memory_order_relaxed);
+  const unsigned int busy_b = atomic_load_explicit(&(b->busy), memory_order_relaxed);
+  if ((busy_a + RELAY_LOAD_BUSY_MARGIN < busy_b) || (busy_b + RELAY_LOAD_BUSY_MARGIN < busy_a)) {
+    return busy_a < busy_b;
+  }
+
+  const unsigned int pps_a = atomic_load_explicit(&(a->pps), memory_order_relaxed);
+  const unsigned int pps_b = atomic_load_explicit(&(b->pps), memory_order_relaxed);
+  const unsigned int pps_max = (pps_a > pps_b) ? pps_a : pps_b;
+  const unsigned int pps_diff = (pps_a > pps_b) ? (pps_a - pps_b) : (pps_b - pps_a);
+  if ((pps_max >= RELAY_LOAD_PPS_MIN) && (pps_diff > (pps_max >> RELAY_LOAD_PPS_SHIFT))) {
+    return pps_a < pps_b;
+  }
+
+  return atomic_load_explicit(&(a->allocations), memory_order_relaxed) <
+         atomic_load_explicit(&(b->allocations), memory_order_relaxed);
+}
+
+size_t relay_load_choose(uint32_t key) {
+  if (relay_loads_number < 2) {
+    return 0;
+  }
+
+  /* relay index + 1 fits the 8 bits: at most MAX_NUMBER_OF_GENERAL_RELAY_SERVERS */
+  atomic_uint_fast64_t *set = relay_load_choices[key % RELAY_LOAD_CHOICES_SETS];
+  const uint32_t now = (uint32_t)turn_time() & RELAY_LOAD_TIME_MASK;
+
+  atomic_uint_fast64_t *way = NULL;
+  uint32_t way_age = 0;
+  for (size_t i = 0; i < RELAY_LOAD_CHOICES_WAYS; ++i) {
+    const uint64_t c = atomic_load_explicit(&(set[i]), memory_order_relaxed);
+    const size_t index = (size_t)(c & 0xFF);
+    if (((uint32_t)(c >> 32) == key) && index && (index <= relay_loads_number)) {
+      return index - 1;
+    }
+    const uint32_t age = index ? ((now - (uint32_t)(c >> 8)) & RELAY_LOAD_TIME_MASK) : RELAY_LOAD_TIME_MASK;
+    if (!way || (age > way_age)) {
+      way = &(set[i]);
+      way_age = age;
+    }
+  }
+
+  /* The two candidates depend on the key only, so a lost choice ends up on one of them again */
+  const size_t first = hash_int32(key) % relay_loads_number;
+  size_t second = hash_int32(key ^ 0x9e3779b9U) % (relay_loads_number - 1);
+  if (second >= first) {
+    ++second;
+  }
+
+  if (way_age < RELAY_LOAD_CONNECT_WINDOW) {
+    /* Every way is taken by a session still connecting: no load check, the key always gets the same relay */
+    return first;
+  }
+
+  const size_t chosen = relay_load_less(&(relay_loads[second]), &(relay_loads[first])) ? second : first;
+
+  atomic_store_explicit(way, ((uint64_t)key << 32) | ((uint64_t)now << 8) | (uint64_t)(chosen + 1),
+                        memory_order_relaxed);
+  return chosen;
+}
+
+bool relay_load_imbalance(turnserver_id id, size_t *dest, uint32_t *max_pps) {
+  relay_load *rl = relay_load_get(id);
+  if (!rl || (relay_loads_number < 2) || !dest || !max_pps) {
+    return false;
+  }
+
+  const unsigned int busy = atomic_load_explicit(&(rl->busy), memory_order_relaxed);
+  if ((busy < RELAY_LOAD_REBALANCE_BUSY) || (atomic_load_explicit(&(rl->allocations), memory_order_relaxed) < 2)) {
+    return false;
+  }
+
+  size_t least = (size_t)id;
+  unsigned int least_busy = busy;
+  for (size_t i = 0; i < relay_loads_number; ++i) {
+    const unsigned int b = atomic_load_explicit(&(relay_loads[i].busy), memory_order_relaxed);
+    if ((i != (size_t)id) && (b < least_busy)) {
+      least = i;
+      least_busy = b;
+    }
+  }
+
+  if ((least == (size_t)id) || (least_busy + RELAY_LOAD_REBALANCE_GAP > busy)) {
+    return false;
+  }
+
+  /* Half of the difference at most, or the session would come back */
+  const uint64_t pps = atomic_load_explicit(&(rl->pps), memory_order_relaxed);
+  *max_pps = (uint32_t)(pps * (busy - least_busy) / (2 * busy));
+  *dest = least;
+  return true;
+}
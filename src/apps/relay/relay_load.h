@@ -0,0 +1,82 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Load of the relay threads, for the placement of the new sessions
+ */
+
+#ifndef __RELAY_LOAD__
+#define __RELAY_LOAD__
+
+#include "loop_stats.h"
+
+#include "ns_turn_server.h"
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//////////////////////////////////////////////////
+
+/* Before the relay threads start */
+void relay_load_init(size_t relays_number);
+
+/* Relay thread, for its own server id */
+void relay_load_allocation(turnserver_id id, int delta);
+void relay_load_packet(turnserver_id id);
+void relay_load_window(turnserver_id id, const loop_stats_snapshot *s);
+
+/*
+ * Any thread: the relay index for a new session, the less loaded of two
+ * relays picked by the key (a hash of the 5-tuple). The same key gets the
+ * same relay again while it stays in the table of recent choices, where a
+ * choice is not evicted during its first seconds.
+ */
+size_t relay_load_choose(uint32_t key);
+
+/*
+ * Relay thread, after its window: whether it is much busier than the least
+ * busy relay, which then gets the session to move, of max_pps at most.
+ */
+bool relay_load_imbalance(turnserver_id id, size_t *dest, uint32_t *max_pps);
+
+//////////////////////////////////////////////////
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RELAY_LOAD__ */
@@ -0,0 +1,242 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "session_stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//////////////////////////////////////////////////
+
+#define SESSION_STATS_CHUNK_SIZE (256)
+#define SESSION_STATS_READ_ATTEMPTS (16)
+
+typedef struct _session_stats_chunk {
+  struct _session_stats_chunk *next;
+  session_stats_record records[SESSION_STATS_CHUNK_SIZE];
+} session_stats_chunk;
+
+struct _session_stats_table {
+  struct _session_stats_table *next;
+  unsigned int id;
+  _Atomic(session_stats_chunk *) chunks;
+  session_stats_record *free_records;
+};
+
+/* all tables, for the readers that walk the records */
+static _Atomic(session_stats_table *) session_stats_tables = NULL;
+
+session_stats_table *session_stats_table_new(unsigned int id) {
+  session_stats_table *t = (session_stats_table *)calloc(1, sizeof(session_stats_table));
+  if (t) {
+    t->id = id;
+    atomic_init(&(t->chunks), NULL);
+    t->next = atomic_load_explicit(&session_stats_tables, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&session_stats_tables, &(t->next), t, memory_order_release,
+                                                  memory_order_relaxed)) {
+    }
+  }
+  return t;
+}
+
+static bool session_stats_grow(session_stats_table *t) {
+  session_stats_chunk *c = (session_stats_chunk *)calloc(1, sizeof(session_stats_chunk));
+  if (!c) {
+    return false;
+  }
+  for (size_t i = 0; i < SESSION_STATS_CHUNK_SIZE; ++i) {
+    atomic_init(&(c->records[i].seq), 0);
+    c->records[i].next = t->free_records;
+    t->free_records = &(c->records[i]);
+  }
+  c->next = atomic_load_explicit(&(t->chunks), memory_order_relaxed);
+  atomic_store_explicit(&(t->chunks), c, memory_order_release);
+  return true;
+}
+
+static inline unsigned int session_stats_write_begin(session_stats_record *r) {
+  const unsigned int seq = atomic_load_explicit(&(r->seq), memory_order_relaxed);
+  atomic_store_explicit(&(r->seq), seq + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  return seq;
+}
+
+static inline void session_stats_write_end(session_stats_record *r, unsigned int seq) {
+  atomic_store_explicit(&(r->seq), seq + 2, memory_order_release);
+}
+
+session_stats_record *session_stats_acquire(session_stats_table *t, turnsession_id id, const char *realm) {
+  if (!t || (!(t->free_records) && !session_stats_grow(t))) {
+    return NULL;
+  }
+
+  session_stats_record *r = t->free_records;
+  t->free_records = r->next;
+  r->next = NULL;
+
+  const unsigned int seq = session_stats_write_begin(r);
+  r->id = id;
+  r->received_packets = 0;
+  r->sent_packets = 0;
+  r->received_bytes = 0;
+  r->sent_bytes = 0;
+  r->peer_received_packets = 0;
+  r->peer_sent_packets = 0;
+  r->peer_received_bytes = 0;
+  r->peer_sent_bytes = 0;
+  r->received_rate = 0;
+  r->sent_rate = 0;
+  r->total_rate = 0;
+  r->peer_received_rate = 0;
+  r->peer_sent_rate = 0;
+  r->peer_total_rate = 0;
+  STRCPY(r->realm, realm ? realm : "");
+  session_stats_write_end(r, seq);
+
+  return r;
+}
+
+void session_stats_release(session_stats_table *t, session_stats_record *r) {
+  if (t && r) {
+    const unsigned int seq = session_stats_write_begin(r);
+    r->id = 0;
+    r->realm[0] = 0;
+    session_stats_write_end(r, seq);
+    r->next = t->free_records;
+    t->free_records = r;
+  }
+}
+
+void session_stats_publish(session_stats_record *r, const ts_ur_super_session *ss) {
+  if (r && ss) {
+    const unsigned int seq = session_stats_write_begin(r);
+    r->received_packets = ss->t_received_packets + ss->received_packets;
+    r->sent_packets = ss->t_sent_packets + ss->sent_packets;
+    r->received_bytes = ss->t_received_bytes + ss->received_bytes;
+    r->sent_bytes = ss->t_sent_bytes + ss->sent_bytes;
+    r->peer_received_packets = (uint64_t)ss->t_peer_received_packets + ss->peer_received_packets;
+    r->peer_sent_packets = (uint64_t)ss->t_peer_sent_packets + ss->peer_sent_packets;
+    r->peer_received_bytes = (uint64_t)ss->t_peer_received_bytes + ss->peer_received_bytes;
+    r->peer_sent_bytes = (uint64_t)ss->t_peer_sent_bytes + ss->peer_sent_bytes;
+    r->received_rate = (uint32_t)ss->received_rate;
+    r->sent_rate = (uint32_t)ss->sent_rate;
+    r->total_rate = (uint32_t)ss->total_rate;
+    r->peer_received_rate = (uint32_t)ss->peer_received_rate;
+    r->peer_sent_rate = (uint32_t)ss->peer_sent_rate;
+    r->peer_total_rate = (uint32_t)ss->peer_total_rate;
+    session_stats_write_end(r, seq);
+  }
+}
+
+static bool session_stats_read(const session_stats_record *r, session_stats_record *snapshot) {
+  for (int attempt = 0; attempt < SESSION_STATS_READ_ATTEMPTS; ++attempt) {
+    const unsigned int seq = atomic_load_explicit(&(r->seq), memory_order_acquire);
+    if (seq & 1) {
+      continue;
+    }
+
+    snapshot->id = r->id;
+    snapshot->received_packets = r->received_packets;
+    snapshot->sent_packets = r->sent_packets;
+    snapshot->received_bytes = r->received_bytes;
+    snapshot->sent_bytes = r->sent_bytes;
+    snapshot->peer_received_packets = r->peer_received_packets;
+    snapshot->peer_sent_packets = r->peer_sent_packets;
+    snapshot->peer_received_bytes = r->peer_received_bytes;
+    snapshot->peer_sent_bytes = r->peer_sent_bytes;
+    snapshot->received_rate = r->received_rate;
+    snapshot->sent_rate = r->sent_rate;
+    snapshot->total_rate = r->total_rate;
+    snapshot->peer_received_rate = r->peer_received_rate;
+    snapshot->peer_sent_rate = r->peer_sent_rate;
+    snapshot->peer_total_rate = r->peer_total_rate;
+    memcpy(snapshot->realm, r->realm, sizeof(snapshot->realm));
+
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&(r->seq), memory_order_relaxed) == seq) {
+      snapshot->realm[sizeof(snapshot->realm) - 1] = 0;
+      snapshot->next = NULL;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool session_stats_load(struct turn_session_info *tsi) {
+  if (!tsi || !(tsi->stats)) {
+    return false;
+  }
+
+  session_stats_record snapshot;
+  if (!session_stats_read(tsi->stats, &snapshot) || (snapshot.id != tsi->id)) {
+    return false;
+  }
+
+  /* The lifecycle message may be newer than the last publication */
+  if (snapshot.received_packets >= tsi->received_packets && snapshot.sent_packets >= tsi->sent_packets) {
+    tsi->received_packets = snapshot.received_packets;
+    tsi->sent_packets = snapshot.sent_packets;
+    tsi->received_bytes = snapshot.received_bytes;
+    tsi->sent_bytes = snapshot.sent_bytes;
+    tsi->peer_received_packets = snapshot.peer_received_packets;
+    tsi->peer_sent_packets = snapshot.peer_sent_packets;
+    tsi->peer_received_bytes = snapshot.peer_received_bytes;
+    tsi->peer_sent_bytes = snapshot.peer_sent_bytes;
+    tsi->received_rate = snapshot.received_rate;
+    tsi->sent_rate = snapshot.sent_rate;
+    tsi->total_rate = snapshot.total_rate;
+    tsi->peer_received_rate = snapshot.peer_received_rate;
+    tsi->peer_sent_rate = snapshot.peer_sent_rate;
+    tsi->peer_total_rate = snapshot.peer_total_rate;
+  }
+  return true;
+}
+
+void session_stats_foreach(session_stats_visitor v, void *arg) {
+  if (!v) {
+    return;
+  }
+
+  session_stats_record snapshot;
+  for (session_stats_table *t = atomic_load_explicit(&session_stats_tables, memory_order_acquire); t; t = t->next) {
+    for (session_stats_chunk *c = atomic_load_explicit(&(t->chunks), memory_order_acquire); c; c = c->next) {
+      for (size_t i = 0; i < SESSION_STATS_CHUNK_SIZE; ++i) {
+        if (session_stats_read(&(c->records[i]), &snapshot) && snapshot.id) {
+          v(t->id, &snapshot, arg);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,114 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Live session counters shared between a relay thread and the admin thread
+ */
+
+#ifndef __SESSION_STATS__
+#define __SESSION_STATS__
+
+#include "ns_turn_session.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//////////////////////////////////////////////////
+
+/* The counters are published once per that many packets of the session */
+#define SESSION_STATS_PUBLISH_MASK (0xFF)
+
+/*
+ * A fixed-size record, written in place by the relay thread of the session
+ * under a sequence lock (odd while the write is in progress) and read on
+ * demand by the other threads. The records are never freed, a record can be
+ * reused by another session: the readers check the session id.
+ */
+typedef struct _session_stats_record {
+  atomic_uint seq;
+  turnsession_id id;
+  uint64_t received_packets;
+  uint64_t sent_packets;
+  uint64_t received_bytes;
+  uint64_t sent_bytes;
+  uint64_t peer_received_packets;
+  uint64_t peer_sent_packets;
+  uint64_t peer_received_bytes;
+  uint64_t peer_sent_bytes;
+  uint32_t received_rate;
+  uint32_t sent_rate;
+  uint32_t total_rate;
+  uint32_t peer_received_rate;
+  uint32_t peer_sent_rate;
+  uint32_t peer_total_rate;
+  char realm[STUN_MAX_REALM_SIZE + 1];
+  /* free list, owner thread only */
+  struct _session_stats_record *next;
+} session_stats_record;
+
+struct _session_stats_table;
+typedef struct _session_stats_table session_stats_table;
+
+/* Owner (relay) thread */
+
+session_stats_table *session_stats_table_new(unsigned int id);
+session_stats_record *session_stats_acquire(session_stats_table *t, turnsession_id id, const char *realm);
+void session_stats_release(session_stats_table *t, session_stats_record *r);
+void session_stats_publish(session_stats_record *r, const ts_ur_super_session *ss);
+
+/*
+ * Any thread: overwrites the counters of tsi with the live values of its
+ * record. Returns false when the record is gone or belongs to another session.
+ */
+bool session_stats_load(struct turn_session_info *tsi);
+
+/*
+ * Any thread: calls v with a consistent copy of every record in use, the
+ * tables are identified by the id given at creation (the dense index of the
+ * relay thread, the UDP relay threads following the general ones).
+ */
+typedef void (*session_stats_visitor)(unsigned int table_id, const session_stats_record *r, void *arg);
+void session_stats_foreach(session_stats_visitor v, void *arg);
+
+//////////////////////////////////////////////////
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SESSION_STATS__ */
@@ -0,0 +1,289 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* splice() */
+#endif
+
+#include "tcp_splice.h"
+
+#include "mainrelay.h"
+#include "ns_turn_session.h"
+
+#include <errno.h>
+
+#if defined(__linux__)
+
+#include <fcntl.h>
+
+struct _tcp_splice {
+  ioa_socket_handle s;   /* data source */
+  ioa_socket_handle dst; /* data sink */
+  int pipefd[2];
+  size_t pipe_bytes; /* read from s, not yet written to dst */
+  struct event *read_ev;
+  struct event *write_ev;
+  bool client_to_peer;
+};
+
+static ts_ur_super_session *tcp_splice_session(ioa_socket_handle s) {
+  if (s && s->sub_session && s->sub_session->owner) {
+    allocation *a = (allocation *)(s->sub_session->owner);
+    return (ts_ur_super_session *)(a->owner);
+  }
+  return NULL;
+}
+
+static bool tcp_splice_output_pending(ioa_socket_handle s) {
+  return s->bev && (evbuffer_get_length(bufferevent_get_output(s->bev)) > 0);
+}
+
+static void tcp_splice_close(ioa_socket_handle s) {
+  /* deletes the TCP connection, which closes (and unsplices) both sockets */
+  s->tobeclosed = 1;
+  s->broken = 1;
+  close_ioa_socket_after_processing_if_necessary(s);
+}
+
+/*
+ * Writes the pipe content to the sink.
+ * Returns 1 when the pipe is empty, 0 when the sink cannot take more now, -1 on error.
+ */
+static int tcp_splice_flush(struct _tcp_splice *sp) {
+  if (tcp_splice_output_pending(sp->dst)) {
+    /* keep the byte order: the bufferevent output goes first */
+    return 0;
+  }
+
+  while (sp->pipe_bytes) {
+    const ssize_t n = splice(sp->pipefd[0], NULL, sp->dst->fd, NULL, sp->pipe_bytes, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (n < 0) {
+      if (socket_eintr()) {
+        continue;
+      }
+      if (socket_ewouldblock()) {
+        return 0;
+      }
+      return -1;
+    }
+    sp->pipe_bytes -= (size_t)n;
+  }
+
+  return 1;
+}
+
+static void tcp_splice_resume(struct _tcp_splice *sp) {
+  const int ret = tcp_splice_flush(sp);
+  if (ret < 0) {
+    tcp_splice_close(sp->dst);
+  } else if (ret > 0) {
+    event_del(sp->write_ev);
+    event_add(sp->read_ev, NULL);
+  } else if (!tcp_splice_output_pending(sp->dst)) {
+    event_add(sp->write_ev, NULL);
+  }
+}
+
+static void tcp_splice_account(struct _tcp_splice *sp, size_t bytes) {
+  ts_ur_super_session *ss = tcp_splice_session(sp->s);
+  if (!ss) {
+    return;
+  }
+
+  if (sp->client_to_peer) {
+    ++(ss->received_packets);
+    ss->received_bytes += (uint32_t)bytes;
+    ++(ss->peer_sent_packets);
+    ss->peer_sent_bytes += (uint32_t)bytes;
+  } else {
+    ++(ss->peer_received_packets);
+    ss->peer_received_bytes += (uint32_t)bytes;
+    ++(ss->sent_packets);
+    ss->sent_bytes += (uint32_t)bytes;
+  }
+
+  turn_report_session_usage(ss, 0);
+}
+
+static void tcp_splice_input_handler(evutil_socket_t fd, short what, void *arg) {
+  struct _tcp_splice *sp = (struct _tcp_splice *)arg;
+  if (!sp || !(what & EV_READ)) {
+    return;
+  }
+
+  int cycle = 0;
+  while (!(sp->pipe_bytes) && (cycle++ < 16)) {
+    const ssize_t n = splice(fd, NULL, sp->pipefd[1], NULL, TCP_SPLICE_CHUNK_SIZE, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (n == 0) {
+      tcp_splice_close(sp->s);
+      return;
+    }
+    if (n < 0) {
+      if (socket_eintr()) {
+        continue;
+      }
+      if (socket_ewouldblock()) {
+        return;
+      }
+      tcp_splice_close(sp->s);
+      return;
+    }
+
+    sp->pipe_bytes = (size_t)n;
+    tcp_splice_account(sp, (size_t)n);
+
+    const int ret = tcp_splice_flush(sp);
+    if (ret < 0) {
+      tcp_splice_close(sp->dst);
+      return;
+    }
+  }
+
+  if (sp->pipe_bytes) {
+    /* Backpressure: stop reading until the sink drains the pipe */
+    event_del(sp->read_ev);
+    if (!tcp_splice_output_pending(sp->dst)) {
+      event_add(sp->write_ev, NULL);
+    }
+  }
+}
+
+static void tcp_splice_output_handler(evutil_socket_t fd, short what, void *arg) {
+  UNUSED_ARG(fd);
+  struct _tcp_splice *sp = (struct _tcp_splice *)arg;
+  if (sp && (what & EV_WRITE)) {
+    tcp_splice_resume(sp);
+  }
+}
+
+static void tcp_splice_free(ioa_socket_handle s) {
+  if (s && s->splice) {
+    struct _tcp_splice *sp = s->splice;
+    s->splice = NULL;
+    EVENT_DEL(sp->read_ev);
+    EVENT_DEL(sp->write_ev);
+    close(sp->pipefd[0]);
+    close(sp->pipefd[1]);
+    free(sp);
+  }
+}
+
+static struct _tcp_splice *tcp_splice_new(ioa_socket_handle s, ioa_socket_handle dst, bool client_to_peer) {
+  struct _tcp_splice *sp = (struct _tcp_splice *)calloc(1, sizeof(struct _tcp_splice));
+  if (!sp) {
+    return NULL;
+  }
+
+  if (pipe2(sp->pipefd, O_NONBLOCK | O_CLOEXEC) < 0) {
+    free(sp);
+    return NULL;
+  }
+  fcntl(sp->pipefd[1], F_SETPIPE_SZ, TCP_SPLICE_CHUNK_SIZE);
+
+  sp->s = s;
+  sp->dst = dst;
+  sp->client_to_peer = client_to_peer;
+  sp->read_ev = event_new(s->e->event_base, s->fd, EV_READ | EV_PERSIST, tcp_splice_input_handler, sp);
+  sp->write_ev = event_new(s->e->event_base, dst->fd, EV_WRITE | EV_PERSIST, tcp_splice_output_handler, sp);
+
+  return sp;
+}
+
+static bool tcp_splice_eligible(ioa_socket_handle s) {
+  return s && (s->magic == SOCKET_MAGIC) && !(s->done) && !(s->tobeclosed) && (s->st == TCP_SOCKET) && s->bev &&
+         (s->fd >= 0) && !(s->splice) && (evbuffer_get_length(bufferevent_get_input(s->bev)) == 0);
+}
+
+int tcp_splice_ioa_sockets(ioa_socket_handle client_s, ioa_socket_handle peer_s) {
+  if (turn_params.no_tcp_splice) {
+    return -1;
+  }
+
+  if (client_s && peer_s && client_s->splice && (client_s->splice->dst == peer_s)) {
+    return 0;
+  }
+
+  /* Plain TCP on both sides only, and only between two reads */
+  if (!tcp_splice_eligible(client_s) || !tcp_splice_eligible(peer_s) || (client_s->e != peer_s->e)) {
+    return -1;
+  }
+
+  client_s->splice = tcp_splice_new(client_s, peer_s, true);
+  peer_s->splice = tcp_splice_new(peer_s, client_s, false);
+  if (!(client_s->splice) || !(peer_s->splice)) {
+    tcp_splice_free(client_s);
+    tcp_splice_free(peer_s);
+    return -1;
+  }
+
+  /* The bufferevents keep writing what is already queued, but do not read anymore */
+  bufferevent_disable(client_s->bev, EV_READ);
+  bufferevent_disable(peer_s->bev, EV_READ);
+
+  event_add(client_s->splice->read_ev, NULL);
+  event_add(peer_s->splice->read_ev, NULL);
+
+  return 0;
+}
+
+void tcp_splice_stop(ioa_socket_handle s) {
+  if (s && s->splice) {
+    ioa_socket_handle dst = s->splice->dst;
+    tcp_splice_free(s);
+    tcp_splice_free(dst);
+  }
+}
+
+void tcp_splice_output_drained(ioa_socket_handle s) {
+  if (s && s->splice && s->splice->dst && s->splice->dst->splice) {
+    struct _tcp_splice *sp = s->splice->dst->splice; /* towards s */
+    if (sp->pipe_bytes) {
+      tcp_splice_resume(sp);
+    }
+  }
+}
+
+#else /* __linux__ */
+
+int tcp_splice_ioa_sockets(ioa_socket_handle client_s, ioa_socket_handle peer_s) {
+  UNUSED_ARG(client_s);
+  UNUSED_ARG(peer_s);
+  return -1;
+}
+
+void tcp_splice_stop(ioa_socket_handle s) { UNUSED_ARG(s); }
+
+void tcp_splice_output_drained(ioa_socket_handle s) { UNUSED_ARG(s); }
+
+#endif /* __linux__ */
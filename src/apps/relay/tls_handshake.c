@@ -0,0 +1,563 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "tls_handshake.h"
+
+#include "ns_turn_utils.h"
+#include "prom_server.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//////////////////////////////////////////////////
+
+#define MAX_TLS_HANDSHAKE_WORKERS (128)
+
+typedef struct _tls_handshake_worker {
+  pthread_t thr;
+  struct event_base *event_base;
+  struct event *wake_ev;
+  /* protects the inbox and the state flags of the jobs of this worker */
+  TURN_MUTEX_DECLARE(mutex)
+  struct _tls_handshake *inbox_head;
+  struct _tls_handshake *inbox_tail;
+} tls_handshake_worker;
+
+/* Completed handshakes waiting for a relay thread */
+struct _tls_handshake_queue {
+  TURN_MUTEX_DECLARE(mutex)
+  struct _tls_handshake *head;
+  struct _tls_handshake *tail;
+  struct event *ev;
+};
+
+struct _tls_handshake {
+  struct _tls_handshake *next;
+  tls_handshake_worker *worker;
+  struct _tls_handshake_queue *queue;
+  ioa_engine_handle e;
+  ioa_socket_handle s;
+  SSL *ssl;
+  evutil_socket_t fd;
+  bool dtls;
+  bool resume; /* DTLS, the ClientHello is already consumed */
+  bool owns_fd;
+  tls_handshake_cb cb;
+  void *cb_arg;
+  struct event *ev; /* socket readiness, TLS only */
+  int verbose;
+  /* under the worker mutex: */
+  bool queued;
+  bool waiting;
+  bool done;
+  bool cancelled;
+  int rc;
+  ioa_network_buffer_handle dgrams[TLS_HANDSHAKE_MAX_DATAGRAMS];
+  size_t dgrams_number;
+  size_t dgrams_processed;
+};
+
+typedef struct _tls_handshake tls_handshake;
+
+static tls_handshake_worker *workers = NULL;
+static size_t workers_number = 0;
+static size_t next_worker = 0;
+static int pending_limit = DEFAULT_TLS_HANDSHAKE_QUEUE;
+static int pending = 0;
+static TURN_MUTEX_DECLARE(pool_mutex)
+
+uint64_t tls_handshake_time_us(void) {
+  struct timespec tp = {0, 0};
+  clock_gettime(CLOCK_MONOTONIC, &tp);
+  return (uint64_t)tp.tv_sec * 1000000 + (uint64_t)(tp.tv_nsec / 1000);
+}
+
+//////////////////// Worker side /////////////////
+
+static void tls_handshake_finish(tls_handshake *h, int rc) {
+  tls_handshake_worker *w = h->worker;
+  struct _tls_handshake_queue *q = h->queue;
+
+  if (h->ev) {
+    event_del(h->ev);
+  }
+
+  TURN_MUTEX_LOCK(&(w->mutex));
+  h->rc = rc;
+  h->waiting = false;
+  h->done = true;
+  TURN_MUTEX_UNLOCK(&(w->mutex));
+
+  TURN_MUTEX_LOCK(&(q->mutex));
+  h->next = NULL;
+  if (q->tail) {
+    q->tail->next = h;
+  } else {
+    q->head = h;
+  }
+  q->tail = h;
+  TURN_MUTEX_UNLOCK(&(q->mutex));
+
+  event_active(q->ev, EV_READ, 0);
+}
+
+static void tls_handshake_socket_handler(evutil_socket_t fd, short what, void *arg);
+
+static void tls_handshake_wait(tls_handshake *h, short what) {
+  tls_handshake_worker *w = h->worker;
+
+  TURN_MUTEX_LOCK(&(w->mutex));
+  if (h->cancelled) {
+    TURN_MUTEX_UNLOCK(&(w->mutex));
+    tls_handshake_finish(h, -1);
+    return;
+  }
+  if (!(h->ev)) {
+    h->ev = event_new(w->event_base, h->fd, what, tls_handshake_socket_handler, h);
+  } else if ((event_get_events(h->ev) & (EV_READ | EV_WRITE)) != what) {
+    event_del(h->ev);
+    event_assign(h->ev, w->event_base, h->fd, what, tls_handshake_socket_handler, h);
+  }
+  h->waiting = true;
+  event_add(h->ev, NULL);
+  TURN_MUTEX_UNLOCK(&(w->mutex));
+}
+
+static void tls_handshake_step(tls_handshake *h) {
+  ERR_clear_error();
+
+  const int ret = SSL_do_handshake(h->ssl);
+  if (ret == 1) {
+    tls_handshake_finish(h, 0);
+    return;
+  }
+
+  switch (SSL_get_error(h->ssl, ret)) {
+  case SSL_ERROR_WANT_READ:
+    tls_handshake_wait(h, EV_READ);
+    return;
+  case SSL_ERROR_WANT_WRITE:
+    tls_handshake_wait(h, EV_WRITE);
+    return;
+  case SSL_ERROR_SYSCALL:
+    if (handle_socket_error()) {
+      tls_handshake_wait(h, EV_READ);
+      return;
+    }
+    break;
+  default:;
+  }
+
+  if (eve(h->verbose)) {
+    char buf[256];
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "%s: TLS handshake failed on fd %d: %s\n", __FUNCTION__, (int)(h->fd),
+                  ERR_error_string(ERR_get_error(), buf));
+  }
+  tls_handshake_finish(h, -1);
+}
+
+static void tls_handshake_socket_handler(evutil_socket_t fd, short what, void *arg) {
+  UNUSED_ARG(fd);
+  UNUSED_ARG(what);
+
+  tls_handshake *h = (tls_handshake *)arg;
+  tls_handshake_worker *w = h->worker;
+
+  TURN_MUTEX_LOCK(&(w->mutex));
+  if (h->cancelled) {
+    /* already in the inbox */
+    TURN_MUTEX_UNLOCK(&(w->mutex));
+    return;
+  }
+  h->waiting = false;
+  TURN_MUTEX_UNLOCK(&(w->mutex));
+
+  tls_handshake_step(h);
+}
+
+/*
+ * Feeds the queued datagrams to the DTLS state machine until the current
+ * flight of the client is consumed or the handshake is over.
+ */
+static void tls_handshake_dtls_step(tls_handshake *h) {
+  tls_handshake_worker *w = h->worker;
+  int rc = 0;
+
+  if (h->resume) {
+    h->resume = false;
+    rc = ssl_resume_handshake(h->fd, h->ssl, h->verbose);
+    if (rc < 0) {
+      tls_handshake_finish(h, -1);
+      return;
+    }
+  }
+
+  for (;;) {
+    TURN_MUTEX_LOCK(&(w->mutex));
+    if (h->cancelled || (h->dgrams_processed >= h->dgrams_number)) {
+      TURN_MUTEX_UNLOCK(&(w->mutex));
+      break;
+    }
+    ioa_network_buffer_handle nbh = h->dgrams[h->dgrams_processed];
+    TURN_MUTEX_UNLOCK(&(w->mutex));
+
+    rc = ssl_read(h->fd, h->ssl, nbh, h->verbose);
+
+    TURN_MUTEX_LOCK(&(w->mutex));
+    h->dgrams_processed += 1;
+    TURN_MUTEX_UNLOCK(&(w->mutex));
+
+    if ((rc < 0) || SSL_is_init_finished(h->ssl)) {
+      break;
+    }
+  }
+
+  tls_handshake_finish(h, (rc < 0) ? -1 : 0);
+}
+
+static void tls_handshake_wake_handler(evutil_socket_t fd, short what, void *arg) {
+  UNUSED_ARG(fd);
+  UNUSED_ARG(what);
+
+  tls_handshake_worker *w = (tls_handshake_worker *)arg;
+
+  for (;;) {
+    TURN_MUTEX_LOCK(&(w->mutex));
+    tls_handshake *h = w->inbox_head;
+    if (h) {
+      w->inbox_head = h->next;
+      if (!(w->inbox_head)) {
+        w->inbox_tail = NULL;
+      }
+      h->next = NULL;
+      h->queued = false;
+    }
+    const bool cancelled = h && h->cancelled;
+    TURN_MUTEX_UNLOCK(&(w->mutex));
+
+    if (!h) {
+      break;
+    }
+
+    if (cancelled) {
+      tls_handshake_finish(h, -1);
+    } else if (h->dtls) {
+      tls_handshake_dtls_step(h);
+    } else {
+      tls_handshake_step(h);
+    }
+  }
+}
+
+static void *run_tls_handshake_thread(void *arg) {
+  tls_handshake_worker *w = (tls_handshake_worker *)arg;
+
+  ignore_sigpipe();
+
+  event_base_loop(w->event_base, EVLOOP_NO_EXIT_ON_EMPTY);
+
+  return arg;
+}
+
+/* Called with the worker mutex held */
+static bool tls_handshake_post(tls_handshake *h) {
+  tls_handshake_worker *w = h->worker;
+  if (h->queued) {
+    return false;
+  }
+  h->queued = true;
+  h->next = NULL;
+  if (w->inbox_tail) {
+    w->inbox_tail->next = h;
+  } else {
+    w->inbox_head = h;
+  }
+  w->inbox_tail = h;
+  return true;
+}
+
+//////////////////// Relay side //////////////////
+
+static void tls_handshake_free(tls_handshake *h) {
+  for (size_t i = 0; i < h->dgrams_number; ++i) {
+    ioa_network_buffer_delete(h->e, h->dgrams[i]);
+  }
+  if (h->ev) {
+    event_free(h->ev);
+  }
+  if (h->ssl) {
+    SSL_free(h->ssl);
+  }
+  if (h->owns_fd && (h->fd >= 0)) {
+    socket_closesocket(h->fd);
+  }
+  free(h);
+}
+
+static void tls_handshake_release(void) {
+  TURN_MUTEX_LOCK(&pool_mutex);
+  pending -= 1;
+  TURN_MUTEX_UNLOCK(&pool_mutex);
+}
+
+static void tls_handshake_completion_handler(evutil_socket_t fd, short what, void *arg) {
+  UNUSED_ARG(fd);
+  UNUSED_ARG(what);
+
+  struct _tls_handshake_queue *q = (struct _tls_handshake_queue *)arg;
+
+  TURN_MUTEX_LOCK(&(q->mutex));
+  tls_handshake *h = q->head;
+  q->head = NULL;
+  q->tail = NULL;
+  TURN_MUTEX_UNLOCK(&(q->mutex));
+
+  while (h) {
+    tls_handshake *next = h->next;
+    h->next = NULL;
+
+    /* The worker is done with the job, only this thread touches it now */
+    if (h->cancelled) {
+      tls_handshake_release();
+      tls_handshake_free(h);
+    } else {
+      ioa_socket_handle s = h->s;
+
+      for (size_t i = 0; i < h->dgrams_processed; ++i) {
+        ioa_network_buffer_delete(h->e, h->dgrams[i]);
+      }
+      h->dgrams_number -= h->dgrams_processed;
+      memmove(h->dgrams, h->dgrams + h->dgrams_processed, h->dgrams_number * sizeof(h->dgrams[0]));
+      h->dgrams_processed = 0;
+
+      if (h->dtls && (h->rc >= 0) && h->dgrams_number && !SSL_is_init_finished(h->ssl)) {
+        /* the next flight arrived meanwhile */
+        tls_handshake_worker *w = h->worker;
+        TURN_MUTEX_LOCK(&(w->mutex));
+        h->done = false;
+        tls_handshake_post(h);
+        TURN_MUTEX_UNLOCK(&(w->mutex));
+        event_active(w->wake_ev, EV_READ, 0);
+      } else {
+        tls_handshake_release();
+        s->handshake = NULL;
+        attach_ioa_socket_ssl(s, h->ssl);
+        h->ssl = NULL;
+        h->cb(s, h->rc, h->dgrams, h->dgrams_number, h->cb_arg);
+        h->dgrams_number = 0;
+        tls_handshake_free(h);
+      }
+    }
+
+    h = next;
+  }
+}
+
+static struct _tls_handshake_queue *get_tls_handshake_queue(ioa_engine_handle e) {
+  if (!(e->handshakes)) {
+    struct _tls_handshake_queue *q = (struct _tls_handshake_queue *)calloc(1, sizeof(struct _tls_handshake_queue));
+    TURN_MUTEX_INIT(&(q->mutex));
+    q->ev = event_new(e->event_base, -1, EV_PERSIST, tls_handshake_completion_handler, q);
+    e->handshakes = q;
+  }
+  return e->handshakes;
+}
+
+static tls_handshake *tls_handshake_new(ioa_socket_handle s, tls_handshake_cb cb, void *arg) {
+  TURN_MUTEX_LOCK(&pool_mutex);
+  const bool full = (pending >= pending_limit);
+  tls_handshake_worker *w = NULL;
+  if (!full) {
+    pending += 1;
+    w = &(workers[next_worker]);
+    next_worker = (next_worker + 1) % workers_number;
+  }
+  TURN_MUTEX_UNLOCK(&pool_mutex);
+
+  if (full) {
+    prom_inc_tls_handshake_rejected(s->st);
+    if (eve(s->e->verbose)) {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "%s: handshake queue is full, socket %p rejected\n", __FUNCTION__, s);
+    }
+    return NULL;
+  }
+
+  tls_handshake *h = (tls_handshake *)calloc(1, sizeof(tls_handshake));
+  h->worker = w;
+  h->queue = get_tls_handshake_queue(s->e);
+  h->e = s->e;
+  h->s = s;
+  h->ssl = s->ssl;
+  h->fd = s->fd;
+  h->cb = cb;
+  h->cb_arg = arg;
+  h->verbose = s->e->verbose;
+
+  /* The SSL runs on the worker until the completion */
+  attach_ioa_socket_ssl(s, NULL);
+  s->handshake = h;
+
+  return h;
+}
+
+static void tls_handshake_start(tls_handshake *h) {
+  tls_handshake_worker *w = h->worker;
+  TURN_MUTEX_LOCK(&(w->mutex));
+  tls_handshake_post(h);
+  TURN_MUTEX_UNLOCK(&(w->mutex));
+  event_active(w->wake_ev, EV_READ, 0);
+}
+
+//////////////////// API /////////////////////////
+
+int tls_handshake_pool_init(int workers_num, int queue_limit) {
+  if (workers_num <= 0) {
+    return 0;
+  }
+  if (workers_num > MAX_TLS_HANDSHAKE_WORKERS) {
+    workers_num = MAX_TLS_HANDSHAKE_WORKERS;
+  }
+
+  TURN_MUTEX_INIT(&pool_mutex);
+  pending_limit = (queue_limit > 0) ? queue_limit : DEFAULT_TLS_HANDSHAKE_QUEUE;
+
+  workers = (tls_handshake_worker *)calloc((size_t)workers_num, sizeof(tls_handshake_worker));
+
+  for (int i = 0; i < workers_num; ++i) {
+    tls_handshake_worker *w = &(workers[i]);
+    TURN_MUTEX_INIT(&(w->mutex));
+    w->event_base = turn_event_base_new();
+    w->wake_ev = event_new(w->event_base, -1, EV_PERSIST, tls_handshake_wake_handler, w);
+    if (pthread_create(&(w->thr), NULL, run_tls_handshake_thread, w)) {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Cannot create TLS handshake thread: %s\n", strerror(errno));
+      break;
+    }
+    pthread_detach(w->thr);
+    workers_number += 1;
+  }
+
+  if (workers_number) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "TLS handshake workers: %d, queue limit: %d\n", (int)workers_number,
+                  pending_limit);
+  }
+
+  return (int)workers_number;
+}
+
+bool tls_handshake_pool_enabled(void) { return workers_number > 0; }
+
+bool tls_handshake_submit(ioa_socket_handle s, tls_handshake_cb cb, void *arg) {
+  if (!s || !(s->ssl) || (s->fd < 0) || s->handshake) {
+    return false;
+  }
+
+  SSL_set_accept_state(s->ssl);
+  if (!SSL_set_fd(s->ssl, s->fd)) {
+    return false;
+  }
+
+  tls_handshake *h = tls_handshake_new(s, cb, arg);
+  if (!h) {
+    return false;
+  }
+
+  tls_handshake_start(h);
+  return true;
+}
+
+bool tls_handshake_submit_dtls(ioa_socket_handle s, ioa_network_buffer_handle nbh, tls_handshake_cb cb, void *arg) {
+  if (!s || !(s->ssl) || s->handshake) {
+    return false;
+  }
+
+  tls_handshake *h = tls_handshake_new(s, cb, arg);
+  if (!h) {
+    return false;
+  }
+
+  h->dtls = true;
+  if (nbh) {
+    h->dgrams[0] = nbh;
+    h->dgrams_number = 1;
+  } else {
+    h->resume = true;
+  }
+
+  tls_handshake_start(h);
+  return true;
+}
+
+void tls_handshake_dtls_input(ioa_socket_handle s, ioa_network_buffer_handle nbh) {
+  tls_handshake *h = s->handshake;
+  tls_handshake_worker *w = h->worker;
+
+  TURN_MUTEX_LOCK(&(w->mutex));
+  const bool stored = (h->dgrams_number < TLS_HANDSHAKE_MAX_DATAGRAMS);
+  if (stored) {
+    h->dgrams[h->dgrams_number] = nbh;
+    h->dgrams_number += 1;
+  }
+  TURN_MUTEX_UNLOCK(&(w->mutex));
+
+  if (!stored) {
+    ioa_network_buffer_delete(s->e, nbh);
+  }
+}
+
+void tls_handshake_cancel(ioa_socket_handle s) {
+  if (!s || !(s->handshake)) {
+    return;
+  }
+
+  tls_handshake *h = s->handshake;
+  tls_handshake_worker *w = h->worker;
+  s->handshake = NULL;
+
+  TURN_MUTEX_LOCK(&(w->mutex));
+  h->cancelled = true;
+  h->s = NULL;
+  if (!(h->dtls)) {
+    /* The worker may still be using the descriptor */
+    h->owns_fd = true;
+    s->fd = -1;
+  }
+  /* A running job notices the flag by itself, a waiting one has to be woken up */
+  const bool wake = !(h->done) && h->waiting && tls_handshake_post(h);
+  TURN_MUTEX_UNLOCK(&(w->mutex));
+
+  if (wake) {
+    event_active(w->wake_ev, EV_READ, 0);
+  }
+}
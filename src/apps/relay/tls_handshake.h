@@ -0,0 +1,109 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * TLS/DTLS handshake worker pool: the handshakes of the client connections
+ * run on dedicated threads, the relay threads get the established SSL back
+ */
+
+#ifndef __TLS_HANDSHAKE__
+#define __TLS_HANDSHAKE__
+
+#include "ns_ioalib_impl.h"
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//////////////////////////////////////////////////
+
+#define DEFAULT_TLS_HANDSHAKE_QUEUE (1024)
+
+/* DTLS datagrams kept while a handshake is running, the others are dropped */
+#define TLS_HANDSHAKE_MAX_DATAGRAMS (16)
+
+/*
+ * Completion of a handshake, called on the relay thread of s once the SSL is
+ * attached to s again; rc is negative when the handshake failed. For DTLS,
+ * dgrams are the datagrams received while the handshake was running and not
+ * consumed by it, oldest first; the callee owns them.
+ */
+typedef void (*tls_handshake_cb)(ioa_socket_handle s, int rc, ioa_network_buffer_handle *dgrams, size_t dgrams_number,
+                                 void *arg);
+
+/*
+ * Starts the worker threads. queue_limit bounds the number of handshakes
+ * waiting or running in the pool.
+ */
+int tls_handshake_pool_init(int workers, int queue_limit);
+bool tls_handshake_pool_enabled(void);
+
+/* Monotonic clock for the handshake latency, in microseconds */
+uint64_t tls_handshake_time_us(void);
+
+/*
+ * Hands the accepting TLS handshake of the stream socket s over to the pool;
+ * the SSL is detached from s until the completion. Returns false when the
+ * pool is full, the SSL then stays with s.
+ */
+bool tls_handshake_submit(ioa_socket_handle s, tls_handshake_cb cb, void *arg);
+
+/*
+ * Same for the DTLS socket s, starting with the datagram nbh; the pool takes
+ * nbh over when the handshake is accepted. With a NULL nbh the ClientHello
+ * has already been consumed, and the handshake resumes with the server flight.
+ */
+bool tls_handshake_submit_dtls(ioa_socket_handle s, ioa_network_buffer_handle nbh, tls_handshake_cb cb, void *arg);
+
+/*
+ * Queues a datagram received for s while its DTLS handshake is in the pool.
+ * The pool takes nbh over in any case.
+ */
+void tls_handshake_dtls_input(ioa_socket_handle s, ioa_network_buffer_handle nbh);
+
+/*
+ * s is being closed: the pending handshake, if any, is abandoned and the
+ * pool releases its resources (including the TLS socket descriptor).
+ */
+void tls_handshake_cancel(ioa_socket_handle s);
+
+//////////////////////////////////////////////////
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TLS_HANDSHAKE__ */
@@ -0,0 +1,449 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "tls_session_cache.h"
+
+#include "ns_turn_ioalib.h"
+#include "ns_turn_utils.h"
+
+#include <openssl/rand.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#else
+#include <openssl/hmac.h>
+#endif
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//////////////////////////////////////////////////
+
+/*
+ * The cache is split in shards, each with its own lock, so that the relay
+ * threads completing handshakes at the same time rarely wait on each other.
+ */
+#define TLS_SESSION_CACHE_SHARDS (16)
+
+typedef struct _tls_session_entry {
+  struct _tls_session_entry *next;  /* bucket chain */
+  struct _tls_session_entry *older; /* eviction order */
+  struct _tls_session_entry *newer;
+  unsigned char id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+  unsigned int id_len;
+  SSL_SESSION *sess;
+} tls_session_entry;
+
+typedef struct _tls_session_shard {
+  TURN_MUTEX_DECLARE(mutex)
+  tls_session_entry **buckets;
+  size_t buckets_mask;
+  size_t size;
+  size_t capacity;
+  tls_session_entry *oldest;
+  tls_session_entry *newest;
+} tls_session_shard;
+
+static tls_session_shard shards[TLS_SESSION_CACHE_SHARDS];
+static bool cache_enabled = false;
+static bool ticket_keys_enabled = false;
+static int session_lifetime = DEFAULT_TLS_SESSION_LIFETIME;
+
+#define TLS_TICKET_KEY_NAME_SIZE (16)
+#define TLS_TICKET_KEY_SIZE (32)
+
+typedef struct _tls_ticket_key {
+  unsigned char name[TLS_TICKET_KEY_NAME_SIZE];
+  unsigned char aes_key[TLS_TICKET_KEY_SIZE];
+  unsigned char hmac_key[TLS_TICKET_KEY_SIZE];
+  time_t created;
+  bool valid;
+} tls_ticket_key;
+
+/* The current key encrypts the new tickets, the previous one still decrypts */
+static tls_ticket_key ticket_keys[2];
+static TURN_MUTEX_DECLARE(ticket_keys_mutex)
+
+/////////////////// Session cache ////////////////
+
+static uint32_t session_id_hash(const unsigned char *id, unsigned int id_len) {
+  uint32_t h = 2166136261U;
+  for (unsigned int i = 0; i < id_len; ++i) {
+    h = (h ^ id[i]) * 16777619U;
+  }
+  return h;
+}
+
+static tls_session_shard *get_shard(uint32_t h) { return &shards[h % TLS_SESSION_CACHE_SHARDS]; }
+
+static tls_session_entry **find_entry(tls_session_shard *shard, uint32_t h, const unsigned char *id,
+                                      unsigned int id_len) {
+  tls_session_entry **pe = &(shard->buckets[(h / TLS_SESSION_CACHE_SHARDS) & shard->buckets_mask]);
+  while (*pe) {
+    if (((*pe)->id_len == id_len) && !memcmp((*pe)->id, id, id_len)) {
+      break;
+    }
+    pe = &((*pe)->next);
+  }
+  return pe;
+}
+
+static void remove_entry(tls_session_shard *shard, tls_session_entry **pe) {
+  tls_session_entry *e = *pe;
+  *pe = e->next;
+
+  if (e->older) {
+    e->older->newer = e->newer;
+  } else {
+    shard->oldest = e->newer;
+  }
+  if (e->newer) {
+    e->newer->older = e->older;
+  } else {
+    shard->newest = e->older;
+  }
+
+  --(shard->size);
+  SSL_SESSION_free(e->sess);
+  free(e);
+}
+
+static int tls_session_new_cb(SSL *ssl, SSL_SESSION *sess) {
+  UNUSED_ARG(ssl);
+
+  unsigned int id_len = 0;
+  const unsigned char *id = SSL_SESSION_get_id(sess, &id_len);
+  if (!id_len || (id_len > SSL_MAX_SSL_SESSION_ID_LENGTH)) {
+    return 0;
+  }
+
+  tls_session_entry *e = (tls_session_entry *)calloc(1, sizeof(tls_session_entry));
+  if (!e) {
+    return 0;
+  }
+  memcpy(e->id, id, id_len);
+  e->id_len = id_len;
+  e->sess = sess;
+
+  const uint32_t h = session_id_hash(id, id_len);
+  tls_session_shard *shard = get_shard(h);
+
+  TURN_MUTEX_LOCK(&(shard->mutex));
+
+  tls_session_entry **pe = find_entry(shard, h, id, id_len);
+  if (*pe) {
+    remove_entry(shard, pe);
+  }
+  while (shard->oldest && (shard->size >= shard->capacity)) {
+    tls_session_entry *old = shard->oldest;
+    remove_entry(shard, find_entry(shard, session_id_hash(old->id, old->id_len), old->id, old->id_len));
+  }
+
+  /* The eviction may have freed the entry that pe pointed into */
+  pe = find_entry(shard, h, id, id_len);
+  e->next = *pe;
+  *pe = e;
+  e->older = shard->newest;
+  if (shard->newest) {
+    shard->newest->newer = e;
+  } else {
+    shard->oldest = e;
+  }
+  shard->newest = e;
+  ++(shard->size);
+
+  TURN_MUTEX_UNLOCK(&(shard->mutex));
+
+  /* The cache keeps the reference */
+  return 1;
+}
+
+static SSL_SESSION *tls_session_get_cb(SSL *ssl, const unsigned char *id, int id_len, int *copy) {
+  UNUSED_ARG(ssl);
+
+  /* The reference is taken here, under the shard lock */
+  *copy = 0;
+
+  if ((id_len <= 0) || (id_len > SSL_MAX_SSL_SESSION_ID_LENGTH)) {
+    return NULL;
+  }
+
+  SSL_SESSION *sess = NULL;
+  const uint32_t h = session_id_hash(id, (unsigned int)id_len);
+  tls_session_shard *shard = get_shard(h);
+
+  TURN_MUTEX_LOCK(&(shard->mutex));
+
+  tls_session_entry **pe = find_entry(shard, h, id, (unsigned int)id_len);
+  if (*pe) {
+    SSL_SESSION *s = (*pe)->sess;
+    if ((long)time(NULL) >= SSL_SESSION_get_time(s) + SSL_SESSION_get_timeout(s)) {
+      remove_entry(shard, pe);
+    } else if (SSL_SESSION_up_ref(s)) {
+      sess = s;
+    }
+  }
+
+  TURN_MUTEX_UNLOCK(&(shard->mutex));
+
+  return sess;
+}
+
+static void tls_session_remove_cb(SSL_CTX *ctx, SSL_SESSION *sess) {
+  UNUSED_ARG(ctx);
+
+  unsigned int id_len = 0;
+  const unsigned char *id = SSL_SESSION_get_id(sess, &id_len);
+  if (!id_len || (id_len > SSL_MAX_SSL_SESSION_ID_LENGTH)) {
+    return;
+  }
+
+  const uint32_t h = session_id_hash(id, id_len);
+  tls_session_shard *shard = get_shard(h);
+
+  TURN_MUTEX_LOCK(&(shard->mutex));
+
+  tls_session_entry **pe = find_entry(shard, h, id, id_len);
+  if (*pe && ((*pe)->sess == sess)) {
+    remove_entry(shard, pe);
+  }
+
+  TURN_MUTEX_UNLOCK(&(shard->mutex));
+}
+
+/////////////////// Ticket keys //////////////////
+
+static void new_ticket_key(tls_ticket_key *key, time_t now) {
+  if ((RAND_bytes(key->name, sizeof(key->name)) <= 0) || (RAND_bytes(key->aes_key, sizeof(key->aes_key)) <= 0) ||
+      (RAND_bytes(key->hmac_key, sizeof(key->hmac_key)) <= 0)) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "%s: cannot generate a session ticket key\n", __FUNCTION__);
+    key->valid = false;
+    return;
+  }
+  key->created = now;
+  key->valid = true;
+}
+
+/* Must be called with the keys mutex held */
+static void rotate_ticket_keys(time_t now, bool force) {
+  if (force || !(ticket_keys[0].valid) || (now - ticket_keys[0].created >= session_lifetime)) {
+    if (force) {
+      OPENSSL_cleanse(&ticket_keys[1], sizeof(ticket_keys[1]));
+    } else {
+      ticket_keys[1] = ticket_keys[0];
+    }
+    new_ticket_key(&ticket_keys[0], now);
+  }
+}
+
+/*
+ * Picks the key for a ticket and sets up the cipher context. Returns the
+ * ticket callback result; on success the key is left in *key for the HMAC.
+ */
+static int tls_ticket_key_select(unsigned char key_name[16], unsigned char *iv, EVP_CIPHER_CTX *cctx, int enc,
+                                 tls_ticket_key *key) {
+  int ret = 1;
+
+  TURN_MUTEX_LOCK(&ticket_keys_mutex);
+  rotate_ticket_keys(time(NULL), false);
+  if (enc) {
+    *key = ticket_keys[0];
+  } else if (ticket_keys[0].valid && !memcmp(key_name, ticket_keys[0].name, TLS_TICKET_KEY_NAME_SIZE)) {
+    *key = ticket_keys[0];
+  } else if (ticket_keys[1].valid && !memcmp(key_name, ticket_keys[1].name, TLS_TICKET_KEY_NAME_SIZE)) {
+    *key = ticket_keys[1];
+    /* Still good, but have the client get a ticket under the current key */
+    ret = 2;
+  } else {
+    ret = 0;
+  }
+  TURN_MUTEX_UNLOCK(&ticket_keys_mutex);
+
+  if (!ret) {
+    /* Unknown key: full handshake */
+    return 0;
+  }
+
+  if (!(key->valid)) {
+    return -1;
+  }
+
+  const EVP_CIPHER *cipher = EVP_aes_256_cbc();
+
+  if (enc) {
+    memcpy(key_name, key->name, TLS_TICKET_KEY_NAME_SIZE);
+    if ((RAND_bytes(iv, EVP_CIPHER_iv_length(cipher)) <= 0) ||
+        !EVP_EncryptInit_ex(cctx, cipher, NULL, key->aes_key, iv)) {
+      ret = -1;
+    }
+  } else if (!EVP_DecryptInit_ex(cctx, cipher, NULL, key->aes_key, iv)) {
+    ret = -1;
+  }
+
+  return ret;
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+
+static int tls_ticket_key_cb(SSL *ssl, unsigned char key_name[16], unsigned char iv[EVP_MAX_IV_LENGTH],
+                             EVP_CIPHER_CTX *cctx, EVP_MAC_CTX *hctx, int enc) {
+  UNUSED_ARG(ssl);
+
+  tls_ticket_key key;
+  int ret = tls_ticket_key_select(key_name, iv, cctx, enc, &key);
+
+  if (ret > 0) {
+    OSSL_PARAM params[3];
+    params[0] = OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key.hmac_key, sizeof(key.hmac_key));
+    params[1] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, (char *)"SHA256", 0);
+    params[2] = OSSL_PARAM_construct_end();
+    if (!EVP_MAC_CTX_set_params(hctx, params)) {
+      ret = -1;
+    }
+  }
+
+  OPENSSL_cleanse(&key, sizeof(key));
+
+  return ret;
+}
+
+#else
+
+static int tls_ticket_key_cb(SSL *ssl, unsigned char key_name[16], unsigned char iv[EVP_MAX_IV_LENGTH],
+                             EVP_CIPHER_CTX *cctx, HMAC_CTX *hctx, int enc) {
+  UNUSED_ARG(ssl);
+
+  tls_ticket_key key;
+  int ret = tls_ticket_key_select(key_name, iv, cctx, enc, &key);
+
+  if ((ret > 0) && !HMAC_Init_ex(hctx, key.hmac_key, sizeof(key.hmac_key), EVP_sha256(), NULL)) {
+    ret = -1;
+  }
+
+  OPENSSL_cleanse(&key, sizeof(key));
+
+  return ret;
+}
+
+#endif
+
+//////////////////////////////////////////////////
+
+void tls_session_cache_init(size_t cache_size, int lifetime) {
+  static bool initialized = false;
+  if (initialized) {
+    return;
+  }
+  initialized = true;
+
+  if (lifetime > 0) {
+    session_lifetime = lifetime;
+  }
+
+  TURN_MUTEX_INIT(&ticket_keys_mutex);
+  ticket_keys_enabled = true;
+
+  if (!cache_size) {
+    return;
+  }
+
+  const size_t capacity = (cache_size + TLS_SESSION_CACHE_SHARDS - 1) / TLS_SESSION_CACHE_SHARDS;
+  size_t nbuckets = 1;
+  while (nbuckets < capacity) {
+    nbuckets <<= 1;
+  }
+
+  for (size_t i = 0; i < TLS_SESSION_CACHE_SHARDS; ++i) {
+    tls_session_shard *shard = &shards[i];
+    TURN_MUTEX_INIT(&(shard->mutex));
+    shard->buckets = (tls_session_entry **)calloc(nbuckets, sizeof(tls_session_entry *));
+    if (!(shard->buckets)) {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "%s: cannot allocate the TLS session cache\n", __FUNCTION__);
+      return;
+    }
+    shard->buckets_mask = nbuckets - 1;
+    shard->capacity = capacity;
+  }
+
+  cache_enabled = true;
+
+  TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "TLS session cache: %lu sessions, session lifetime %d sec\n",
+                (unsigned long)(capacity * TLS_SESSION_CACHE_SHARDS), session_lifetime);
+}
+
+void tls_session_cache_setup_ctx(SSL_CTX *ctx) {
+  if (!ctx || !ticket_keys_enabled) {
+    return;
+  }
+
+  /* Required to resume the sessions of verified clients */
+  static const unsigned char sid_ctx[] = "turnserver";
+  SSL_CTX_set_session_id_context(ctx, sid_ctx, sizeof(sid_ctx) - 1);
+
+  SSL_CTX_set_timeout(ctx, session_lifetime);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, tls_ticket_key_cb);
+#else
+  SSL_CTX_set_tlsext_ticket_key_cb(ctx, tls_ticket_key_cb);
+#endif
+
+  /* Without the cache, the tickets are the only way to resume */
+  if (cache_enabled) {
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+    SSL_CTX_sess_set_new_cb(ctx, tls_session_new_cb);
+    SSL_CTX_sess_set_get_cb(ctx, tls_session_get_cb);
+    SSL_CTX_sess_set_remove_cb(ctx, tls_session_remove_cb);
+  }
+}
+
+void tls_session_cache_flush(void) {
+  if (!ticket_keys_enabled) {
+    return;
+  }
+
+  for (size_t i = 0; cache_enabled && (i < TLS_SESSION_CACHE_SHARDS); ++i) {
+    tls_session_shard *shard = &shards[i];
+    TURN_MUTEX_LOCK(&(shard->mutex));
+    while (shard->oldest) {
+      tls_session_entry *old = shard->oldest;
+      remove_entry(shard, find_entry(shard, session_id_hash(old->id, old->id_len), old->id, old->id_len));
+    }
+    TURN_MUTEX_UNLOCK(&(shard->mutex));
+  }
+
+  TURN_MUTEX_LOCK(&ticket_keys_mutex);
+  rotate_ticket_keys(time(NULL), true);
+  TURN_MUTEX_UNLOCK(&ticket_keys_mutex);
+}
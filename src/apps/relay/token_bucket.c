@@ -0,0 +1,170 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "token_bucket.h"
+
+#include <time.h>
+
+//////////////////////////////////////////////////
+
+#define TOKEN_BUCKET_NS_PER_SEC (1000000000ULL)
+#define TOKEN_BUCKET_NS_PER_MS (1000000ULL)
+
+/* Read and write directions of the server */
+static shared_token_bucket token_bucket_servers[2];
+
+static atomic_ulong token_bucket_server_bps = 0;
+static band_limit_t token_bucket_realm_bps = 0;
+
+static uint64_t token_bucket_burst_ns = TOKEN_BUCKET_DEFAULT_BURST_MS * TOKEN_BUCKET_NS_PER_MS;
+static uint64_t token_bucket_queue = 0;
+
+static atomic_uint_fast64_t token_bucket_shaped[TOKEN_BUCKET_LEVELS_NUMBER];
+static atomic_uint_fast64_t token_bucket_dropped[TOKEN_BUCKET_LEVELS_NUMBER];
+
+static const char *token_bucket_level_names[TOKEN_BUCKET_LEVELS_NUMBER] = {"session", "realm", "server"};
+
+void token_bucket_setup(uint32_t burst_ms, uint32_t queue_ms, band_limit_t realm_bps) {
+  token_bucket_burst_ns = (uint64_t)burst_ms * TOKEN_BUCKET_NS_PER_MS;
+  token_bucket_queue = (uint64_t)queue_ms * TOKEN_BUCKET_NS_PER_MS;
+  token_bucket_realm_bps = realm_bps;
+}
+
+void token_bucket_set_server_bps(band_limit_t bps) {
+  atomic_store_explicit(&token_bucket_server_bps, bps, memory_order_relaxed);
+}
+
+uint64_t token_bucket_now(void) {
+  struct timespec tp = {0, 0};
+  clock_gettime(CLOCK_MONOTONIC, &tp);
+  return (uint64_t)tp.tv_sec * TOKEN_BUCKET_NS_PER_SEC + (uint64_t)tp.tv_nsec;
+}
+
+uint64_t token_bucket_queue_ns(void) { return token_bucket_queue; }
+
+bool token_bucket_aggregate(void) {
+  return token_bucket_realm_bps || atomic_load_explicit(&token_bucket_server_bps, memory_order_relaxed);
+}
+
+shared_token_bucket *token_bucket_server(int read) { return &(token_bucket_servers[read ? 0 : 1]); }
+
+static inline uint64_t token_bucket_cost(size_t size, band_limit_t bps) {
+  return (uint64_t)size * TOKEN_BUCKET_NS_PER_SEC / (uint64_t)bps;
+}
+
+static uint64_t local_take(token_bucket *b, uint64_t now, uint64_t cost) {
+  const uint64_t limit = now + token_bucket_burst_ns;
+  if (b->tat > limit) {
+    return b->tat - limit;
+  }
+  b->tat = ((b->tat > now) ? b->tat : now) + cost;
+  return 0;
+}
+
+static uint64_t shared_take(shared_token_bucket *b, uint64_t now, uint64_t cost) {
+  const uint64_t limit = now + token_bucket_burst_ns;
+  uint_fast64_t tat = atomic_load_explicit(&(b->tat), memory_order_relaxed);
+  do {
+    if (tat > limit) {
+      return tat - limit;
+    }
+  } while (!atomic_compare_exchange_weak_explicit(&(b->tat), &tat, ((tat > now) ? tat : now) + cost,
+                                                  memory_order_relaxed, memory_order_relaxed));
+  return 0;
+}
+
+uint64_t token_bucket_take(token_bucket *session, band_limit_t bps, shared_token_bucket *realm,
+                           shared_token_bucket *server, size_t size, uint64_t now, TOKEN_BUCKET_LEVEL *level) {
+  uint64_t session_cost = 0;
+  uint64_t realm_cost = 0;
+  uint64_t wait = 0;
+
+  if (bps) {
+    session_cost = token_bucket_cost(size, bps);
+    wait = local_take(session, now, session_cost);
+    if (wait) {
+      *level = TOKEN_BUCKET_SESSION;
+      return wait;
+    }
+  }
+
+  if (realm && token_bucket_realm_bps) {
+    realm_cost = token_bucket_cost(size, token_bucket_realm_bps);
+    wait = shared_take(realm, now, realm_cost);
+    if (wait) {
+      *level = TOKEN_BUCKET_REALM;
+      session->tat -= session_cost;
+      return wait;
+    }
+  }
+
+  const band_limit_t server_bps = atomic_load_explicit(&token_bucket_server_bps, memory_order_relaxed);
+  if (server && server_bps) {
+    wait = shared_take(server, now, token_bucket_cost(size, server_bps));
+    if (wait) {
+      /* the bytes do not pass, so they do not count against the levels under it */
+      *level = TOKEN_BUCKET_SERVER;
+      session->tat -= session_cost;
+      if (realm_cost) {
+        atomic_fetch_sub_explicit(&(realm->tat), realm_cost, memory_order_relaxed);
+      }
+      return wait;
+    }
+  }
+
+  return 0;
+}
+
+void token_bucket_count(TOKEN_BUCKET_LEVEL level, size_t size, bool dropped) {
+  if ((level >= 0) && (level < TOKEN_BUCKET_LEVELS_NUMBER)) {
+    atomic_fetch_add_explicit(dropped ? &(token_bucket_dropped[level]) : &(token_bucket_shaped[level]), size,
+                              memory_order_relaxed);
+  }
+}
+
+void token_bucket_get_stats(token_bucket_stats *stats) {
+  if (stats) {
+    for (size_t i = 0; i < TOKEN_BUCKET_LEVELS_NUMBER; ++i) {
+      stats->shaped_bytes[i] = atomic_load_explicit(&(token_bucket_shaped[i]), memory_order_relaxed);
+      stats->dropped_bytes[i] = atomic_load_explicit(&(token_bucket_dropped[i]), memory_order_relaxed);
+    }
+  }
+}
+
+const char *token_bucket_level_name(TOKEN_BUCKET_LEVEL level) {
+  if ((level < 0) || (level >= TOKEN_BUCKET_LEVELS_NUMBER)) {
+    return "unknown";
+  }
+  return token_bucket_level_names[level];
+}
@@ -0,0 +1,113 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Token buckets of the bandwidth limits, in bytes per second: per session
+ * socket, nested under the buckets of the realm and of the whole server.
+ * A bucket is the theoretical arrival time of its next byte (GCRA), in
+ * nanoseconds of the monotonic clock, so the shared levels take one CAS.
+ */
+
+#ifndef __TOKEN_BUCKET__
+#define __TOKEN_BUCKET__
+
+#include "ns_turn_msg.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//////////////////////////////////////////////////
+
+#define TOKEN_BUCKET_DEFAULT_BURST_MS (1000)
+
+typedef enum {
+  TOKEN_BUCKET_SESSION = 0,
+  TOKEN_BUCKET_REALM,
+  TOKEN_BUCKET_SERVER,
+  TOKEN_BUCKET_LEVELS_NUMBER
+} TOKEN_BUCKET_LEVEL;
+
+/* Owned by one relay thread */
+typedef struct _token_bucket {
+  uint64_t tat;
+} token_bucket;
+
+/* Shared by the relay threads */
+typedef struct _shared_token_bucket {
+  atomic_uint_fast64_t tat;
+} shared_token_bucket;
+
+typedef struct _token_bucket_stats {
+  uint64_t shaped_bytes[TOKEN_BUCKET_LEVELS_NUMBER];
+  uint64_t dropped_bytes[TOKEN_BUCKET_LEVELS_NUMBER];
+} token_bucket_stats;
+
+/* Before the relay threads start; the server rate may change later */
+void token_bucket_setup(uint32_t burst_ms, uint32_t queue_ms, band_limit_t realm_bps);
+void token_bucket_set_server_bps(band_limit_t bps);
+
+uint64_t token_bucket_now(void);
+
+/* How long the input of a stream socket may wait for its bucket, 0 to drop it */
+uint64_t token_bucket_queue_ns(void);
+
+/* Whether the data traffic goes through the realm and server buckets */
+bool token_bucket_aggregate(void);
+shared_token_bucket *token_bucket_server(int read);
+
+/*
+ * Takes size bytes from the session bucket at bps (no session limit when 0),
+ * then from the realm and server buckets when given. Returns 0 when the bytes
+ * conform and are taken; otherwise nothing is taken and the nanoseconds until
+ * they would conform are returned, with the level that refused them.
+ */
+uint64_t token_bucket_take(token_bucket *session, band_limit_t bps, shared_token_bucket *realm,
+                           shared_token_bucket *server, size_t size, uint64_t now, TOKEN_BUCKET_LEVEL *level);
+
+void token_bucket_count(TOKEN_BUCKET_LEVEL level, size_t size, bool dropped);
+void token_bucket_get_stats(token_bucket_stats *stats);
+const char *token_bucket_level_name(TOKEN_BUCKET_LEVEL level);
+
+//////////////////////////////////////////////////
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TOKEN_BUCKET__ */
@@ -85,6 +85,9 @@
 #include "turn_admin_server.h"
 
 #include "http_server.h"
+#include "latency_hist.h"
+#include "loop_stats.h"
+#include "session_stats.h"
 
 #include "dbdrivers/dbdriver.h"
 
@@ -171,6 +174,12 @@ static const char *CLI_HELP_STR[] = {"",
                                      "",
                                      "  pu [udp|tcp|dtls|tls]- print current users",
                                      "",
+                                     "  pl - print control plane latencies",
+                                     "",
+                                     "  pt - print threads event loop load",
+                                     "",
+                                     "  pb - print traffic over the bandwidth limits",
+                                     "",
                                      "  lr - log reset",
                                      "",
                                      "  aas ip[:port} - add an alternate server reference",
@@ -180,6 +189,8 @@ static const char *CLI_HELP_STR[] = {"",
                                      "",
                                      "  cs <session-id> - cancel session, forcefully",
                                      "",
+                                     "  ms <session-id> <relay-number> - move UDP session to another relay thread",
+                                     "",
                                      NULL};
 
 static const char *CLI_GREETING_STR[] = {"TURN Server", TURN_SOFTWARE, NULL};
@@ -449,6 +460,8 @@ static bool print_session(ur_map_key_type key, ur_map_value_type value, void *ar
       return false;
     }
 
+    session_stats_load(tsi);
+
     if (cs->origin[0] && strcmp(cs->origin, tsi->origin) != 0) {
       return false;
     }
@@ -592,6 +605,22 @@ static void cancel_session(struct cli_session *cs, const char *ssid) {
   }
 }
 
+static void migrate_session(struct cli_session *cs, const char *args) {
+  if (cs && cs->ts && args && *args) {
+    char *end = NULL;
+    const turnsession_id sid = strtoull(args, &end, 10);
+    const char *dest = end;
+    while (*dest == ' ') {
+      ++dest;
+    }
+    if (!sid || (end == args) || !(*dest)) {
+      myprintf(cs, "Usage: ms <session-id> <relay-number>\n");
+    } else if (send_session_migration_to_relay(sid, (size_t)strtoul(dest, NULL, 10)) < 0) {
+      myprintf(cs, "Session %018llu cannot migrate there\n", (unsigned long long)sid);
+    }
+  }
+}
+
 static void print_sessions(struct cli_session *cs, const char *pn, int exact_match, int print_users) {
   if (cs && cs->ts && pn) {
 
@@ -680,6 +709,57 @@ static void print_sessions(struct cli_session *cs, const char *pn, int exact_mat
   }
 }
 
+static void print_latencies(struct cli_session *cs) {
+  if (cs && cs->ts) {
+    myprintf(cs, "\n  %-18s %10s %10s %10s %10s %10s %10s %10s\n", "operation, us", "count", "avg", "p50", "p90",
+             "p99", "p99.9", "max");
+    for (int op = 0; op < TURN_LATENCY_OPS_NUMBER; ++op) {
+      turn_latency_summary summary;
+      turn_latency_summarize((TURN_LATENCY_OP)op, &summary);
+      myprintf(cs, "  %-18s %10llu %10llu %10llu %10llu %10llu %10llu %10llu\n",
+               turn_latency_op_name((TURN_LATENCY_OP)op), (unsigned long long)summary.count,
+               (unsigned long long)(summary.count ? (summary.sum_us / summary.count) : 0),
+               (unsigned long long)summary.quantiles_us[0], (unsigned long long)summary.quantiles_us[1],
+               (unsigned long long)summary.quantiles_us[2], (unsigned long long)summary.quantiles_us[3],
+               (unsigned long long)summary.max_us);
+    }
+    myprintf(cs, "\n");
+  }
+}
+
+static void print_loop_visit(const loop_stats_snapshot *ls, void *arg) {
+  struct cli_session *cs = (struct cli_session *)arg;
+
+  const uint64_t iterations = ls->window_iterations ? ls->window_iterations : 1;
+  myprintf(cs, "  %-18s %12llu %6.1f%% %10llu %10.1f %10llu %10llu\n", ls->name, (unsigned long long)ls->iterations,
+           ls->window_us ? (100.0 * (double)ls->busy_us / (double)ls->window_us) : 0.0,
+           (unsigned long long)(ls->busy_us / iterations), (double)ls->window_callbacks / (double)iterations,
+           (unsigned long long)ls->lateness_avg_us, (unsigned long long)ls->lateness_max_us);
+}
+
+static void print_loops(struct cli_session *cs) {
+  if (cs && cs->ts) {
+    myprintf(cs, "\n  %-18s %12s %7s %10s %10s %10s %10s\n", "thread, last 1s", "iterations", "busy", "iter, us",
+             "events", "lag, us", "max lag");
+    loop_stats_foreach(print_loop_visit, cs);
+    myprintf(cs, "\n");
+  }
+}
+
+static void print_bandwidth(struct cli_session *cs) {
+  if (cs && cs->ts) {
+    token_bucket_stats stats;
+    token_bucket_get_stats(&stats);
+
+    myprintf(cs, "\n  %-10s %20s %20s\n", "limit", "delayed, bytes", "dropped, bytes");
+    for (int level = 0; level < TOKEN_BUCKET_LEVELS_NUMBER; ++level) {
+      myprintf(cs, "  %-10s %20llu %20llu\n", token_bucket_level_name((TOKEN_BUCKET_LEVEL)level),
+               (unsigned long long)stats.shaped_bytes[level], (unsigned long long)stats.dropped_bytes[level]);
+    }
+    myprintf(cs, "\n");
+  }
+}
+
 static void cli_print_configuration(struct cli_session *cs) {
   if (cs) {
     myprintf(cs, "\n");
@@ -853,6 +933,9 @@ static void cli_print_configuration(struct cli_session *cs) {
     cli_print_uint(cs, (unsigned long)get_bps_capacity(), "Total server bps-capacity", 2);
     cli_print_uint(cs, (unsigned long)get_bps_capacity_allocated(), "Allocated bps-capacity", 0);
     cli_print_uint(cs, (unsigned long)get_max_bps(), "Default max-bps", 2);
+    cli_print_uint(cs, (unsigned long)turn_params.realm_bps_capacity, "Total realm bps-capacity", 0);
+    cli_print_uint(cs, (unsigned long)turn_params.bps_burst, "bps-burst, msec", 0);
+    cli_print_uint(cs, (unsigned long)turn_params.bps_queue, "bps-queue, msec", 0);
 
     myprintf(cs, "\n");
 
@@ -1058,12 +1141,24 @@ static int run_cli_input(struct cli_session *cs, const char *buf0, unsigned int
       } else if (!strcmp(cmd, "pu")) {
         print_sessions(cs, cmd + 2, 0, 1);
         type_cli_cursor(cs);
+      } else if (!strcmp(cmd, "pl")) {
+        print_latencies(cs);
+        type_cli_cursor(cs);
+      } else if (!strcmp(cmd, "pt")) {
+        print_loops(cs);
+        type_cli_cursor(cs);
+      } else if (!strcmp(cmd, "pb")) {
+        print_bandwidth(cs);
+        type_cli_cursor(cs);
       } else if (strstr(cmd, "ps") == cmd) {
         print_sessions(cs, cmd + 2, 1, 0);
         type_cli_cursor(cs);
       } else if (strstr(cmd, "cs ") == cmd) {
         cancel_session(cs, cmd + 3);
         type_cli_cursor(cs);
+      } else if (strstr(cmd, "ms ") == cmd) {
+        migrate_session(cs, cmd + 3);
+        type_cli_cursor(cs);
       } else if (strstr(cmd, "lr") == cmd) {
         log_reset(cs);
         type_cli_cursor(cs);
@@ -2306,6 +2401,8 @@ static bool https_print_session(ur_map_key_type key, ur_map_value_type value, vo
       return false;
     }
 
+    session_stats_load(tsi);
+
     if (csarg->user_pattern[0]) {
       if (!strstr((char *)tsi->username, csarg->user_pattern)) {
         return false;
@@ -3704,6 +3801,7 @@ static void handle_https(ioa_socket_handle s, ioa_network_buffer_handle nbh) {
               const turn_dbdriver_t *dbd = get_dbdriver();
               if (dbd && dbd->del_oauth_key) {
                 (*dbd->del_oauth_key)((const uint8_t *)del_kid);
+                oauth_cache_flush();
               }
             }
           }
@@ -3758,6 +3856,7 @@ static void handle_https(ioa_socket_handle s, ioa_network_buffer_handle nbh) {
                 if ((*dbd->set_oauth_key)(&key) < 0) {
                   msg = "Cannot insert oAuth key into the database";
                 } else {
+                  oauth_cache_flush();
                   add_kid = "";
                   add_ts = "0";
                   add_lt = "0";
@@ -53,6 +53,7 @@
 #include <event2/bufferevent.h>
 
 #include "dbdrivers/dbdriver.h"
+#include "latency_hist.h"
 #include "mainrelay.h"
 #include "userdb.h"
 
@@ -70,6 +71,7 @@ static realm_params_t *default_realm_params_ptr = NULL;
 static ur_string_map *realms = NULL;
 static TURN_MUTEX_DECLARE(o_to_realm_mutex);
 static ur_string_map *o_to_realm = NULL;
+static TURN_MUTEX_DECLARE(oauth_cache_mutex);
 static secrets_list_t realms_list;
 
 static char userdb_type_unknown[] = "Unknown";
@@ -112,24 +114,32 @@ void update_o_to_realm(ur_string_map *o_to_realm_new) {
   TURN_MUTEX_UNLOCK(&o_to_realm_mutex);
 }
 
+static void create_alloc_counters(realm_status_t *status) {
+  for (size_t i = 0; i < ALLOC_COUNTERS_SHARDS; ++i) {
+    status->alloc_counters[i] = ur_string_map_create(NULL);
+  }
+}
+
 void create_default_realm(void) {
   if (default_realm_params_ptr) {
     return;
   }
 
-  static realm_params_t _default_realm_params = {1,
-                                                 {"\0", /* name */
-                                                  {0, 0, 0}},
-                                                 {0, NULL}};
+  static realm_params_t _default_realm_params = {.is_default_realm = 1,
+                                                 .options = {.name = "\0", .perf_options = {0, 0, 0}},
+                                                 .status = {.total_current_allocs = 0,
+                                                            .alloc_counters = {NULL},
+                                                            .bps = {{0}, {0}}}};
 
   /* init everything: */
   TURN_MUTEX_INIT_RECURSIVE(&o_to_realm_mutex);
+  TURN_MUTEX_INIT(&oauth_cache_mutex);
   init_secrets_list(&realms_list);
   o_to_realm = ur_string_map_create(free);
   default_realm_params_ptr = &_default_realm_params;
-  realms = ur_string_map_create(NULL);
+  realms = ur_string_map_create_read_mostly(NULL);
   lock_realms();
-  default_realm_params_ptr->status.alloc_counters = ur_string_map_create(NULL);
+  create_alloc_counters(&(default_realm_params_ptr->status));
   unlock_realms();
 }
 
@@ -152,9 +162,13 @@ void set_default_realm_name(char *realm) {
 
 realm_params_t *get_realm(char *name) {
   if (name && name[0]) {
-    lock_realms();
     ur_string_map_value_type value = 0;
     ur_string_map_key_type key = (ur_string_map_key_type)name;
+    /* realms are only added, the known ones are found without the lock */
+    if (ur_string_map_get_unlocked(realms, key, &value)) {
+      return (realm_params_t *)value;
+    }
+    lock_realms();
     if (ur_string_map_get(realms, key, &value)) {
       unlock_realms();
       return (realm_params_t *)value;
@@ -166,9 +180,12 @@ realm_params_t *get_realm(char *name) {
         return default_realm_params_ptr;
       }
       STRCPY(ret->options.name, name);
+      atomic_init(&(ret->status.total_current_allocs), 0);
+      create_alloc_counters(&(ret->status));
+      memset(ret->status.bps, 0, sizeof(ret->status.bps));
+      /* published last, for the lookups without the lock */
       value = (ur_string_map_value_type)ret;
       ur_string_map_put(realms, key, value);
-      ret->status.alloc_counters = ur_string_map_create(NULL);
       add_to_secrets_list(&realms_list, name);
       unlock_realms();
       return ret;
@@ -322,7 +339,9 @@ static int get_auth_secrets(secrets_list_t *sl, uint8_t *realm) {
   }
 
   if (dbd && dbd->get_auth_secrets) {
+    const uint64_t db_start = turn_time_us();
     ret = (*dbd->get_auth_secrets)(sl, realm);
+    turn_latency_record(TURN_LATENCY_DB, db_start);
   }
 
   return ret;
@@ -369,14 +388,18 @@ static turn_time_t get_rest_api_timestamp(char *usname) {
   return ts;
 }
 
-static char *get_real_username(char *usname) {
+/* The user name of the quota, without the timestamp of the REST API user names */
+static void get_real_username(const char *usname, char *buf, size_t sz) {
+  size_t len = strlen(usname);
+
   if (usname[0] && turn_params.use_auth_secret_with_timestamp) {
-    char *col = strchr(usname, turn_params.rest_api_separator);
+    const char *col = strchr(usname, turn_params.rest_api_separator);
     if (col) {
       if (col == usname) {
         usname += 1;
+        len -= 1;
       } else {
-        char *ptr = usname;
+        const char *ptr = usname;
         int found_non_figure = 0;
         while (ptr < col) {
           if (!(ptr[0] >= '0' && ptr[0] <= '9')) {
@@ -386,18 +409,245 @@ static char *get_real_username(char *usname) {
           ++ptr;
         }
         if (!found_non_figure) {
+          len -= (size_t)(col + 1 - usname);
           usname = col + 1;
         } else {
-          *col = 0;
-          usname = strdup(usname);
-          *col = turn_params.rest_api_separator;
-          return usname;
+          len = (size_t)(col - usname);
         }
       }
     }
   }
 
-  return strdup(usname);
+  if (len >= sz) {
+    len = sz - 1;
+  }
+  memcpy(buf, usname, len);
+  buf[len] = 0;
+}
+
+//////////// oAuth cache //////////////
+
+/*
+ * Decoded oAuth tokens, by hash of the kid, server name and encoded
+ * token, and the keys converted from the database by kid, so that the
+ * clients re-sending the same token with each request do not cost a
+ * database lookup and a decryption every time. The entries do not
+ * outlive their token or key, and are kept OAUTH_CACHE_TIME at most so
+ * that the changes in the database are picked up.
+ */
+#define OAUTH_TOKEN_CACHE_SIZE (1024)
+#define OAUTH_KEY_CACHE_SIZE (64)
+#define OAUTH_CACHE_TIME (300)
+
+typedef struct _oauth_token_cache_entry {
+  uint8_t hash[SHA256SIZEBYTES];
+  turn_time_t expires;
+  /* end of the token lifetime, zero if unlimited */
+  turn_time_t token_expires;
+  /* end of the key cache entry the token was decoded with */
+  turn_time_t key_expires;
+  uint16_t key_length;
+  uint8_t mac_key[MAXSHASIZE];
+  char realm[STUN_MAX_REALM_SIZE + 1];
+} oauth_token_cache_entry;
+
+typedef struct _oauth_key_cache_entry {
+  char kid[OAUTH_KID_SIZE + 1];
+  turn_time_t expires;
+  oauth_key okey;
+  char realm[STUN_MAX_REALM_SIZE + 1];
+} oauth_key_cache_entry;
+
+static oauth_token_cache_entry oauth_token_cache[OAUTH_TOKEN_CACHE_SIZE];
+static oauth_key_cache_entry oauth_key_cache[OAUTH_KEY_CACHE_SIZE];
+
+static turn_time_t oauth_cache_expiration(turn_time_t now, turn_time_t limit) {
+  const turn_time_t expires = now + OAUTH_CACHE_TIME;
+  if (limit && turn_time_before(limit, expires)) {
+    return limit;
+  }
+  return expires;
+}
+
+static bool oauth_token_hash(const uint8_t *kid, const char *server_name, const uint8_t *token, size_t token_len,
+                             uint8_t *hash) {
+  EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+  if (!ctx) {
+    return false;
+  }
+  unsigned int hash_len = 0;
+  const bool ret = EVP_DigestInit_ex(ctx, EVP_sha256(), NULL) &&
+                   EVP_DigestUpdate(ctx, kid, strlen((const char *)kid) + 1) &&
+                   EVP_DigestUpdate(ctx, server_name, strlen(server_name) + 1) &&
+                   EVP_DigestUpdate(ctx, token, token_len) && EVP_DigestFinal_ex(ctx, hash, &hash_len);
+  EVP_MD_CTX_free(ctx);
+  return ret;
+}
+
+static oauth_token_cache_entry *oauth_token_cache_slot(const uint8_t *hash) {
+  uint32_t i = 0;
+  memcpy(&i, hash, sizeof(i));
+  return &oauth_token_cache[i % OAUTH_TOKEN_CACHE_SIZE];
+}
+
+static bool oauth_token_cache_get(const uint8_t *hash, oauth_token_cache_entry *dot) {
+  bool found = false;
+  const turn_time_t now = turn_time();
+
+  TURN_MUTEX_LOCK(&oauth_cache_mutex);
+  const oauth_token_cache_entry *entry = oauth_token_cache_slot(hash);
+  if (entry->expires && turn_time_before(now, entry->expires) && !memcmp(entry->hash, hash, SHA256SIZEBYTES)) {
+    *dot = *entry;
+    found = true;
+  }
+  TURN_MUTEX_UNLOCK(&oauth_cache_mutex);
+
+  return found;
+}
+
+static void oauth_token_cache_put(const uint8_t *hash, oauth_token_cache_entry *dot) {
+  memcpy(dot->hash, hash, SHA256SIZEBYTES);
+  dot->expires = oauth_cache_expiration(turn_time(), dot->token_expires);
+  /* A key that expires or is replaced takes its tokens with it */
+  if (dot->key_expires && turn_time_before(dot->key_expires, dot->expires)) {
+    dot->expires = dot->key_expires;
+  }
+
+  TURN_MUTEX_LOCK(&oauth_cache_mutex);
+  *oauth_token_cache_slot(hash) = *dot;
+  TURN_MUTEX_UNLOCK(&oauth_cache_mutex);
+}
+
+static oauth_key_cache_entry *oauth_key_cache_slot(const uint8_t *kid) {
+  uint32_t h = 2166136261U;
+  for (; *kid; ++kid) {
+    h = (h ^ *kid) * 16777619U;
+  }
+  return &oauth_key_cache[h % OAUTH_KEY_CACHE_SIZE];
+}
+
+static int get_oauth_key_by_kid(const turn_dbdriver_t *dbd, const uint8_t *kid, oauth_key *okey, char *realm,
+                                turn_time_t *cache_expires) {
+  const turn_time_t now = turn_time();
+  bool found = false;
+
+  TURN_MUTEX_LOCK(&oauth_cache_mutex);
+  const oauth_key_cache_entry *entry = oauth_key_cache_slot(kid);
+  if (entry->expires && turn_time_before(now, entry->expires) && !strcmp(entry->kid, (const char *)kid)) {
+    *okey = entry->okey;
+    memcpy(realm, entry->realm, sizeof(entry->realm));
+    *cache_expires = entry->expires;
+    found = true;
+  }
+  TURN_MUTEX_UNLOCK(&oauth_cache_mutex);
+
+  if (found) {
+    return 0;
+  }
+
+  oauth_key_data_raw rawKey;
+  memset(&rawKey, 0, sizeof(rawKey));
+
+  const uint64_t db_start = turn_time_us();
+  const int gres = (*(dbd->get_oauth_key))((uint8_t *)kid, &rawKey);
+  turn_latency_record(TURN_LATENCY_DB, db_start);
+  if (gres < 0) {
+    return -1;
+  }
+
+  if (!rawKey.kid[0]) {
+    return -1;
+  }
+
+  turn_time_t key_expires = 0;
+  if (rawKey.lifetime) {
+    key_expires = (turn_time_t)(rawKey.timestamp + rawKey.lifetime + OAUTH_TIME_DELTA);
+    if (!turn_time_before(now, key_expires)) {
+      return -1;
+    }
+  }
+
+  oauth_key_data okd;
+  memset(&okd, 0, sizeof(okd));
+
+  convert_oauth_key_data_raw(&rawKey, &okd);
+
+  char err_msg[1025] = "\0";
+  const size_t err_msg_size = sizeof(err_msg) - 1;
+
+  if (!convert_oauth_key_data(&okd, okey, err_msg, err_msg_size)) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "%s\n", err_msg);
+    return -1;
+  }
+
+  memcpy(realm, rawKey.realm, sizeof(rawKey.realm));
+
+  TURN_MUTEX_LOCK(&oauth_cache_mutex);
+  oauth_key_cache_entry *slot = oauth_key_cache_slot(kid);
+  STRCPY(slot->kid, kid);
+  slot->okey = *okey;
+  memcpy(slot->realm, rawKey.realm, sizeof(rawKey.realm));
+  slot->expires = oauth_cache_expiration(now, key_expires);
+  *cache_expires = slot->expires;
+  TURN_MUTEX_UNLOCK(&oauth_cache_mutex);
+
+  return 0;
+}
+
+static int decode_oauth_token_by_kid(const turn_dbdriver_t *dbd, const uint8_t *kid, const char *server_name,
+                                     const uint8_t *value, size_t len, oauth_token_cache_entry *dot) {
+  oauth_key okey;
+  memset(&okey, 0, sizeof(okey));
+
+  if (get_oauth_key_by_kid(dbd, kid, &okey, dot->realm, &(dot->key_expires)) < 0) {
+    return -1;
+  }
+
+  oauth_token token;
+  memset(&token, 0, sizeof(token));
+
+  encoded_oauth_token etoken;
+  memset(&etoken, 0, sizeof(etoken));
+
+  if (len > sizeof(etoken.token)) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Encoded oAuth token is too large\n");
+    return -1;
+  }
+  memcpy(etoken.token, value, len);
+  etoken.size = len;
+
+  if (!decode_oauth_token((const uint8_t *)server_name, &etoken, &okey, &token)) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Cannot decode oauth token\n");
+    return -1;
+  }
+
+  switch (token.enc_block.key_length) {
+  case SHA1SIZEBYTES:
+    break;
+  case SHA256SIZEBYTES:
+  case SHA384SIZEBYTES:
+  case SHA512SIZEBYTES:
+  default:
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Wrong size of the MAC key in oAuth token(3): %d\n",
+                  (int)token.enc_block.key_length);
+    return -1;
+  };
+
+  dot->key_length = token.enc_block.key_length;
+  memcpy(dot->mac_key, token.enc_block.mac_key, sizeof(dot->mac_key));
+  if (token.enc_block.lifetime) {
+    const turn_time_t ts = (turn_time_t)(token.enc_block.timestamp >> 16);
+    dot->token_expires = ts + (turn_time_t)(token.enc_block.lifetime) + OAUTH_TIME_DELTA;
+  }
+
+  return 0;
+}
+
+void oauth_cache_flush(void) {
+  TURN_MUTEX_LOCK(&oauth_cache_mutex);
+  memset(oauth_token_cache, 0, sizeof(oauth_token_cache));
+  memset(oauth_key_cache, 0, sizeof(oauth_key_cache));
+  TURN_MUTEX_UNLOCK(&oauth_cache_mutex);
 }
 
 /*
@@ -428,53 +678,6 @@ int get_user_key(int in_oauth, int *out_oauth, int *max_session_time, uint8_t *u
 
         if (dbd && dbd->get_oauth_key) {
 
-          oauth_key_data_raw rawKey;
-          memset(&rawKey, 0, sizeof(rawKey));
-
-          const int gres = (*(dbd->get_oauth_key))(usname, &rawKey);
-          if (gres < 0) {
-            return ret;
-          }
-
-          if (!rawKey.kid[0]) {
-            return ret;
-          }
-
-          if (rawKey.lifetime) {
-            if (!turn_time_before(turn_time(), (turn_time_t)(rawKey.timestamp + rawKey.lifetime + OAUTH_TIME_DELTA))) {
-              return ret;
-            }
-          }
-
-          oauth_key_data okd;
-          memset(&okd, 0, sizeof(okd));
-
-          convert_oauth_key_data_raw(&rawKey, &okd);
-
-          char err_msg[1025] = "\0";
-          const size_t err_msg_size = sizeof(err_msg) - 1;
-
-          oauth_key okey;
-          memset(&okey, 0, sizeof(okey));
-
-          if (!convert_oauth_key_data(&okd, &okey, err_msg, err_msg_size)) {
-            TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "%s\n", err_msg);
-            return -1;
-          }
-
-          oauth_token dot;
-          memset((&dot), 0, sizeof(dot));
-
-          encoded_oauth_token etoken;
-          memset(&etoken, 0, sizeof(etoken));
-
-          if ((size_t)len > sizeof(etoken.token)) {
-            TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Encoded oAuth token is too large\n");
-            return -1;
-          }
-          memcpy(etoken.token, value, (size_t)len);
-          etoken.size = (size_t)len;
-
           const char *server_name = (char *)turn_params.oauth_server_name;
           if (!(server_name && server_name[0])) {
             server_name = (char *)realm;
@@ -484,46 +687,41 @@ int get_user_key(int in_oauth, int *out_oauth, int *max_session_time, uint8_t *u
             }
           }
 
-          if (!decode_oauth_token((const uint8_t *)server_name, &etoken, &okey, &dot)) {
-            TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Cannot decode oauth token\n");
-            return -1;
-          }
+          oauth_token_cache_entry dot;
+          memset(&dot, 0, sizeof(dot));
 
-          switch (dot.enc_block.key_length) {
-          case SHA1SIZEBYTES:
-            break;
-          case SHA256SIZEBYTES:
-          case SHA384SIZEBYTES:
-          case SHA512SIZEBYTES:
-          default:
-            TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Wrong size of the MAC key in oAuth token(3): %d\n",
-                          (int)dot.enc_block.key_length);
-            return -1;
-          };
+          uint8_t token_hash[SHA256SIZEBYTES];
+          const bool hashed = oauth_token_hash(usname, server_name, value, (size_t)len, token_hash);
+
+          if (!hashed || !oauth_token_cache_get(token_hash, &dot)) {
+            if (decode_oauth_token_by_kid(dbd, usname, server_name, value, (size_t)len, &dot) < 0) {
+              return -1;
+            }
+            if (hashed) {
+              oauth_token_cache_put(token_hash, &dot);
+            }
+          }
 
           password_t pwdtmp;
           if (stun_check_message_integrity_by_key_str(TURN_CREDENTIALS_LONG_TERM, ioa_network_buffer_data(nbh),
-                                                      ioa_network_buffer_get_size(nbh), dot.enc_block.mac_key, pwdtmp,
+                                                      ioa_network_buffer_get_size(nbh), dot.mac_key, pwdtmp,
                                                       SHATYPE_DEFAULT) > 0) {
 
-            const turn_time_t lifetime = (turn_time_t)(dot.enc_block.lifetime);
-            if (lifetime) {
-              const turn_time_t ts = (turn_time_t)(dot.enc_block.timestamp >> 16);
-              const turn_time_t to = ts + lifetime + OAUTH_TIME_DELTA;
+            if (dot.token_expires) {
               const turn_time_t ct = turn_time();
-              if (!turn_time_before(ct, to)) {
+              if (!turn_time_before(ct, dot.token_expires)) {
                 TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "oAuth token is too old\n");
                 return -1;
               }
               if (max_session_time) {
-                *max_session_time = to - ct;
+                *max_session_time = dot.token_expires - ct;
               }
             }
 
-            memcpy(key, dot.enc_block.mac_key, dot.enc_block.key_length);
+            memcpy(key, dot.mac_key, dot.key_length);
 
-            if (rawKey.realm[0]) {
-              memcpy(realm, rawKey.realm, sizeof(rawKey.realm));
+            if (dot.realm[0]) {
+              memcpy(realm, dot.realm, sizeof(dot.realm));
             }
 
             ret = 0;
@@ -632,7 +830,9 @@ int get_user_key(int in_oauth, int *out_oauth, int *max_session_time, uint8_t *u
 
   const turn_dbdriver_t *dbd = get_dbdriver();
   if (dbd && dbd->get_user_key) {
+    const uint64_t db_start = turn_time_us();
     ret = (*(dbd->get_user_key))(usname, realm, key);
+    turn_latency_record(TURN_LATENCY_DB, db_start);
   }
 
   return ret;
@@ -655,41 +855,66 @@ uint8_t *start_user_check(turnserver_id id, turn_credential_type ct, int in_oaut
   memcpy(&(am.in_buffer), in_buffer, sizeof(ioa_net_data));
   in_buffer->nbh = NULL;
   am.ctxkey = ctxkey;
+  am.start_us = turn_time_us();
 
   send_auth_message_to_auth_server(&am);
 
   return NULL;
 }
 
+static ur_string_map *get_alloc_counters(realm_status_t *status, const char *username) {
+  return status->alloc_counters[kh_str_hash_func(username) % ALLOC_COUNTERS_SHARDS];
+}
+
+/* Takes one from the total allocations of the realm, unless over the quota (0 - no quota) */
+static bool reserve_total_allocation(realm_status_t *status, vint quota) {
+  int current = atomic_load_explicit(&(status->total_current_allocs), memory_order_relaxed);
+  do {
+    if (quota && (current >= quota)) {
+      return false;
+    }
+  } while (!atomic_compare_exchange_weak_explicit(&(status->total_current_allocs), &current, current + 1,
+                                                  memory_order_relaxed, memory_order_relaxed));
+  return true;
+}
+
+static void release_total_allocation(realm_status_t *status) {
+  int current = atomic_load_explicit(&(status->total_current_allocs), memory_order_relaxed);
+  while (current && !atomic_compare_exchange_weak_explicit(&(status->total_current_allocs), &current, current - 1,
+                                                           memory_order_relaxed, memory_order_relaxed)) {
+  }
+}
+
 int check_new_allocation_quota(uint8_t *user, int oauth, uint8_t *realm) {
   int ret = 0;
   if (user || oauth) {
-    uint8_t *username = oauth ? (uint8_t *)strdup("") : (uint8_t *)get_real_username((char *)user);
+    char username[STUN_MAX_USERNAME_SIZE + 1] = "";
+    if (!oauth) {
+      get_real_username((const char *)user, username, sizeof(username));
+    }
     realm_params_t *rp = get_realm((char *)realm);
-    ur_string_map_lock(rp->status.alloc_counters);
-    if (rp->options.perf_options.total_quota &&
-        (rp->status.total_current_allocs >= rp->options.perf_options.total_quota)) {
+    if (!reserve_total_allocation(&(rp->status), rp->options.perf_options.total_quota)) {
       ret = -1;
     } else if (username[0]) {
+      ur_string_map *counters = get_alloc_counters(&(rp->status), username);
+      ur_string_map_lock(counters);
       ur_string_map_value_type value = 0;
-      if (!ur_string_map_get(rp->status.alloc_counters, (ur_string_map_key_type)username, &value)) {
+      if (!ur_string_map_get(counters, (ur_string_map_key_type)username, &value)) {
         value = (ur_string_map_value_type)1;
-        ur_string_map_put(rp->status.alloc_counters, (ur_string_map_key_type)username, value);
-        ++(rp->status.total_current_allocs);
+        ur_string_map_put(counters, (ur_string_map_key_type)username, value);
       } else {
         if ((rp->options.perf_options.user_quota) && ((size_t)value >= (size_t)(rp->options.perf_options.user_quota))) {
           ret = -1;
         } else {
           value = (ur_string_map_value_type)(((size_t)value) + 1);
-          ur_string_map_put(rp->status.alloc_counters, (ur_string_map_key_type)username, value);
-          ++(rp->status.total_current_allocs);
+          ur_string_map_put(counters, (ur_string_map_key_type)username, value);
         }
       }
-    } else {
-      ++(rp->status.total_current_allocs);
+      ur_string_map_unlock(counters);
+      if (ret < 0) {
+        release_total_allocation(&(rp->status));
+      }
     }
-    free(username);
-    ur_string_map_unlock(rp->status.alloc_counters);
   }
 
   return ret;
@@ -697,26 +922,27 @@ int check_new_allocation_quota(uint8_t *user, int oauth, uint8_t *realm) {
 
 void release_allocation_quota(uint8_t *user, int oauth, uint8_t *realm) {
   if (user) {
-    uint8_t *username = oauth ? (uint8_t *)strdup("") : (uint8_t *)get_real_username((char *)user);
+    char username[STUN_MAX_USERNAME_SIZE + 1] = "";
+    if (!oauth) {
+      get_real_username((const char *)user, username, sizeof(username));
+    }
     realm_params_t *rp = get_realm((char *)realm);
-    ur_string_map_lock(rp->status.alloc_counters);
     if (username[0]) {
+      ur_string_map *counters = get_alloc_counters(&(rp->status), username);
+      ur_string_map_lock(counters);
       ur_string_map_value_type value = 0;
-      ur_string_map_get(rp->status.alloc_counters, (ur_string_map_key_type)username, &value);
+      ur_string_map_get(counters, (ur_string_map_key_type)username, &value);
       if (value) {
         value = (ur_string_map_value_type)(((size_t)value) - 1);
         if (value == 0) {
-          ur_string_map_del(rp->status.alloc_counters, (ur_string_map_key_type)username);
+          ur_string_map_del(counters, (ur_string_map_key_type)username);
         } else {
-          ur_string_map_put(rp->status.alloc_counters, (ur_string_map_key_type)username, value);
+          ur_string_map_put(counters, (ur_string_map_key_type)username, value);
         }
       }
+      ur_string_map_unlock(counters);
     }
-    if (rp->status.total_current_allocs) {
-      --(rp->status.total_current_allocs);
-    }
-    ur_string_map_unlock(rp->status.alloc_counters);
-    free(username);
+    release_total_allocation(&(rp->status));
   }
 }
 
@@ -45,6 +45,7 @@
 #include "ns_turn_utils.h"
 
 #include "apputils.h"
+#include "token_bucket.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -58,10 +59,16 @@ typedef struct _realm_status_t realm_status_t;
 struct _realm_params_t;
 typedef struct _realm_params_t realm_params_t;
 
+/* Shards of the allocation counters of the users of a realm, by user name hash */
+#define ALLOC_COUNTERS_SHARDS (16)
+
 struct _realm_status_t {
 
-  vint total_current_allocs;
-  ur_string_map *alloc_counters;
+  atomic_int total_current_allocs;
+  /* each shard has a lock of its own */
+  ur_string_map *alloc_counters[ALLOC_COUNTERS_SHARDS];
+  /* bandwidth of the realm sessions, read and write */
+  shared_token_bucket bps[2];
 };
 
 struct _realm_params_t {
@@ -93,6 +100,8 @@ struct auth_message {
   ioa_net_data in_buffer;
   uint64_t ctxkey;
   int success;
+  /* for the auth round trip latency */
+  uint64_t start_us;
 };
 
 enum _TURN_USERDB_TYPE {
@@ -181,6 +190,7 @@ void add_to_secrets_list(secrets_list_t *sl, const char *elem);
 
 /////////// USER DB CHECK //////////////////
 
+void oauth_cache_flush(void);
 int get_user_key(int in_oauth, int *out_oauth, int *max_session_time, uint8_t *uname, uint8_t *realm, hmackey_t key,
                  ioa_network_buffer_handle nbh);
 uint8_t *start_user_check(turnserver_id id, turn_credential_type ct, int in_oauth, int *out_oauth, uint8_t *usname,
@@ -0,0 +1,461 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "xdp_socket.h"
+
+#include "ns_turn_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(TURN_NO_XDP)
+
+#include "bpf/turn_xsk_maps.h"
+
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+#include <linux/if_ether.h>
+#include <linux/if_link.h>
+#include <linux/ip.h>
+#include <linux/udp.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <xdp/xsk.h>
+
+#define XDP_SOCKET_FRAMES (4096)
+#define XDP_SOCKET_FRAME_SIZE (XSK_UMEM__DEFAULT_FRAME_SIZE)
+#define XDP_SOCKET_RX_BATCH (64)
+#define XDP_SOCKET_MAX_LISTENERS (64)
+
+typedef struct _xdp_listener {
+  ioa_addr addr;
+  xdp_socket_input_handler handler;
+  void *arg;
+} xdp_listener;
+
+struct _xdp_socket {
+  struct _xdp_socket *next;
+  uint32_t queue_id;
+  ioa_engine_handle e;
+  void *umem_area;
+  struct xsk_umem *umem;
+  struct xsk_ring_prod fq;
+  struct xsk_ring_cons cq;
+  struct xsk_ring_cons rx;
+  struct xsk_socket *xsk;
+  struct event *ev;
+  /* consumed frames not yet back in the fill ring */
+  uint64_t pending_frames[XDP_SOCKET_FRAMES];
+  uint32_t pending_number;
+  /* filled by the setup thread before the count is published */
+  xdp_listener listeners[XDP_SOCKET_MAX_LISTENERS];
+  atomic_size_t listeners_number;
+};
+
+static char xdp_ifname[IF_NAMESIZE + 1] = "";
+static int xdp_ifindex = 0;
+static uint32_t xdp_flags = 0;
+static struct bpf_object *xdp_obj = NULL;
+static int xdp_xsk_map_fd = -1;
+static int xdp_endpoints_map_fd = -1;
+/* endpoints are steered only once every engine has its listeners */
+static struct turn_xsk_endpoint xdp_endpoints[TURN_XSK_MAX_ENDPOINTS];
+static size_t xdp_endpoints_number = 0;
+
+int xdp_sockets_init(const char *ifname, const char *object_file) {
+  if (!ifname || !ifname[0]) {
+    return -1;
+  }
+
+  if (!object_file || !object_file[0]) {
+    object_file = DEFAULT_XDP_SOCKETS_OBJECT;
+  }
+
+  xdp_ifindex = (int)if_nametoindex(ifname);
+  if (!xdp_ifindex) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "AF_XDP: cannot find network interface %s\n", ifname);
+    return -1;
+  }
+  STRCPY(xdp_ifname, ifname);
+
+  xdp_obj = bpf_object__open_file(object_file, NULL);
+  if (!xdp_obj) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "AF_XDP: cannot open BPF object %s\n", object_file);
+    return -1;
+  }
+
+  if (bpf_object__load(xdp_obj) < 0) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "AF_XDP: cannot load BPF object %s\n", object_file);
+    goto err;
+  }
+
+  struct bpf_program *prog = bpf_object__find_program_by_name(xdp_obj, TURN_XSK_PROG_NAME);
+  if (!prog) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "AF_XDP: program %s not found in %s\n", TURN_XSK_PROG_NAME, object_file);
+    goto err;
+  }
+
+  xdp_xsk_map_fd = bpf_object__find_map_fd_by_name(xdp_obj, TURN_XSK_MAP_NAME);
+  xdp_endpoints_map_fd = bpf_object__find_map_fd_by_name(xdp_obj, TURN_XSK_ENDPOINTS_MAP_NAME);
+  if (xdp_xsk_map_fd < 0 || xdp_endpoints_map_fd < 0) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "AF_XDP: maps not found in %s\n", object_file);
+    goto err;
+  }
+
+  /* Native (driver) mode first, then the generic mode that works on any device (veth etc) */
+  xdp_flags = XDP_FLAGS_UPDATE_IF_NOEXIST | XDP_FLAGS_DRV_MODE;
+  if (bpf_xdp_attach(xdp_ifindex, bpf_program__fd(prog), xdp_flags, NULL) < 0) {
+    xdp_flags = XDP_FLAGS_UPDATE_IF_NOEXIST | XDP_FLAGS_SKB_MODE;
+    if (bpf_xdp_attach(xdp_ifindex, bpf_program__fd(prog), xdp_flags, NULL) < 0) {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "AF_XDP: cannot attach XDP program to %s\n", ifname);
+      goto err;
+    }
+  }
+
+  TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "AF_XDP: XDP program attached to %s (%s mode)\n", ifname,
+                (xdp_flags & XDP_FLAGS_DRV_MODE) ? "native" : "generic");
+
+  return 0;
+
+err:
+  bpf_object__close(xdp_obj);
+  xdp_obj = NULL;
+  xdp_xsk_map_fd = -1;
+  xdp_endpoints_map_fd = -1;
+  return -1;
+}
+
+void xdp_sockets_shutdown(void) {
+  if (xdp_obj) {
+    bpf_xdp_detach(xdp_ifindex, xdp_flags & ~XDP_FLAGS_UPDATE_IF_NOEXIST, NULL);
+    bpf_object__close(xdp_obj);
+    xdp_obj = NULL;
+    xdp_xsk_map_fd = -1;
+    xdp_endpoints_map_fd = -1;
+  }
+}
+
+bool xdp_sockets_enabled(void) { return (xdp_xsk_map_fd >= 0) && (xdp_endpoints_map_fd >= 0); }
+
+static uint32_t xdp_csum_add(uint32_t sum, const uint8_t *data, size_t len) {
+  for (; len > 1; data += 2, len -= 2) {
+    sum += ((uint32_t)data[0] << 8) | data[1];
+  }
+  if (len) {
+    sum += (uint32_t)data[0] << 8;
+  }
+  return sum;
+}
+
+static uint16_t xdp_csum_fold(uint32_t sum) {
+  while (sum >> 16) {
+    sum = (sum & 0xFFFF) + (sum >> 16);
+  }
+  return (uint16_t)sum;
+}
+
+/*
+ * The steering program passes only unfragmented IPv4 UDP with consistent
+ * lengths; the checks are repeated here with the checksums, which the
+ * kernel stack would verify before delivering the datagram.
+ */
+static bool xdp_frame_valid(const uint8_t *frame, size_t len) {
+  if (len < sizeof(struct ethhdr) + sizeof(struct iphdr) + sizeof(struct udphdr)) {
+    return false;
+  }
+
+  const uint8_t *l3 = frame + sizeof(struct ethhdr);
+  const struct iphdr *ip = (const struct iphdr *)l3;
+  const struct udphdr *udp = (const struct udphdr *)(l3 + sizeof(struct iphdr));
+  const size_t tot_len = ntohs(ip->tot_len);
+  const size_t udp_len = ntohs(udp->len);
+
+  if ((ip->version != 4) || (ip->ihl != 5) || (ip->protocol != IPPROTO_UDP) || (ip->frag_off & htons(0x3FFF)) ||
+      (tot_len < sizeof(struct iphdr) + sizeof(struct udphdr)) || (tot_len > len - sizeof(struct ethhdr)) ||
+      (udp_len < sizeof(struct udphdr)) || (udp_len > tot_len - sizeof(struct iphdr))) {
+    return false;
+  }
+
+  if (xdp_csum_fold(xdp_csum_add(0, l3, sizeof(struct iphdr))) != 0xFFFF) {
+    return false;
+  }
+
+  /* A zero UDP checksum means none over IPv4 */
+  if (udp->check) {
+    uint32_t sum = xdp_csum_add(0, (const uint8_t *)&(ip->saddr), 8);
+    sum += IPPROTO_UDP + (uint32_t)udp_len;
+    sum = xdp_csum_add(sum, (const uint8_t *)udp, udp_len);
+    if (xdp_csum_fold(sum) != 0xFFFF) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void xdp_socket_dispatch(struct _xdp_socket *xs, const uint8_t *frame, size_t len) {
+  if (!xdp_frame_valid(frame, len)) {
+    return;
+  }
+
+  const struct iphdr *ip = (const struct iphdr *)(frame + sizeof(struct ethhdr));
+  const struct udphdr *udp = (const struct udphdr *)(frame + sizeof(struct ethhdr) + sizeof(struct iphdr));
+  const size_t udp_len = ntohs(udp->len);
+
+  ioa_addr dst_addr;
+  memset(&dst_addr, 0, sizeof(dst_addr));
+  dst_addr.s4.sin_family = AF_INET;
+  dst_addr.s4.sin_addr.s_addr = ip->daddr;
+  dst_addr.s4.sin_port = udp->dest;
+
+  const size_t listeners_number = atomic_load_explicit(&(xs->listeners_number), memory_order_acquire);
+  for (size_t i = 0; i < listeners_number; ++i) {
+    xdp_listener *l = &(xs->listeners[i]);
+    if (addr_eq(&(l->addr), &dst_addr)) {
+      ioa_addr src_addr;
+      memset(&src_addr, 0, sizeof(src_addr));
+      src_addr.s4.sin_family = AF_INET;
+      src_addr.s4.sin_addr.s_addr = ip->saddr;
+      src_addr.s4.sin_port = udp->source;
+      l->handler(l->arg, &src_addr, (int)ip->ttl, (int)ip->tos, (const uint8_t *)(udp + 1),
+                 udp_len - sizeof(struct udphdr));
+      return;
+    }
+  }
+}
+
+/*
+ * Gives the pending frames back to the kernel, as many as the fill ring
+ * takes now. What is left waits for the next batch: a full fill ring means
+ * the kernel has frames to receive into, so the next batch will come.
+ */
+static void xdp_socket_refill(struct _xdp_socket *xs) {
+  uint32_t n = xsk_prod_nb_free(&(xs->fq), xs->pending_number);
+  if (n > xs->pending_number) {
+    n = xs->pending_number;
+  }
+  if (!n) {
+    return;
+  }
+
+  uint32_t idx_fq = 0;
+  if (xsk_ring_prod__reserve(&(xs->fq), n, &idx_fq) != n) {
+    return;
+  }
+  for (uint32_t i = 0; i < n; ++i) {
+    *xsk_ring_prod__fill_addr(&(xs->fq), idx_fq++) = xs->pending_frames[--(xs->pending_number)];
+  }
+  xsk_ring_prod__submit(&(xs->fq), n);
+}
+
+static void xdp_socket_input_handler_ev(evutil_socket_t fd, short what, void *arg) {
+  UNUSED_ARG(fd);
+
+  struct _xdp_socket *xs = (struct _xdp_socket *)arg;
+  if (!xs || !(what & EV_READ)) {
+    return;
+  }
+
+  uint32_t idx_rx = 0;
+  const uint32_t rcvd = xsk_ring_cons__peek(&(xs->rx), XDP_SOCKET_RX_BATCH, &idx_rx);
+
+  for (uint32_t i = 0; i < rcvd; ++i) {
+    const struct xdp_desc *desc = xsk_ring_cons__rx_desc(&(xs->rx), idx_rx++);
+    xdp_socket_dispatch(xs, (const uint8_t *)xsk_umem__get_data(xs->umem_area, desc->addr), desc->len);
+    /* The datagram has been copied out by the listener, the frame goes back to the kernel */
+    xs->pending_frames[xs->pending_number++] = xsk_umem__extract_addr(desc->addr);
+  }
+
+  if (rcvd) {
+    xsk_ring_cons__release(&(xs->rx), rcvd);
+  }
+
+  xdp_socket_refill(xs);
+}
+
+int xdp_socket_open(ioa_engine_handle e, uint32_t queue_id) {
+  if (!e || !xdp_sockets_enabled() || queue_id >= TURN_XSK_MAX_QUEUES) {
+    return -1;
+  }
+
+  struct _xdp_socket *xs = (struct _xdp_socket *)calloc(1, sizeof(struct _xdp_socket));
+  if (!xs) {
+    return -1;
+  }
+  xs->e = e;
+  xs->queue_id = queue_id;
+
+  const size_t umem_size = (size_t)XDP_SOCKET_FRAMES * XDP_SOCKET_FRAME_SIZE;
+  if (posix_memalign(&(xs->umem_area), (size_t)getpagesize(), umem_size)) {
+    xs->umem_area = NULL;
+    goto err;
+  }
+
+  if (xsk_umem__create(&(xs->umem), xs->umem_area, umem_size, &(xs->fq), &(xs->cq), NULL) < 0) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "AF_XDP: cannot create UMEM for queue %u\n", (unsigned)queue_id);
+    goto err;
+  }
+
+  struct xsk_socket_config cfg;
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.rx_size = XSK_RING_CONS__DEFAULT_NUM_DESCS;
+  cfg.libxdp_flags = XSK_LIBXDP_FLAGS__INHIBIT_PROG_LOAD;
+  cfg.xdp_flags = xdp_flags & ~XDP_FLAGS_UPDATE_IF_NOEXIST;
+  cfg.bind_flags = (xdp_flags & XDP_FLAGS_SKB_MODE) ? XDP_COPY : 0;
+
+  if (xsk_socket__create(&(xs->xsk), xdp_ifname, queue_id, xs->umem, &(xs->rx), NULL, &cfg) < 0) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "AF_XDP: cannot create socket for %s queue %u\n", xdp_ifname,
+                  (unsigned)queue_id);
+    goto err;
+  }
+
+  {
+    uint32_t idx = 0;
+    const uint32_t frames = XSK_RING_PROD__DEFAULT_NUM_DESCS;
+    if (xsk_ring_prod__reserve(&(xs->fq), frames, &idx) != frames) {
+      goto err;
+    }
+    for (uint32_t i = 0; i < frames; ++i) {
+      *xsk_ring_prod__fill_addr(&(xs->fq), idx++) = (uint64_t)i * XDP_SOCKET_FRAME_SIZE;
+    }
+    xsk_ring_prod__submit(&(xs->fq), frames);
+  }
+
+  const int xsk_fd = xsk_socket__fd(xs->xsk);
+  if (bpf_map_update_elem(xdp_xsk_map_fd, &queue_id, &xsk_fd, BPF_ANY) < 0) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "AF_XDP: cannot register socket for queue %u\n", (unsigned)queue_id);
+    goto err;
+  }
+
+  xs->ev = event_new(e->event_base, xsk_fd, EV_READ | EV_PERSIST, xdp_socket_input_handler_ev, xs);
+  event_add(xs->ev, NULL);
+
+  xs->next = e->xsks;
+  e->xsks = xs;
+
+  TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "AF_XDP: socket bound to %s queue %u\n", xdp_ifname, (unsigned)queue_id);
+
+  return 0;
+
+err:
+  if (xs->xsk) {
+    xsk_socket__delete(xs->xsk);
+  }
+  if (xs->umem) {
+    xsk_umem__delete(xs->umem);
+  }
+  free(xs->umem_area);
+  free(xs);
+  return -1;
+}
+
+void xdp_socket_add_listener(ioa_engine_handle e, const ioa_addr *addr, xdp_socket_input_handler handler, void *arg) {
+  if (!e || !e->xsks || !addr || !handler || (addr->ss.sa_family != AF_INET)) {
+    return;
+  }
+
+  for (struct _xdp_socket *xs = e->xsks; xs; xs = xs->next) {
+    const size_t n = atomic_load_explicit(&(xs->listeners_number), memory_order_relaxed);
+    if (n >= XDP_SOCKET_MAX_LISTENERS) {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_WARNING, "AF_XDP: too many listeners on queue %u\n", (unsigned)xs->queue_id);
+      continue;
+    }
+    addr_cpy(&(xs->listeners[n].addr), addr);
+    xs->listeners[n].handler = handler;
+    xs->listeners[n].arg = arg;
+    atomic_store_explicit(&(xs->listeners_number), n + 1, memory_order_release);
+  }
+
+  struct turn_xsk_endpoint ep;
+  memset(&ep, 0, sizeof(ep));
+  ep.ip = addr->s4.sin_addr.s_addr;
+  ep.port = addr->s4.sin_port;
+  for (size_t i = 0; i < xdp_endpoints_number; ++i) {
+    if (!memcmp(&(xdp_endpoints[i]), &ep, sizeof(ep))) {
+      return;
+    }
+  }
+  if (xdp_endpoints_number < TURN_XSK_MAX_ENDPOINTS) {
+    xdp_endpoints[xdp_endpoints_number++] = ep;
+  }
+}
+
+void xdp_sockets_start(void) {
+  if (!xdp_sockets_enabled()) {
+    return;
+  }
+
+  const uint8_t on = 1;
+  for (size_t i = 0; i < xdp_endpoints_number; ++i) {
+    if (bpf_map_update_elem(xdp_endpoints_map_fd, &(xdp_endpoints[i]), &on, BPF_ANY) < 0) {
+      TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "AF_XDP: cannot steer UDP endpoint\n");
+    }
+  }
+
+  TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "AF_XDP: %lu UDP endpoint(s) steered to user space\n",
+                (unsigned long)xdp_endpoints_number);
+}
+
+#else /* TURN_NO_XDP */
+
+int xdp_sockets_init(const char *ifname, const char *object_file) {
+  UNUSED_ARG(object_file);
+  if (ifname && ifname[0]) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_WARNING, "AF_XDP is not supported in this build (no libxdp)\n");
+  }
+  return -1;
+}
+
+void xdp_sockets_shutdown(void) {}
+
+bool xdp_sockets_enabled(void) { return false; }
+
+int xdp_socket_open(ioa_engine_handle e, uint32_t queue_id) {
+  UNUSED_ARG(e);
+  UNUSED_ARG(queue_id);
+  return -1;
+}
+
+void xdp_socket_add_listener(ioa_engine_handle e, const ioa_addr *addr, xdp_socket_input_handler handler, void *arg) {
+  UNUSED_ARG(e);
+  UNUSED_ARG(addr);
+  UNUSED_ARG(handler);
+  UNUSED_ARG(arg);
+}
+
+void xdp_sockets_start(void) {}
+
+#endif /* TURN_NO_XDP */
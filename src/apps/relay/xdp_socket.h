@@ -0,0 +1,98 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * https://opensource.org/license/bsd-3-clause
+ *
+ * Copyright (C) 2026 Coturn project
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * AF_XDP receive path for the IPv4 UDP client listeners. Receive only:
+ * there is no AF_XDP transmit, the replies go out through the listener
+ * sockets, and the relay (peer) sockets are not bound to AF_XDP.
+ */
+
+#ifndef __XDP_SOCKET__
+#define __XDP_SOCKET__
+
+#include "ns_ioalib_impl.h"
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//////////////////////////////////////////////////
+
+#define DEFAULT_XDP_SOCKETS_OBJECT "turn_xsk.bpf.o"
+
+/*
+ * Client datagram received on an AF_XDP socket for the listener endpoint
+ * registered with xdp_socket_add_listener().
+ */
+typedef void (*xdp_socket_input_handler)(void *arg, const ioa_addr *src_addr, int ttl, int tos,
+                                         const uint8_t *payload, size_t len);
+
+/*
+ * Loads the steering program from object_file and attaches it to the
+ * network interface ifname. Until (and unless) this succeeds, the UDP
+ * listeners receive through their regular sockets only.
+ */
+int xdp_sockets_init(const char *ifname, const char *object_file);
+
+void xdp_sockets_shutdown(void);
+
+bool xdp_sockets_enabled(void);
+
+/*
+ * Binds an AF_XDP socket (with its own UMEM) to the NIC queue queue_id,
+ * and serves it from the event loop of the engine e.
+ */
+int xdp_socket_open(ioa_engine_handle e, uint32_t queue_id);
+
+/*
+ * Makes the AF_XDP sockets of the engine e deliver the datagrams sent
+ * to the listener address addr to the handler.
+ */
+void xdp_socket_add_listener(ioa_engine_handle e, const ioa_addr *addr, xdp_socket_input_handler handler, void *arg);
+
+/*
+ * Starts steering the datagrams of all the registered listener addresses
+ * to the AF_XDP sockets.
+ */
+void xdp_sockets_start(void);
+
+//////////////////////////////////////////////////
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __XDP_SOCKET__ */
@@ -203,6 +203,112 @@ err:
 
 static SHATYPE shatype = SHATYPE_SHA1;
 
+/*
+ * Runs a test vector through the indexed checks: fingerprint, integrity
+ * and a negative fingerprint after the message is altered.
+ */
+static int check_index(const char *name, const unsigned char *msg, size_t len, turn_credential_type ct,
+                       hmackey_t key, password_t pwd) {
+  uint8_t buf[1024];
+  stun_attr_index attrs;
+
+  printf("RFC 5769 %s indexed fingerprint and integrity test result: ", name);
+
+  if (len > sizeof(buf)) {
+    printf("failure on message size\n");
+    return -1;
+  }
+  memcpy(buf, msg, len);
+
+  if (!stun_attr_index_build(buf, len, &attrs)) {
+    printf("failure on message structure check\n");
+    return -1;
+  }
+
+  if (!stun_is_command_message_full_check_index(&attrs, 1, NULL)) {
+    printf("failure on fingerprint check\n");
+    return -1;
+  }
+
+  const int res = stun_check_message_integrity_by_index_str(ct, buf, &attrs, key, pwd, shatype);
+  if (res == 0) {
+    printf("failure on integrity check\n");
+    return -1;
+  } else if (res < 0) {
+    printf("failure on message structure check\n");
+    return -1;
+  }
+
+  buf[27] = 23;
+  if (stun_is_command_message_full_check_index(&attrs, 1, NULL)) {
+    printf("failure on NEGATIVE fingerprint check\n");
+    return -1;
+  }
+
+  printf("success\n");
+  return 0;
+}
+
+/*
+ * A message with more attributes than the index holds: the integrity and
+ * the fingerprint are found by the scan past the last indexed attribute.
+ */
+static int check_index_truncated(void) {
+  uint8_t buf[1024];
+  size_t len = 0;
+  hmackey_t key;
+  password_t pwd;
+  stun_attr_index attrs;
+
+  memset(key, 0, sizeof(key));
+  strcpy((char *)pwd, "VOkJxbRl1RmTxUk/WvJxBt");
+
+  printf("RFC 5769 truncated index fingerprint and integrity test result: ");
+
+  stun_init_request_str(STUN_METHOD_BINDING, buf, &len);
+  for (int i = 0; i < STUN_ATTR_INDEX_SIZE + 8; ++i) {
+    if (!stun_attr_add_str(buf, &len, STUN_ATTRIBUTE_SOFTWARE, (const uint8_t *)"test", 4)) {
+      printf("failure on message encoding\n");
+      return -1;
+    }
+  }
+  if (!stun_attr_add_integrity_str(TURN_CREDENTIALS_SHORT_TERM, buf, &len, key, pwd, shatype) ||
+      !stun_attr_add_fingerprint_str(buf, &len)) {
+    printf("failure on message encoding\n");
+    return -1;
+  }
+
+  if (!stun_attr_index_build(buf, len, &attrs) || !(attrs.truncated)) {
+    printf("failure on index truncation\n");
+    return -1;
+  }
+
+  if (stun_attr_index_get(&attrs, STUN_ATTRIBUTE_MESSAGE_INTEGRITY) !=
+      stun_attr_get_first_by_type_str(buf, len, STUN_ATTRIBUTE_MESSAGE_INTEGRITY)) {
+    printf("failure on attribute lookup\n");
+    return -1;
+  }
+
+  if (!stun_is_command_message_full_check_index(&attrs, 1, NULL)) {
+    printf("failure on fingerprint check\n");
+    return -1;
+  }
+
+  if (stun_check_message_integrity_by_index_str(TURN_CREDENTIALS_SHORT_TERM, buf, &attrs, key, pwd, shatype) < 1) {
+    printf("failure on integrity check\n");
+    return -1;
+  }
+
+  /* Cut short: the index must not be built over the missing bytes */
+  if (stun_attr_index_build(buf, len - 4, &attrs)) {
+    printf("failure on short message check\n");
+    return -1;
+  }
+
+  printf("success\n");
+  return 0;
+}
+
 int main(int argc, const char **argv) {
   int res = -1;
 
@@ -285,6 +391,17 @@ int main(int argc, const char **argv) {
         exit(-1);
       }
     }
+
+    { // indexed checks
+      hmackey_t key;
+      password_t pwd;
+      memset(key, 0, sizeof(key));
+      strcpy((char *)pwd, "VOkJxbRl1RmTxUk/WvJxBt");
+
+      if (check_index("simple request", reqstc, sizeof(reqstc) - 1, TURN_CREDENTIALS_SHORT_TERM, key, pwd) < 0) {
+        exit(-1);
+      }
+    }
   }
 
   {
@@ -388,6 +505,35 @@ int main(int argc, const char **argv) {
       printf("failure on NEGATIVE long-term credentials check\n");
       exit(-1);
     }
+
+    { // indexed checks, the vector has no fingerprint
+      hmackey_t key;
+      password_t pwd;
+      stun_attr_index attrs;
+      memset(pwd, 0, sizeof(pwd));
+
+      memcpy(buf, reqltc, sizeof(reqltc));
+
+      printf("RFC 5769 long-term credentials indexed integrity test result: ");
+
+      if (!stun_produce_integrity_key_str(uname, realm, upwd, key, shatype) ||
+          !stun_attr_index_build(buf, sizeof(reqltc) - 1, &attrs)) {
+        printf("failure on message structure check\n");
+        exit(-1);
+      }
+
+      res = stun_check_message_integrity_by_index_str(TURN_CREDENTIALS_LONG_TERM, buf, &attrs, key, pwd, shatype);
+
+      if (res > 0) {
+        printf("success\n");
+      } else if (res == 0) {
+        printf("failure on integrity check\n");
+        exit(-1);
+      } else {
+        printf("failure on message structure check\n");
+        exit(-1);
+      }
+    }
   }
 
   {
@@ -455,6 +601,17 @@ int main(int argc, const char **argv) {
       }
     }
 
+    { // indexed checks
+      hmackey_t key;
+      password_t pwd;
+      memset(key, 0, sizeof(key));
+      strcpy((char *)pwd, "VOkJxbRl1RmTxUk/WvJxBt");
+
+      if (check_index("IPv4 response", respv4, sizeof(respv4) - 1, TURN_CREDENTIALS_SHORT_TERM, key, pwd) < 0) {
+        exit(-1);
+      }
+    }
+
     { // IPv4 addr
       ioa_addr addr4;
       ioa_addr addr4_test;
@@ -543,6 +700,17 @@ int main(int argc, const char **argv) {
       }
     }
 
+    { // indexed checks
+      hmackey_t key;
+      password_t pwd;
+      memset(key, 0, sizeof(key));
+      strcpy((char *)pwd, "VOkJxbRl1RmTxUk/WvJxBt");
+
+      if (check_index("IPv6 response", respv6, sizeof(respv6) - 1, TURN_CREDENTIALS_SHORT_TERM, key, pwd) < 0) {
+        exit(-1);
+      }
+    }
+
     { // IPv6 deconding test
       ioa_addr addr6;
       ioa_addr addr6_test;
@@ -564,6 +732,10 @@ int main(int argc, const char **argv) {
     }
   }
 
+  if (check_index_truncated() < 0) {
+    exit(-1);
+  }
+
   if (check_oauth() < 0) {
     exit(-1);
   }
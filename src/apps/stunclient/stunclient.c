@@ -410,13 +410,141 @@ static int run_stunclient(const char *rip, uint16_t rport, uint16_t *port, bool
 }
 #endif // ifdef __cplusplus
 
+//////////////// Binding flood /////////////////
+
+#define BINDING_FLOOD_WINDOW (64)
+#define BINDING_FLOOD_TIMEOUT_MS (1000)
+
+static uint64_t flood_mstime(void) {
+  struct timespec tp = {0, 0};
+  clock_gettime(CLOCK_MONOTONIC, &tp);
+  return (uint64_t)tp.tv_sec * 1000 + (uint64_t)(tp.tv_nsec / 1000000);
+}
+
+/*
+ * Sends <count> Binding requests, each one from a new local port, with up to
+ * BINDING_FLOOD_WINDOW requests in flight, and prints the response rate.
+ * Every request looks like the first packet of a new client to the server.
+ */
+static int run_binding_flood(const char *rip, uint16_t rport, int count) {
+  ioa_addr remote_addr;
+  evutil_socket_t fds[BINDING_FLOOD_WINDOW];
+  uint64_t sent_at[BINDING_FLOOD_WINDOW];
+  int sent = 0;
+  int answered = 0;
+  int lost = 0;
+  int in_flight = 0;
+
+  memset(&remote_addr, 0, sizeof(remote_addr));
+  if (make_ioa_addr((const uint8_t *)rip, rport, &remote_addr) < 0) {
+    err(-1, NULL);
+  }
+
+  for (int i = 0; i < BINDING_FLOOD_WINDOW; ++i) {
+    fds[i] = -1;
+  }
+
+  const uint64_t start = flood_mstime();
+
+  while ((sent < count) || in_flight) {
+
+    for (int i = 0; (i < BINDING_FLOOD_WINDOW) && (sent < count); ++i) {
+      if (fds[i] >= 0) {
+        continue;
+      }
+
+      fds[i] = socket(remote_addr.ss.sa_family, CLIENT_DGRAM_SOCKET_TYPE, CLIENT_DGRAM_SOCKET_PROTOCOL);
+      if (fds[i] < 0) {
+        err(-1, NULL);
+      }
+
+      if (!addr_any(&real_local_addr)) {
+        addr_set_port(&real_local_addr, 0);
+        if (addr_bind(fds[i], &real_local_addr, 0, 1, UDP_SOCKET) < 0) {
+          err(-1, NULL);
+        }
+      }
+
+      stun_buffer buf;
+      stun_prepare_binding_request(&buf);
+
+      ssize_t len = 0;
+      do {
+        len = sendto(fds[i], buf.buf, buf.len, 0, (struct sockaddr *)&remote_addr,
+                     (socklen_t)get_ioa_addr_len(&remote_addr));
+      } while (len < 0 && (socket_eintr() || socket_enobufs() || socket_eagain()));
+
+      sent_at[i] = flood_mstime();
+      ++sent;
+      ++in_flight;
+    }
+
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    evutil_socket_t maxfd = -1;
+    for (int i = 0; i < BINDING_FLOOD_WINDOW; ++i) {
+      if (fds[i] >= 0) {
+        FD_SET(fds[i], &rfds);
+        if (fds[i] > maxfd) {
+          maxfd = fds[i];
+        }
+      }
+    }
+
+    struct timeval tv = {0, 100000};
+    if (select((int)maxfd + 1, &rfds, NULL, NULL, &tv) < 0 && !socket_eintr()) {
+      err(-1, NULL);
+    }
+
+    const uint64_t now = flood_mstime();
+
+    for (int i = 0; i < BINDING_FLOOD_WINDOW; ++i) {
+      if (fds[i] < 0) {
+        continue;
+      }
+
+      if (FD_ISSET(fds[i], &rfds)) {
+        stun_buffer buf;
+        const ssize_t len = recv(fds[i], buf.buf, sizeof(buf.buf), 0);
+        if (len <= 0) {
+          continue;
+        }
+        buf.len = (size_t)len;
+        if (stun_is_command_message(&buf) && stun_is_binding_response(&buf) && stun_is_success_response(&buf)) {
+          ++answered;
+        } else {
+          ++lost;
+        }
+      } else if (now - sent_at[i] >= BINDING_FLOOD_TIMEOUT_MS) {
+        ++lost;
+      } else {
+        continue;
+      }
+
+      socket_closesocket(fds[i]);
+      fds[i] = -1;
+      --in_flight;
+    }
+  }
+
+  const uint64_t elapsed = flood_mstime() - start;
+
+  printf("Binding requests: %d, responses: %d, lost or wrong: %d\n", sent, answered, lost);
+  printf("Elapsed: %lu ms, rate: %.0f responses/sec\n", (unsigned long)elapsed,
+         elapsed ? ((double)answered * 1000.0 / (double)elapsed) : 0.0);
+
+  return 0;
+}
+
 //////////////// local definitions /////////////////
 
 static char Usage[] = "Usage: stunclient [options] address\n"
                       "Options:\n"
                       "        -p      STUN server port (Default: 3478)\n"
                       "        -L      Local address to use (optional)\n"
-                      "        -f      Force RFC 5780 processing\n";
+                      "        -f      Force RFC 5780 processing\n"
+                      "        -n      Binding flood: send <number> requests, each one from a new local port,\n"
+                      "                and print the response rate\n";
 
 //////////////////////////////////////////////////
 
@@ -425,6 +553,7 @@ int main(int argc, char **argv) {
   char local_addr[256] = "\0";
   int c = 0;
   bool forceRfc5780 = false;
+  int flood_count = 0;
 
   if (socket_init()) {
     return -1;
@@ -436,7 +565,7 @@ int main(int argc, char **argv) {
 
   memset(local_addr, 0, sizeof(local_addr));
 
-  while ((c = getopt(argc, argv, "p:L:f")) != -1) {
+  while ((c = getopt(argc, argv, "p:L:fn:")) != -1) {
     switch (c) {
     case 'f':
       forceRfc5780 = 1;
@@ -447,6 +576,9 @@ int main(int argc, char **argv) {
     case 'L':
       STRCPY(local_addr, optarg);
       break;
+    case 'n':
+      flood_count = atoi(optarg);
+      break;
     default:
       fprintf(stderr, "%s\n", Usage);
       exit(1);
@@ -466,6 +598,10 @@ int main(int argc, char **argv) {
     }
   }
 
+  if (flood_count > 0) {
+    return run_binding_flood(argv[optind], port, flood_count);
+  }
+
   uint16_t local_port = 0;
   bool rfc5780 = false;
 
@@ -439,12 +439,8 @@ bool old_stun_is_command_message_str(const uint8_t *buf, size_t blen, uint32_t *
   return false;
 }
 
-bool stun_is_command_message_full_check_str(const uint8_t *buf, size_t blen, int must_check_fingerprint,
-                                            int *fingerprint_present) {
-  if (!stun_is_command_message_str(buf, blen)) {
-    return false;
-  }
-  stun_attr_ref sar = stun_attr_get_first_by_type_str(buf, blen, STUN_ATTRIBUTE_FINGERPRINT);
+static bool check_fingerprint(const uint8_t *buf, size_t blen, stun_attr_ref sar, int must_check_fingerprint,
+                              int *fingerprint_present) {
   if (!sar) {
     if (fingerprint_present) {
       *fingerprint_present = 0;
@@ -469,6 +465,24 @@ bool stun_is_command_message_full_check_str(const uint8_t *buf, size_t blen, int
   return ret;
 }
 
+bool stun_is_command_message_full_check_str(const uint8_t *buf, size_t blen, int must_check_fingerprint,
+                                            int *fingerprint_present) {
+  if (!stun_is_command_message_str(buf, blen)) {
+    return false;
+  }
+  stun_attr_ref sar = stun_attr_get_first_by_type_str(buf, blen, STUN_ATTRIBUTE_FINGERPRINT);
+  return check_fingerprint(buf, blen, sar, must_check_fingerprint, fingerprint_present);
+}
+
+bool stun_is_command_message_full_check_index(const stun_attr_index *attrs, int must_check_fingerprint,
+                                              int *fingerprint_present) {
+  if (!stun_is_command_message_str(attrs->buf, attrs->len)) {
+    return false;
+  }
+  stun_attr_ref sar = stun_attr_index_get(attrs, STUN_ATTRIBUTE_FINGERPRINT);
+  return check_fingerprint(attrs->buf, attrs->len, sar, must_check_fingerprint, fingerprint_present);
+}
+
 bool stun_is_request_str(const uint8_t *buf, size_t len) {
   if (is_channel_msg_str(buf, len)) {
     return false;
@@ -602,22 +616,30 @@ void stun_init_buffer_str(uint8_t *buf, size_t *len) {
   memset(buf, 0, *len);
 }
 
-void stun_init_command_str(uint16_t message_type, uint8_t *buf, size_t *len) {
+/*
+ * Responses echo the transaction ID of the request, so a new one is
+ * generated only when none is given.
+ */
+static void stun_init_header_str(uint16_t message_type, uint8_t *buf, size_t *len, uint32_t cookie,
+                                 const stun_tid *id) {
   stun_init_buffer_str(buf, len);
   message_type &= (uint16_t)(0x3FFF);
   ((uint16_t *)buf)[0] = nswap16(message_type);
   ((uint16_t *)buf)[1] = 0;
-  ((uint32_t *)buf)[1] = nswap32(STUN_MAGIC_COOKIE);
-  stun_tid_generate_in_message_str(buf, NULL);
+  ((uint32_t *)buf)[1] = nswap32(cookie);
+  if (id) {
+    stun_tid_message_cpy(buf, id);
+  } else {
+    stun_tid_generate_in_message_str(buf, NULL);
+  }
+}
+
+void stun_init_command_str(uint16_t message_type, uint8_t *buf, size_t *len) {
+  stun_init_header_str(message_type, buf, len, STUN_MAGIC_COOKIE, NULL);
 }
 
 void old_stun_init_command_str(uint16_t message_type, uint8_t *buf, size_t *len, uint32_t cookie) {
-  stun_init_buffer_str(buf, len);
-  message_type &= (uint16_t)(0x3FFF);
-  ((uint16_t *)buf)[0] = nswap16(message_type);
-  ((uint16_t *)buf)[1] = 0;
-  ((uint32_t *)buf)[1] = nswap32(cookie);
-  stun_tid_generate_in_message_str(buf, NULL);
+  stun_init_header_str(message_type, buf, len, cookie, NULL);
 }
 
 void stun_init_request_str(uint16_t method, uint8_t *buf, size_t *len) {
@@ -629,17 +651,46 @@ void stun_init_indication_str(uint16_t method, uint8_t *buf, size_t *len) {
 }
 
 void stun_init_success_response_str(uint16_t method, uint8_t *buf, size_t *len, stun_tid *id) {
-  stun_init_command_str(stun_make_success_response(method), buf, len);
-  if (id) {
-    stun_tid_message_cpy(buf, id);
-  }
+  stun_init_header_str(stun_make_success_response(method), buf, len, STUN_MAGIC_COOKIE, id);
 }
 
 void old_stun_init_success_response_str(uint16_t method, uint8_t *buf, size_t *len, stun_tid *id, uint32_t cookie) {
-  old_stun_init_command_str(stun_make_success_response(method), buf, len, cookie);
-  if (id) {
-    stun_tid_message_cpy(buf, id);
+  stun_init_header_str(stun_make_success_response(method), buf, len, cookie, id);
+}
+
+bool stun_response_template_init(stun_response_template *tmpl, uint16_t method, const uint8_t *software,
+                                 size_t software_len) {
+  tmpl->len = 0;
+
+  if (STUN_HEADER_LENGTH + 4 + software_len + 3 > sizeof(tmpl->buf)) {
+    return false;
+  }
+
+  /* the transaction ID is patched in per response */
+  stun_tid tid;
+  memset(&tid, 0, sizeof(tid));
+
+  size_t len = 0;
+  stun_init_header_str(stun_make_success_response(method), tmpl->buf, &len, STUN_MAGIC_COOKIE, &tid);
+  if (software && !stun_attr_add_str(tmpl->buf, &len, STUN_ATTRIBUTE_SOFTWARE, software, (int)software_len)) {
+    return false;
   }
+
+  tmpl->len = len;
+  return true;
+}
+
+bool stun_init_response_from_template_str(const stun_response_template *tmpl, uint8_t *buf, size_t *len,
+                                          const stun_tid *id) {
+  if (!tmpl->len) {
+    return false;
+  }
+
+  memcpy(buf, tmpl->buf, tmpl->len);
+  stun_tid_message_cpy(buf, id);
+  *len = tmpl->len;
+
+  return true;
 }
 
 const uint8_t *get_default_reason(int error_code) {
@@ -707,7 +758,7 @@ const uint8_t *get_default_reason(int error_code) {
 }
 
 static void stun_init_error_response_common_str(uint8_t *buf, size_t *len, uint16_t error_code, const uint8_t *reason,
-                                                stun_tid *id, bool include_reason_string) {
+                                                bool include_reason_string) {
 
   if (include_reason_string && (!reason || !strcmp((const char *)reason, "Unknown error"))) {
     reason = get_default_reason(error_code);
@@ -733,26 +784,23 @@ static void stun_init_error_response_common_str(uint8_t *buf, size_t *len, uint1
   }
 
   stun_attr_add_str(buf, len, STUN_ATTRIBUTE_ERROR_CODE, (uint8_t *)avalue, alen);
-  if (id) {
-    stun_tid_message_cpy(buf, id);
-  }
 }
 
 void old_stun_init_error_response_str(uint16_t method, uint8_t *buf, size_t *len, uint16_t error_code,
                                       const uint8_t *reason, stun_tid *id, uint32_t cookie,
                                       bool include_reason_string) {
 
-  old_stun_init_command_str(stun_make_error_response(method), buf, len, cookie);
+  stun_init_header_str(stun_make_error_response(method), buf, len, cookie, id);
 
-  stun_init_error_response_common_str(buf, len, error_code, reason, id, include_reason_string);
+  stun_init_error_response_common_str(buf, len, error_code, reason, include_reason_string);
 }
 
 void stun_init_error_response_str(uint16_t method, uint8_t *buf, size_t *len, uint16_t error_code,
                                   const uint8_t *reason, stun_tid *id, bool include_reason_string) {
 
-  stun_init_command_str(stun_make_error_response(method), buf, len);
+  stun_init_header_str(stun_make_error_response(method), buf, len, STUN_MAGIC_COOKIE, id);
 
-  stun_init_error_response_common_str(buf, len, error_code, reason, id, include_reason_string);
+  stun_init_error_response_common_str(buf, len, error_code, reason, include_reason_string);
 }
 
 /////////// CHANNEL ////////////////////////////////////////////////
@@ -894,6 +942,90 @@ int is_http(const char *s, size_t blen) {
   return 0;
 }
 
+/* Candidate classes by the first byte of the packet */
+#define PACKET_MAY_BE_STUN (0x1)
+#define PACKET_MAY_BE_DTLS (0x2)
+#define PACKET_MAY_BE_CHANNEL (0x4)
+#define PACKET_MAY_BE_HTTP (0x8)
+
+static inline unsigned int packet_candidates(uint8_t b) {
+  return ((b < 0x40) ? PACKET_MAY_BE_STUN : 0) | (((uint8_t)(b - 0x14) < 4) ? PACKET_MAY_BE_DTLS : 0) |
+         (((b & 0xC0) == 0x40) ? PACKET_MAY_BE_CHANNEL : 0) |
+         (((b == 'G') || (b == 'P') || (b == 'D')) ? PACKET_MAY_BE_HTTP : 0);
+}
+
+/*
+ * One pass over the header: the first byte selects the candidate classes,
+ * and each candidate is confirmed with the checks of
+ * stun_is_channel_message_str, stun_is_command_message_str,
+ * old_stun_is_command_message_str, is_dtls_message and is_http, tried in
+ * the order the server applies them.
+ */
+TURN_PACKET_CLASS turn_packet_classify_str(const uint8_t *buf, size_t len, bool mandatory_padding) {
+  if (!buf || (len < 4)) {
+    return TURN_PACKET_GARBAGE;
+  }
+
+  const unsigned int candidates = packet_candidates(buf[0]);
+
+  if (candidates & PACKET_MAY_BE_CHANNEL) {
+    size_t blen = len;
+    uint16_t chnum = 0;
+    if (stun_is_channel_message_str(buf, &blen, &chnum, mandatory_padding)) {
+      return TURN_PACKET_CHANNEL_DATA;
+    }
+  }
+
+  if ((candidates & PACKET_MAY_BE_STUN) && (len >= STUN_HEADER_LENGTH)) {
+    const uint16_t type = nswap16(((const uint16_t *)buf)[0]);
+    const uint16_t mlen = nswap16(((const uint16_t *)buf)[1]);
+    if (!(mlen & 0x0003) && ((size_t)mlen + STUN_HEADER_LENGTH == len)) {
+      if (nswap32(((const uint32_t *)buf)[1]) != STUN_MAGIC_COOKIE) {
+        return TURN_PACKET_OLD_STUN;
+      }
+      switch (type & 0x0110) {
+      case 0x0000:
+        return TURN_PACKET_STUN_REQUEST;
+      case 0x0010:
+        return TURN_PACKET_STUN_INDICATION;
+      default:
+        return TURN_PACKET_STUN_RESPONSE;
+      }
+    }
+  }
+
+  if ((candidates & PACKET_MAY_BE_DTLS) && (buf[1] == 0xfe) && ((buf[2] == 0xff) || (buf[2] == 0xfd))) {
+    return TURN_PACKET_DTLS;
+  }
+
+  if ((candidates & PACKET_MAY_BE_HTTP) && is_http((const char *)buf, len)) {
+    return TURN_PACKET_HTTP;
+  }
+
+  return TURN_PACKET_GARBAGE;
+}
+
+const char *turn_packet_class_name(TURN_PACKET_CLASS pclass) {
+  switch (pclass) {
+  case TURN_PACKET_CHANNEL_DATA:
+    return "channel_data";
+  case TURN_PACKET_STUN_REQUEST:
+    return "stun_request";
+  case TURN_PACKET_STUN_INDICATION:
+    return "stun_indication";
+  case TURN_PACKET_STUN_RESPONSE:
+    return "stun_response";
+  case TURN_PACKET_OLD_STUN:
+    return "old_stun";
+  case TURN_PACKET_DTLS:
+    return "dtls";
+  case TURN_PACKET_HTTP:
+    return "http";
+  default:
+    return "garbage";
+  }
+}
+
 int stun_get_message_len_str(uint8_t *buf, size_t blen, int padding, size_t *app_len) {
   if (buf && blen) {
     /* STUN request/response ? */
@@ -1137,6 +1269,31 @@ void stun_set_channel_bind_response_str(uint8_t *buf, size_t *len, stun_tid *tid
 
 void stun_set_binding_request_str(uint8_t *buf, size_t *len) { stun_init_request_str(STUN_METHOD_BINDING, buf, len); }
 
+static bool stun_add_binding_addrs_str(uint8_t *buf, size_t *len, const ioa_addr *reflexive_addr, bool old_stun,
+                                       bool stun_backward_compatibility) {
+  if (!old_stun && reflexive_addr) {
+    if (!stun_attr_add_addr_str(buf, len, STUN_ATTRIBUTE_XOR_MAPPED_ADDRESS, reflexive_addr)) {
+      return false;
+    }
+  }
+  if (reflexive_addr) {
+    if (stun_backward_compatibility &&
+        !stun_attr_add_addr_str(buf, len, STUN_ATTRIBUTE_MAPPED_ADDRESS, reflexive_addr)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool stun_set_binding_response_from_template_str(const stun_response_template *tmpl, uint8_t *buf, size_t *len,
+                                                 const stun_tid *tid, const ioa_addr *reflexive_addr,
+                                                 bool stun_backward_compatibility) {
+  if (!stun_init_response_from_template_str(tmpl, buf, len, tid)) {
+    return false;
+  }
+  return stun_add_binding_addrs_str(buf, len, reflexive_addr, false, stun_backward_compatibility);
+}
+
 bool stun_set_binding_response_str(uint8_t *buf, size_t *len, stun_tid *tid, const ioa_addr *reflexive_addr,
                                    int error_code, const uint8_t *reason, uint32_t cookie, bool old_stun,
                                    bool stun_backward_compatibility, bool include_reason_string)
@@ -1148,17 +1305,7 @@ bool stun_set_binding_response_str(uint8_t *buf, size_t *len, stun_tid *tid, con
     } else {
       old_stun_init_success_response_str(STUN_METHOD_BINDING, buf, len, tid, cookie);
     }
-    if (!old_stun && reflexive_addr) {
-      if (!stun_attr_add_addr_str(buf, len, STUN_ATTRIBUTE_XOR_MAPPED_ADDRESS, reflexive_addr)) {
-        return false;
-      }
-    }
-    if (reflexive_addr) {
-      if (stun_backward_compatibility &&
-          !stun_attr_add_addr_str(buf, len, STUN_ATTRIBUTE_MAPPED_ADDRESS, reflexive_addr)) {
-        return false;
-      }
-    }
+    return stun_add_binding_addrs_str(buf, len, reflexive_addr, old_stun, stun_backward_compatibility);
   } else if (!old_stun) {
     stun_init_error_response_str(STUN_METHOD_BINDING, buf, len, error_code, reason, tid, include_reason_string);
   } else {
@@ -1451,6 +1598,101 @@ stun_attr_ref stun_attr_get_next_str(const uint8_t *buf, size_t len, stun_attr_r
   }
 }
 
+/*
+ * Walks the attributes of the message once, with the bounds checks of
+ * stun_attr_get_next_str. Returns false if buf is shorter than the message.
+ */
+bool stun_attr_index_build(const uint8_t *buf, size_t len, stun_attr_index *attrs) {
+  attrs->buf = buf;
+  attrs->len = len;
+  attrs->attrs_number = 0;
+  attrs->truncated = false;
+
+  const int bufLen = stun_get_command_message_len_str(buf, len);
+  if (bufLen < STUN_HEADER_LENGTH) {
+    return false;
+  }
+
+  const size_t end = (size_t)bufLen;
+  size_t offset = STUN_HEADER_LENGTH;
+
+  while (offset + 4 <= end) {
+    if (attrs->attrs_number >= STUN_ATTR_INDEX_SIZE) {
+      attrs->truncated = true;
+      break;
+    }
+    const stun_attr_ref attr = buf + offset;
+    size_t attrlen = (size_t)stun_attr_get_len(attr);
+    attrlen = (attrlen + 3) & ~((size_t)3);
+    if (attrlen > end - offset - 4) {
+      break;
+    }
+    attrs->types[attrs->attrs_number] = (uint16_t)stun_attr_get_type(attr);
+    attrs->offsets[attrs->attrs_number] = (uint32_t)offset;
+    attrs->attrs_number += 1;
+    offset += 4 + attrlen;
+  }
+
+  return true;
+}
+
+stun_attr_ref stun_attr_index_get(const stun_attr_index *attrs, uint16_t attr_type) {
+  for (size_t i = 0; i < attrs->attrs_number; ++i) {
+    if (attrs->types[i] == attr_type) {
+      return attrs->buf + attrs->offsets[i];
+    }
+  }
+
+  if (attrs->truncated) {
+    stun_attr_ref attr = attrs->buf + attrs->offsets[attrs->attrs_number - 1];
+    while ((attr = stun_attr_get_next_str(attrs->buf, attrs->len, attr))) {
+      if (stun_attr_get_type(attr) == attr_type) {
+        return attr;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+stun_attr_ref stun_attr_index_first(const stun_attr_index *attrs) {
+  if (attrs->attrs_number) {
+    return attrs->buf + attrs->offsets[0];
+  }
+  return NULL;
+}
+
+stun_attr_ref stun_attr_index_next(const stun_attr_index *attrs, stun_attr_ref prev) {
+  if (!prev) {
+    return stun_attr_index_first(attrs);
+  }
+
+  const size_t offset = (size_t)((const uint8_t *)prev - attrs->buf);
+
+  /* offsets are ascending */
+  size_t lo = 0;
+  size_t hi = attrs->attrs_number;
+  while (lo < hi) {
+    const size_t mid = (lo + hi) >> 1;
+    if (attrs->offsets[mid] < offset) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  if ((lo < attrs->attrs_number) && (attrs->offsets[lo] == offset)) {
+    if (lo + 1 < attrs->attrs_number) {
+      return attrs->buf + attrs->offsets[lo + 1];
+    }
+    if (!(attrs->truncated)) {
+      return NULL;
+    }
+  }
+
+  return stun_attr_get_next_str(attrs->buf, attrs->len, prev);
+}
+
 bool stun_attr_add_str(uint8_t *buf, size_t *len, uint16_t attr, const uint8_t *avalue, int alen) {
   if (alen < 0) {
     alen = 0;
@@ -1839,9 +2081,8 @@ bool stun_attr_add_integrity_by_user_short_term_str(uint8_t *buf, size_t *len, c
 /*
  * Return -1 if failure, 0 if the integrity is not correct, 1 if OK
  */
-int stun_check_message_integrity_by_key_str(turn_credential_type ct, uint8_t *buf, size_t len, hmackey_t key,
-                                            password_t pwd, SHATYPE shatype) {
-  stun_attr_ref sar = stun_attr_get_first_by_type_str(buf, len, STUN_ATTRIBUTE_MESSAGE_INTEGRITY);
+static int check_message_integrity(turn_credential_type ct, uint8_t *buf, size_t len, stun_attr_ref sar,
+                                   hmackey_t key, password_t pwd, SHATYPE shatype) {
   if (!sar) {
     return -1;
   }
@@ -1925,6 +2166,21 @@ int stun_check_message_integrity_by_key_str(turn_credential_type ct, uint8_t *bu
   return +1;
 }
 
+int stun_check_message_integrity_by_key_str(turn_credential_type ct, uint8_t *buf, size_t len, hmackey_t key,
+                                            password_t pwd, SHATYPE shatype) {
+  stun_attr_ref sar = stun_attr_get_first_by_type_str(buf, len, STUN_ATTRIBUTE_MESSAGE_INTEGRITY);
+  return check_message_integrity(ct, buf, len, sar, key, pwd, shatype);
+}
+
+/*
+ * Same with the attributes of buf already indexed
+ */
+int stun_check_message_integrity_by_index_str(turn_credential_type ct, uint8_t *buf, const stun_attr_index *attrs,
+                                              hmackey_t key, password_t pwd, SHATYPE shatype) {
+  stun_attr_ref sar = stun_attr_index_get(attrs, STUN_ATTRIBUTE_MESSAGE_INTEGRITY);
+  return check_message_integrity(ct, buf, attrs->len, sar, key, pwd, shatype);
+}
+
 /*
  * Return -1 if failure, 0 if the integrity is not correct, 1 if OK
  */
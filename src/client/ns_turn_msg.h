@@ -77,6 +77,34 @@ typedef unsigned long band_limit_t;
 
 typedef const void *stun_attr_ref;
 
+/*
+ * Attributes of a message located in one pass over it, in message order.
+ * Past STUN_ATTR_INDEX_SIZE attributes the index is truncated, and the
+ * lookups beyond its last entry scan the rest of the message.
+ */
+#define STUN_ATTR_INDEX_SIZE (32)
+
+typedef struct _stun_attr_index {
+  const uint8_t *buf;
+  size_t len;
+  size_t attrs_number;
+  bool truncated;
+  uint16_t types[STUN_ATTR_INDEX_SIZE];
+  uint32_t offsets[STUN_ATTR_INDEX_SIZE];
+} stun_attr_index;
+
+/*
+ * Start of a success response serialized once: the header and the
+ * attributes that are the same in every response of the method. Only
+ * the transaction ID is patched in when a response is started from it.
+ */
+#define STUN_RESPONSE_TEMPLATE_SIZE (128)
+
+typedef struct _stun_response_template {
+  size_t len;
+  uint8_t buf[STUN_RESPONSE_TEMPLATE_SIZE];
+} stun_response_template;
+
 //////////////////////////////////////////////////////////////
 
 bool stun_tid_equals(const stun_tid *id1, const stun_tid *id2);
@@ -113,12 +141,18 @@ void stun_init_error_response_str(uint16_t method, uint8_t *buf, size_t *len, ui
                                   const uint8_t *reason, stun_tid *id, bool include_reason_string);
 void old_stun_init_error_response_str(uint16_t method, uint8_t *buf, size_t *len, uint16_t error_code,
                                       const uint8_t *reason, stun_tid *id, uint32_t cookie, bool include_reason_string);
+bool stun_response_template_init(stun_response_template *tmpl, uint16_t method, const uint8_t *software,
+                                 size_t software_len);
+bool stun_init_response_from_template_str(const stun_response_template *tmpl, uint8_t *buf, size_t *len,
+                                          const stun_tid *id);
 bool stun_init_channel_message_str(uint16_t chnumber, uint8_t *buf, size_t *len, int length, bool do_padding);
 
 bool stun_is_command_message_str(const uint8_t *buf, size_t blen);
 bool old_stun_is_command_message_str(const uint8_t *buf, size_t blen, uint32_t *cookie);
 bool stun_is_command_message_full_check_str(const uint8_t *buf, size_t blen, int must_check_fingerprint,
                                             int *fingerprint_present);
+bool stun_is_command_message_full_check_index(const stun_attr_index *attrs, int must_check_fingerprint,
+                                              int *fingerprint_present);
 bool stun_is_request_str(const uint8_t *buf, size_t len);
 bool stun_is_success_response_str(const uint8_t *buf, size_t len);
 bool stun_is_error_response_str(const uint8_t *buf, size_t len, int *err_code, uint8_t *err_msg, size_t err_msg_size);
@@ -136,6 +170,9 @@ void stun_set_binding_request_str(uint8_t *buf, size_t *len);
 bool stun_set_binding_response_str(uint8_t *buf, size_t *len, stun_tid *tid, const ioa_addr *reflexive_addr,
                                    int error_code, const uint8_t *reason, uint32_t cookie, bool old_stun,
                                    bool stun_backward_compatibility, bool include_reason_string);
+bool stun_set_binding_response_from_template_str(const stun_response_template *tmpl, uint8_t *buf, size_t *len,
+                                                 const stun_tid *tid, const ioa_addr *reflexive_addr,
+                                                 bool stun_backward_compatibility);
 bool stun_is_binding_request_str(const uint8_t *buf, size_t len, size_t offset);
 bool stun_is_binding_response_str(const uint8_t *buf, size_t len);
 
@@ -158,6 +195,10 @@ uint64_t stun_attr_get_reservation_token_value(stun_attr_ref attr);
 stun_attr_ref stun_attr_get_first_by_type_str(const uint8_t *buf, size_t len, uint16_t attr_type);
 stun_attr_ref stun_attr_get_first_str(const uint8_t *buf, size_t len);
 stun_attr_ref stun_attr_get_next_str(const uint8_t *buf, size_t len, stun_attr_ref prev);
+bool stun_attr_index_build(const uint8_t *buf, size_t len, stun_attr_index *attrs);
+stun_attr_ref stun_attr_index_get(const stun_attr_index *attrs, uint16_t attr_type);
+stun_attr_ref stun_attr_index_first(const stun_attr_index *attrs);
+stun_attr_ref stun_attr_index_next(const stun_attr_index *attrs, stun_attr_ref prev);
 bool stun_attr_add_str(uint8_t *buf, size_t *len, uint16_t attr, const uint8_t *avalue, int alen);
 bool stun_attr_add_addr_str(uint8_t *buf, size_t *len, uint16_t attr_type, const ioa_addr *ca);
 bool stun_attr_get_addr_str(const uint8_t *buf, size_t len, stun_attr_ref attr, ioa_addr *ca,
@@ -195,6 +236,8 @@ void print_bin_func(const char *name, size_t len, const void *s, const char *fun
  */
 int stun_check_message_integrity_by_key_str(turn_credential_type ct, uint8_t *buf, size_t len, hmackey_t key,
                                             password_t pwd, SHATYPE shatype);
+int stun_check_message_integrity_by_index_str(turn_credential_type ct, uint8_t *buf, const stun_attr_index *attrs,
+                                              hmackey_t key, password_t pwd, SHATYPE shatype);
 int stun_check_message_integrity_str(turn_credential_type ct, uint8_t *buf, size_t len, const uint8_t *uname,
                                      const uint8_t *realm, const uint8_t *upwd, SHATYPE shatype);
 bool stun_attr_add_integrity_str(turn_credential_type ct, uint8_t *buf, size_t *len, hmackey_t key, password_t pwd,
@@ -230,6 +273,25 @@ bool stun_attr_add_padding_str(uint8_t *buf, size_t *len, uint16_t padding_len);
 /* HTTP */
 int is_http(const char *s, size_t blen);
 
+/*
+ * Classes of the packets received by a listener, from their first bytes
+ * (RFC 7983 demultiplexing, and HTTP)
+ */
+typedef enum {
+  TURN_PACKET_GARBAGE = 0,
+  TURN_PACKET_CHANNEL_DATA,
+  TURN_PACKET_STUN_REQUEST,
+  TURN_PACKET_STUN_INDICATION,
+  TURN_PACKET_STUN_RESPONSE,
+  TURN_PACKET_OLD_STUN,
+  TURN_PACKET_DTLS,
+  TURN_PACKET_HTTP,
+  TURN_PACKET_CLASSES_NUMBER
+} TURN_PACKET_CLASS;
+
+TURN_PACKET_CLASS turn_packet_classify_str(const uint8_t *buf, size_t len, bool mandatory_padding);
+const char *turn_packet_class_name(TURN_PACKET_CLASS pclass);
+
 /* OAUTH */
 bool convert_oauth_key_data(const oauth_key_data *oakd, oauth_key *key, char *err_msg, size_t err_msg_size);
 bool decode_oauth_token(const uint8_t *server_name, const encoded_oauth_token *etoken, const oauth_key *key,
@@ -214,14 +214,26 @@ typedef uint32_t turn_time_t;
 #define TURN_CHANNEL_HANDLER_KERNEL void *
 #endif
 
+/*
+ * Default handlers are implemented by the relay I/O engine
+ * (see create_turn_channel_kernel() in ns_turn_ioalib.h);
+ * a NULL handler means the channel is relayed in user space.
+ */
+
 #if !defined(CREATE_TURN_CHANNEL_KERNEL)
 #define CREATE_TURN_CHANNEL_KERNEL(channel_number, address_family_client, address_family_peer, protocol_client,        \
                                    client_addr, local_addr, local_relay_addr, peer_addr)                               \
-  ((TURN_CHANNEL_HANDLER_KERNEL)(1))
+  create_turn_channel_kernel((channel_number), (address_family_client), (address_family_peer), (protocol_client),      \
+                             (const ioa_addr *)(client_addr), (const ioa_addr *)(local_addr),                          \
+                             (const ioa_addr *)(local_relay_addr), (const ioa_addr *)(peer_addr))
 #endif
 
 #if !defined(DELETE_TURN_CHANNEL_KERNEL)
-#define DELETE_TURN_CHANNEL_KERNEL(handler)
+#define DELETE_TURN_CHANNEL_KERNEL(handler) delete_turn_channel_kernel(handler)
+#endif
+
+#if !defined(GET_TURN_CHANNEL_KERNEL_TRAFFIC)
+#define GET_TURN_CHANNEL_KERNEL_TRAFFIC(handler, traffic) get_turn_channel_kernel_traffic((handler), (traffic))
 #endif
 
 ////////////////////////////////////////////////////////
@@ -47,6 +47,10 @@ static void init_turn_permission_hashtable(turn_permission_hashtable *map);
 static void free_turn_permission_hashtable(turn_permission_hashtable *map);
 static turn_permission_info *get_from_turn_permission_hashtable(turn_permission_hashtable *map, const ioa_addr *addr);
 
+/////////////// Channel forward declarations /////////////////
+
+static void ch_info_get_kernel_traffic(ch_info *c, turn_channel_kernel_traffic *traffic);
+
 /////////////// ALLOCATION //////////////////////////////////////
 
 void init_allocation(void *owner, allocation *a, ur_map *tcp_connections) {
@@ -93,6 +97,79 @@ void clear_allocation(allocation *a, SOCKET_TYPE socket_type) {
   a->is_valid = false;
 }
 
+/*
+ * Collects the traffic relayed by the kernel on behalf of the allocation
+ * since the previous call, including the channels deleted in between.
+ */
+void allocation_get_kernel_traffic(allocation *a, turn_channel_kernel_traffic *traffic) {
+  if (!a || !traffic) {
+    return;
+  }
+
+  *traffic = a->kernel_traffic;
+  memset(&(a->kernel_traffic), 0, sizeof(a->kernel_traffic));
+
+  for (size_t index = 0; index < CH_MAP_HASH_SIZE; ++index) {
+    ch_map_array *cha = &(a->chns.table[index]);
+
+    for (size_t i = 0; i < CH_MAP_ARRAY_SIZE; ++i) {
+      if (cha->main_chns[i].allocated) {
+        ch_info_get_kernel_traffic(&(cha->main_chns[i]), traffic);
+      }
+    }
+
+    for (size_t i = 0; i < cha->extra_sz; ++i) {
+      if (cha->extra_chns[i] && cha->extra_chns[i]->allocated) {
+        ch_info_get_kernel_traffic(cha->extra_chns[i], traffic);
+      }
+    }
+  }
+}
+
+void allocation_foreach_permission(allocation *a, turn_permission_visitor visitor, void *arg) {
+  if (!a || !visitor) {
+    return;
+  }
+
+  for (size_t index = 0; index < TURN_PERMISSION_HASHTABLE_SIZE; ++index) {
+    turn_permission_array *parray = &(a->addr_to_perm.table[index]);
+
+    for (size_t i = 0; i < TURN_PERMISSION_ARRAY_SIZE; ++i) {
+      if (parray->main_slots[i].info.allocated) {
+        visitor(&(parray->main_slots[i].info), arg);
+      }
+    }
+
+    for (size_t i = 0; i < parray->extra_sz; ++i) {
+      if (parray->extra_slots[i] && parray->extra_slots[i]->info.allocated) {
+        visitor(&(parray->extra_slots[i]->info), arg);
+      }
+    }
+  }
+}
+
+void allocation_foreach_channel(allocation *a, ch_info_visitor visitor, void *arg) {
+  if (!a || !visitor) {
+    return;
+  }
+
+  for (size_t index = 0; index < CH_MAP_HASH_SIZE; ++index) {
+    ch_map_array *cha = &(a->chns.table[index]);
+
+    for (size_t i = 0; i < CH_MAP_ARRAY_SIZE; ++i) {
+      if (cha->main_chns[i].allocated) {
+        visitor(&(cha->main_chns[i]), arg);
+      }
+    }
+
+    for (size_t i = 0; i < cha->extra_sz; ++i) {
+      if (cha->extra_chns[i] && cha->extra_chns[i]->allocated) {
+        visitor(cha->extra_chns[i], arg);
+      }
+    }
+  }
+}
+
 relay_endpoint_session *get_relay_session(allocation *a, int family) {
   if (a) {
     return &(a->relay_sessions[ALLOC_INDEX(family)]);
@@ -265,9 +342,23 @@ static turn_permission_info *get_from_turn_permission_hashtable(turn_permission_
   return NULL;
 }
 
+static void ch_info_get_kernel_traffic(ch_info *c, turn_channel_kernel_traffic *traffic) {
+  turn_channel_kernel_traffic t;
+  if (c->kernel_channel && (GET_TURN_CHANNEL_KERNEL_TRAFFIC(c->kernel_channel, &t) >= 0)) {
+    traffic->client_packets += t.client_packets;
+    traffic->client_bytes += t.client_bytes;
+    traffic->peer_packets += t.peer_packets;
+    traffic->peer_bytes += t.peer_bytes;
+  }
+}
+
 static void ch_info_clean(ch_info *c) {
   if (c) {
     if (c->kernel_channel) {
+      turn_permission_info *tinfo = (turn_permission_info *)c->owner;
+      if (tinfo && tinfo->owner) {
+        ch_info_get_kernel_traffic(c, &(((allocation *)tinfo->owner)->kernel_traffic));
+      }
       DELETE_TURN_CHANNEL_KERNEL(c->kernel_channel);
       c->kernel_channel = 0;
     }
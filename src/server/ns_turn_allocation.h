@@ -186,6 +186,7 @@ typedef struct _allocation {
   void *owner;             // ss
   ur_map *tcp_connections; // global (per turn server) reference
   tcp_connection_list tcs; // local reference
+  turn_channel_kernel_traffic kernel_traffic; /* not yet collected, from deleted kernel channels */
 } allocation;
 
 //////////// CHANNELS ////////////////////
@@ -218,6 +219,13 @@ int get_relay_session_failure(allocation *a, int family);
 void set_relay_session_failure(allocation *a, int family);
 ioa_socket_handle get_relay_socket(allocation *a, int family);
 void set_allocation_family_invalid(allocation *a, int family);
+void allocation_get_kernel_traffic(allocation *a, turn_channel_kernel_traffic *traffic);
+
+typedef void (*turn_permission_visitor)(turn_permission_info *tinfo, void *arg);
+typedef void (*ch_info_visitor)(ch_info *chn, void *arg);
+
+void allocation_foreach_permission(allocation *a, turn_permission_visitor visitor, void *arg);
+void allocation_foreach_channel(allocation *a, ch_info_visitor visitor, void *arg);
 
 tcp_connection *get_and_clean_tcp_connection_by_id(ur_map *map, tcp_connection_id id);
 tcp_connection *get_tcp_connection_by_id(ur_map *map, tcp_connection_id id);
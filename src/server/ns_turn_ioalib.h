@@ -225,6 +225,14 @@ void stun_report_binding(void *session, STUN_PROMETHEUS_METRIC_TYPE type);
 void turn_report_allocation_set(void *a, turn_time_t lifetime, int refresh);
 void turn_report_allocation_delete(void *a, SOCKET_TYPE socket_type);
 void turn_report_session_usage(void *session, int force_invalid);
+/* The session leaves its relay server (arrived == 0) or lands on the new one */
+void turn_report_session_migration(void *session, int arrived);
+void turn_session_stats_attach(void *session);
+void turn_session_stats_detach(void *session);
+
+/* Monotonic clock, microseconds */
+uint64_t turn_time_us(void);
+void turn_report_request_latency(uint16_t method, uint64_t start_us);
 
 /*
  * Network event handler callback
@@ -315,6 +323,14 @@ int ioa_socket_tobeclosed(ioa_socket_handle s);
 void set_ioa_socket_tobeclosed(ioa_socket_handle s);
 void close_ioa_socket_after_processing_if_necessary(ioa_socket_handle s);
 
+/*
+ * RFC 6062: moves the data between the two data connections of a ready TCP
+ * relay connection in the kernel, when both connections are plain TCP.
+ * The read callbacks of the sockets are not called anymore after that.
+ * Returns 0 when the connections are (already) spliced.
+ */
+int tcp_splice_ioa_sockets(ioa_socket_handle client_s, ioa_socket_handle peer_s);
+
 ////////////////// Base64 /////////////////////////////
 
 char *base64_encode(const unsigned char *data, size_t input_length, size_t *output_length);
@@ -339,6 +355,23 @@ void handle_http_echo(ioa_socket_handle s);
 
 int try_acme_redirect(char *req, size_t len, const char *url, ioa_socket_handle s);
 
+///////////// Kernel channels /////////////
+
+/* Traffic forwarded by the kernel since the previous read */
+typedef struct _turn_channel_kernel_traffic {
+  uint64_t client_packets; /* client -> peer */
+  uint64_t client_bytes;
+  uint64_t peer_packets; /* peer -> client */
+  uint64_t peer_bytes;
+} turn_channel_kernel_traffic;
+
+TURN_CHANNEL_HANDLER_KERNEL create_turn_channel_kernel(uint16_t channel_number, int address_family_client,
+                                                       int address_family_peer, int protocol_client,
+                                                       const ioa_addr *client_addr, const ioa_addr *local_addr,
+                                                       const ioa_addr *local_relay_addr, const ioa_addr *peer_addr);
+void delete_turn_channel_kernel(TURN_CHANNEL_HANDLER_KERNEL handler);
+int get_turn_channel_kernel_traffic(TURN_CHANNEL_HANDLER_KERNEL handler, turn_channel_kernel_traffic *traffic);
+
 ///////////////////////////////////////
 
 #ifdef __cplusplus
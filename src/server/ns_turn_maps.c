@@ -39,6 +39,7 @@
 #include "ns_turn_khash.h"
 
 #include <assert.h> // for assert
+#include <stdatomic.h>
 #include <stdlib.h> // for size_t, free, malloc, NULL, realloc
 #include <string.h> // for memset, strcmp, memcpy, strlen
 
@@ -805,139 +806,167 @@ size_t ur_addr_map_size(const ur_addr_map *map) {
   return ret;
 }
 
-////////////////////  STRING LISTS ///////////////////////////////////
+////////// STRING MAPS ////////////////////////////////////////////
+
+/*
+ * Open addressing with linear probing. A slot keeps the hash and the size
+ * of its key, most probes compare them and never touch the key string.
+ * The key, hash and size of a slot do not change once it is used: a removed
+ * key leaves a tombstone value, the tombstones go away when the table is
+ * rebuilt. So the read-mostly maps can be read without the map lock while
+ * a writer, under the lock, adds keys or rebuilds the table.
+ */
 
-typedef struct _string_list {
-  struct _string_list *next;
-} string_list;
+#define STRING_MAP_INITIAL_CAPACITY (16)
 
-typedef struct _string_elem {
-  string_list list;
-  ur_string_map_key_type key;
+typedef struct _string_slot {
+  _Atomic(char *) key; /* NULL - never used */
+  uint32_t hash;
   uint32_t key_size;
-  ur_string_map_value_type value;
-} string_elem;
+  _Atomic(ur_string_map_value_type) value;
+} string_slot;
 
-typedef struct _string_list_header {
-  string_list *list;
-} string_list_header;
+typedef struct _string_table {
+  struct _string_table *retired_next;
+  size_t capacity; /* power of 2 */
+  string_slot slots[];
+} string_table;
 
-static size_t string_list_size(const string_list *sl) {
-  if (!sl) {
-    return 0;
+struct _ur_string_map {
+  _Atomic(string_table *) table;
+  size_t size;
+  size_t used; /* with the tombstones */
+  bool read_mostly;
+  /* read-mostly maps: tables the readers may still be probing */
+  string_table *retired;
+  uint64_t magic;
+  ur_string_map_func del_value_func;
+  TURN_MUTEX_DECLARE(mutex)
+};
+
+static char string_map_tombstone;
+#define STRING_MAP_TOMBSTONE ((ur_string_map_value_type)&string_map_tombstone)
+
+static uint32_t string_hash(const ur_string_map_key_type key, uint32_t *key_size) {
+
+  const uint8_t *str = (const uint8_t *)key;
+
+  uint32_t hash = 0;
+  int c = 0;
+
+  while ((c = *str++)) {
+    hash = c + (hash << 6) + (hash << 16) - hash;
   }
-  return 1 + string_list_size(sl->next);
+
+  *key_size = (uint32_t)(str - (const uint8_t *)key);
+
+  return hash;
 }
 
-static void string_list_free(string_list_header *slh, ur_string_map_func del_value_func) {
-  if (slh) {
-    string_list *list = slh->list;
-    while (list) {
-      string_elem *elem = (string_elem *)list;
-      string_list *tail = elem->list.next;
-      if (elem->key) {
-        free(elem->key);
-      }
-      if (del_value_func && elem->value) {
-        del_value_func(elem->value);
-      }
-      free(elem);
-      list = tail;
-    }
-    slh->list = NULL;
+static string_table *string_table_create(size_t capacity) {
+  string_table *t = (string_table *)calloc(1, sizeof(string_table) + capacity * sizeof(string_slot));
+  if (t) {
+    t->capacity = capacity;
   }
+  return t;
 }
 
-static string_list *string_list_add(string_list *sl, const ur_string_map_key_type key, ur_string_map_value_type value) {
-  if (!key) {
-    return sl;
-  }
-  string_elem *elem = (string_elem *)malloc(sizeof(string_elem));
-  if (!elem) {
-    return sl;
-  }
-  elem->list.next = sl;
-  elem->key_size = strlen(key) + 1;
-  elem->key = (char *)malloc(elem->key_size);
-  if (!elem->key) {
-    free(elem);
-    return sl;
-  }
-  memcpy(elem->key, key, elem->key_size);
-  elem->value = value;
-  return &(elem->list);
+static inline string_table *string_map_table(const ur_string_map *map) {
+  return atomic_load_explicit(&(((ur_string_map *)map)->table), memory_order_acquire);
 }
 
-static string_list *string_list_remove(string_list *sl, const ur_string_map_key_type key,
-                                       ur_string_map_func del_value_func, int *counter) {
-  if (!sl || !key) {
-    return sl;
-  }
-  string_elem *elem = (string_elem *)sl;
-  string_list *tail = elem->list.next;
-  if (strcmp(elem->key, key) == 0) {
-    free(elem->key);
-    if (del_value_func) {
-      del_value_func(elem->value);
+/* The slot of the live key, or NULL */
+static string_slot *string_table_find(string_table *t, const ur_string_map_key_type key, uint32_t hash,
+                                      uint32_t key_size) {
+  const size_t mask = t->capacity - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    string_slot *slot = &(t->slots[i]);
+    const char *skey = atomic_load_explicit(&(slot->key), memory_order_acquire);
+    if (!skey) {
+      return NULL;
     }
-    free(elem);
-    if (counter) {
-      *counter += 1;
+    if ((slot->hash == hash) && (slot->key_size == key_size) && !memcmp(skey, key, key_size) &&
+        (atomic_load_explicit(&(slot->value), memory_order_acquire) != STRING_MAP_TOMBSTONE)) {
+      return slot;
     }
-    sl = string_list_remove(tail, key, del_value_func, counter);
-  } else {
-    elem->list.next = string_list_remove(tail, key, del_value_func, counter);
   }
-  return sl;
 }
 
-static string_elem *string_list_get(string_list *sl, const ur_string_map_key_type key) {
-  if (!sl || !key) {
-    return NULL;
-  }
-
-  string_elem *elem = (string_elem *)sl;
-  if (strcmp(elem->key, key) == 0) {
-    return elem;
-  } else {
-    return string_list_get(elem->list.next, key);
+/* The slot for a new key: a never used one, or a tombstone when nobody reads without the lock */
+static string_slot *string_table_free_slot(string_table *t, uint32_t hash, bool reuse) {
+  const size_t mask = t->capacity - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    string_slot *slot = &(t->slots[i]);
+    if (!atomic_load_explicit(&(slot->key), memory_order_relaxed) ||
+        (reuse && (atomic_load_explicit(&(slot->value), memory_order_relaxed) == STRING_MAP_TOMBSTONE))) {
+      return slot;
+    }
   }
 }
 
-////////// STRING MAPS ////////////////////////////////////////////
-
-#define STRING_MAP_SIZE (1024)
+static void string_slot_set(string_slot *slot, char *key, uint32_t hash, uint32_t key_size,
+                            ur_string_map_value_type value) {
+  slot->hash = hash;
+  slot->key_size = key_size;
+  atomic_store_explicit(&(slot->value), value, memory_order_relaxed);
+  /* the readers see the key last */
+  atomic_store_explicit(&(slot->key), key, memory_order_release);
+}
 
-struct _ur_string_map {
-  string_list_header lists[STRING_MAP_SIZE];
-  uint64_t magic;
-  ur_string_map_func del_value_func;
-  TURN_MUTEX_DECLARE(mutex)
-};
+static void string_table_free_keys(string_table *t, bool live) {
+  for (size_t i = 0; i < t->capacity; ++i) {
+    char *key = atomic_load_explicit(&(t->slots[i].key), memory_order_relaxed);
+    if (key && (live == (atomic_load_explicit(&(t->slots[i].value), memory_order_relaxed) != STRING_MAP_TOMBSTONE))) {
+      free(key);
+    }
+  }
+}
 
-static uint32_t string_hash(const ur_string_map_key_type key) {
+/* A new table for the live keys, the old one is retired or freed */
+static bool string_map_rebuild(ur_string_map *map) {
+  string_table *old = string_map_table(map);
 
-  uint8_t *str = (uint8_t *)key;
+  size_t capacity = STRING_MAP_INITIAL_CAPACITY;
+  while (capacity < ((map->size + 1) * 2)) {
+    capacity <<= 1;
+  }
 
-  uint32_t hash = 0;
-  int c = 0;
+  string_table *t = string_table_create(capacity);
+  if (!t) {
+    return false;
+  }
 
-  while ((c = *str++)) {
-    hash = c + (hash << 6) + (hash << 16) - hash;
+  for (size_t i = 0; i < old->capacity; ++i) {
+    string_slot *slot = &(old->slots[i]);
+    char *key = atomic_load_explicit(&(slot->key), memory_order_relaxed);
+    ur_string_map_value_type value = atomic_load_explicit(&(slot->value), memory_order_relaxed);
+    if (key && (value != STRING_MAP_TOMBSTONE)) {
+      string_slot_set(string_table_free_slot(t, slot->hash, false), key, slot->hash, slot->key_size, value);
+    }
   }
 
-  return hash;
-}
+  atomic_store_explicit(&(map->table), t, memory_order_release);
+  map->used = map->size;
 
-static size_t string_map_index(const ur_string_map_key_type key) { return string_hash(key) % STRING_MAP_SIZE; }
+  if (map->read_mostly) {
+    old->retired_next = map->retired;
+    map->retired = old;
+  } else {
+    string_table_free_keys(old, false);
+    free(old);
+  }
 
-static string_list_header *get_string_list_header(ur_string_map *map, const ur_string_map_key_type key) {
-  return &(map->lists[string_map_index(key)]);
+  return true;
 }
 
 static bool ur_string_map_init(ur_string_map *map) {
   if (map) {
     memset(map, 0, sizeof(ur_string_map));
+    string_table *t = string_table_create(STRING_MAP_INITIAL_CAPACITY);
+    if (!t) {
+      return false;
+    }
+    atomic_init(&(map->table), t);
     map->magic = MAGIC_HASH;
 
     TURN_MUTEX_INIT_RECURSIVE(&(map->mutex));
@@ -962,39 +991,76 @@ ur_string_map *ur_string_map_create(ur_string_map_func del_value_func) {
   }
 }
 
+ur_string_map *ur_string_map_create_read_mostly(ur_string_map_func del_value_func) {
+  ur_string_map *map = ur_string_map_create(del_value_func);
+  if (map) {
+    map->read_mostly = true;
+  }
+  return map;
+}
+
 bool ur_string_map_put(ur_string_map *map, const ur_string_map_key_type key, ur_string_map_value_type value) {
 
-  if (!ur_string_map_valid(map)) {
+  if (!ur_string_map_valid(map) || !key) {
     return false;
   }
 
-  string_list_header *slh = get_string_list_header(map, key);
-  string_elem *elem = string_list_get(slh->list, key);
-  if (elem) {
-    if (elem->value != value) {
+  uint32_t key_size = 0;
+  const uint32_t hash = string_hash(key, &key_size);
+
+  string_slot *slot = string_table_find(string_map_table(map), key, hash, key_size);
+  if (slot) {
+    ur_string_map_value_type old = atomic_load_explicit(&(slot->value), memory_order_relaxed);
+    if (old != value) {
+      atomic_store_explicit(&(slot->value), value, memory_order_release);
       if (map->del_value_func) {
-        map->del_value_func(elem->value);
+        map->del_value_func(old);
       }
-      elem->value = value;
     }
     return true;
   }
 
-  slh->list = string_list_add(slh->list, key, value);
+  /* at most 3/4 of the slots are used, with the tombstones */
+  string_table *t = string_map_table(map);
+  if (((map->used + 1) * 4) > (t->capacity * 3)) {
+    if (!string_map_rebuild(map)) {
+      return false;
+    }
+    t = string_map_table(map);
+  }
+
+  char *skey = (char *)malloc(key_size);
+  if (!skey) {
+    return false;
+  }
+  memcpy(skey, key, key_size);
+
+  slot = string_table_free_slot(t, hash, !(map->read_mostly));
+  if (atomic_load_explicit(&(slot->key), memory_order_relaxed)) {
+    /* a tombstone */
+    free(atomic_load_explicit(&(slot->key), memory_order_relaxed));
+  } else {
+    ++(map->used);
+  }
+  string_slot_set(slot, skey, hash, key_size, value);
+  ++(map->size);
+
   return true;
 }
 
 bool ur_string_map_get(ur_string_map *map, const ur_string_map_key_type key, ur_string_map_value_type *value) {
 
-  if (!ur_string_map_valid(map)) {
+  if (!ur_string_map_valid(map) || !key) {
     return false;
   }
 
-  string_list_header *slh = get_string_list_header(map, key);
-  string_elem *elem = string_list_get(slh->list, key);
-  if (elem) {
+  uint32_t key_size = 0;
+  const uint32_t hash = string_hash(key, &key_size);
+
+  string_slot *slot = string_table_find(string_map_table(map), key, hash, key_size);
+  if (slot) {
     if (value) {
-      *value = elem->value;
+      *value = atomic_load_explicit(&(slot->value), memory_order_acquire);
     }
     return true;
   } else {
@@ -1002,32 +1068,96 @@ bool ur_string_map_get(ur_string_map *map, const ur_string_map_key_type key, ur_
   }
 }
 
+bool ur_string_map_get_unlocked(ur_string_map *map, const ur_string_map_key_type key,
+                                ur_string_map_value_type *value) {
+  if (!ur_string_map_valid(map) || !(map->read_mostly)) {
+    return false;
+  }
+
+  return ur_string_map_get(map, key, value);
+}
+
 bool ur_string_map_del(ur_string_map *map, const ur_string_map_key_type key) {
 
-  if (!ur_string_map_valid(map)) {
+  if (!ur_string_map_valid(map) || !key) {
     return false;
   }
 
-  string_list_header *slh = get_string_list_header(map, key);
+  uint32_t key_size = 0;
+  const uint32_t hash = string_hash(key, &key_size);
 
-  int counter = 0;
-  slh->list = string_list_remove(slh->list, key, map->del_value_func, &counter);
-  return (counter > 0);
+  string_slot *slot = string_table_find(string_map_table(map), key, hash, key_size);
+  if (!slot) {
+    return false;
+  }
+
+  ur_string_map_value_type old = atomic_load_explicit(&(slot->value), memory_order_relaxed);
+  atomic_store_explicit(&(slot->value), STRING_MAP_TOMBSTONE, memory_order_release);
+  if (map->del_value_func) {
+    map->del_value_func(old);
+  }
+  --(map->size);
+
+  return true;
+}
+
+static void string_map_free_tables(ur_string_map *map) {
+  string_table *t = string_map_table(map);
+  string_table_free_keys(t, true);
+  string_table_free_keys(t, false);
+  free(t);
+
+  /* every removed key is a tombstone in exactly one table, the live ones are in the current table */
+  while (map->retired) {
+    string_table *retired = map->retired;
+    map->retired = retired->retired_next;
+    string_table_free_keys(retired, false);
+    free(retired);
+  }
+}
+
+static void string_map_del_values(ur_string_map *map) {
+  if (map->del_value_func) {
+    string_table *t = string_map_table(map);
+    for (size_t i = 0; i < t->capacity; ++i) {
+      ur_string_map_value_type value = atomic_load_explicit(&(t->slots[i].value), memory_order_relaxed);
+      if (atomic_load_explicit(&(t->slots[i].key), memory_order_relaxed) && (value != STRING_MAP_TOMBSTONE) &&
+          value) {
+        map->del_value_func(value);
+      }
+    }
+  }
 }
 
 void ur_string_map_clean(ur_string_map *map) {
   if (ur_string_map_valid(map)) {
-    for (size_t i = 0; i < STRING_MAP_SIZE; ++i) {
-      string_list_free(&(map->lists[i]), map->del_value_func);
+    string_table *t = string_table_create(STRING_MAP_INITIAL_CAPACITY);
+    if (!t) {
+      return;
     }
+    string_map_del_values(map);
+    if (map->read_mostly) {
+      /* the keys stay with the retired table, as removed ones */
+      string_table *old = string_map_table(map);
+      for (size_t i = 0; i < old->capacity; ++i) {
+        atomic_store_explicit(&(old->slots[i].value), STRING_MAP_TOMBSTONE, memory_order_release);
+      }
+      atomic_store_explicit(&(map->table), t, memory_order_release);
+      old->retired_next = map->retired;
+      map->retired = old;
+    } else {
+      string_map_free_tables(map);
+      atomic_store_explicit(&(map->table), t, memory_order_release);
+    }
+    map->size = 0;
+    map->used = 0;
   }
 }
 
 void ur_string_map_free(ur_string_map **map) {
   if (map && ur_string_map_valid(*map)) {
-    for (size_t i = 0; i < STRING_MAP_SIZE; ++i) {
-      string_list_free(&((*map)->lists[i]), (*map)->del_value_func);
-    }
+    string_map_del_values(*map);
+    string_map_free_tables(*map);
     (*map)->magic = 0;
     TURN_MUTEX_DESTROY(&((*map)->mutex));
     free(*map);
@@ -1040,11 +1170,7 @@ size_t ur_string_map_size(const ur_string_map *map) {
     return 0;
   }
 
-  size_t ret = 0;
-  for (size_t i = 0; i < STRING_MAP_SIZE; ++i) {
-    ret += string_list_size(map->lists[i].list);
-  }
-  return ret;
+  return map->size;
 }
 
 bool ur_string_map_lock(const ur_string_map *map) {
@@ -256,6 +256,14 @@ typedef void (*ur_string_map_func)(ur_string_map_value_type);
 
 ur_string_map *ur_string_map_create(ur_string_map_func del_value_func);
 
+/*
+ * A map that is mostly read: ur_string_map_get_unlocked() can look it up
+ * without the lock, while the writers take it. The replaced and removed
+ * values must stay valid for such readers, the removed keys are freed with
+ * the map.
+ */
+ur_string_map *ur_string_map_create_read_mostly(ur_string_map_func del_value_func);
+
 /**
  * @ret:
  * true - success
@@ -271,6 +279,16 @@ bool ur_string_map_put(ur_string_map *map, const ur_string_map_key_type key, ur_
  */
 bool ur_string_map_get(ur_string_map *map, const ur_string_map_key_type key, ur_string_map_value_type *value);
 
+/**
+ * Lookup without the map lock, read-mostly maps only. A key put meanwhile
+ * may not be found yet.
+ * @ret:
+ * true - success
+ * false - not found
+ */
+bool ur_string_map_get_unlocked(ur_string_map *map, const ur_string_map_key_type key,
+                                ur_string_map_value_type *value);
+
 /**
  * @ret:
  * true - success
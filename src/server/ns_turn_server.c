@@ -92,11 +92,25 @@ static void maybe_add_software_attribute(turn_turnserver *server, ioa_network_bu
     const char *software = get_version(server);
     size_t fsz = strlen(get_version(server));
     size_t len = ioa_network_buffer_get_size(nbh);
+    const uint8_t *buf = ioa_network_buffer_data(nbh);
+    /* Responses started from a template carry it as their first attribute */
+    if ((len >= STUN_HEADER_LENGTH + 4) &&
+        (nswap16(((const uint16_t *)(buf + STUN_HEADER_LENGTH))[0]) == STUN_ATTRIBUTE_SOFTWARE)) {
+      return;
+    }
     stun_attr_add_str(ioa_network_buffer_data(nbh), &len, STUN_ATTRIBUTE_SOFTWARE, (const uint8_t *)software, fsz);
     ioa_network_buffer_set_size(nbh, len);
   }
 }
 
+static void init_success_response_str(turn_turnserver *server, uint16_t method, uint8_t *buf, size_t *len,
+                                      stun_tid *tid) {
+  if ((method >= STUN_RESPONSE_TEMPLATES_NUMBER) ||
+      !stun_init_response_from_template_str(&(server->success_templates[method]), buf, len, tid)) {
+    stun_init_success_response_str(method, buf, len, tid);
+  }
+}
+
 #define MAX_NUMBER_OF_UNKNOWN_ATTRS (128)
 
 int TURN_MAX_ALLOCATE_TIMEOUT = 60;
@@ -142,7 +156,7 @@ static inline void log_method(ts_ur_super_session *ss, const char *method, int e
 static int attach_socket_to_session(turn_turnserver *server, ioa_socket_handle s, ts_ur_super_session *ss);
 
 static int check_stun_auth(turn_turnserver *server, ts_ur_super_session *ss, stun_tid *tid, int *resp_constructed,
-                           int *err_code, const uint8_t **reason, ioa_net_data *in_buffer,
+                           int *err_code, const uint8_t **reason, ioa_net_data *in_buffer, const stun_attr_index *attrs,
                            ioa_network_buffer_handle nbh, uint16_t method, int *message_integrity, int *postpone_reply,
                            int can_resume);
 
@@ -241,6 +255,19 @@ void init_turn_server_addrs_list(turn_server_addrs_list_t *l) {
 
 /////////////////// RFC 5780 ///////////////////////
 
+void set_stateless_nonce(turn_turnserver *server, const uint8_t *secret) {
+  if (server) {
+    memset(server->nonce_keys, 0, sizeof(server->nonce_keys));
+    if (secret) {
+      memcpy(server->nonce_secret, secret, sizeof(server->nonce_secret));
+      server->stateless_nonce = true;
+    } else {
+      memset(server->nonce_secret, 0, sizeof(server->nonce_secret));
+      server->stateless_nonce = false;
+    }
+  }
+}
+
 void set_rfc5780(turn_turnserver *server, get_alt_addr_cb cb, send_message_cb smcb) {
   if (server) {
     if (!cb || !smcb) {
@@ -456,6 +483,7 @@ int turn_session_info_copy_from(struct turn_session_info *tsi, ts_ur_super_sessi
 
   if (tsi && ss) {
     tsi->id = ss->id;
+    tsi->stats = ss->stats;
     tsi->bps = ss->bps;
     tsi->start_time = ss->start_time;
     tsi->valid = is_allocation_valid(&(ss->alloc)) && !(ss->to_be_closed) && (ss->quota_used);
@@ -624,6 +652,9 @@ int report_turn_session_info(turn_turnserver *server, ts_ur_super_session *ss, i
   if (server && ss && server->send_turn_session_info) {
     struct turn_session_info tsi;
     memset(&tsi, 0, sizeof(struct turn_session_info));
+    if (!force_invalid) {
+      turn_session_stats_attach(ss);
+    }
     if (turn_session_info_copy_from(&tsi, ss) < 0) {
       turn_session_info_clean(&tsi);
     } else {
@@ -818,6 +849,7 @@ static void delete_ur_map_ss(void *p, SOCKET_TYPE socket_type) {
   if (p) {
     ts_ur_super_session *ss = (ts_ur_super_session *)p;
     delete_session_from_map(ss);
+    turn_session_stats_detach(ss);
     IOA_CLOSE_SOCKET(ss->client_socket);
     clear_allocation(get_allocation_ss(ss), socket_type);
     IOA_EVENT_DEL(ss->to_be_allocated_timeout_ev);
@@ -923,6 +955,24 @@ static int update_turn_permission_lifetime(ts_ur_super_session *ss, turn_permiss
   return -1;
 }
 
+static void collect_kernel_channels_traffic(ts_ur_super_session *ss) {
+  turn_channel_kernel_traffic t;
+  allocation_get_kernel_traffic(get_allocation_ss(ss), &t);
+
+  if (t.client_packets) {
+    ss->received_packets += (uint32_t)t.client_packets;
+    ss->received_bytes += (uint32_t)(t.client_bytes + t.client_packets * STUN_CHANNEL_HEADER_LENGTH);
+    ss->peer_sent_packets += (uint32_t)t.client_packets;
+    ss->peer_sent_bytes += (uint32_t)t.client_bytes;
+  }
+  if (t.peer_packets) {
+    ss->peer_received_packets += (uint32_t)t.peer_packets;
+    ss->peer_received_bytes += (uint32_t)t.peer_bytes;
+    ss->sent_packets += (uint32_t)t.peer_packets;
+    ss->sent_bytes += (uint32_t)(t.peer_bytes + t.peer_packets * STUN_CHANNEL_HEADER_LENGTH);
+  }
+}
+
 static int update_channel_lifetime(ts_ur_super_session *ss, ch_info *chn) {
 
   if (chn) {
@@ -941,6 +991,10 @@ static int update_channel_lifetime(ts_ur_super_session *ss, ch_info *chn) {
 
         chn->expiration_time = server->ctime + *(server->channel_lifetime);
 
+        if (chn->kernel_channel) {
+          collect_kernel_channels_traffic(ss);
+        }
+
         IOA_EVENT_DEL(chn->lifetime_ev);
         chn->lifetime_ev = set_ioa_timer(server->e, *(server->channel_lifetime), 0, client_ss_channel_timeout_handler,
                                          chn, 0, "client_ss_channel_timeout_handler");
@@ -964,8 +1018,7 @@ static int update_channel_lifetime(ts_ur_super_session *ss, ch_info *chn) {
   case STUN_ATTRIBUTE_REALM:                                                                                           \
   case STUN_ATTRIBUTE_NONCE:                                                                                           \
   case STUN_ATTRIBUTE_ORIGIN:                                                                                          \
-    sar = stun_attr_get_next_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh), \
-                                 sar);                                                                                 \
+    sar = stun_attr_index_next(attrs, sar);                                                                            \
     continue
 
 static uint8_t get_transport_value(const uint8_t *value) {
@@ -977,7 +1030,7 @@ static uint8_t get_transport_value(const uint8_t *value) {
 
 static int handle_turn_allocate(turn_turnserver *server, ts_ur_super_session *ss, stun_tid *tid, int *resp_constructed,
                                 int *err_code, const uint8_t **reason, uint16_t *unknown_attrs, uint16_t *ua_num,
-                                ioa_net_data *in_buffer, ioa_network_buffer_handle nbh) {
+                                const stun_attr_index *attrs, ioa_network_buffer_handle nbh) {
 
   int err_code4 = 0;
   int err_code6 = 0;
@@ -1052,8 +1105,7 @@ static int handle_turn_allocate(turn_turnserver *server, ts_ur_super_session *ss
     band_limit_t bps = 0;
     band_limit_t max_bps = 0;
 
-    stun_attr_ref sar =
-        stun_attr_get_first_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh));
+    stun_attr_ref sar = stun_attr_index_first(attrs);
     while (sar && (!(*err_code)) && (*ua_num < MAX_NUMBER_OF_UNKNOWN_ATTRS)) {
 
       const int attr_type = stun_attr_get_type(sar);
@@ -1224,8 +1276,7 @@ static int handle_turn_allocate(turn_turnserver *server, ts_ur_super_session *ss
           unknown_attrs[(*ua_num)++] = nswap16(attr_type);
         }
       };
-      sar = stun_attr_get_next_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh),
-                                   sar);
+      sar = stun_attr_index_next(attrs, sar);
     }
 
     if (!transport) {
@@ -1510,8 +1561,8 @@ static void copy_auth_parameters(ts_ur_super_session *orig_ss, ts_ur_super_sessi
 
 static int handle_turn_refresh(turn_turnserver *server, ts_ur_super_session *ss, stun_tid *tid, int *resp_constructed,
                                int *err_code, const uint8_t **reason, uint16_t *unknown_attrs, uint16_t *ua_num,
-                               ioa_net_data *in_buffer, ioa_network_buffer_handle nbh, int message_integrity,
-                               int *no_response, int can_resume) {
+                               ioa_net_data *in_buffer, const stun_attr_index *attrs, ioa_network_buffer_handle nbh,
+                               int message_integrity, int *no_response, int can_resume) {
 
   allocation *a = get_allocation_ss(ss);
   int af4c = 0;
@@ -1544,8 +1595,7 @@ static int handle_turn_refresh(turn_turnserver *server, ts_ur_super_session *ss,
     mobile_id_t mid = 0;
     char smid[sizeof(ss->s_mobile_id)] = "\0";
 
-    stun_attr_ref sar =
-        stun_attr_get_first_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh));
+    stun_attr_ref sar = stun_attr_index_first(attrs);
     while (sar && (!(*err_code)) && (*ua_num < MAX_NUMBER_OF_UNKNOWN_ATTRS)) {
       const int attr_type = stun_attr_get_type(sar);
       switch (attr_type) {
@@ -1626,8 +1676,7 @@ static int handle_turn_refresh(turn_turnserver *server, ts_ur_super_session *ss,
           unknown_attrs[(*ua_num)++] = nswap16(attr_type);
         }
       };
-      sar = stun_attr_get_next_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh),
-                                   sar);
+      sar = stun_attr_index_next(attrs, sar);
     }
 
     if (*ua_num > 0) {
@@ -1697,7 +1746,7 @@ static int handle_turn_refresh(turn_turnserver *server, ts_ur_super_session *ss,
               copy_auth_parameters(orig_ss, ss);
             }
 
-            if (check_stun_auth(server, ss, tid, resp_constructed, err_code, reason, in_buffer, nbh,
+            if (check_stun_auth(server, ss, tid, resp_constructed, err_code, reason, in_buffer, attrs, nbh,
                                 STUN_METHOD_REFRESH, &message_integrity, &postpone_reply, can_resume) < 0) {
               if (!(*err_code)) {
                 *err_code = 401;
@@ -1772,7 +1821,7 @@ static int handle_turn_refresh(turn_turnserver *server, ts_ur_super_session *ss,
 
                     turn_report_allocation_set(&(ss->alloc), lifetime, 1);
 
-                    stun_init_success_response_str(STUN_METHOD_REFRESH, ioa_network_buffer_data(nbh), &len, tid);
+                    init_success_response_str(server, STUN_METHOD_REFRESH, ioa_network_buffer_data(nbh), &len, tid);
                     uint32_t lt = nswap32(lifetime);
 
                     stun_attr_add_str(ioa_network_buffer_data(nbh), &len, STUN_ATTRIBUTE_LIFETIME, (const uint8_t *)&lt,
@@ -1850,7 +1899,7 @@ static int handle_turn_refresh(turn_turnserver *server, ts_ur_super_session *ss,
         turn_report_allocation_set(&(ss->alloc), lifetime, 1);
 
         size_t len = ioa_network_buffer_get_size(nbh);
-        stun_init_success_response_str(STUN_METHOD_REFRESH, ioa_network_buffer_data(nbh), &len, tid);
+        init_success_response_str(server, STUN_METHOD_REFRESH, ioa_network_buffer_data(nbh), &len, tid);
 
         if (ss->s_mobile_id[0]) {
           stun_attr_add_str(ioa_network_buffer_data(nbh), &len, STUN_ATTRIBUTE_MOBILITY_TICKET,
@@ -1948,9 +1997,13 @@ static void tcp_peer_input_handler(ioa_socket_handle s, int event_type, ioa_net_
   const int ret = send_data_from_ioa_socket_nbh(tc->client_s, NULL, nbh, TTL_IGNORE, TOS_IGNORE, NULL);
   if (ret < 0) {
     set_ioa_socket_tobeclosed(s);
-  } else if (ss) {
-    ++(ss->sent_packets);
-    ss->sent_bytes += bytes;
+  } else {
+    if (ss) {
+      ++(ss->sent_packets);
+      ss->sent_bytes += bytes;
+    }
+    /* The stream is opaque from now on, let the kernel move it if possible */
+    tcp_splice_ioa_sockets(tc->client_s, tc->peer_s);
   }
 
   if (ss) {
@@ -1995,6 +2048,9 @@ static void tcp_client_input_handler_rfc6062data(ioa_socket_handle s, int event_
   const int ret = send_data_from_ioa_socket_nbh(tc->peer_s, NULL, nbh, TTL_IGNORE, TOS_IGNORE, &skip);
   if (ret < 0) {
     set_ioa_socket_tobeclosed(s);
+  } else {
+    /* The stream is opaque from now on, let the kernel move it if possible */
+    tcp_splice_ioa_sockets(tc->client_s, tc->peer_s);
   }
 
   if (!skip && ss) {
@@ -2282,7 +2338,7 @@ static void tcp_peer_accept_connection(ioa_socket_handle s, void *arg) {
 
 static int handle_turn_connect(turn_turnserver *server, ts_ur_super_session *ss, stun_tid *tid, int *err_code,
                                const uint8_t **reason, uint16_t *unknown_attrs, uint16_t *ua_num,
-                               ioa_net_data *in_buffer) {
+                               ioa_net_data *in_buffer, const stun_attr_index *attrs) {
 
   FUNCSTART;
   ioa_addr peer_addr;
@@ -2297,8 +2353,7 @@ static int handle_turn_connect(turn_turnserver *server, ts_ur_super_session *ss,
     *err_code = 437;
   } else {
 
-    stun_attr_ref sar =
-        stun_attr_get_first_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh));
+    stun_attr_ref sar = stun_attr_index_first(attrs);
     while (sar && (!(*err_code)) && (*ua_num < MAX_NUMBER_OF_UNKNOWN_ATTRS)) {
       const int attr_type = stun_attr_get_type(sar);
       switch (attr_type) {
@@ -2323,8 +2378,7 @@ static int handle_turn_connect(turn_turnserver *server, ts_ur_super_session *ss,
           unknown_attrs[(*ua_num)++] = nswap16(attr_type);
         }
       };
-      sar = stun_attr_get_next_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh),
-                                   sar);
+      sar = stun_attr_index_next(attrs, sar);
     }
 
     if (*ua_num > 0) {
@@ -2357,7 +2411,8 @@ static int handle_turn_connect(turn_turnserver *server, ts_ur_super_session *ss,
 static int handle_turn_connection_bind(turn_turnserver *server, ts_ur_super_session *ss, stun_tid *tid,
                                        int *resp_constructed, int *err_code, const uint8_t **reason,
                                        uint16_t *unknown_attrs, uint16_t *ua_num, ioa_net_data *in_buffer,
-                                       ioa_network_buffer_handle nbh, int message_integrity, int can_resume) {
+                                       const stun_attr_index *attrs, ioa_network_buffer_handle nbh,
+                                       int message_integrity, int can_resume) {
 
   allocation *a = get_allocation_ss(ss);
 
@@ -2380,8 +2435,7 @@ static int handle_turn_connection_bind(turn_turnserver *server, ts_ur_super_sess
   } else {
     tcp_connection_id id = 0;
 
-    stun_attr_ref sar =
-        stun_attr_get_first_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh));
+    stun_attr_ref sar = stun_attr_index_first(attrs);
     while (sar && (!(*err_code)) && (*ua_num < MAX_NUMBER_OF_UNKNOWN_ATTRS)) {
       const int attr_type = stun_attr_get_type(sar);
       switch (attr_type) {
@@ -2405,8 +2459,7 @@ static int handle_turn_connection_bind(turn_turnserver *server, ts_ur_super_sess
           unknown_attrs[(*ua_num)++] = nswap16(attr_type);
         }
       };
-      sar = stun_attr_get_next_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh),
-                                   sar);
+      sar = stun_attr_index_next(attrs, sar);
     }
 
     if (*ua_num > 0) {
@@ -2495,7 +2548,10 @@ int turnserver_accept_tcp_client_data_connection(turn_turnserver *server, tcp_co
         } else {
           // Check security:
           int postpone_reply = 0;
-          check_stun_auth(server, ss, tid, &resp_constructed, &err_code, &reason, in_buffer, nbh,
+          stun_attr_index attrs;
+          stun_attr_index_build(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh),
+                                &attrs);
+          check_stun_auth(server, ss, tid, &resp_constructed, &err_code, &reason, in_buffer, &attrs, nbh,
                           STUN_METHOD_CONNECTION_BIND, &message_integrity, &postpone_reply, can_resume);
 
           if (postpone_reply) {
@@ -2586,7 +2642,7 @@ int turnserver_accept_tcp_client_data_connection(turn_turnserver *server, tcp_co
 static int handle_turn_channel_bind(turn_turnserver *server, ts_ur_super_session *ss, stun_tid *tid,
                                     int *resp_constructed, int *err_code, const uint8_t **reason,
                                     uint16_t *unknown_attrs, uint16_t *ua_num, ioa_net_data *in_buffer,
-                                    ioa_network_buffer_handle nbh) {
+                                    const stun_attr_index *attrs, ioa_network_buffer_handle nbh) {
 
   FUNCSTART;
   uint16_t chnum = 0;
@@ -2600,8 +2656,7 @@ static int handle_turn_channel_bind(turn_turnserver *server, ts_ur_super_session
     *reason = (const uint8_t *)"Channel bind cannot be used with TCP relay";
   } else if (is_allocation_valid(a)) {
 
-    stun_attr_ref sar =
-        stun_attr_get_first_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh));
+    stun_attr_ref sar = stun_attr_index_first(attrs);
     while (sar && (!(*err_code)) && (*ua_num < MAX_NUMBER_OF_UNKNOWN_ATTRS)) {
       const int attr_type = stun_attr_get_type(sar);
       switch (attr_type) {
@@ -2643,8 +2698,7 @@ static int handle_turn_channel_bind(turn_turnserver *server, ts_ur_super_session
           unknown_attrs[(*ua_num)++] = nswap16(attr_type);
         }
       };
-      sar = stun_attr_get_next_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh),
-                                   sar);
+      sar = stun_attr_index_next(attrs, sar);
     }
 
     if (*ua_num > 0) {
@@ -2723,12 +2777,12 @@ static int handle_turn_channel_bind(turn_turnserver *server, ts_ur_super_session
           *reason = (const uint8_t *)"Cannot update channel lifetime (internal error)";
         } else {
           size_t len = ioa_network_buffer_get_size(nbh);
-          stun_set_channel_bind_response_str(ioa_network_buffer_data(nbh), &len, tid, 0, NULL,
-                                             server->include_reason_string);
+          init_success_response_str(server, STUN_METHOD_CHANNEL_BIND, ioa_network_buffer_data(nbh), &len, tid);
           ioa_network_buffer_set_size(nbh, len);
           *resp_constructed = 1;
 
-          if (!(ss->is_mobile)) {
+          /* Bandwidth-limited sessions stay in user space, where the limit is enforced */
+          if (!(ss->is_mobile) && !(chn->kernel_channel) && !(ss->bps)) {
             if (get_ioa_socket_type(ss->client_socket) == UDP_SOCKET ||
                 get_ioa_socket_type(ss->client_socket) == TCP_SOCKET ||
                 get_ioa_socket_type(ss->client_socket) == SCTP_SOCKET) {
@@ -2736,10 +2790,10 @@ static int handle_turn_channel_bind(turn_turnserver *server, ts_ur_super_session
                 chn->kernel_channel = CREATE_TURN_CHANNEL_KERNEL(
                     chn->chnum, get_ioa_socket_address_family(ss->client_socket), peer_addr.ss.sa_family,
                     (get_ioa_socket_type(ss->client_socket) == UDP_SOCKET ? IPPROTO_UDP : IPPROTO_TCP),
-                    &(get_remote_addr_from_ioa_socket(ss->client_socket)->ss),
-                    &(get_local_addr_from_ioa_socket(ss->client_socket)->ss),
-                    &(get_local_addr_from_ioa_socket(get_relay_socket(&(ss->alloc), peer_addr.ss.sa_family))),
-                    &(get_remote_addr_from_ioa_socket(get_relay_socket(&(ss->alloc), peer_addr.ss.sa_family))));
+                    get_remote_addr_from_ioa_socket(ss->client_socket),
+                    get_local_addr_from_ioa_socket(ss->client_socket),
+                    get_local_addr_from_ioa_socket(get_relay_socket(&(ss->alloc), peer_addr.ss.sa_family)),
+                    &peer_addr);
               }
             }
           }
@@ -2754,9 +2808,9 @@ static int handle_turn_channel_bind(turn_turnserver *server, ts_ur_super_session
 
 static int handle_turn_binding(turn_turnserver *server, ts_ur_super_session *ss, stun_tid *tid, int *resp_constructed,
                                int *err_code, const uint8_t **reason, uint16_t *unknown_attrs, uint16_t *ua_num,
-                               ioa_net_data *in_buffer, ioa_network_buffer_handle nbh, int *origin_changed,
-                               ioa_addr *response_origin, int *dest_changed, ioa_addr *response_destination,
-                               uint32_t cookie, int old_stun) {
+                               ioa_net_data *in_buffer, const stun_attr_index *attrs, ioa_network_buffer_handle nbh,
+                               int *origin_changed, ioa_addr *response_origin, int *dest_changed,
+                               ioa_addr *response_destination, uint32_t cookie, int old_stun) {
 
   FUNCSTART;
   bool change_ip = false;
@@ -2774,8 +2828,7 @@ static int handle_turn_binding(turn_turnserver *server, ts_ur_super_session *ss,
   *origin_changed = 0;
   *dest_changed = 0;
 
-  stun_attr_ref sar =
-      stun_attr_get_first_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh));
+  stun_attr_ref sar = stun_attr_index_first(attrs);
   while (sar && (!(*err_code)) && (*ua_num < MAX_NUMBER_OF_UNKNOWN_ATTRS)) {
     const int attr_type = stun_attr_get_type(sar);
     switch (attr_type) {
@@ -2852,8 +2905,7 @@ static int handle_turn_binding(turn_turnserver *server, ts_ur_super_session *ss,
         unknown_attrs[(*ua_num)++] = nswap16(attr_type);
       }
     };
-    sar = stun_attr_get_next_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh),
-                                 sar);
+    sar = stun_attr_index_next(attrs, sar);
   }
 
   if (*ua_num > 0) {
@@ -2866,7 +2918,10 @@ static int handle_turn_binding(turn_turnserver *server, ts_ur_super_session *ss,
     stun_report_binding(ss, STUN_PROMETHEUS_METRIC_TYPE_REQUEST);
 
     size_t len = ioa_network_buffer_get_size(nbh);
-    if (stun_set_binding_response_str(ioa_network_buffer_data(nbh), &len, tid,
+    if ((!old_stun && stun_set_binding_response_from_template_str(
+                          &(server->success_templates[STUN_METHOD_BINDING]), ioa_network_buffer_data(nbh), &len, tid,
+                          get_remote_addr_from_ioa_socket(ss->client_socket), *server->stun_backward_compatibility)) ||
+        stun_set_binding_response_str(ioa_network_buffer_data(nbh), &len, tid,
                                       get_remote_addr_from_ioa_socket(ss->client_socket), 0, NULL, cookie, old_stun,
                                       *server->stun_backward_compatibility, server->include_reason_string)) {
 
@@ -2936,7 +2991,8 @@ static int handle_turn_binding(turn_turnserver *server, ts_ur_super_session *ss,
 }
 
 static int handle_turn_send(turn_turnserver *server, ts_ur_super_session *ss, int *err_code, const uint8_t **reason,
-                            uint16_t *unknown_attrs, uint16_t *ua_num, ioa_net_data *in_buffer) {
+                            uint16_t *unknown_attrs, uint16_t *ua_num, ioa_net_data *in_buffer,
+                            const stun_attr_index *attrs) {
 
   FUNCSTART;
 
@@ -2958,8 +3014,7 @@ static int handle_turn_send(turn_turnserver *server, ts_ur_super_session *ss, in
     *reason = (const uint8_t *)"Send cannot be used with TCP relay";
   } else if (is_allocation_valid(a) && (in_buffer->recv_ttl != 0)) {
 
-    stun_attr_ref sar =
-        stun_attr_get_first_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh));
+    stun_attr_ref sar = stun_attr_index_first(attrs);
     while (sar && (!(*err_code)) && (*ua_num < MAX_NUMBER_OF_UNKNOWN_ATTRS)) {
       const int attr_type = stun_attr_get_type(sar);
       switch (attr_type) {
@@ -2994,8 +3049,7 @@ static int handle_turn_send(turn_turnserver *server, ts_ur_super_session *ss, in
           unknown_attrs[(*ua_num)++] = nswap16(attr_type);
         }
       };
-      sar = stun_attr_get_next_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh),
-                                   sar);
+      sar = stun_attr_index_next(attrs, sar);
     }
 
     if (*err_code) {
@@ -3081,7 +3135,7 @@ static int update_permission(ts_ur_super_session *ss, ioa_addr *peer_addr) {
 static int handle_turn_create_permission(turn_turnserver *server, ts_ur_super_session *ss, stun_tid *tid,
                                          int *resp_constructed, int *err_code, const uint8_t **reason,
                                          uint16_t *unknown_attrs, uint16_t *ua_num, ioa_net_data *in_buffer,
-                                         ioa_network_buffer_handle nbh) {
+                                         const stun_attr_index *attrs, ioa_network_buffer_handle nbh) {
 
   int ret = -1;
 
@@ -3094,8 +3148,7 @@ static int handle_turn_create_permission(turn_turnserver *server, ts_ur_super_se
   if (is_allocation_valid(a)) {
 
     {
-      stun_attr_ref sar =
-          stun_attr_get_first_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh));
+      stun_attr_ref sar = stun_attr_index_first(attrs);
 
       while (sar && (!(*err_code)) && (*ua_num < MAX_NUMBER_OF_UNKNOWN_ATTRS)) {
 
@@ -3128,8 +3181,7 @@ static int handle_turn_create_permission(turn_turnserver *server, ts_ur_super_se
             unknown_attrs[(*ua_num)++] = nswap16(attr_type);
           }
         };
-        sar = stun_attr_get_next_str(ioa_network_buffer_data(in_buffer->nbh),
-                                     ioa_network_buffer_get_size(in_buffer->nbh), sar);
+        sar = stun_attr_index_next(attrs, sar);
       }
     }
 
@@ -3148,8 +3200,7 @@ static int handle_turn_create_permission(turn_turnserver *server, ts_ur_super_se
 
     } else {
 
-      stun_attr_ref sar =
-          stun_attr_get_first_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh));
+      stun_attr_ref sar = stun_attr_index_first(attrs);
 
       while (sar) {
 
@@ -3176,13 +3227,12 @@ static int handle_turn_create_permission(turn_turnserver *server, ts_ur_super_se
         default:;
         }
 
-        sar = stun_attr_get_next_str(ioa_network_buffer_data(in_buffer->nbh),
-                                     ioa_network_buffer_get_size(in_buffer->nbh), sar);
+        sar = stun_attr_index_next(attrs, sar);
       }
 
       if (*err_code == 0) {
         size_t len = ioa_network_buffer_get_size(nbh);
-        stun_init_success_response_str(STUN_METHOD_CREATE_PERMISSION, ioa_network_buffer_data(nbh), &len, tid);
+        init_success_response_str(server, STUN_METHOD_CREATE_PERMISSION, ioa_network_buffer_data(nbh), &len, tid);
         ioa_network_buffer_set_size(nbh, len);
 
         ret = 0;
@@ -3210,14 +3260,157 @@ static int need_stun_authentication(turn_turnserver *server, ts_ur_super_session
   return 0;
 }
 
+/////////////// Stateless nonces ///////////////
+
+#define STATELESS_NONCE_MAC_SIZE (12)
+#define STATELESS_NONCE_LENGTH (8 + 2 * STATELESS_NONCE_MAC_SIZE)
+
+/* Tolerated clock difference between the servers sharing the secret */
+#define STATELESS_NONCE_CLOCK_SKEW (30)
+
+static const uint8_t *get_stateless_nonce_key(turn_turnserver *server, turn_time_t period) {
+  stateless_nonce_key *nk = &(server->nonce_keys[period & 1]);
+
+  if (!(nk->valid) || (nk->period != period)) {
+    uint8_t msg[9] = {'n'};
+    for (int i = 0; i < 8; ++i) {
+      msg[8 - i] = (uint8_t)((uint64_t)period >> (8 * i));
+    }
+    uint8_t hmac[MAXSHASIZE];
+    unsigned int hmac_len = 0;
+    nk->valid = 0;
+    if (!stun_calculate_hmac(msg, sizeof(msg), server->nonce_secret, sizeof(server->nonce_secret), hmac, &hmac_len,
+                             SHATYPE_SHA256)) {
+      return NULL;
+    }
+    memcpy(nk->key, hmac, sizeof(nk->key));
+    nk->period = period;
+    nk->valid = 1;
+  }
+
+  return nk->key;
+}
+
+/*
+ * The nonce is bound to its issue time and to the client IP address,
+ * not to the port or the server, so that it stays valid when the client
+ * is redirected to another server sharing the secret.
+ */
+static bool stateless_nonce_mac(turn_turnserver *server, ts_ur_super_session *ss, turn_time_t issued, uint8_t *mac) {
+  const uint8_t *key = get_stateless_nonce_key(server, issued / STATELESS_NONCE_KEY_PERIOD);
+  if (!key) {
+    return false;
+  }
+
+  uint8_t msg[4 + 1 + 16];
+  size_t len = 0;
+  msg[len++] = (uint8_t)(issued >> 24);
+  msg[len++] = (uint8_t)(issued >> 16);
+  msg[len++] = (uint8_t)(issued >> 8);
+  msg[len++] = (uint8_t)issued;
+
+  const ioa_addr *addr = get_remote_addr_from_ioa_socket(ss->client_socket);
+  if (addr && (addr->ss.sa_family == AF_INET)) {
+    msg[len++] = 4;
+    memcpy(msg + len, &(addr->s4.sin_addr), 4);
+    len += 4;
+  } else if (addr && (addr->ss.sa_family == AF_INET6)) {
+    msg[len++] = 6;
+    memcpy(msg + len, &(addr->s6.sin6_addr), 16);
+    len += 16;
+  }
+
+  uint8_t hmac[MAXSHASIZE];
+  unsigned int hmac_len = 0;
+  if (!stun_calculate_hmac(msg, len, key, SHA256SIZEBYTES, hmac, &hmac_len, SHATYPE_SHA256)) {
+    return false;
+  }
+  memcpy(mac, hmac, STATELESS_NONCE_MAC_SIZE);
+
+  return true;
+}
+
+static void stateless_nonce_encode(turn_time_t issued, const uint8_t *mac, char *nonce) {
+  snprintf(nonce, 9, "%08x", (unsigned int)issued);
+  for (size_t i = 0; i < STATELESS_NONCE_MAC_SIZE; ++i) {
+    snprintf(nonce + 8 + 2 * i, 3, "%02x", (unsigned int)mac[i]);
+  }
+}
+
+static size_t generate_stateless_nonce(turn_turnserver *server, ts_ur_super_session *ss, uint8_t *nonce) {
+  const turn_time_t issued = server->ctime;
+  uint8_t mac[STATELESS_NONCE_MAC_SIZE];
+
+  if (!stateless_nonce_mac(server, ss, issued, mac)) {
+    nonce[0] = 0;
+    return 0;
+  }
+  stateless_nonce_encode(issued, mac, (char *)nonce);
+
+  return STATELESS_NONCE_LENGTH;
+}
+
+static bool check_stateless_nonce(turn_turnserver *server, ts_ur_super_session *ss, const uint8_t *nonce,
+                                  size_t len) {
+  if (len != STATELESS_NONCE_LENGTH) {
+    return false;
+  }
+
+  turn_time_t issued = 0;
+  for (size_t i = 0; i < 8; ++i) {
+    const uint8_t c = nonce[i];
+    int d = 0;
+    if (c >= '0' && c <= '9') {
+      d = c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      d = c - 'a' + 10;
+    } else {
+      return false;
+    }
+    issued = (issued << 4) | (turn_time_t)d;
+  }
+
+  const turn_time_t now = server->ctime;
+  if (turn_time_before(now + STATELESS_NONCE_CLOCK_SKEW, issued)) {
+    return false;
+  }
+  if (*(server->stale_nonce) && turn_time_before(issued + *(server->stale_nonce), now)) {
+    return false;
+  }
+  /* The key of its period must not have been rotated out */
+  if ((issued / STATELESS_NONCE_KEY_PERIOD) + 1 < (now / STATELESS_NONCE_KEY_PERIOD)) {
+    return false;
+  }
+
+  uint8_t mac[STATELESS_NONCE_MAC_SIZE];
+  if (!stateless_nonce_mac(server, ss, issued, mac)) {
+    return false;
+  }
+  char expected[STATELESS_NONCE_LENGTH + 1];
+  stateless_nonce_encode(issued, mac, expected);
+
+  uint8_t diff = 0;
+  for (size_t i = 8; i < STATELESS_NONCE_LENGTH; ++i) {
+    diff |= (uint8_t)(expected[i] ^ nonce[i]);
+  }
+
+  return diff == 0;
+}
+
 static int create_challenge_response(ts_ur_super_session *ss, stun_tid *tid, int *resp_constructed, int *err_code,
                                      const uint8_t **reason, ioa_network_buffer_handle nbh, uint16_t method) {
   size_t len = ioa_network_buffer_get_size(nbh);
-  const turn_turnserver *srv = (const turn_turnserver *)ss->server;
+  turn_turnserver *srv = (turn_turnserver *)ss->server;
   stun_init_error_response_str(method, ioa_network_buffer_data(nbh), &len, *err_code, *reason, tid,
                                srv ? srv->include_reason_string : false);
   *resp_constructed = 1;
-  stun_attr_add_str(ioa_network_buffer_data(nbh), &len, STUN_ATTRIBUTE_NONCE, ss->nonce, (int)(NONCE_MAX_SIZE - 1));
+  if (srv && srv->stateless_nonce) {
+    uint8_t nonce[STATELESS_NONCE_LENGTH + 1];
+    const size_t nonce_len = generate_stateless_nonce(srv, ss, nonce);
+    stun_attr_add_str(ioa_network_buffer_data(nbh), &len, STUN_ATTRIBUTE_NONCE, nonce, (int)nonce_len);
+  } else {
+    stun_attr_add_str(ioa_network_buffer_data(nbh), &len, STUN_ATTRIBUTE_NONCE, ss->nonce, (int)(NONCE_MAX_SIZE - 1));
+  }
   char *realm = ss->realm_options.name;
   stun_attr_add_str(ioa_network_buffer_data(nbh), &len, STUN_ATTRIBUTE_REALM, (uint8_t *)realm,
                     (int)(strlen((char *)(realm))));
@@ -3272,7 +3465,7 @@ static void resume_processing_after_username_check(int success, int oauth, int m
 }
 
 static int check_stun_auth(turn_turnserver *server, ts_ur_super_session *ss, stun_tid *tid, int *resp_constructed,
-                           int *err_code, const uint8_t **reason, ioa_net_data *in_buffer,
+                           int *err_code, const uint8_t **reason, ioa_net_data *in_buffer, const stun_attr_index *attrs,
                            ioa_network_buffer_handle nbh, uint16_t method, int *message_integrity, int *postpone_reply,
                            int can_resume) {
   uint8_t usname[STUN_MAX_USERNAME_SIZE + 1];
@@ -3286,7 +3479,7 @@ static int check_stun_auth(turn_turnserver *server, ts_ur_super_session *ss, stu
 
   int new_nonce = 0;
 
-  {
+  if (!(server->stateless_nonce)) {
     int generate_new_nonce = 0;
     if (ss->nonce[0] == 0) {
       generate_new_nonce = 1;
@@ -3322,9 +3515,7 @@ static int check_stun_auth(turn_turnserver *server, ts_ur_super_session *ss, stu
 
   /* MESSAGE_INTEGRITY ATTR: */
 
-  stun_attr_ref sar =
-      stun_attr_get_first_by_type_str(ioa_network_buffer_data(in_buffer->nbh),
-                                      ioa_network_buffer_get_size(in_buffer->nbh), STUN_ATTRIBUTE_MESSAGE_INTEGRITY);
+  stun_attr_ref sar = stun_attr_index_get(attrs, STUN_ATTRIBUTE_MESSAGE_INTEGRITY);
 
   if (!sar) {
     *err_code = 401;
@@ -3350,8 +3541,7 @@ static int check_stun_auth(turn_turnserver *server, ts_ur_super_session *ss, stu
 
     /* REALM ATTR: */
 
-    sar = stun_attr_get_first_by_type_str(ioa_network_buffer_data(in_buffer->nbh),
-                                          ioa_network_buffer_get_size(in_buffer->nbh), STUN_ATTRIBUTE_REALM);
+    sar = stun_attr_index_get(attrs, STUN_ATTRIBUTE_REALM);
 
     if (!sar) {
       *err_code = 400;
@@ -3392,8 +3582,7 @@ static int check_stun_auth(turn_turnserver *server, ts_ur_super_session *ss, stu
 
   /* USERNAME ATTR: */
 
-  sar = stun_attr_get_first_by_type_str(ioa_network_buffer_data(in_buffer->nbh),
-                                        ioa_network_buffer_get_size(in_buffer->nbh), STUN_ATTRIBUTE_USERNAME);
+  sar = stun_attr_index_get(attrs, STUN_ATTRIBUTE_USERNAME);
 
   if (!sar) {
     *err_code = 400;
@@ -3432,8 +3621,7 @@ static int check_stun_auth(turn_turnserver *server, ts_ur_super_session *ss, stu
   {
     /* NONCE ATTR: */
 
-    sar = stun_attr_get_first_by_type_str(ioa_network_buffer_data(in_buffer->nbh),
-                                          ioa_network_buffer_get_size(in_buffer->nbh), STUN_ATTRIBUTE_NONCE);
+    sar = stun_attr_index_get(attrs, STUN_ATTRIBUTE_NONCE);
 
     if (!sar) {
       *err_code = 400;
@@ -3446,13 +3634,17 @@ static int check_stun_auth(turn_turnserver *server, ts_ur_super_session *ss, stu
 
     /* Stale Nonce check: */
 
-    if (new_nonce) {
+    if (server->stateless_nonce) {
+      if (!check_stateless_nonce(server, ss, nonce, alen)) {
+        *err_code = 438;
+        *reason = (const uint8_t *)"Stale nonce";
+        return create_challenge_response(ss, tid, resp_constructed, err_code, reason, nbh, method);
+      }
+    } else if (new_nonce) {
       *err_code = 438;
       *reason = (const uint8_t *)"Wrong nonce";
       return create_challenge_response(ss, tid, resp_constructed, err_code, reason, nbh, method);
-    }
-
-    if (strcmp((char *)ss->nonce, (char *)nonce)) {
+    } else if (strcmp((char *)ss->nonce, (char *)nonce)) {
       *err_code = 438;
       *reason = (const uint8_t *)"Stale nonce";
       return create_challenge_response(ss, tid, resp_constructed, err_code, reason, nbh, method);
@@ -3476,9 +3668,8 @@ static int check_stun_auth(turn_turnserver *server, ts_ur_super_session *ss, stu
   }
 
   /* Check integrity */
-  if (stun_check_message_integrity_by_key_str(server->ct, ioa_network_buffer_data(in_buffer->nbh),
-                                              ioa_network_buffer_get_size(in_buffer->nbh), ss->hmackey, ss->pwd,
-                                              SHATYPE_DEFAULT) < 1) {
+  if (stun_check_message_integrity_by_index_str(server->ct, ioa_network_buffer_data(in_buffer->nbh), attrs,
+                                                ss->hmackey, ss->pwd, SHATYPE_DEFAULT) < 1) {
 
     if (can_resume) {
       (server->userkeycb)(server->id, server->ct, server->oauth, &(ss->oauth), usname, realm,
@@ -3541,7 +3732,8 @@ static void set_alternate_server(turn_server_addrs_list_t *asl, const ioa_addr *
 }
 
 static int handle_turn_command(turn_turnserver *server, ts_ur_super_session *ss, ioa_net_data *in_buffer,
-                               ioa_network_buffer_handle nbh, int *resp_constructed, int can_resume) {
+                               const stun_attr_index *attrs, ioa_network_buffer_handle nbh, int *resp_constructed,
+                               int can_resume) {
 
   stun_tid tid;
   int err_code = 0;
@@ -3557,6 +3749,7 @@ static int handle_turn_command(turn_turnserver *server, ts_ur_super_session *ss,
   uint16_t ua_num = 0;
   const uint16_t method =
       stun_get_method_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh));
+  uint64_t request_start = 0;
 
   *resp_constructed = 0;
 
@@ -3564,6 +3757,14 @@ static int handle_turn_command(turn_turnserver *server, ts_ur_super_session *ss,
 
   if (stun_is_request_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh))) {
 
+    /* A request resumed after the auth thread counts from its first arrival */
+    if (ss->postponed_request_start && stun_tid_equals(&(ss->postponed_request_tid), &tid)) {
+      request_start = ss->postponed_request_start;
+      ss->postponed_request_start = 0;
+    } else {
+      request_start = turn_time_us();
+    }
+
     if ((method == STUN_METHOD_BINDING) && (*(server->no_stun))) {
 
       no_response = 1;
@@ -3615,8 +3816,7 @@ static int handle_turn_command(turn_turnserver *server, ts_ur_super_session *ss,
 
       /* check that the realm is the same as in the original request */
       if (ss->origin_set) {
-        stun_attr_ref sar = stun_attr_get_first_str(ioa_network_buffer_data(in_buffer->nbh),
-                                                    ioa_network_buffer_get_size(in_buffer->nbh));
+        stun_attr_ref sar = stun_attr_index_first(attrs);
 
         int origin_found = 0;
         int norigins = 0;
@@ -3642,8 +3842,7 @@ static int handle_turn_command(turn_turnserver *server, ts_ur_super_session *ss,
               free(o);
             }
           }
-          sar = stun_attr_get_next_str(ioa_network_buffer_data(in_buffer->nbh),
-                                       ioa_network_buffer_get_size(in_buffer->nbh), sar);
+          sar = stun_attr_index_next(attrs, sar);
         }
 
         if (server->check_origin && *(server->check_origin)) {
@@ -3674,8 +3873,7 @@ static int handle_turn_command(turn_turnserver *server, ts_ur_super_session *ss,
       /* get the initial origin value */
       if (!err_code && !(ss->origin_set) && (method == STUN_METHOD_ALLOCATE)) {
 
-        stun_attr_ref sar = stun_attr_get_first_str(ioa_network_buffer_data(in_buffer->nbh),
-                                                    ioa_network_buffer_get_size(in_buffer->nbh));
+        stun_attr_ref sar = stun_attr_index_first(attrs);
 
         int origin_found = 0;
 
@@ -3698,8 +3896,7 @@ static int handle_turn_command(turn_turnserver *server, ts_ur_super_session *ss,
               origin_found = get_realm_options_by_origin(ss->origin, &(ss->realm_options));
             }
           }
-          sar = stun_attr_get_next_str(ioa_network_buffer_data(in_buffer->nbh),
-                                       ioa_network_buffer_get_size(in_buffer->nbh), sar);
+          sar = stun_attr_index_next(attrs, sar);
         }
 
         ss->origin_set = 1;
@@ -3711,10 +3908,13 @@ static int handle_turn_command(turn_turnserver *server, ts_ur_super_session *ss,
         } else if (!(*(server->mobility)) || (method != STUN_METHOD_REFRESH) ||
                    is_allocation_valid(get_allocation_ss(ss))) {
           int postpone_reply = 0;
-          check_stun_auth(server, ss, &tid, resp_constructed, &err_code, &reason, in_buffer, nbh, method,
+          check_stun_auth(server, ss, &tid, resp_constructed, &err_code, &reason, in_buffer, attrs, nbh, method,
                           &message_integrity, &postpone_reply, can_resume);
           if (postpone_reply) {
             no_response = 1;
+            stun_tid_cpy(&(ss->postponed_request_tid), &tid);
+            ss->postponed_request_start = request_start;
+            request_start = 0;
           }
         }
       }
@@ -3727,7 +3927,7 @@ static int handle_turn_command(turn_turnserver *server, ts_ur_super_session *ss,
       case STUN_METHOD_ALLOCATE:
 
       {
-        handle_turn_allocate(server, ss, &tid, resp_constructed, &err_code, &reason, unknown_attrs, &ua_num, in_buffer,
+        handle_turn_allocate(server, ss, &tid, resp_constructed, &err_code, &reason, unknown_attrs, &ua_num, attrs,
                              nbh);
 
         if (server->verbose) {
@@ -3739,7 +3939,7 @@ static int handle_turn_command(turn_turnserver *server, ts_ur_super_session *ss,
 
       case STUN_METHOD_CONNECT:
 
-        handle_turn_connect(server, ss, &tid, &err_code, &reason, unknown_attrs, &ua_num, in_buffer);
+        handle_turn_connect(server, ss, &tid, &err_code, &reason, unknown_attrs, &ua_num, in_buffer, attrs);
 
         if (server->verbose) {
           log_method(ss, "CONNECT", err_code, reason);
@@ -3754,7 +3954,7 @@ static int handle_turn_command(turn_turnserver *server, ts_ur_super_session *ss,
       case STUN_METHOD_CONNECTION_BIND:
 
         handle_turn_connection_bind(server, ss, &tid, resp_constructed, &err_code, &reason, unknown_attrs, &ua_num,
-                                    in_buffer, nbh, message_integrity, can_resume);
+                                    in_buffer, attrs, nbh, message_integrity, can_resume);
 
         if (server->verbose && err_code) {
           log_method(ss, "CONNECTION_BIND", err_code, reason);
@@ -3765,7 +3965,7 @@ static int handle_turn_command(turn_turnserver *server, ts_ur_super_session *ss,
       case STUN_METHOD_REFRESH:
 
         handle_turn_refresh(server, ss, &tid, resp_constructed, &err_code, &reason, unknown_attrs, &ua_num, in_buffer,
-                            nbh, message_integrity, &no_response, can_resume);
+                            attrs, nbh, message_integrity, &no_response, can_resume);
 
         if (server->verbose) {
           log_method(ss, "REFRESH", err_code, reason);
@@ -3775,7 +3975,7 @@ static int handle_turn_command(turn_turnserver *server, ts_ur_super_session *ss,
       case STUN_METHOD_CHANNEL_BIND:
 
         handle_turn_channel_bind(server, ss, &tid, resp_constructed, &err_code, &reason, unknown_attrs, &ua_num,
-                                 in_buffer, nbh);
+                                 in_buffer, attrs, nbh);
 
         if (server->verbose) {
           log_method(ss, "CHANNEL_BIND", err_code, reason);
@@ -3785,7 +3985,7 @@ static int handle_turn_command(turn_turnserver *server, ts_ur_super_session *ss,
       case STUN_METHOD_CREATE_PERMISSION:
 
         handle_turn_create_permission(server, ss, &tid, resp_constructed, &err_code, &reason, unknown_attrs, &ua_num,
-                                      in_buffer, nbh);
+                                      in_buffer, attrs, nbh);
 
         if (server->verbose) {
           log_method(ss, "CREATE_PERMISSION", err_code, reason);
@@ -3801,7 +4001,7 @@ static int handle_turn_command(turn_turnserver *server, ts_ur_super_session *ss,
         ioa_addr response_destination;
 
         handle_turn_binding(server, ss, &tid, resp_constructed, &err_code, &reason, unknown_attrs, &ua_num, in_buffer,
-                            nbh, &origin_changed, &response_origin, &dest_changed, &response_destination, 0, 0);
+                            attrs, nbh, &origin_changed, &response_origin, &dest_changed, &response_destination, 0, 0);
 
         if (server->verbose && *(server->log_binding)) {
           log_method(ss, "BINDING", err_code, reason);
@@ -3845,7 +4045,7 @@ static int handle_turn_command(turn_turnserver *server, ts_ur_super_session *ss,
 
       case STUN_METHOD_SEND:
 
-        handle_turn_send(server, ss, &err_code, &reason, unknown_attrs, &ua_num, in_buffer);
+        handle_turn_send(server, ss, &err_code, &reason, unknown_attrs, &ua_num, in_buffer, attrs);
 
         if (eve(server->verbose)) {
           log_method(ss, "SEND", err_code, reason);
@@ -3935,6 +4135,8 @@ static int handle_turn_command(turn_turnserver *server, ts_ur_super_session *ss,
     *resp_constructed = 0;
   }
 
+  turn_report_request_latency(method, request_start);
+
   return 0;
 }
 
@@ -3970,9 +4172,14 @@ static int handle_old_stun_command(turn_turnserver *server, ts_ur_super_session
       ioa_addr response_origin;
       int dest_changed = 0;
       ioa_addr response_destination;
+      stun_attr_index attrs;
+
+      stun_attr_index_build(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh),
+                            &attrs);
 
       handle_turn_binding(server, ss, &tid, resp_constructed, &err_code, &reason, unknown_attrs, &ua_num, in_buffer,
-                          nbh, &origin_changed, &response_origin, &dest_changed, &response_destination, cookie, 1);
+                          &attrs, nbh, &origin_changed, &response_origin, &dest_changed, &response_destination, cookie,
+                          1);
 
       if (server->verbose && *(server->log_binding)) {
         log_method(ss, "OLD BINDING", err_code, reason);
@@ -4132,6 +4339,7 @@ int shutdown_client_connection(turn_turnserver *server, ts_ur_super_session *ss,
 
   const SOCKET_TYPE socket_type = get_ioa_socket_type(ss->client_socket);
 
+  collect_kernel_channels_traffic(ss);
   turn_report_session_usage(ss, 1);
   dec_quota(ss);
   dec_bps(ss);
@@ -4508,12 +4716,15 @@ static int read_client_connection(turn_turnserver *server, ts_ur_super_session *
 
   uint16_t chnum = 0;
   uint32_t old_stun_cookie = 0;
+  stun_attr_index attrs;
 
   size_t blen = ioa_network_buffer_get_size(in_buffer->nbh);
   const size_t orig_blen = blen;
   const SOCKET_TYPE st = get_ioa_socket_type(ss->client_socket);
   const SOCKET_APP_TYPE sat = get_ioa_socket_app_type(ss->client_socket);
   const int is_padding_mandatory = is_stream_socket(st);
+  const TURN_PACKET_CLASS pclass =
+      turn_packet_classify_str(ioa_network_buffer_data(in_buffer->nbh), blen, is_padding_mandatory);
 
   if (sat == HTTP_CLIENT_SOCKET) {
 
@@ -4528,7 +4739,8 @@ static int read_client_connection(turn_turnserver *server, ts_ur_super_session *
 
     //???
 
-  } else if (stun_is_channel_message_str(ioa_network_buffer_data(in_buffer->nbh), &blen, &chnum,
+  } else if ((pclass == TURN_PACKET_CHANNEL_DATA) &&
+             stun_is_channel_message_str(ioa_network_buffer_data(in_buffer->nbh), &blen, &chnum,
                                          is_padding_mandatory)) {
 
     if (ss->is_tcp_relay) {
@@ -4551,9 +4763,11 @@ static int read_client_connection(turn_turnserver *server, ts_ur_super_session *
     FUNCEND;
     return 0;
 
-  } else if (stun_is_command_message_full_check_str(ioa_network_buffer_data(in_buffer->nbh),
-                                                    ioa_network_buffer_get_size(in_buffer->nbh), 0,
-                                                    &(ss->enforce_fingerprints))) {
+  } else if (((pclass == TURN_PACKET_STUN_REQUEST) || (pclass == TURN_PACKET_STUN_INDICATION) ||
+              (pclass == TURN_PACKET_STUN_RESPONSE)) &&
+             stun_attr_index_build(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh),
+                                   &attrs) &&
+             stun_is_command_message_full_check_index(&attrs, 0, &(ss->enforce_fingerprints))) {
 
     ioa_network_buffer_handle nbh = ioa_network_buffer_allocate(server->e);
     int resp_constructed = 0;
@@ -4561,7 +4775,7 @@ static int read_client_connection(turn_turnserver *server, ts_ur_super_session *
     const uint16_t method =
         stun_get_method_str(ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh));
 
-    handle_turn_command(server, ss, in_buffer, nbh, &resp_constructed, can_resume);
+    handle_turn_command(server, ss, in_buffer, &attrs, nbh, &resp_constructed, can_resume);
 
     if ((method != STUN_METHOD_BINDING) && (method != STUN_METHOD_SEND)) {
       report_turn_session_info(server, ss, 0);
@@ -4594,7 +4808,8 @@ static int read_client_connection(turn_turnserver *server, ts_ur_super_session *
       return 0;
     }
 
-  } else if (old_stun_is_command_message_str(ioa_network_buffer_data(in_buffer->nbh),
+  } else if ((pclass == TURN_PACKET_OLD_STUN) &&
+             old_stun_is_command_message_str(ioa_network_buffer_data(in_buffer->nbh),
                                              ioa_network_buffer_get_size(in_buffer->nbh), &old_stun_cookie) &&
              !(*(server->no_stun)) && !(*(server->stun_backward_compatibility))) {
 
@@ -4616,7 +4831,7 @@ static int read_client_connection(turn_turnserver *server, ts_ur_super_session *
   } else {
     const SOCKET_TYPE st = get_ioa_socket_type(ss->client_socket);
     if (is_stream_socket(st)) {
-      if (is_http((char *)ioa_network_buffer_data(in_buffer->nbh), ioa_network_buffer_get_size(in_buffer->nbh))) {
+      if (pclass == TURN_PACKET_HTTP) {
 
         const char *proto = st == TLS_SOCKET ? "HTTPS" : "HTTP";
 
@@ -4764,6 +4979,283 @@ int open_client_connection_session(turn_turnserver *server, struct socket_messag
   return ret;
 }
 
+/////////////// Live migration ///////////////////
+
+static void check_kernel_channel(ch_info *chn, void *arg) {
+  if (chn->kernel_channel) {
+    *((bool *)arg) = true;
+  }
+}
+
+static const char *get_session_migration_obstacle(ts_ur_super_session *ss) {
+  if (ss->to_be_closed || !(ss->client_socket) || ioa_socket_tobeclosed(ss->client_socket)) {
+    return "closing";
+  }
+  if (!is_allocation_valid(get_allocation_ss(ss))) {
+    return "not allocated";
+  }
+  if (get_ioa_socket_type(ss->client_socket) != UDP_SOCKET) {
+    return "not a UDP client";
+  }
+  if (ss->is_tcp_relay || ss->alloc.tcs.sz) {
+    return "TCP relay";
+  }
+  if (ss->is_mobile) {
+    return "mobile";
+  }
+  if (ss->postponed_request_start) {
+    return "authentication in progress";
+  }
+
+  bool kernel_channel = false;
+  allocation_foreach_channel(get_allocation_ss(ss), check_kernel_channel, &kernel_channel);
+  if (kernel_channel) {
+    return "kernel channels";
+  }
+
+  return NULL;
+}
+
+static int get_remaining_lifetime(turn_turnserver *server, turn_time_t expiration_time) {
+  return (expiration_time > server->ctime) ? (int)(expiration_time - server->ctime) : 1;
+}
+
+static void stop_permission_timer(turn_permission_info *tinfo, void *arg) {
+  UNUSED_ARG(arg);
+  IOA_EVENT_DEL(tinfo->lifetime_ev);
+}
+
+static void stop_channel_timer(ch_info *chn, void *arg) {
+  UNUSED_ARG(arg);
+  IOA_EVENT_DEL(chn->lifetime_ev);
+}
+
+static void start_permission_timer(turn_permission_info *tinfo, void *arg) {
+  ts_ur_super_session *ss = (ts_ur_super_session *)arg;
+  turn_turnserver *server = (turn_turnserver *)(ss->server);
+  tinfo->session_id = ss->id;
+  tinfo->lifetime_ev = set_ioa_timer(server->e, get_remaining_lifetime(server, tinfo->expiration_time), 0,
+                                     client_ss_perm_timeout_handler, tinfo, 0, "client_ss_perm_timeout_handler");
+}
+
+static void start_channel_timer(ch_info *chn, void *arg) {
+  ts_ur_super_session *ss = (ts_ur_super_session *)arg;
+  turn_turnserver *server = (turn_turnserver *)(ss->server);
+  chn->lifetime_ev = set_ioa_timer(server->e, get_remaining_lifetime(server, chn->expiration_time), 0,
+                                   client_ss_channel_timeout_handler, chn, 0, "client_ss_channel_timeout_handler");
+}
+
+ts_ur_super_session *turn_session_export(turn_turnserver *server, turnsession_id sid) {
+  ts_ur_super_session *ss = get_session_from_map(server, sid);
+  if (!ss) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_ERROR, "Session %018llu to migrate not found\n", (unsigned long long)sid);
+    return NULL;
+  }
+
+  const char *obstacle = get_session_migration_obstacle(ss);
+  if (obstacle) {
+    TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "Session %018llu cannot migrate: %s\n", (unsigned long long)sid, obstacle);
+    return NULL;
+  }
+
+  /* The client gets its own connected socket, the listener of this thread does not see it anymore */
+  ioa_socket_handle s = detach_ioa_socket(ss->client_socket);
+  if (!s) {
+    shutdown_client_connection(server, ss, 0, "Migration failure");
+    return NULL;
+  }
+  IOA_CLOSE_SOCKET(ss->client_socket);
+  ss->client_socket = s;
+  set_ioa_socket_session(s, ss);
+
+  allocation *a = get_allocation_ss(ss);
+  for (size_t i = 0; i < ALLOC_PROTOCOLS_NUMBER; ++i) {
+    IOA_EVENT_DEL(a->relay_sessions[i].lifetime_ev);
+    detach_socket_net_data(a->relay_sessions[i].s);
+  }
+  allocation_foreach_permission(a, stop_permission_timer, NULL);
+  allocation_foreach_channel(a, stop_channel_timer, NULL);
+  IOA_EVENT_DEL(ss->to_be_allocated_timeout_ev);
+
+  /* The old id is gone for the admin thread and the stats */
+  report_turn_session_info(server, ss, 1);
+  turn_report_session_migration(ss, 0);
+  delete_session_from_map(ss);
+
+  return ss;
+}
+
+int turn_session_import(turn_turnserver *server, ts_ur_super_session *ss) {
+  if (!server || !ss) {
+    return -1;
+  }
+
+  const turnsession_id old_id = ss->id;
+  const turn_time_t start_time = ss->start_time;
+
+  ss->server = server;
+  ss->id = 0;
+  put_session_into_map(ss);
+  ss->start_time = start_time;
+
+  allocation *a = get_allocation_ss(ss);
+  a->tcp_connections = server->tcp_relay_connections;
+
+  int ret = register_callback_on_ioa_socket(server->e, ss->client_socket, IOA_EV_READ, client_input_handler, ss, 0);
+
+  turn_time_t lifetime = 0;
+  for (size_t i = 0; i < ALLOC_PROTOCOLS_NUMBER; ++i) {
+    relay_endpoint_session *rsession = &(a->relay_sessions[i]);
+    if (rsession->s) {
+      if (register_callback_on_ioa_socket(server->e, rsession->s, IOA_EV_READ, peer_input_handler, ss, 0) < 0) {
+        ret = -1;
+      }
+      const int remaining = get_remaining_lifetime(server, rsession->expiration_time);
+      rsession->lifetime_ev = set_ioa_timer(server->e, remaining, 0, client_ss_allocation_timeout_handler, rsession, 0,
+                                            "client_ss_allocation_timeout_handler");
+      lifetime = (turn_time_t)remaining;
+    }
+  }
+  allocation_foreach_permission(a, start_permission_timer, ss);
+  allocation_foreach_channel(a, start_channel_timer, ss);
+
+  turn_report_session_migration(ss, 1);
+
+  if (ret < 0) {
+    shutdown_client_connection(server, ss, 0, "Migration failure");
+    return -1;
+  }
+
+  turn_report_allocation_set(a, lifetime, 1);
+  report_turn_session_info(server, ss, 0);
+
+  TURN_LOG_FUNC(TURN_LOG_LEVEL_INFO, "session %018llu: migrated, was session %018llu\n", (unsigned long long)ss->id,
+                (unsigned long long)old_id);
+
+  return 0;
+}
+
+struct migration_candidate {
+  turn_time_t ctime;
+  uint32_t max_pps;
+  uint64_t pps;
+  turnsession_id id;
+};
+
+static bool check_migration_candidate(ur_map_key_type key, ur_map_value_type value, void *arg) {
+  ts_ur_super_session *ss = (ts_ur_super_session *)value;
+  struct migration_candidate *mc = (struct migration_candidate *)arg;
+  if (ss && !get_session_migration_obstacle(ss)) {
+    /* Average rate of the packets the session brings to the thread, from both sides */
+    const uint64_t packets = ss->t_received_packets + ss->received_packets + ss->t_peer_received_packets +
+                             ss->peer_received_packets;
+    const uint64_t pps = packets / ((mc->ctime > ss->start_time) ? (mc->ctime - ss->start_time) : 1);
+    if ((pps <= mc->max_pps) && (!(mc->id) || (pps > mc->pps))) {
+      mc->id = (turnsession_id)key;
+      mc->pps = pps;
+    }
+  }
+  return false;
+}
+
+turnsession_id turn_session_migration_candidate(turn_turnserver *server, uint32_t max_pps) {
+  struct migration_candidate mc = {0, max_pps, 0, 0};
+  if (server) {
+    mc.ctime = server->ctime;
+    ur_map_foreach_arg(server->sessions_map, check_migration_candidate, &mc);
+  }
+  return mc.id;
+}
+
+/*
+ * Answers a plain Binding request from a transport address that has no
+ * session yet, without creating one. Only requests carrying nothing but
+ * SOFTWARE, FINGERPRINT, an empty CHANGE-REQUEST or comprehension-optional
+ * attributes qualify; everything else returns false and goes through the
+ * regular session processing.
+ */
+bool stateless_binding_response(turn_turnserver *server, ioa_network_buffer_handle in_nbh, const ioa_addr *local_addr,
+                                const ioa_addr *remote_addr, ioa_network_buffer_handle nbh) {
+  if (!server || !in_nbh || !nbh || !local_addr || !remote_addr) {
+    return false;
+  }
+
+  if (*(server->no_stun) || *(server->secure_stun)) {
+    return false;
+  }
+
+  const uint8_t *req = ioa_network_buffer_data(in_nbh);
+  const size_t req_len = ioa_network_buffer_get_size(in_nbh);
+
+  int fingerprint_present = 0;
+  if (!stun_is_command_message_full_check_str(req, req_len, 0, &fingerprint_present) ||
+      !stun_is_request_str(req, req_len) || (stun_get_method_str(req, req_len) != STUN_METHOD_BINDING)) {
+    return false;
+  }
+
+  stun_attr_ref sar = stun_attr_get_first_str(req, req_len);
+  while (sar) {
+    const int attr_type = stun_attr_get_type(sar);
+    switch (attr_type) {
+    case STUN_ATTRIBUTE_SOFTWARE:
+    case STUN_ATTRIBUTE_FINGERPRINT:
+      break;
+    case STUN_ATTRIBUTE_CHANGE_REQUEST: {
+      bool change_ip = false;
+      bool change_port = false;
+      stun_attr_get_change_request_str(sar, &change_ip, &change_port);
+      if (change_ip || change_port) {
+        return false;
+      }
+      break;
+    }
+    default:
+      if (attr_type >= 0x0000 && attr_type <= 0x7FFF) {
+        return false;
+      }
+    };
+    sar = stun_attr_get_next_str(req, req_len, sar);
+  }
+
+  stun_tid tid;
+  stun_tid_from_message_str(req, req_len, &tid);
+
+  stun_report_binding(NULL, STUN_PROMETHEUS_METRIC_TYPE_REQUEST);
+
+  size_t len = ioa_network_buffer_get_size(nbh);
+  if (!stun_set_binding_response_from_template_str(&(server->success_templates[STUN_METHOD_BINDING]),
+                                                   ioa_network_buffer_data(nbh), &len, &tid, remote_addr,
+                                                   *(server->stun_backward_compatibility)) &&
+      !stun_set_binding_response_str(ioa_network_buffer_data(nbh), &len, &tid, remote_addr, 0, NULL, 0, false,
+                                     *(server->stun_backward_compatibility), server->include_reason_string)) {
+    return false;
+  }
+
+  if (is_rfc5780(server)) {
+    ioa_addr response_origin;
+    ioa_addr other_address;
+    addr_cpy(&response_origin, local_addr);
+    if (server->alt_addr_cb(&response_origin, &other_address) == 0) {
+      stun_attr_add_addr_str(ioa_network_buffer_data(nbh), &len, STUN_ATTRIBUTE_RESPONSE_ORIGIN, &response_origin);
+      stun_attr_add_addr_str(ioa_network_buffer_data(nbh), &len, STUN_ATTRIBUTE_OTHER_ADDRESS, &other_address);
+    }
+  }
+
+  ioa_network_buffer_set_size(nbh, len);
+
+  maybe_add_software_attribute(server, nbh);
+
+  if (server->fingerprint || fingerprint_present) {
+    len = ioa_network_buffer_get_size(nbh);
+    if (!stun_attr_add_fingerprint_str(ioa_network_buffer_data(nbh), &len)) {
+      return false;
+    }
+    ioa_network_buffer_set_size(nbh, len);
+  }
+
+  return true;
+}
+
 /////////////// io handlers ///////////////////
 
 static void peer_input_handler(ioa_socket_handle s, int event_type, ioa_net_data *in_buffer, void *arg,
@@ -4985,6 +5477,11 @@ void init_turn_server(turn_turnserver *server, turnserver_id id, int verbose, io
   server->stun_only = stun_only;
   server->no_stun = no_stun;
   server->software_attribute = software_attribute;
+  for (uint16_t method = 0; method < STUN_RESPONSE_TEMPLATES_NUMBER; ++method) {
+    const char *software = software_attribute ? get_version(server) : NULL;
+    stun_response_template_init(&(server->success_templates[method]), method, (const uint8_t *)software,
+                                software ? strlen(software) : 0);
+  }
   server->web_admin_listen_on_workers = web_admin_listen_on_workers;
 
   server->dont_fragment = dont_fragment;
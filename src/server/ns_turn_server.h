@@ -71,7 +71,15 @@ extern int TURN_MAX_ALLOCATE_TIMEOUT_STUN_ONLY;
 
 typedef uint8_t turnserver_id;
 
-enum _MESSAGE_TO_RELAY_TYPE { RMT_UNKNOWN = 0, RMT_SOCKET, RMT_CB_SOCKET, RMT_MOBILE_SOCKET, RMT_CANCEL_SESSION };
+enum _MESSAGE_TO_RELAY_TYPE {
+  RMT_UNKNOWN = 0,
+  RMT_SOCKET,
+  RMT_CB_SOCKET,
+  RMT_MOBILE_SOCKET,
+  RMT_CANCEL_SESSION,
+  RMT_MIGRATE_SESSION,
+  RMT_ADOPT_SESSION
+};
 typedef enum _MESSAGE_TO_RELAY_TYPE MESSAGE_TO_RELAY_TYPE;
 
 ///////// ALLOCATION DEFAULT ADDRESS FAMILY TYPES /////////////////////
@@ -94,6 +102,22 @@ typedef enum {
   DONT_FRAGMENT_SUPPORT_EMULATED
 } dont_fragment_option_t;
 
+#define STUN_RESPONSE_TEMPLATES_NUMBER (STUN_METHOD_CONNECTION_BIND + 1)
+
+/*
+ * Stateless nonces are authenticated with keys derived from a secret for
+ * periods of this length; the keys of the current and previous periods
+ * are accepted.
+ */
+#define STATELESS_NONCE_SECRET_SIZE (32)
+#define STATELESS_NONCE_KEY_PERIOD (3600)
+
+typedef struct _stateless_nonce_key {
+  turn_time_t period;
+  int valid;
+  uint8_t key[SHA256SIZEBYTES];
+} stateless_nonce_key;
+
 struct _turn_turnserver;
 typedef struct _turn_turnserver turn_turnserver;
 
@@ -206,6 +230,14 @@ struct _turn_turnserver {
 
   /* Set to true on SIGUSR1 */
   bool is_draining;
+
+  /* Nonces carrying their issue time, authenticated instead of stored in the session */
+  bool stateless_nonce;
+  uint8_t nonce_secret[STATELESS_NONCE_SECRET_SIZE];
+  stateless_nonce_key nonce_keys[2];
+
+  /* Success responses, by method, with the SOFTWARE attribute already in place */
+  stun_response_template success_templates[STUN_RESPONSE_TEMPLATES_NUMBER];
 };
 
 const char *get_version(turn_turnserver *server);
@@ -232,6 +264,7 @@ ioa_engine_handle turn_server_get_engine(turn_turnserver *s);
 ////////// RFC 5780 ///////////////////////
 
 void set_rfc5780(turn_turnserver *server, get_alt_addr_cb cb, send_message_cb smcb);
+void set_stateless_nonce(turn_turnserver *server, const uint8_t *secret);
 
 ///////////////////////////////////////////
 
@@ -245,10 +278,27 @@ int turnserver_accept_tcp_client_data_connection(turn_turnserver *server, tcp_co
 
 int report_turn_session_info(turn_turnserver *server, ts_ur_super_session *ss, int force_invalid);
 
+bool stateless_binding_response(turn_turnserver *server, ioa_network_buffer_handle in_nbh, const ioa_addr *local_addr,
+                                const ioa_addr *remote_addr, ioa_network_buffer_handle nbh);
+
 turn_time_t get_turn_server_time(turn_turnserver *server);
 
 void turn_cancel_session(turn_turnserver *server, turnsession_id sid);
 
+/*
+ * Live migration of a session between relay servers. The export runs in
+ * the thread of the old server: it takes the session out of the server,
+ * with its client and relay sockets and timers stopped. The import runs in
+ * the thread of the new server, which gives the session a new id and
+ * restarts everything there. Only the allocated UDP sessions without TCP
+ * relays, mobility or kernel channels can move.
+ */
+ts_ur_super_session *turn_session_export(turn_turnserver *server, turnsession_id sid);
+int turn_session_import(turn_turnserver *server, ts_ur_super_session *ss);
+
+/* The movable session with the highest packet rate under max_pps, or 0 */
+turnsession_id turn_session_migration_candidate(turn_turnserver *server, uint32_t max_pps);
+
 ///////////////////////////////////////////
 
 #ifdef __cplusplus
@@ -69,6 +69,9 @@ typedef uint64_t turnsession_id;
 
 typedef uint64_t mobile_id_t;
 
+struct _session_stats_record;
+struct _shared_token_bucket;
+
 struct _ts_ur_super_session {
   void *server;
   turnsession_id id;
@@ -79,6 +82,9 @@ struct _ts_ur_super_session {
   int enforce_fingerprints;
   int is_tcp_relay;
   int to_be_closed;
+  /* request waiting for the auth thread, for its latency */
+  stun_tid postponed_request_tid;
+  uint64_t postponed_request_start;
   /* Auth */
   uint8_t nonce[NONCE_MAX_SIZE];
   turn_time_t nonce_expiration_time;
@@ -116,6 +122,8 @@ struct _ts_ur_super_session {
   uint64_t peer_received_rate;
   size_t peer_sent_rate;
   size_t peer_total_rate;
+  /* live counters shared with the admin thread */
+  struct _session_stats_record *stats;
   /* Mobile */
   int is_mobile;
   mobile_id_t mobile_id;
@@ -123,6 +131,9 @@ struct _ts_ur_super_session {
   char s_mobile_id[33];
   /* Bandwidth */
   band_limit_t bps;
+  /* read and write buckets of the realm, resolved once the allocation is valid */
+  struct _shared_token_bucket *realm_bps;
+  char realm_bps_name[STUN_MAX_REALM_SIZE + 1];
 };
 
 ////// Session info for statistics //////
@@ -165,6 +176,7 @@ struct turn_session_info {
   uint32_t peer_received_rate;
   uint32_t peer_sent_rate;
   uint32_t peer_total_rate;
+  struct _session_stats_record *stats;
   /* Mobile */
   int is_mobile;
   /* Peers */